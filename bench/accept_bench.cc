@@ -0,0 +1,158 @@
+/// \brief Accept benchmark. Opens connections to the plain TCP port of a
+/// running server as fast as possible and measures the accepted connections
+/// per second as well as the handshake latency, i.e. the time from starting
+/// the connect until the server's HandshakePacket has been received.
+///
+/// Usage: accept-bench <address> <tcpPort> <connections> <concurrency>
+/// <threads>
+///
+/// Run it once against a server started with "sharding.enabled" = false and
+/// once with "sharding.enabled" = true to get a before / after comparison.
+
+#include <boost/asio/connect.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace asio = boost::asio;
+using tcp = asio::ip::tcp;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+/// \brief A single connection loop. Connects, waits for the server handshake,
+/// closes and starts over until the shared budget is exhausted.
+class Client : public std::enable_shared_from_this<Client>
+{
+  private:
+    tcp::socket socket_;
+    tcp::endpoint endpoint_;
+    std::atomic<long>& budget_;
+    std::vector<double>& latencies_;
+    std::array<char, 1> header_{};
+    Clock::time_point start_;
+
+  public:
+    Client(asio::io_context& _io, tcp::endpoint _endpoint,
+           std::atomic<long>& _budget, std::vector<double>& _latencies)
+        : socket_(_io)
+        , endpoint_(std::move(_endpoint))
+        , budget_(_budget)
+        , latencies_(_latencies)
+    {
+    }
+
+    void run()
+    {
+        if (budget_.fetch_sub(1, std::memory_order_relaxed) <= 0) {
+            return;
+        }
+
+        start_ = Clock::now();
+        socket_.async_connect(endpoint_, [self = shared_from_this()](
+                                             auto const& ec) {
+            if (ec) {
+                fmt::print(stderr, "connect error: {}\n", ec.message());
+                return;
+            }
+            asio::async_read(self->socket_, asio::buffer(self->header_),
+                             [self](auto const& ec, std::size_t) {
+                                 self->onHandshake(ec);
+                             });
+        });
+    }
+
+    void onHandshake(boost::system::error_code const& _error)
+    {
+        if (_error) {
+            fmt::print(stderr, "read error: {}\n", _error.message());
+            return;
+        }
+
+        latencies_.push_back(
+            std::chrono::duration<double, std::micro>(Clock::now() - start_)
+                .count());
+
+        boost::system::error_code ec;
+        socket_.close(ec);
+        run();
+    }
+};
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc != 6) {
+        fmt::print(stderr,
+                   "Usage: {} <address> <tcpPort> <connections> "
+                   "<concurrency> <threads>\nExample: {} 127.0.0.1 9090 "
+                   "100000 256 4\n",
+                   argv[0], argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    tcp::endpoint const endpoint{asio::ip::make_address(argv[1]),
+                                 static_cast<unsigned short>(
+                                     std::atoi(argv[2]))};
+    auto const connections = std::atol(argv[3]);
+    auto const concurrency = std::atoi(argv[4]);
+    auto const threads = std::max(1, std::atoi(argv[5]));
+
+    std::atomic<long> budget{connections};
+    std::vector<std::vector<double>> latencies(threads);
+    std::vector<std::unique_ptr<asio::io_context>> contexts;
+    for (auto i = 0; i < threads; ++i) {
+        contexts.emplace_back(std::make_unique<asio::io_context>(1));
+        latencies[i].reserve(connections / threads + 1);
+        for (auto j = i; j < concurrency; j += threads) {
+            std::make_shared<Client>(*contexts[i], endpoint, budget,
+                                     latencies[i])
+                ->run();
+        }
+    }
+
+    auto const start = Clock::now();
+    std::vector<std::thread> workers;
+    for (auto i = 0; i < threads; ++i) {
+        workers.emplace_back([&io = *contexts[i]] { io.run(); });
+    }
+    for (auto& t : workers) {
+        t.join();
+    }
+    auto const elapsed =
+        std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<double> all;
+    for (auto const& l : latencies) {
+        all.insert(all.end(), l.begin(), l.end());
+    }
+    if (all.empty()) {
+        fmt::print(stderr, "No connection completed.\n");
+        return EXIT_FAILURE;
+    }
+    std::sort(all.begin(), all.end());
+
+    auto const percentile = [&all](double _p) {
+        auto const idx = static_cast<std::size_t>(_p * (all.size() - 1));
+        return all[idx];
+    };
+
+    fmt::print("connections: {}\n", all.size());
+    fmt::print("accepted conn/s: {:.0f}\n", all.size() / elapsed);
+    fmt::print("handshake latency p50: {:.1f} us\n", percentile(0.50));
+    fmt::print("handshake latency p99: {:.1f} us\n", percentile(0.99));
+    fmt::print("handshake latency max: {:.1f} us\n", all.back());
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,173 @@
+/// \brief Notification batching benchmark. A steady stream of notifications
+/// of three stations is queued on a single PlainWebSocketSession, which
+/// writes them to a client over loopback, once for every flush window. The
+/// client reads on its own thread. Reports the WebSocket messages written and
+/// the CPU time of the session's thread per notification, which includes
+/// producing the notifications.
+///
+/// Usage: batch-bench [notifications per second] [seconds]
+
+#include "websocket_server/PlainWebSocketSession.hh"
+#include "websocket_server/SharedState.hh"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+#include <boost/beast/core/tcp_stream.hpp>
+#include <boost/beast/http/read.hpp>
+#include <boost/beast/http/string_body.hpp>
+#include <boost/beast/websocket/stream.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <thread>
+
+using namespace amadeus;
+
+namespace {
+/// The interval in which notifications are produced.
+auto constexpr Tick = std::chrono::milliseconds{1};
+
+/// \brief Returns the CPU time of the calling thread in seconds.
+double threadSeconds()
+{
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<double>(ts.tv_sec) +
+           static_cast<double>(ts.tv_nsec) / 1e9;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::size_t const rate =
+        argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20'000U;
+    std::size_t const seconds =
+        argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2U;
+    auto const perTick = std::max<std::size_t>(rate / 1000U, 1U);
+    auto const ticks = seconds * 1000U;
+
+    Logger::instance().severity(LoggerSeverity::Off);
+
+    auto state = std::make_shared<SharedState>(
+        "", JSON::object(), std::chrono::milliseconds{0}, std::size_t{0},
+        ReadingStoreOptions{}, StreamConfig{});
+    auto& metrics = state->metrics();
+
+    asio::io_context ioc;
+    asio::io_context clientIoc;
+    asio::ip::tcp::acceptor acceptor{
+        ioc, {asio::ip::make_address("127.0.0.1"), 0}};
+
+    websocket::stream<beast::tcp_stream> client{clientIoc};
+    client.next_layer().connect(acceptor.local_endpoint());
+    beast::tcp_stream server{acceptor.accept()};
+
+    // the client reads everything on its own thread
+    std::atomic<bool> connected{false};
+    beast::flat_buffer buffer;
+    std::function<void()> read;
+    read = [&] {
+        client.async_read(buffer,
+                          [&](beast::error_code const& _ec, std::size_t) {
+                              if (_ec) {
+                                  return;
+                              }
+                              buffer.consume(buffer.size());
+                              read();
+                          });
+    };
+    client.async_handshake("127.0.0.1", "/",
+                           [&](beast::error_code const& _ec) {
+                               if (_ec) {
+                                   std::exit(EXIT_FAILURE);
+                               }
+                               connected = true;
+                               read();
+                           });
+    std::thread reader{[&clientIoc] { clientIoc.run(); }};
+
+    // upgrade the connection like the HttpSession does
+    std::shared_ptr<PlainWebSocketSession> session;
+    beast::flat_buffer upgrade;
+    http::request<http::string_body> request;
+    http::async_read(server, upgrade, request,
+                     [&](beast::error_code const& _ec, std::size_t) {
+                         if (_ec) {
+                             std::exit(EXIT_FAILURE);
+                         }
+                         session = std::make_shared<PlainWebSocketSession>(
+                             std::move(server), state);
+                         session->run(std::move(request));
+                     });
+    while (!connected) {
+        ioc.run_one_for(std::chrono::milliseconds{10});
+    }
+    ioc.poll();
+
+    std::array<SharedMessage, 3> notifications;
+    for (std::size_t i = 0; i < notifications.size(); ++i) {
+        notifications[i] = encodeWeatherStatus(WeatherStatusNotification{
+            static_cast<StationId>(i), 21.5F, 43.25F, 1'600'000'000U});
+    }
+
+    fmt::print("{:>10} {:>14} {:>10} {:>16}\n", "window[ms]", "notifications",
+               "messages", "cpu/notif. [µs]");
+
+    for (auto const window : {0, 10, 50, 100}) {
+        session->flushWindow(std::chrono::milliseconds{window});
+
+        auto const written =
+            metrics.wsMessagesWritten.load(std::memory_order_relaxed);
+        auto const start = threadSeconds();
+
+        // produce perTick notifications every tick
+        asio::steady_timer timer{ioc};
+        std::size_t tick{0};
+        std::size_t produced{0};
+        std::function<void()> produce;
+        produce = [&] {
+            for (std::size_t i = 0; i < perTick; ++i, ++produced) {
+                session->onNotification(
+                    notifications[produced % notifications.size()],
+                    static_cast<StationId>(produced % notifications.size()));
+            }
+            if (++tick == ticks) {
+                return;
+            }
+            timer.expires_at(timer.expiry() + Tick);
+            timer.async_wait([&](beast::error_code const&) { produce(); });
+        };
+        timer.expires_after(Tick);
+        timer.async_wait([&](beast::error_code const&) { produce(); });
+
+        ioc.restart();
+        while (tick < ticks && ioc.run_one() > 0) {
+        }
+        // write the last batch and wait until everything was written
+        session->flushWindow(std::chrono::milliseconds{0});
+        while (metrics.wsQueuedMessages.load(std::memory_order_relaxed) > 0 &&
+               ioc.run_one() > 0) {
+        }
+
+        auto const cpu = threadSeconds() - start;
+        auto const messages =
+            metrics.wsMessagesWritten.load(std::memory_order_relaxed) -
+            written;
+        fmt::print("{:>10} {:>14} {:>10} {:>16.2f}\n", window, produced,
+                   messages, cpu * 1e6 / static_cast<double>(produced));
+    }
+
+    clientIoc.stop();
+    reader.join();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,149 @@
+/// \brief Compressed block benchmark. Encodes the readings of a station
+/// reporting once a minute into compressed blocks and reports the size on
+/// disk compared to raw segments as well as the encode and decode
+/// throughput, for a full scan and for one-hour range queries.
+/// Two series are measured, both with the 0.1 resolution of a typical
+/// sensor: "diurnal" follows a daily cycle with slowly drifting weather, so
+/// consecutive readings often repeat; "noisy" is a random walk which changes
+/// almost every reading and is close to the worst case of XOR compression.
+///
+/// Usage: compression-bench [readings]
+
+#include "websocket_server/CompressedBlock.hh"
+#include "websocket_server/ReadingStore.hh"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+
+using Clock = std::chrono::steady_clock;
+using namespace amadeus;
+
+namespace {
+/// The reporting interval of the simulated station.
+constexpr std::uint32_t Interval{60};
+
+/// \brief Rounds to the resolution of the sensor.
+float quantize(double _value)
+{
+    return static_cast<float>(std::round(_value * 10) / 10);
+}
+
+/// \brief Generates _count readings.
+/// \param _noisy Whether to generate a random walk instead of a daily cycle.
+HistorySamples generate(std::size_t _count, bool _noisy)
+{
+    constexpr double Pi{3.14159265358979323846};
+    std::mt19937 rng{42};
+    std::normal_distribution<double> step{0.0, _noisy ? 0.05 : 0.002};
+    std::bernoulli_distribution jitter{0.02};
+
+    HistorySamples samples;
+    samples.times.reserve(_count);
+    samples.temperatures.reserve(_count);
+    samples.humidities.reserve(_count);
+
+    std::uint32_t time{1'609'459'200};
+    double weather{0.0};
+    double temperature{20.0};
+    double humidity{45.0};
+    for (std::size_t i = 0; i < _count; ++i) {
+        // the clock of the station is not perfectly regular
+        time += Interval + (jitter(rng) ? 1U : 0U);
+        weather += step(rng);
+        if (_noisy) {
+            temperature += step(rng);
+            humidity = std::clamp(humidity + 2 * step(rng), 0.0, 100.0);
+        } else {
+            auto const day = std::sin(2 * Pi * (time % 86'400) / 86'400);
+            temperature = 15.0 + 5.0 * day + weather;
+            humidity = std::clamp(60.0 - 15.0 * day + 3 * weather, 0.0, 100.0);
+        }
+        samples.times.push_back(time);
+        samples.temperatures.push_back(quantize(temperature));
+        samples.humidities.push_back(quantize(humidity));
+    }
+    return samples;
+}
+
+double seconds(Clock::time_point _start)
+{
+    return std::chrono::duration<double>(Clock::now() - _start).count();
+}
+
+
+/// \brief Runs the benchmark for one series.
+/// \returns Whether the decoded samples match.
+bool run(std::size_t _readings, bool _noisy)
+{
+    auto const readings = _readings;
+    auto const samples = generate(readings, _noisy);
+
+    auto start = Clock::now();
+    auto const block = CompressedBlock::encode(samples);
+    auto const encodeTime = seconds(start);
+
+    auto const raw = readings * ReadingStore::RecordSize;
+    fmt::print("{}:\n", _noisy ? "noisy" : "diurnal");
+    fmt::print("readings:        {}\n", readings);
+    fmt::print("raw segment:     {} bytes ({} bytes/reading)\n", raw,
+               ReadingStore::RecordSize);
+    fmt::print("compressed:      {} bytes ({:.2f} bits/reading)\n",
+               block.size(), 8.0 * block.size() / readings);
+    fmt::print("ratio:           {:.1f}x\n",
+               static_cast<double>(raw) / block.size());
+    fmt::print("encode:          {:.1f} M readings/s\n",
+               readings / encodeTime / 1e6);
+
+    CompressedBlock const view{block.data(), block.size(), true};
+
+    // full scan
+    HistorySamples decoded;
+    decoded.times.reserve(readings);
+    decoded.temperatures.reserve(readings);
+    decoded.humidities.reserve(readings);
+    start = Clock::now();
+    view.decode(0, ~0U, decoded);
+    auto const decodeTime = seconds(start);
+
+    auto const equal = decoded.times == samples.times &&
+                       decoded.temperatures == samples.temperatures &&
+                       decoded.humidities == samples.humidities;
+    fmt::print("decode (scan):   {:.1f} M readings/s{}\n",
+               readings / decodeTime / 1e6, equal ? "" : " MISMATCH");
+
+    // one hour windows at random positions
+    constexpr std::size_t Queries{10'000};
+    std::mt19937 rng{7};
+    std::uniform_int_distribution<std::size_t> position{0, readings - 1};
+    std::size_t found{0};
+    start = Clock::now();
+    for (std::size_t i = 0; i < Queries; ++i) {
+        HistorySamples window;
+        auto const from = samples.times[position(rng)];
+        view.decode(from, from + 3600, window);
+        found += window.times.size();
+    }
+    auto const queryTime = seconds(start);
+    fmt::print("decode (1h):     {:.2f} us/query, {} readings/query\n",
+               queryTime / Queries * 1e6, found / Queries);
+
+    return equal;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::size_t const readings =
+        argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1'000'000;
+
+    auto const diurnal = run(readings, false);
+    fmt::print("\n");
+    auto const noisy = run(readings, true);
+
+    return diurnal && noisy ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,216 @@
+/// \brief µc ingest benchmark. Feeds a stream of WeatherStatusPackets and of
+/// WeatherStatusBatchPackets with 1, 16 and 256 readings through the
+/// TCPRequestHandler of a stand-in session, so that every reading takes the
+/// same path as on the server: packet dispatch, decoding, station cache,
+/// history, reading store and the fan-out to a single subscriber. Reports
+/// the ingested readings per second of CPU time of the ingesting thread.
+///
+/// Usage: ingest-bench [readings] [store directory]
+///
+/// Without a store directory the reading store is disabled.
+
+#include "websocket_server/PlainTCPSession.hh"
+#include "websocket_server/SharedState.hh"
+#include "websocket_server/TCPRequestHandler.hh"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/uuid/random_generator.hpp>
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <vector>
+
+using namespace amadeus;
+namespace fs = std::filesystem;
+
+namespace {
+/// \brief Stands in for a TCPSession. Packets written to the µc are
+/// discarded. The derived session is only used to join the station and to
+/// arm the ping timer, which never runs.
+class BenchSession
+{
+  public:
+    BenchSession(asio::io_context& _ioc, std::shared_ptr<SharedState> _state)
+        : state_(_state)
+        , derived_(std::make_shared<PlainTCPSession>(
+              _ioc, asio::ip::tcp::socket(_ioc), std::move(_state)))
+    {
+    }
+
+    PlainTCPSession& derived() noexcept
+    {
+        return *derived_;
+    }
+
+    SharedState& sharedState() noexcept
+    {
+        return *state_;
+    }
+
+    StationId stationId() const noexcept
+    {
+        return stationId_;
+    }
+
+    void stationId(StationId _id) noexcept
+    {
+        stationId_ = _id;
+    }
+
+    template <typename Packet, typename CompletionHandler>
+    bool writePacket(Packet const&, CompletionHandler&&)
+    {
+        return true;
+    }
+
+  private:
+    std::shared_ptr<SharedState> state_;
+    std::shared_ptr<PlainTCPSession> derived_;
+    StationId stationId_{};
+};
+
+/// \brief Returns the CPU time of the calling thread in seconds.
+double threadSeconds()
+{
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<double>(ts.tv_sec) +
+           static_cast<double>(ts.tv_nsec) / 1e9;
+}
+
+/// \brief Encodes _readings readings as WeatherStatusPackets.
+std::vector<std::uint8_t> singlePackets(std::size_t _readings)
+{
+    auto constexpr Size = wireSize<in::WeatherStatusPacket>;
+    std::vector<std::uint8_t> stream(_readings * Size);
+    for (std::size_t i = 0; i < _readings; ++i) {
+        in::WeatherStatusPacket packet{};
+        packet.header =
+            static_cast<std::uint8_t>(in::PacketType::WeatherStatus);
+        packet.temperature = 20.0F + static_cast<float>(i % 100) / 10.0F;
+        packet.humidity = 40.0F + static_cast<float>(i % 200) / 10.0F;
+        packet.time = 1'600'000'000U + static_cast<std::uint32_t>(i);
+        encode(packet, stream.data() + i * Size);
+    }
+    return stream;
+}
+
+/// \brief Encodes _readings readings as WeatherStatusBatchPackets of _batch
+/// readings each.
+std::vector<std::uint8_t> batchPackets(std::size_t _readings,
+                                       std::size_t _batch)
+{
+    auto const packets = _readings / _batch;
+    std::vector<std::uint8_t> stream(packets * in::batchPacketSize(_batch));
+    auto* out = stream.data();
+    for (std::size_t p = 0; p < packets; ++p) {
+        in::WeatherStatusBatchPacket packet{};
+        packet.header =
+            static_cast<std::uint8_t>(in::PacketType::WeatherStatusBatch);
+        packet.count = static_cast<std::uint16_t>(_batch);
+        encode(packet, out);
+        out += wireSize<in::WeatherStatusBatchPacket>;
+        for (std::size_t r = 0; r < _batch; ++r) {
+            auto const i = p * _batch + r;
+            in::WeatherReading reading{};
+            reading.temperature = 20.0F + static_cast<float>(i % 100) / 10.0F;
+            reading.humidity = 40.0F + static_cast<float>(i % 200) / 10.0F;
+            reading.time = 1'600'000'000U + static_cast<std::uint32_t>(i);
+            encode(reading, out);
+            out += wireSize<in::WeatherReading>;
+        }
+    }
+    return stream;
+}
+
+/// \brief Feeds the stream through the handler and returns the ingested
+/// readings per second of thread CPU time.
+double run(TCPRequestHandler<BenchSession>& _handler,
+           std::vector<std::uint8_t> const& _stream, std::size_t _readings)
+{
+    auto const start = threadSeconds();
+    std::size_t offset{0};
+    while (offset < _stream.size()) {
+        auto const id = static_cast<in::PacketType>(_stream[offset]);
+        auto const [status, parsed] = _handler.handle(
+            id, asio::const_buffer(_stream.data() + offset,
+                                   _stream.size() - offset));
+        if (status != ResultType::Good) {
+            fmt::print(stderr, "unexpected parse result at {}\n", offset);
+            std::exit(EXIT_FAILURE);
+        }
+        offset += parsed;
+    }
+    return static_cast<double>(_readings) / (threadSeconds() - start);
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::size_t const readings =
+        argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1U << 20U;
+
+    Logger::instance().severity(LoggerSeverity::Off);
+
+    ReadingStoreOptions options;
+    if (argc > 2) {
+        options.directory = argv[2];
+        options.fsync = FsyncPolicy::Never;
+        options.queueCapacity = readings;
+        fs::remove_all(options.directory);
+    }
+
+    auto const config = JSON::parse(
+        R"({"uuids": [{"uuid": "a851173e-8264-4b35-80e2-80017112cc9d"}]})");
+    auto state = std::make_shared<SharedState>(
+        "", config, std::chrono::milliseconds{1000}, std::size_t{1} << 20U,
+        options, StreamConfig{});
+    if (state->readingStore().enabled()) {
+        state->readingStore().start();
+    }
+
+    asio::io_context ioc;
+    BenchSession session{ioc, state};
+    TCPRequestHandler<BenchSession> handler{ioc, session};
+
+    in::HandshakePacket handshake{};
+    handshake.header = static_cast<std::uint8_t>(in::PacketType::Handshake);
+    handshake.uuid = {0xa8, 0x51, 0x17, 0x3e, 0x82, 0x64, 0x4b, 0x35,
+                      0x80, 0xe2, 0x80, 0x01, 0x71, 0x12, 0xcc, 0x9d};
+    handshake.stationId = StationId::Goe;
+    EncodedPacket<in::HandshakePacket> encoded;
+    encode(handshake, encoded.data());
+    handler.handle(in::PacketType::Handshake, asio::buffer(encoded));
+
+    std::size_t delivered{0};
+    state->subscribe(
+        StationId::Goe, boost::uuids::random_generator()(),
+        [&delivered](SharedMessage const&, std::optional<StationId>) {
+            ++delivered;
+        });
+
+    fmt::print("{:<24} {:>16} {:>12}\n", "packets", "readings/s/core",
+               "published");
+
+    auto const report = [&](char const* _name, auto const& _stream) {
+        delivered = 0;
+        auto const rate = run(handler, _stream, readings);
+        fmt::print("{:<24} {:>16.0f} {:>12}\n", _name, rate, delivered);
+    };
+
+    report("WeatherStatus", singlePackets(readings));
+    for (auto const batch : {1U, 16U, 256U}) {
+        report(fmt::format("WeatherStatusBatch {}", batch).c_str(),
+               batchPackets(readings, batch));
+    }
+
+    state->readingStore().stop();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,209 @@
+/// \brief Logger benchmark. Several threads call LOG_INFO with a typical
+/// packet log message as fast as they can and measure the time spent per
+/// call, once with every overflow policy of the asynchronous logger, once
+/// with the binary log and once with a synchronous logger which formats,
+/// writes and flushes the file on the calling thread like the logger used
+/// to. The console sink is disabled, all messages go to the log file.
+/// "ns/call" is the wall time of all calls divided by their number, i.e. the
+/// inverse throughput of all threads together. The percentiles are taken from
+/// individually timed calls and include the cost of reading the clock.
+///
+/// Usage: log-bench <logfile> [threads] [messagesPerThread]
+
+#include "websocket_server/Logger.hh"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+using namespace amadeus;
+
+namespace {
+/// Every n-th call is timed individually for the percentiles.
+constexpr std::size_t SampleInterval{16};
+
+/// \brief The result of a single run.
+struct Result
+{
+    double mean;
+    double p50;
+    double p99;
+};
+
+/// \brief The synchronous baseline.
+class SyncLogger
+{
+  public:
+    explicit SyncLogger(std::string const& _filename)
+        : file_(_filename)
+    {
+    }
+
+    template <typename... Args>
+    void log(source_location const& _loc, char const* _fmt, Args&&... _args)
+    {
+        auto const message = fmt::format(_fmt, std::forward<Args>(_args)...);
+        auto const line =
+            fmt::format("[{}] [INFO] {} {}:{} {}",
+                        Clock::now().time_since_epoch().count(),
+                        _loc.function_name(), _loc.file_name(), _loc.line(),
+                        message);
+        std::scoped_lock<std::mutex> lk(mtx_);
+        file_ << line;
+        file_.flush();
+    }
+
+  private:
+    std::mutex mtx_;
+    std::ofstream file_;
+};
+
+/// \brief Runs _threads threads calling _log _messages times each.
+template <typename Log>
+Result run(std::size_t _threads, std::size_t _messages, Log&& _log)
+{
+    std::vector<std::vector<double>> samples(_threads);
+    std::vector<std::thread> threads;
+
+    auto const start = Clock::now();
+    for (std::size_t t = 0; t < _threads; ++t) {
+        threads.emplace_back([&, t] {
+            auto& own = samples[t];
+            own.reserve(_messages / SampleInterval + 1);
+            for (std::size_t i = 0; i < _messages; ++i) {
+                if (i % SampleInterval == 0) {
+                    auto const before = Clock::now();
+                    _log(t, i);
+                    own.push_back(
+                        std::chrono::duration<double, std::nano>(
+                            Clock::now() - before)
+                            .count());
+                } else {
+                    _log(t, i);
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    auto const wall =
+        std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+    std::vector<double> all;
+    for (auto const& s : samples) {
+        all.insert(std::end(all), std::begin(s), std::end(s));
+    }
+    std::sort(std::begin(all), std::end(all));
+    return Result{wall / static_cast<double>(_threads * _messages),
+                  all[all.size() / 2], all[all.size() * 99 / 100]};
+}
+
+void print(char const* _name, Result const& _result, std::uint64_t _dropped)
+{
+    fmt::print("{:<14} {:>10.1f} {:>10.1f} {:>10.1f} {:>12}\n", _name,
+               _result.mean, _result.p50, _result.p99, _dropped);
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        fmt::print(stderr, "Usage: log-bench <logfile> [threads] "
+                           "[messagesPerThread]\n");
+        return EXIT_FAILURE;
+    }
+
+    std::string const filename{argv[1]};
+    std::size_t const threads =
+        argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 16;
+    std::size_t const messages =
+        argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 100'000;
+
+    fmt::print("{} threads, {} messages per thread\n", threads, messages);
+    fmt::print("{:<14} {:>10} {:>10} {:>10} {:>12}\n", "logger", "ns/call",
+               "p50 ns", "p99 ns", "dropped");
+
+    auto& logger = Logger::instance();
+    logger.console(false);
+    logger.open(std::string(filename));
+
+    for (auto const policy : {LogOverflowPolicy::Block, LogOverflowPolicy::Drop,
+                              LogOverflowPolicy::Count}) {
+        logger.overflow(policy);
+        auto const dropped = logger.dropped();
+        auto const result = run(threads, messages, [](std::size_t _thread,
+                                                      std::size_t _i) {
+            LOG_INFO("Packet of size {} received from station {} ({}).\n",
+                     _i % 64, _thread, "Pong");
+        });
+        logger.flush();
+        print(policy == LogOverflowPolicy::Block  ? "async block"
+              : policy == LogOverflowPolicy::Drop ? "async drop"
+                                                  : "async count",
+              result, logger.dropped() - dropped);
+    }
+
+    // deferred formatting, the text log file is no longer written
+    logger.binary(filename + ".bin");
+    for (auto const policy :
+         {LogOverflowPolicy::Block, LogOverflowPolicy::Count}) {
+        logger.overflow(policy);
+        auto const dropped = logger.dropped();
+        auto const result = run(threads, messages, [](std::size_t _thread,
+                                                      std::size_t _i) {
+            LOG_INFO("Packet of size {} received from station {} ({}).\n",
+                     _i % 64, _thread, "Pong");
+        });
+        logger.flush();
+        print(policy == LogOverflowPolicy::Block ? "binary block"
+                                                 : "binary count",
+              result, logger.dropped() - dropped);
+    }
+
+    // a single thread in bursts which fit into its buffer, i.e. the cost of
+    // a call on the hot path without waiting for the sink thread
+    constexpr std::size_t Burst{8192};
+    double burst{0};
+    for (std::size_t done = 0; done < messages; done += Burst) {
+        auto const begin = Clock::now();
+        for (std::size_t i = 0; i < Burst; ++i) {
+            LOG_INFO("Packet of size {} received from station {} ({}).\n",
+                     i % 64, done, "Pong");
+        }
+        burst += std::chrono::duration<double, std::nano>(Clock::now() - begin)
+                     .count();
+        logger.flush();
+    }
+    fmt::print("{:<14} {:>10.1f}\n", "binary burst",
+               burst / static_cast<double>((messages + Burst - 1) / Burst *
+                                           Burst));
+
+    // the floor of a binary log call
+    auto const start = Clock::now();
+    for (std::size_t i = 0; i < messages; ++i) {
+        details::binaryLogTicks();
+    }
+    fmt::print("{:<14} {:>10.1f}\n", "timestamp",
+               std::chrono::duration<double, std::nano>(Clock::now() - start)
+                       .count() /
+                   static_cast<double>(messages));
+
+    SyncLogger sync{filename + ".sync"};
+    auto const result =
+        run(threads, messages, [&sync](std::size_t _thread, std::size_t _i) {
+            sync.log(source_location::current(),
+                     "Packet of size {} received from station {} ({}).\n",
+                     _i % 64, _thread, "Pong");
+        });
+    print("sync", result, 0);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,182 @@
+/// \brief TCP input parse benchmark. Simulates reads of 1, 10 and 100
+/// WeatherStatusPackets each and parses them, once with the flat input
+/// buffer which is compacted with std::memmove after every packet (as the
+/// TCPSession used to) and once with the ring buffer. The reads are not
+/// aligned to packets, so a partial packet is always left over and packets
+/// wrap around the ring buffer. The handler only does the size check of
+/// TCPRequestHandler::handle, so the numbers are the cost of the buffer
+/// management alone.
+///
+/// Usage: parse-bench [packets]
+
+#include "websocket_server/Packets/In.hh"
+#include "websocket_server/RequestHandler.hh"
+#include "websocket_server/utils/ring_buffer.hh"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <tuple>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+using namespace amadeus;
+
+namespace {
+/// The size of the input buffer of a TCPSession.
+constexpr std::size_t InputSize{4096};
+
+/// \brief Stands in for TCPRequestHandler::handle.
+HandlerReturnType handle(in::PacketType _id, BufferView const _view) noexcept
+{
+    auto const expectedSize = in::sizeByPacketId(_id);
+    if (expectedSize == 0) {
+        return std::make_pair(ResultType::Bad, 0);
+    }
+    if (_view.size() < expectedSize) {
+        return std::make_pair(ResultType::Indeterminate, 0);
+    }
+    return std::make_pair(ResultType::Good, expectedSize);
+}
+
+/// \brief The flat input buffer compacted after every packet.
+class FlatInput
+{
+  public:
+    /// \brief Appends the bytes of a read.
+    void read(char const* _data, std::size_t _size) noexcept
+    {
+        std::memcpy(input_.data() + numBytesLeft_, _data, _size);
+        numBytesLeft_ += _size;
+    }
+
+    /// \brief Parses all complete packets, returns the number of packets.
+    std::size_t parse() noexcept
+    {
+        std::size_t packets{0};
+        while (numBytesLeft_) {
+            auto const id = static_cast<in::PacketType>(*input_.begin());
+            auto const view{
+                boost::asio::const_buffer(input_.data(), numBytesLeft_)};
+            auto const [status, bytesParsed] = handle(id, view);
+            std::memmove(input_.data(), input_.data() + bytesParsed,
+                         numBytesLeft_ - bytesParsed);
+            numBytesLeft_ -= bytesParsed;
+            if (status != ResultType::Good) {
+                break;
+            }
+            ++packets;
+        }
+        return packets;
+    }
+
+  private:
+    std::array<char, InputSize> input_{};
+    std::size_t numBytesLeft_{};
+};
+
+/// \brief The ring buffer, parsed like TCPSession::parsePacketHeader.
+class RingInput
+{
+  public:
+    /// \brief Scatters the bytes of a read into the free regions.
+    void read(char const* _data, std::size_t _size) noexcept
+    {
+        auto const regions = input_.prepare();
+        auto const first = std::min(_size, regions[0].size());
+        std::memcpy(regions[0].data(), _data, first);
+        if (first < _size) {
+            std::memcpy(regions[1].data(), _data + first, _size - first);
+        }
+        input_.commit(_size);
+    }
+
+    /// \brief Parses all complete packets, returns the number of packets.
+    std::size_t parse() noexcept
+    {
+        std::size_t packets{0};
+        while (!input_.empty()) {
+            auto const id = static_cast<in::PacketType>(input_.front());
+            auto view = input_.data()[0];
+            auto [status, bytesParsed] = handle(id, view);
+            if (status == ResultType::Indeterminate &&
+                view.size() < input_.size()) {
+                view = input_.linearize(
+                    std::min(input_.size(), staging_.size()), staging_.data());
+                std::tie(status, bytesParsed) = handle(id, view);
+            }
+            input_.consume(bytesParsed);
+            if (status != ResultType::Good) {
+                break;
+            }
+            ++packets;
+        }
+        return packets;
+    }
+
+  private:
+    ring_buffer<InputSize> input_;
+    std::array<char, std::max(in::batchPacketSize(in::MaxBatchReadings),
+                              in::backfillPacketSize(in::MaxBackfillReadings))>
+        staging_{};
+};
+
+/// The number of bytes of a packet which are read ahead.
+constexpr std::size_t ReadAhead{wireSize<in::WeatherStatusPacket> / 2};
+
+/// \brief Feeds _packets packets in reads of _perRead packets and returns
+/// the parsed packets per second.
+/// \param _read The bytes of a single read: _perRead packets, shifted by
+/// \ref ReadAhead bytes.
+template <typename Input>
+double run(std::vector<char> const& _read, std::size_t _perRead,
+           std::size_t _packets)
+{
+    Input input;
+    input.read(_read.data(), ReadAhead);
+    std::size_t parsed{0};
+    auto const start = Clock::now();
+    for (std::size_t i = 0; i < _packets; i += _perRead) {
+        input.read(_read.data() + ReadAhead, _read.size() - ReadAhead);
+        parsed += input.parse();
+    }
+    auto const seconds =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    if (parsed < _packets) {
+        fmt::print(stderr, "parsed only {} of {} packets\n", parsed,
+                   _packets);
+        std::exit(EXIT_FAILURE);
+    }
+    return static_cast<double>(parsed) / seconds;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::size_t const packets =
+        argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10'000'000;
+
+    fmt::print("{:<18} {:>16} {:>16}\n", "packets per read", "memmove [1/s]",
+               "ring buffer [1/s]");
+
+    for (std::size_t const perRead : {1U, 10U, 100U}) {
+        in::WeatherStatusPacket packet{};
+        packet.header =
+            static_cast<std::uint8_t>(in::PacketType::WeatherStatus);
+        auto constexpr Size = wireSize<in::WeatherStatusPacket>;
+        std::vector<char> read((perRead + 1) * Size);
+        for (std::size_t i = 0; i <= perRead; ++i) {
+            encode(packet, read.data() + i * Size);
+        }
+
+        auto const flat = run<FlatInput>(read, perRead, packets);
+        auto const ring = run<RingInput>(read, perRead, packets);
+        fmt::print("{:<18} {:>16.0f} {:>16.0f}\n", perRead, flat, ring);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,203 @@
+/// \brief Registry contention benchmark. Runs a read-mostly workload (lookups
+/// of single and of three session ids at once, plus 1% leave/join) against
+/// one std::mutex guarded std::unordered_map (the old SharedState) and
+/// against the sharded_map used by SharedState, with 1, 8 and 32 threads.
+///
+/// Usage: registry-bench [opsPerThread]
+
+#include "websocket_server/utils/sharded_map.hh"
+#include "websocket_server/utils/uuid_hash.hh"
+
+#include <boost/functional/hash.hpp>
+#include <boost/uuid/uuid.hpp>
+#include <boost/uuid/uuid_generators.hpp>
+
+#include <fmt/format.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+using Key = boost::uuids::uuid;
+using Value = std::weak_ptr<int>;
+using namespace amadeus;
+
+namespace {
+/// The number of registered sessions.
+constexpr std::size_t Sessions{1024};
+/// Every Nth operation is a leave followed by a join.
+constexpr std::size_t WriteEvery{100};
+
+/// \brief The registry before: one mutex for everything.
+class MutexRegistry
+{
+    std::mutex mtx_;
+    std::unordered_map<Key, Value, boost::hash<Key>> map_;
+
+  public:
+    void join(Key const& _key, Value _value)
+    {
+        std::scoped_lock<std::mutex> lk(mtx_);
+        map_.try_emplace(_key, std::move(_value));
+    }
+
+    void leave(Key const& _key)
+    {
+        std::scoped_lock<std::mutex> lk(mtx_);
+        map_.erase(_key);
+    }
+
+    bool find(Key const& _key)
+    {
+        Value wp;
+        {
+            std::scoped_lock<std::mutex> lk(mtx_);
+            if (auto const it = map_.find(_key); it != std::end(map_)) {
+                wp = it->second;
+            }
+        }
+        return wp.lock() != nullptr;
+    }
+
+    std::size_t findMany(std::array<Key, 3> const& _keys)
+    {
+        std::array<Value, 3> wps;
+        {
+            std::scoped_lock<std::mutex> lk(mtx_);
+            for (std::size_t i = 0; i < _keys.size(); ++i) {
+                if (auto const it = map_.find(_keys[i]); it != std::end(map_)) {
+                    wps[i] = it->second;
+                }
+            }
+        }
+        std::size_t found{};
+        for (auto const& wp : wps) {
+            found += wp.lock() != nullptr;
+        }
+        return found;
+    }
+};
+
+/// \brief The registry after: per-shard reader-writer locks.
+class ShardedRegistry
+{
+    sharded_map<Key, Value, uuid_hash> map_;
+
+  public:
+    void join(Key const& _key, Value _value)
+    {
+        map_.try_emplace(_key, std::move(_value));
+    }
+
+    void leave(Key const& _key)
+    {
+        map_.erase(_key);
+    }
+
+    bool find(Key const& _key)
+    {
+        Value wp;
+        map_.visit(_key, [&](Value const& _wp) { wp = _wp; });
+        return wp.lock() != nullptr;
+    }
+
+    std::size_t findMany(std::array<Key, 3> const& _keys)
+    {
+        std::array<Value, 3> wps;
+        map_.visit_many(std::begin(_keys), std::end(_keys),
+                        [&](std::size_t _index, Value const& _wp) {
+                            wps[_index] = _wp;
+                        });
+        std::size_t found{};
+        for (auto const& wp : wps) {
+            found += wp.lock() != nullptr;
+        }
+        return found;
+    }
+};
+
+/// \brief Runs the workload and returns the throughput in Mops/s.
+template <typename Registry>
+double run(std::size_t _threads, std::size_t _ops, std::vector<Key> const& _keys,
+           std::vector<std::shared_ptr<int>> const& _values)
+{
+    Registry registry;
+    for (std::size_t i = 0; i < _keys.size(); ++i) {
+        registry.join(_keys[i], _values[i]);
+    }
+
+    std::atomic<bool> go{false};
+    std::atomic<std::size_t> sink{};
+    std::vector<std::thread> threads;
+    threads.reserve(_threads);
+
+    for (std::size_t t = 0; t < _threads; ++t) {
+        threads.emplace_back([&, t] {
+            std::mt19937 rng{static_cast<std::mt19937::result_type>(t)};
+            std::uniform_int_distribution<std::size_t> dist{0,
+                                                            _keys.size() - 1};
+            std::size_t found{};
+
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+
+            for (std::size_t i = 0; i < _ops; ++i) {
+                auto const k = dist(rng);
+                if (i % WriteEvery == 0) {
+                    registry.leave(_keys[k]);
+                    registry.join(_keys[k], _values[k]);
+                } else if (i % 2 == 0) {
+                    found += registry.find(_keys[k]);
+                } else {
+                    found += registry.findMany(
+                        {_keys[k], _keys[dist(rng)], _keys[dist(rng)]});
+                }
+            }
+            sink += found;
+        });
+    }
+
+    auto const start = Clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& t : threads) {
+        t.join();
+    }
+    auto const elapsed =
+        std::chrono::duration<double>(Clock::now() - start).count();
+
+    return static_cast<double>(_threads * _ops) / elapsed / 1e6;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::size_t const ops =
+        argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1'000'000;
+
+    boost::uuids::random_generator gen;
+    std::vector<Key> keys(Sessions);
+    std::vector<std::shared_ptr<int>> values(Sessions);
+    for (std::size_t i = 0; i < Sessions; ++i) {
+        keys[i] = gen();
+        values[i] = std::make_shared<int>(static_cast<int>(i));
+    }
+
+    fmt::print("{:>8} {:>16} {:>16}\n", "threads", "mutex Mops/s",
+               "sharded Mops/s");
+    for (std::size_t const threads : {1, 8, 32}) {
+        auto const mutex = run<MutexRegistry>(threads, ops, keys, values);
+        auto const sharded = run<ShardedRegistry>(threads, ops, keys, values);
+        fmt::print("{:>8} {:>16.2f} {:>16.2f}\n", threads, mutex, sharded);
+    }
+
+    return EXIT_SUCCESS;
+}
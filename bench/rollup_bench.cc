@@ -0,0 +1,137 @@
+/// \brief Rollup benchmark. Feeds a year of readings of a station reporting
+/// once a minute into the rollups and reports the cost per reading. Then
+/// compares answering a one-year chart from the rollups in every resolution
+/// with aggregating the raw samples of the year on every request.
+///
+/// Usage: rollup-bench <directory> [years]
+
+#include "websocket_server/StationHistory.hh"
+#include "websocket_server/StationRollups.hh"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+
+using Clock = std::chrono::steady_clock;
+using namespace amadeus;
+namespace fs = std::filesystem;
+
+namespace {
+/// The readings per publish, like a batch of the writer thread.
+constexpr std::size_t Batch{4096};
+/// The number of timed queries per resolution.
+constexpr std::size_t Queries{1000};
+
+double seconds(Clock::time_point _start)
+{
+    return std::chrono::duration<double>(Clock::now() - _start).count();
+}
+
+/// \brief Aggregates the raw samples of every day, the work the rollups
+/// save.
+std::vector<RollupBucket> aggregate(HistorySamples const& _samples)
+{
+    std::vector<RollupBucket> days;
+    for (std::size_t i = 0; i < _samples.times.size(); ++i) {
+        auto const start = _samples.times[i] - _samples.times[i] % 86400;
+        auto const t = _samples.temperatures[i];
+        auto const h = _samples.humidities[i];
+        if (days.empty() || days.back().start != start) {
+            days.push_back(RollupBucket{start, 0, t, t, 0, h, h, 0});
+        }
+        auto& day = days.back();
+        day.minTemperature = std::min(day.minTemperature, t);
+        day.maxTemperature = std::max(day.maxTemperature, t);
+        day.avgTemperature += t;
+        day.minHumidity = std::min(day.minHumidity, h);
+        day.maxHumidity = std::max(day.maxHumidity, h);
+        day.avgHumidity += h;
+        ++day.count;
+    }
+    for (auto& day : days) {
+        day.avgTemperature /= static_cast<float>(day.count);
+        day.avgHumidity /= static_cast<float>(day.count);
+    }
+    return days;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        fmt::print(stderr, "Usage: rollup-bench <directory> [years]\n");
+        return EXIT_FAILURE;
+    }
+
+    fs::path const directory{argv[1]};
+    std::size_t const years = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1;
+    fs::remove_all(directory);
+    fs::create_directories(directory);
+
+    // a year of readings, once a minute
+    HistorySamples samples;
+    std::mt19937 rng{42};
+    std::normal_distribution<float> step{0.0f, 0.05f};
+    std::uint32_t const first{1'609'459'200};
+    auto const readings = years * 365 * 24 * 60;
+    float temperature{15.0f};
+    float humidity{60.0f};
+    for (std::size_t i = 0; i < readings; ++i) {
+        temperature += step(rng);
+        humidity = std::clamp(humidity + step(rng), 0.0f, 100.0f);
+        samples.times.push_back(first + static_cast<std::uint32_t>(i) * 60);
+        samples.temperatures.push_back(temperature);
+        samples.humidities.push_back(humidity);
+    }
+
+    Metrics metrics;
+    StationRollups rollups{{}, metrics};
+    rollups.open(StationId::Goe, directory);
+
+    auto start = Clock::now();
+    for (std::size_t i = 0; i < readings; ++i) {
+        rollups.add(StationId::Goe, samples.times[i], samples.temperatures[i],
+                    samples.humidities[i]);
+        if ((i + 1) % Batch == 0) {
+            rollups.publish(StationId::Goe);
+        }
+    }
+    rollups.publish(StationId::Goe);
+    auto const ingest = seconds(start);
+
+    fmt::print("readings:         {}\n", readings);
+    fmt::print("ingest:           {:.1f} ns/reading (incl. rollup files)\n",
+               ingest / readings * 1e9);
+    fmt::print("buckets written:  {}\n", metrics.storeRollupBuckets.load());
+
+    auto const last = samples.times.back();
+    for (std::size_t i = 0; i < RollupLevels; ++i) {
+        auto const level = static_cast<RollupLevel>(i);
+        std::size_t buckets{0};
+        start = Clock::now();
+        for (std::size_t q = 0; q < Queries; ++q) {
+            buckets += rollups.query(StationId::Goe, level, first, last).size();
+        }
+        fmt::print("query {:<7}     {:.2f} us ({} buckets)\n",
+                   rollupName(level), seconds(start) / Queries * 1e6,
+                   buckets / Queries);
+    }
+
+    // the same chart computed from the raw samples
+    std::size_t days{0};
+    start = Clock::now();
+    constexpr std::size_t RawQueries{10};
+    for (std::size_t q = 0; q < RawQueries; ++q) {
+        days += aggregate(samples).size();
+    }
+    fmt::print("raw scan (day)    {:.2f} us ({} buckets)\n",
+               seconds(start) / RawQueries * 1e6, days / RawQueries);
+
+    rollups.close();
+    fs::remove_all(directory);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,197 @@
+/// \brief Packet decode benchmark. Decodes a stream of WeatherStatusPackets
+/// and the readings of WeatherStatusBatchPackets, once through a
+/// reinterpret_cast to a packed struct (as the TCPRequestHandler used to) and
+/// once with the packet schema. Also compares looking up the size of a packet
+/// through a switch with the generated packet table.
+///
+/// Usage: schema-bench [packets]
+
+#include "websocket_server/Packets/In.hh"
+
+#include <fmt/format.h>
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+using namespace amadeus;
+
+namespace {
+#pragma pack(push, 1)
+/// \brief The packed WeatherStatusPacket decoded by reinterpret_cast.
+struct PackedWeatherStatusPacket
+{
+    std::uint8_t header;
+    std::array<std::uint8_t, 16> uuid;
+    float temperature;
+    float humidity;
+    std::uint32_t time;
+    WebSocketSessionFlag flag;
+    std::uint32_t requestId;
+};
+
+/// \brief The packed WeatherReading decoded by reinterpret_cast.
+struct PackedWeatherReading
+{
+    float temperature;
+    float humidity;
+    std::uint32_t time;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(PackedWeatherStatusPacket) ==
+              wireSize<in::WeatherStatusPacket>);
+static_assert(sizeof(PackedWeatherReading) == wireSize<in::WeatherReading>);
+
+/// \brief The size lookup of the TCPRequestHandler before the packet table.
+std::size_t sizeBySwitch(in::PacketType _id) noexcept
+{
+    switch (_id) {
+    case in::PacketType::Handshake:
+        return wireSize<in::HandshakePacket>;
+    case in::PacketType::Pong:
+        return wireSize<in::PongPacket>;
+    case in::PacketType::WeatherStatus:
+        return wireSize<in::WeatherStatusPacket>;
+    case in::PacketType::WeatherStatusBatch:
+        return wireSize<in::WeatherStatusBatchPacket>;
+    case in::PacketType::Backfill:
+        return wireSize<in::BackfillPacket>;
+    default:
+        break;
+    }
+    return 0;
+}
+
+/// \brief Sums up the bits of the fields, so that the decoding is not
+/// optimized away.
+struct Sum
+{
+    std::uint64_t value{0};
+
+    void add(float _temperature, float _humidity, std::uint32_t _time,
+             std::uint8_t _last) noexcept
+    {
+        std::uint32_t temperature;
+        std::uint32_t humidity;
+        std::memcpy(&temperature, &_temperature, sizeof(temperature));
+        std::memcpy(&humidity, &_humidity, sizeof(humidity));
+        value += std::uint64_t{temperature} + humidity + _time + _last;
+    }
+};
+
+/// \brief Runs _f and returns the processed items per second.
+template <typename F>
+double rate(std::size_t _items, F&& _f)
+{
+    auto const start = Clock::now();
+    _f();
+    auto const seconds =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    return static_cast<double>(_items) / seconds;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::size_t const packets =
+        argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1U << 22U;
+
+    // a stream of packets which starts at an odd address, like the packets
+    // in the input buffer of a TCPSession
+    auto constexpr Size = wireSize<in::WeatherStatusPacket>;
+    std::vector<std::uint8_t> stream(packets * Size + 1);
+    for (std::size_t i = 0; i < packets; ++i) {
+        in::WeatherStatusPacket packet{};
+        packet.header =
+            static_cast<std::uint8_t>(in::PacketType::WeatherStatus);
+        packet.temperature = 20.0F + static_cast<float>(i % 100) / 10.0F;
+        packet.humidity = 40.0F + static_cast<float>(i % 200) / 10.0F;
+        packet.time = 1'600'000'000U + static_cast<std::uint32_t>(i);
+        encode(packet, stream.data() + 1 + i * Size);
+    }
+    auto const* packetData = stream.data() + 1;
+
+    fmt::print("{:<26} {:>18} {:>18}\n", "", "reinterpret_cast [1/s]",
+               "schema [1/s]");
+
+    Sum a;
+    Sum b;
+    auto const castPackets = rate(packets, [&] {
+        for (std::size_t i = 0; i < packets; ++i) {
+            auto const* packet =
+                reinterpret_cast<PackedWeatherStatusPacket const*>(
+                    packetData + i * Size);
+            a.add(packet->temperature, packet->humidity, packet->time,
+                  packet->uuid[15]);
+        }
+    });
+    auto const schemaPackets = rate(packets, [&] {
+        for (std::size_t i = 0; i < packets; ++i) {
+            auto const packet =
+                decode<in::WeatherStatusPacket>(packetData + i * Size);
+            b.add(packet.temperature, packet.humidity, packet.time,
+                  packet.uuid[15]);
+        }
+    });
+    fmt::print("{:<26} {:>18.0f} {:>18.0f}\n", "WeatherStatusPacket",
+               castPackets, schemaPackets);
+
+    // the readings of batches, decoded into columns
+    auto constexpr ReadingSize = wireSize<in::WeatherReading>;
+    auto const readings = packets * Size / ReadingSize;
+    std::vector<std::uint32_t> times(in::MaxBatchReadings);
+    std::vector<float> temperatures(in::MaxBatchReadings);
+    std::vector<float> humidities(in::MaxBatchReadings);
+    auto const batches = readings / in::MaxBatchReadings;
+    auto const batchSize = in::MaxBatchReadings * ReadingSize;
+
+    auto const castReadings = rate(batches * in::MaxBatchReadings, [&] {
+        for (std::size_t i = 0; i < batches; ++i) {
+            auto const* batch = reinterpret_cast<PackedWeatherReading const*>(
+                packetData + i * batchSize);
+            for (std::size_t r = 0; r < in::MaxBatchReadings; ++r) {
+                temperatures[r] = batch[r].temperature;
+                humidities[r] = batch[r].humidity;
+                times[r] = batch[r].time;
+            }
+            a.add(temperatures.back(), humidities.back(), times.back(), 0);
+        }
+    });
+    auto const schemaReadings = rate(batches * in::MaxBatchReadings, [&] {
+        for (std::size_t i = 0; i < batches; ++i) {
+            in::decodeReadings(packetData + i * batchSize,
+                               in::MaxBatchReadings, times.data(),
+                               temperatures.data(), humidities.data());
+            b.add(temperatures.back(), humidities.back(), times.back(), 0);
+        }
+    });
+    fmt::print("{:<26} {:>18.0f} {:>18.0f}\n", "WeatherReading (batch)",
+               castReadings, schemaReadings);
+
+    // the size lookups of the packet ids in the stream
+    std::size_t x{0};
+    std::size_t y{0};
+    auto const switchLookups = rate(packets * Size, [&] {
+        for (std::size_t i = 0; i < packets * Size; ++i) {
+            x += sizeBySwitch(static_cast<in::PacketType>(packetData[i] & 7));
+        }
+    });
+    auto const tableLookups = rate(packets * Size, [&] {
+        for (std::size_t i = 0; i < packets * Size; ++i) {
+            y += in::sizeByPacketId(
+                static_cast<in::PacketType>(packetData[i] & 7));
+        }
+    });
+    fmt::print("{:<26} {:>18.0f} {:>18.0f}\n", "size lookup (switch/table)",
+               switchLookups, tableLookups);
+
+    if (a.value != b.value || x != y) {
+        fmt::print(stderr, "results differ\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
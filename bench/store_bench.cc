@@ -0,0 +1,122 @@
+/// \brief Reading store ingest benchmark. Several producer threads (standing
+/// in for the I/O threads) append readings of all stations as fast as the
+/// queue accepts them, while the writer thread persists them. Reports the
+/// ingest throughput in readings/s, the number of batches and the number of
+/// fsync calls for every fsync policy.
+///
+/// Usage: store-bench <directory> [readings] [producers]
+
+#include "websocket_server/ReadingStore.hh"
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+using namespace amadeus;
+namespace fs = std::filesystem;
+
+namespace {
+/// \brief A single benchmark configuration.
+struct Run
+{
+    char const* name;
+    FsyncPolicy fsync;
+    std::chrono::milliseconds interval;
+};
+
+/// \brief Ingests _readings readings and returns the throughput.
+double run(fs::path const& _directory, Run const& _run, std::size_t _readings,
+           std::size_t _producers, Metrics& _metrics)
+{
+    fs::remove_all(_directory);
+
+    ReadingStoreOptions options;
+    options.directory = _directory;
+    options.fsync = _run.fsync;
+    options.fsyncInterval = _run.interval;
+
+    ReadingStore store{options, _metrics};
+    store.start();
+
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+    threads.reserve(_producers);
+
+    auto const perProducer = _readings / _producers;
+    for (std::size_t p = 0; p < _producers; ++p) {
+        threads.emplace_back([&, p] {
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+
+            WeatherStatusNotification reading{};
+            for (std::size_t i = 0; i < perProducer; ++i) {
+                reading.id = static_cast<StationId>(
+                    (p + i) % static_cast<std::size_t>(StationId::Max));
+                reading.temperature = static_cast<float>(i % 40);
+                reading.humidity = static_cast<float>(i % 100);
+                reading.time = static_cast<std::uint32_t>(i);
+                // retry instead of dropping to measure the writer
+                while (!store.append(reading)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    auto const start = Clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& t : threads) {
+        t.join();
+    }
+    // drains the queue and syncs the remaining readings
+    store.stop();
+    auto const elapsed =
+        std::chrono::duration<double>(Clock::now() - start).count();
+
+    return static_cast<double>(perProducer * _producers) / elapsed;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        fmt::print(stderr, "Usage: {} <directory> [readings] [producers]\n",
+                   argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    fs::path const directory{argv[1]};
+    std::size_t const readings =
+        argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1'000'000;
+    std::size_t const producers =
+        argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 4;
+
+    Run const runs[] = {
+        {"never", FsyncPolicy::Never, std::chrono::milliseconds{0}},
+        {"interval 100ms", FsyncPolicy::Interval,
+         std::chrono::milliseconds{100}},
+        {"interval 10ms", FsyncPolicy::Interval, std::chrono::milliseconds{10}},
+        {"batch", FsyncPolicy::Batch, std::chrono::milliseconds{0}},
+    };
+
+    fmt::print("{:>16} {:>14} {:>10} {:>10}\n", "fsync", "readings/s",
+               "batches", "fsyncs");
+    for (auto const& r : runs) {
+        Metrics metrics;
+        auto const throughput =
+            run(directory / "store-bench", r, readings, producers, metrics);
+        fmt::print("{:>16} {:>14.0f} {:>10} {:>10}\n", r.name, throughput,
+                   metrics.storeBatches.load(), metrics.storeFsyncs.load());
+    }
+
+    fs::remove_all(directory / "store-bench");
+
+    return EXIT_SUCCESS;
+}
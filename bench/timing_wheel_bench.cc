@@ -0,0 +1,119 @@
+/// \brief Timer benchmark. Arms and cancels 1M timers, once with one
+/// asio::steady_timer per timer (as the sessions used to) and once on the
+/// hierarchical timing wheel. Also measures how long it takes to expire 1M
+/// timers on the wheel.
+///
+/// Usage: timing-wheel-bench [timers]
+
+#include "websocket_server/utils/timing_wheel.hh"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace asio = boost::asio;
+using Clock = std::chrono::steady_clock;
+using namespace amadeus;
+
+namespace {
+/// \brief A timer on the wheel.
+struct Timer : timing_wheel::hook
+{
+    std::size_t fired{};
+};
+
+/// \brief Returns the elapsed nanoseconds per operation.
+double nsPerOp(Clock::time_point _start, std::size_t _ops)
+{
+    return std::chrono::duration<double, std::nano>(Clock::now() - _start)
+               .count() /
+           static_cast<double>(_ops);
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::size_t const count =
+        argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1'000'000;
+
+    // Delays between 10s and 60s at 100ms resolution, just like the ping,
+    // pong, idle and read timeouts.
+    std::mt19937 rng{42};
+    std::uniform_int_distribution<std::uint64_t> dist{100, 600};
+    std::vector<std::uint64_t> delays(count);
+    for (auto& d : delays) {
+        d = dist(rng);
+    }
+
+    {
+        asio::io_context io{1};
+        std::vector<std::unique_ptr<asio::steady_timer>> timers;
+        timers.reserve(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            timers.emplace_back(std::make_unique<asio::steady_timer>(io));
+        }
+
+        auto start = Clock::now();
+        for (std::size_t i = 0; i < count; ++i) {
+            timers[i]->expires_after(std::chrono::milliseconds(delays[i] * 100));
+            timers[i]->async_wait([](auto&&) {});
+        }
+        auto const arm = nsPerOp(start, count);
+
+        start = Clock::now();
+        for (auto& t : timers) {
+            t->cancel();
+        }
+        io.run();
+        auto const cancel = nsPerOp(start, count);
+
+        fmt::print("asio::steady_timer: arm {:.1f} ns/op, cancel {:.1f} ns/op\n",
+                   arm, cancel);
+    }
+
+    {
+        timing_wheel wheel;
+        std::vector<Timer> timers(count);
+
+        auto start = Clock::now();
+        for (std::size_t i = 0; i < count; ++i) {
+            wheel.schedule(timers[i], delays[i]);
+        }
+        auto const arm = nsPerOp(start, count);
+
+        start = Clock::now();
+        for (auto& t : timers) {
+            wheel.cancel(t);
+        }
+        auto const cancel = nsPerOp(start, count);
+
+        fmt::print("timing_wheel:       arm {:.1f} ns/op, cancel {:.1f} ns/op\n",
+                   arm, cancel);
+
+        for (std::size_t i = 0; i < count; ++i) {
+            wheel.schedule(timers[i], delays[i]);
+        }
+        start = Clock::now();
+        auto const expired =
+            wheel.advance(wheel.now() + 600, [](timing_wheel::hook& _hook) {
+                ++static_cast<Timer&>(_hook).fired;
+            });
+        auto const expire = nsPerOp(start, expired);
+
+        if (expired != count) {
+            fmt::print(stderr, "expected {} expirations, got {}\n", count,
+                       expired);
+            return EXIT_FAILURE;
+        }
+        fmt::print("timing_wheel:       expire {:.1f} ns/op\n", expire);
+    }
+
+    return EXIT_SUCCESS;
+}
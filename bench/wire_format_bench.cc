@@ -0,0 +1,92 @@
+/// \brief Wire format benchmark. Encodes and decodes an AvailableStations
+/// response of 1000 stations, shaped like the one of
+/// WebSocketRequestHandler::handleAvailableStations, in every wire format.
+/// Reports the bytes of the message and of the WebSocket frame the server
+/// sends, and the CPU time per encode and decode.
+///
+/// Usage: wire-format-bench [stations] [iterations]
+
+#include "websocket_server/WireFormat.hh"
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
+
+using namespace amadeus;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+/// \brief Returns the size of the frame header of an unmasked (server to
+/// client) WebSocket message.
+std::size_t frameHeader(std::size_t _payload) noexcept
+{
+    if (_payload < 126U) {
+        return 2U;
+    }
+    return _payload <= 0xFFFFU ? 4U : 10U;
+}
+
+/// \brief Returns the average time of _iterations calls to _f in µs.
+template <typename F>
+double measure(std::size_t _iterations, F&& _f)
+{
+    auto const start = Clock::now();
+    for (std::size_t i = 0; i < _iterations; ++i) {
+        _f();
+    }
+    return std::chrono::duration<double, std::micro>(Clock::now() - start)
+               .count() /
+           static_cast<double>(_iterations);
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::size_t const stations =
+        argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000U;
+    std::size_t const iterations =
+        argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2000U;
+
+    JSON response;
+    response["id"] = 1;
+    auto list = JSON::array();
+    for (std::size_t i = 0; i < stations; ++i) {
+        auto&& entry = list.emplace_back(JSON::object());
+        entry["stationId"] = i;
+        entry["stationName"] = fmt::format("S{:03}", i);
+    }
+    response["stations"] = std::move(list);
+
+    fmt::print("{:<8} {:>10} {:>10} {:>12} {:>12}\n", "format", "bytes",
+               "frame", "encode [µs]", "decode [µs]");
+
+    for (auto const format :
+         {WireFormat::Json, WireFormat::MsgPack, WireFormat::Cbor}) {
+        auto const encoded = encode(response, format);
+        if (decode(encoded, format) != response) {
+            fmt::print(stderr, "{} does not round-trip\n",
+                       wireFormatName(format));
+            return EXIT_FAILURE;
+        }
+
+        std::size_t sink{0};
+        auto const encodeTime = measure(iterations, [&] {
+            sink += encode(response, format).size();
+        });
+        auto const decodeTime = measure(iterations, [&] {
+            sink += decode(encoded, format).size();
+        });
+
+        fmt::print("{:<8} {:>10} {:>10} {:>12.1f} {:>12.1f}\n",
+                   wireFormatName(format), encoded.size(),
+                   encoded.size() + frameHeader(encoded.size()), encodeTime,
+                   decodeTime);
+        if (sink == 0) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,186 @@
+/// \brief WebSocket write benchmark. A PlainWebSocketSession writes messages
+/// to a client over loopback, once already serialized notifications (as
+/// queued by the fan-out) and once JSON responses serialized by writeRequest.
+/// The session is kept busy with a window of queued messages. Reports the
+/// messages per second of the single session and the heap allocations per
+/// message of the whole process (session and client).
+///
+/// Usage: ws-write-bench [messages] [window]
+
+#include "websocket_server/PlainWebSocketSession.hh"
+#include "websocket_server/SharedState.hh"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+#include <boost/beast/core/tcp_stream.hpp>
+#include <boost/beast/http/read.hpp>
+#include <boost/beast/http/string_body.hpp>
+#include <boost/beast/websocket/stream.hpp>
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <new>
+
+using namespace amadeus;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+/// The number of heap allocations of the process.
+std::atomic<std::size_t> allocations{0};
+} // namespace
+
+void* operator new(std::size_t _size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto* p = std::malloc(_size == 0 ? 1 : _size)) {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* _p) noexcept
+{
+    std::free(_p);
+}
+
+void operator delete(void* _p, std::size_t) noexcept
+{
+    std::free(_p);
+}
+
+namespace {
+/// \brief The result of a single run.
+struct Result
+{
+    /// Messages per second.
+    double rate;
+    /// Heap allocations per message.
+    double allocations;
+};
+
+/// \brief Writes _messages messages through the session and reads them with
+/// the client. _produce queues a single message on the session.
+Result run(asio::io_context& _ioc,
+           websocket::stream<beast::tcp_stream>& _client,
+           std::size_t _messages, std::size_t _window,
+           std::function<void()> const& _produce)
+{
+    std::size_t produced{0};
+    std::size_t received{0};
+    beast::flat_buffer buffer;
+
+    std::function<void()> read;
+    read = [&] {
+        _client.async_read(buffer, [&](beast::error_code const& _ec,
+                                       std::size_t) {
+            if (_ec) {
+                fmt::print(stderr, "read error: {}\n", _ec.message());
+                std::exit(EXIT_FAILURE);
+            }
+            buffer.consume(buffer.size());
+            if (++received == _messages) {
+                return;
+            }
+            // keep the window of queued messages filled
+            if (produced < _messages) {
+                _produce();
+                ++produced;
+            }
+            read();
+        });
+    };
+
+    auto const start = Clock::now();
+    auto const before = allocations.load(std::memory_order_relaxed);
+
+    for (; produced < std::min(_window, _messages); ++produced) {
+        _produce();
+    }
+    read();
+
+    _ioc.restart();
+    while (received < _messages && _ioc.run_one() > 0) {
+    }
+
+    auto const allocated =
+        allocations.load(std::memory_order_relaxed) - before;
+    auto const seconds =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    return Result{static_cast<double>(_messages) / seconds,
+                  static_cast<double>(allocated) /
+                      static_cast<double>(_messages)};
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::size_t const messages =
+        argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1U << 20U;
+    std::size_t const window =
+        argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 64U;
+
+    Logger::instance().severity(LoggerSeverity::Off);
+
+    auto state = std::make_shared<SharedState>(
+        "", JSON::object(), std::chrono::milliseconds{0}, std::size_t{0},
+        ReadingStoreOptions{}, StreamConfig{});
+
+    asio::io_context ioc;
+    asio::ip::tcp::acceptor acceptor{
+        ioc, {asio::ip::make_address("127.0.0.1"), 0}};
+
+    websocket::stream<beast::tcp_stream> client{ioc};
+    client.next_layer().connect(acceptor.local_endpoint());
+    beast::tcp_stream server{acceptor.accept()};
+
+    // upgrade the connection like the HttpSession does
+    std::shared_ptr<PlainWebSocketSession> session;
+    beast::flat_buffer upgrade;
+    http::request<http::string_body> request;
+    http::async_read(server, upgrade, request,
+                     [&](beast::error_code const& _ec, std::size_t) {
+                         if (_ec) {
+                             std::exit(EXIT_FAILURE);
+                         }
+                         session = std::make_shared<PlainWebSocketSession>(
+                             std::move(server), state);
+                         session->run(std::move(request));
+                     });
+    bool connected{false};
+    client.async_handshake("127.0.0.1", "/",
+                           [&](beast::error_code const& _ec) {
+                               connected = !_ec;
+                           });
+    while (!connected && ioc.run_one() > 0) {
+    }
+    // let the session finish its accept
+    ioc.poll();
+
+    WeatherStatusNotification notification{StationId::Goe, 21.5F, 43.25F,
+                                           1'600'000'000U};
+    auto const message = encodeWeatherStatus(notification);
+    auto const json = JSON::parse(*message->encoded(WireFormat::Json));
+
+    fmt::print("{:<16} {:>14} {:>14}\n", "message", "messages/s",
+               "allocs/message");
+
+    auto const notify = run(ioc, client, messages, window, [&] {
+        session->onNotification(message, StationId::Goe);
+    });
+    fmt::print("{:<16} {:>14.0f} {:>14.2f}\n", "notification", notify.rate,
+               notify.allocations);
+
+    auto const respond = run(ioc, client, messages, window, [&] {
+        session->writeRequest(JSON(json), [](std::size_t) {});
+    });
+    fmt::print("{:<16} {:>14.0f} {:>14.2f}\n", "writeRequest", respond.rate,
+               respond.allocations);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,409 @@
+/// \brief Turns a binary log file written by the server (see BinaryLog) back
+/// into the text log format. The entries of every batch are printed in the
+/// order of their timestamps.
+///
+/// Usage: log-decode <file>
+
+#include "websocket_server/BinaryLog.hh"
+#include "websocket_server/Logger.hh"
+
+#include <fmt/args.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace amadeus;
+
+namespace {
+/// \brief A call site read from the file.
+struct Site
+{
+    LoggerSeverity severity;
+    std::uint32_t line;
+    std::vector<BinaryArg> types;
+    std::string file;
+    std::string function;
+    std::string format;
+};
+
+/// \brief A pair of ticks and wall clock time read from the file.
+struct Clock
+{
+    std::uint64_t ticks;
+    std::int64_t nanos;
+};
+
+/// \brief A decoded entry of a batch.
+struct Entry
+{
+    std::uint64_t ticks;
+    std::string text;
+};
+
+/// \brief Reads the records of a binary log file. All reads fail once the
+/// end of the data is reached.
+class Reader
+{
+  public:
+    Reader(char const* _begin, char const* _end)
+        : pos_(_begin)
+        , end_(_end)
+    {
+    }
+
+    bool done() const noexcept
+    {
+        return pos_ == end_;
+    }
+
+    char const* position() const noexcept
+    {
+        return pos_;
+    }
+
+    template <typename T>
+    std::optional<T> read() noexcept
+    {
+        if (static_cast<std::size_t>(end_ - pos_) < sizeof(T)) {
+            return std::nullopt;
+        }
+        T value;
+        std::memcpy(&value, pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return value;
+    }
+
+    std::optional<std::string_view> string() noexcept
+    {
+        auto const size = read<std::uint32_t>();
+        if (!size || static_cast<std::size_t>(end_ - pos_) < *size) {
+            return std::nullopt;
+        }
+        std::string_view const text{pos_, *size};
+        pos_ += *size;
+        return text;
+    }
+
+    std::optional<std::uint64_t> varint() noexcept
+    {
+        std::uint64_t value{0};
+        for (unsigned shift = 0; shift < 64 && pos_ != end_; shift += 7) {
+            auto const byte = static_cast<std::uint8_t>(*pos_++);
+            value |= std::uint64_t{byte & 0x7FU} << shift;
+            if ((byte & 0x80U) == 0) {
+                return value;
+            }
+        }
+        return std::nullopt;
+    }
+
+    bool skip(std::size_t _size) noexcept
+    {
+        if (static_cast<std::size_t>(end_ - pos_) < _size) {
+            return false;
+        }
+        pos_ += _size;
+        return true;
+    }
+
+  private:
+    char const* pos_;
+    char const* end_;
+};
+
+constexpr std::string_view severityName(LoggerSeverity _severity) noexcept
+{
+    switch (_severity) {
+    case LoggerSeverity::Trace:
+        return "TRACE";
+    case LoggerSeverity::Debug:
+        return "DEBUG";
+    case LoggerSeverity::Info:
+        return "INFO";
+    case LoggerSeverity::Warn:
+        return "WARN";
+    case LoggerSeverity::Error:
+        return "ERROR";
+    case LoggerSeverity::Fatal:
+        return "FATAL";
+    default:
+        return "unknown";
+    }
+}
+
+/// \brief Reads a site record.
+std::optional<Site> readSite(Reader& _reader)
+{
+    auto const severity = _reader.read<std::uint8_t>();
+    auto const line = _reader.read<std::uint32_t>();
+    auto const argc = _reader.read<std::uint8_t>();
+    if (!severity || !line || !argc) {
+        return std::nullopt;
+    }
+    Site site{static_cast<LoggerSeverity>(*severity), *line, {}, {}, {}, {}};
+    for (std::size_t i = 0; i < *argc; ++i) {
+        auto const type = _reader.read<BinaryArg>();
+        if (!type) {
+            return std::nullopt;
+        }
+        site.types.push_back(*type);
+    }
+    auto const file = _reader.string();
+    auto const function = _reader.string();
+    auto const format = _reader.string();
+    if (!file || !function || !format) {
+        return std::nullopt;
+    }
+    site.file = *file;
+    site.function = *function;
+    site.format = *format;
+    return site;
+}
+
+/// \brief Reads the arguments of an entry into _args.
+bool readArgs(Reader& _reader, Site const& _site,
+              fmt::dynamic_format_arg_store<fmt::format_context>& _args)
+{
+    for (auto const type : _site.types) {
+        bool ok{false};
+        switch (type) {
+        case BinaryArg::Bool:
+            if (auto const v = _reader.read<char>(); (ok = v.has_value())) {
+                _args.push_back(*v != 0);
+            }
+            break;
+        case BinaryArg::Char:
+            if (auto const v = _reader.read<char>(); (ok = v.has_value())) {
+                _args.push_back(*v);
+            }
+            break;
+        case BinaryArg::Int32:
+            if (auto const v = _reader.read<std::int32_t>();
+                (ok = v.has_value())) {
+                _args.push_back(*v);
+            }
+            break;
+        case BinaryArg::UInt32:
+            if (auto const v = _reader.read<std::uint32_t>();
+                (ok = v.has_value())) {
+                _args.push_back(*v);
+            }
+            break;
+        case BinaryArg::Int64:
+            if (auto const v = _reader.read<std::int64_t>();
+                (ok = v.has_value())) {
+                _args.push_back(*v);
+            }
+            break;
+        case BinaryArg::UInt64:
+            if (auto const v = _reader.read<std::uint64_t>();
+                (ok = v.has_value())) {
+                _args.push_back(*v);
+            }
+            break;
+        case BinaryArg::Float:
+            if (auto const v = _reader.read<float>(); (ok = v.has_value())) {
+                _args.push_back(*v);
+            }
+            break;
+        case BinaryArg::Double:
+            if (auto const v = _reader.read<double>(); (ok = v.has_value())) {
+                _args.push_back(*v);
+            }
+            break;
+        case BinaryArg::String:
+            if (auto const v = _reader.string(); (ok = v.has_value())) {
+                _args.push_back(std::string(*v));
+            }
+            break;
+        default:
+            break;
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// \brief Converts ticks to unix nanoseconds by interpolating between the
+/// surrounding clock records.
+std::int64_t toNanos(std::vector<Clock> const& _clocks, std::uint64_t _ticks)
+{
+    if (_clocks.empty()) {
+        return static_cast<std::int64_t>(_ticks);
+    }
+    if (_clocks.size() == 1) {
+        return _clocks.front().nanos +
+               static_cast<std::int64_t>(_ticks - _clocks.front().ticks);
+    }
+    auto it = std::upper_bound(
+        std::begin(_clocks), std::end(_clocks), _ticks,
+        [](std::uint64_t _t, Clock const& _clock) {
+            return _t < _clock.ticks;
+        });
+    it = std::clamp(it, std::next(std::begin(_clocks)),
+                    std::prev(std::end(_clocks)));
+    auto const& a = *std::prev(it);
+    auto const& b = *it;
+    auto const rate =
+        b.ticks == a.ticks ? 1.0
+                           : static_cast<double>(b.nanos - a.nanos) /
+                                 static_cast<double>(b.ticks - a.ticks);
+    auto const delta = static_cast<double>(static_cast<std::int64_t>(
+        _ticks - a.ticks));
+    return a.nanos + static_cast<std::int64_t>(delta * rate);
+}
+
+/// \brief Formats the prefix of a line like the text log does.
+std::string prefix(std::int64_t _nanos, Site const& _site)
+{
+    auto const seconds = static_cast<std::time_t>(_nanos / 1'000'000'000);
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S",
+                  std::localtime(&seconds));
+    std::string_view file{_site.file};
+    file = file.substr(file.find_last_of("/\\") + 1);
+    return fmt::format("[{}:{}] [{}] {} {}:{} ", buffer,
+                       _nanos / 1'000'000 % 1000,
+                       severityName(_site.severity), _site.function, file,
+                       _site.line);
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        fmt::print(stderr, "Usage: log-decode <file>\n");
+        return EXIT_FAILURE;
+    }
+
+    std::ifstream in{argv[1], std::ios::binary};
+    std::vector<char> const data{std::istreambuf_iterator<char>(in),
+                                 std::istreambuf_iterator<char>()};
+    if (data.size() < BinaryLog::Magic.size() ||
+        std::string_view(data.data(), BinaryLog::Magic.size()) !=
+            BinaryLog::Magic) {
+        fmt::print(stderr, "'{}' is not a binary log file.\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    // the clock records are needed first to convert the ticks of the
+    // entries which precede them
+    std::vector<Clock> clocks;
+    Reader records{data.data() + BinaryLog::Magic.size(),
+                   data.data() + data.size()};
+    while (!records.done()) {
+        auto const tag = records.read<char>();
+        if (tag == 'C') {
+            auto const ticks = records.read<std::uint64_t>();
+            auto const nanos = records.read<std::int64_t>();
+            if (!ticks || !nanos) {
+                break;
+            }
+            clocks.push_back(Clock{*ticks, *nanos});
+        } else if (tag == 'S') {
+            if (!records.skip(4) || !readSite(records)) {
+                break;
+            }
+        } else if (tag == 'B') {
+            auto const size = records.read<std::uint32_t>();
+            if (!size || !records.skip(*size)) {
+                break;
+            }
+        } else {
+            break;
+        }
+    }
+    std::sort(std::begin(clocks), std::end(clocks),
+              [](Clock const& _a, Clock const& _b) {
+                  return _a.ticks < _b.ticks;
+              });
+
+    std::vector<Site> sites;
+    std::uint64_t ticks{0};
+    std::size_t decoded{0};
+    auto truncated = false;
+    records = Reader{data.data() + BinaryLog::Magic.size(),
+                     data.data() + data.size()};
+    while (!records.done() && !truncated) {
+        auto const tag = records.read<char>();
+        if (tag == 'C') {
+            auto const clock = records.read<std::uint64_t>();
+            if (!clock || !records.skip(sizeof(std::int64_t))) {
+                truncated = true;
+                break;
+            }
+            ticks = *clock;
+        } else if (tag == 'S') {
+            auto const id = records.read<std::uint32_t>();
+            auto site = readSite(records);
+            if (!id || !site) {
+                truncated = true;
+                break;
+            }
+            if (sites.size() <= *id) {
+                sites.resize(*id + 1);
+            }
+            sites[*id] = std::move(*site);
+        } else if (tag == 'B') {
+            auto const size = records.read<std::uint32_t>();
+            if (!size || !records.skip(*size)) {
+                truncated = true;
+                break;
+            }
+
+            std::vector<Entry> entries;
+            Reader batch{records.position() - *size, records.position()};
+            while (!batch.done()) {
+                auto const id = batch.varint();
+                auto const delta = batch.varint();
+                if (!id || !delta || *id >= sites.size()) {
+                    truncated = true;
+                    break;
+                }
+                ticks += (*delta >> 1U) ^ (~(*delta & 1U) + 1);
+
+                auto const& site = sites[*id];
+                fmt::dynamic_format_arg_store<fmt::format_context> args;
+                if (!readArgs(batch, site, args)) {
+                    truncated = true;
+                    break;
+                }
+                std::string text;
+                try {
+                    text = fmt::vformat(site.format, args);
+                } catch (fmt::format_error const& e) {
+                    text = fmt::format("<{}> {}", e.what(), site.format);
+                }
+                entries.push_back(Entry{
+                    ticks, prefix(toNanos(clocks, ticks), site) + text});
+            }
+
+            std::stable_sort(std::begin(entries), std::end(entries),
+                             [](Entry const& _a, Entry const& _b) {
+                                 return _a.ticks < _b.ticks;
+                             });
+            for (auto const& entry : entries) {
+                fmt::print("{}", entry.text);
+            }
+            decoded += entries.size();
+        } else {
+            truncated = true;
+        }
+    }
+
+    if (truncated) {
+        fmt::print(stderr, "'{}' is truncated or corrupt after {} entries.\n",
+                   argv[1], decoded);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
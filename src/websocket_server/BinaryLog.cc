@@ -0,0 +1,225 @@
+#include "websocket_server/BinaryLog.hh"
+
+#include <algorithm>
+
+using namespace amadeus;
+
+namespace {
+/// \brief Releases the staging buffer of a thread when the thread exits.
+struct StagingHolder
+{
+    /// The staging buffer of the thread.
+    std::shared_ptr<details::StagingBuffer> buffer;
+    /// The thread's pointer to the buffer.
+    details::StagingBuffer** slot{nullptr};
+
+    ~StagingHolder();
+};
+
+/// Set once the staging buffer of the thread has been released, logging
+/// falls back to the text log from then on.
+thread_local bool exited{false};
+
+StagingHolder::~StagingHolder()
+{
+    exited = true;
+    if (slot != nullptr) {
+        *slot = nullptr;
+    }
+    if (buffer) {
+        buffer->retired.store(true, std::memory_order_release);
+    }
+}
+
+template <typename T>
+void put(std::vector<char>& _out, T _value)
+{
+    auto const data = reinterpret_cast<char const*>(&_value);
+    _out.insert(std::end(_out), data, data + sizeof(_value));
+}
+
+void putString(std::vector<char>& _out, std::string_view _text)
+{
+    put(_out, static_cast<std::uint32_t>(_text.size()));
+    _out.insert(std::end(_out), std::begin(_text), std::end(_text));
+}
+
+void putVarint(std::vector<char>& _out, std::uint64_t _value)
+{
+    while (_value >= 0x80) {
+        _out.push_back(static_cast<char>(_value | 0x80));
+        _value >>= 7;
+    }
+    _out.push_back(static_cast<char>(_value));
+}
+
+/// \brief Appends a clock record.
+void putClock(std::vector<char>& _out, std::uint64_t _ticks)
+{
+    auto const now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::system_clock::now().time_since_epoch())
+                         .count();
+    _out.push_back('C');
+    put(_out, _ticks);
+    put(_out, static_cast<std::int64_t>(now));
+}
+} // namespace
+
+BinaryLog::BinaryLog(std::atomic<std::uint64_t>& _dropped)
+    : dropped_(_dropped)
+{
+}
+
+BinaryLog::~BinaryLog()
+{
+    if (file_ != nullptr) {
+        records_.clear();
+        putClock(records_, details::binaryLogTicks());
+        std::fwrite(records_.data(), 1, records_.size(), file_);
+        std::fclose(file_);
+    }
+}
+
+bool BinaryLog::open(std::string const& _filename)
+{
+    std::scoped_lock<std::mutex> lk(mtx_);
+    if (file_ != nullptr) {
+        std::fclose(file_);
+    }
+    file_ = std::fopen(_filename.c_str(), "wb");
+    if (file_ == nullptr) {
+        open_.store(false, std::memory_order_relaxed);
+        return false;
+    }
+
+    {
+        // the new file needs all sites again
+        std::scoped_lock<std::mutex> sitesLk(sitesMtx_);
+        sitesWritten_ = 0;
+    }
+    records_.assign(std::begin(Magic), std::end(Magic));
+    putClock(records_, details::binaryLogTicks());
+    std::fwrite(records_.data(), 1, records_.size(), file_);
+    std::fflush(file_);
+    open_.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+details::StagingBuffer* BinaryLog::attach()
+{
+    if (exited) {
+        return nullptr;
+    }
+
+    thread_local StagingHolder holder;
+    holder.buffer = std::make_shared<details::StagingBuffer>();
+    holder.slot = &staging_;
+    {
+        std::scoped_lock<std::mutex> lk(mtx_);
+        buffers_.push_back(holder.buffer);
+    }
+    staging_ = holder.buffer.get();
+    return staging_;
+}
+
+std::uint32_t BinaryLog::registerSite(source_location const& _loc,
+                                      std::uint8_t _severity,
+                                      std::string_view _fmt,
+                                      std::vector<BinaryArg> _types)
+{
+    std::scoped_lock<std::mutex> lk(sitesMtx_);
+    sites_.push_back(Site{_severity, static_cast<std::uint32_t>(_loc.line()),
+                          std::move(_types), _loc.file_name(),
+                          _loc.function_name(), std::string(_fmt)});
+    return static_cast<std::uint32_t>(sites_.size() - 1);
+}
+
+void BinaryLog::writeSites()
+{
+    std::scoped_lock<std::mutex> lk(sitesMtx_);
+    for (; sitesWritten_ < sites_.size(); ++sitesWritten_) {
+        auto const& site = sites_[sitesWritten_];
+        records_.push_back('S');
+        put(records_, static_cast<std::uint32_t>(sitesWritten_));
+        put(records_, site.severity);
+        put(records_, site.line);
+        put(records_, static_cast<std::uint8_t>(site.types.size()));
+        for (auto const type : site.types) {
+            put(records_, type);
+        }
+        putString(records_, site.file);
+        putString(records_, site.function);
+        putString(records_, site.format);
+    }
+}
+
+void BinaryLog::drain()
+{
+    if (!open_.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    std::scoped_lock<std::mutex> lk(mtx_);
+    auto const ticks = details::binaryLogTicks();
+    lastTicks_ = ticks;
+    batch_.clear();
+    for (auto const& buffer : buffers_) {
+        drain(*buffer);
+    }
+
+    // the buffers of exited threads are released once they are empty
+    buffers_.erase(std::remove_if(std::begin(buffers_), std::end(buffers_),
+                                  [](auto const& _buffer) {
+                                      return _buffer->retired.load(
+                                                 std::memory_order_acquire) &&
+                                             _buffer->consumed() ==
+                                                 _buffer->head();
+                                  }),
+                   std::end(buffers_));
+
+    if (batch_.empty() || file_ == nullptr) {
+        return;
+    }
+
+    // every site of the batch has been registered before its entries
+    records_.clear();
+    writeSites();
+    putClock(records_, ticks);
+    records_.push_back('B');
+    put(records_, static_cast<std::uint32_t>(batch_.size()));
+    records_.insert(std::end(records_), std::begin(batch_), std::end(batch_));
+    std::fwrite(records_.data(), 1, records_.size(), file_);
+    std::fflush(file_);
+}
+
+void BinaryLog::drain(details::StagingBuffer& _buffer)
+{
+    auto const head = _buffer.head();
+    auto position = _buffer.consumed();
+
+    while (position < head) {
+        auto const entry = _buffer.at(position);
+        std::uint32_t site;
+        std::memcpy(&site, entry, sizeof(site));
+        if (site == details::StagingBuffer::Padding) {
+            position += details::StagingBuffer::Capacity -
+                        (position & (details::StagingBuffer::Capacity - 1));
+            continue;
+        }
+
+        std::uint32_t args;
+        std::uint64_t ticks;
+        std::memcpy(&args, entry + 4, sizeof(args));
+        std::memcpy(&ticks, entry + 8, sizeof(ticks));
+
+        auto const delta = static_cast<std::int64_t>(ticks - lastTicks_);
+        putVarint(batch_, site);
+        putVarint(batch_, (static_cast<std::uint64_t>(delta) << 1U) ^
+                              static_cast<std::uint64_t>(delta >> 63));
+        lastTicks_ = ticks;
+        batch_.insert(std::end(batch_), entry + HeaderSize,
+                      entry + HeaderSize + args);
+        position += (HeaderSize + args + 7) & ~std::uint64_t{7};
+    }
+    _buffer.consume(position);
+}
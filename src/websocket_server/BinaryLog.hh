@@ -0,0 +1,407 @@
+#ifndef WEBSOCKET_SERVER_BINARY_LOG_HH
+#define WEBSOCKET_SERVER_BINARY_LOG_HH
+
+#include "websocket_server/utils/source_location.hh"
+
+#include <fmt/format.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+namespace amadeus {
+/// \brief The type of a logged argument in the binary log.
+enum class BinaryArg : std::uint8_t
+{
+    Bool,
+    Char,
+    Int32,
+    UInt32,
+    Int64,
+    UInt64,
+    Float,
+    Double,
+    /// A u32 length followed by the characters.
+    String,
+    /// The argument has to be formatted by the logging thread.
+    None,
+};
+
+namespace details {
+/// \brief Returns how an argument of type T is stored in the binary log.
+template <typename T>
+constexpr BinaryArg binaryArg() noexcept
+{
+    using U = std::decay_t<T>;
+    if constexpr (std::is_same_v<U, bool>) {
+        return BinaryArg::Bool;
+    } else if constexpr (std::is_same_v<U, char>) {
+        return BinaryArg::Char;
+    } else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>) {
+        return sizeof(U) <= 4 ? BinaryArg::Int32 : BinaryArg::Int64;
+    } else if constexpr (std::is_integral_v<U>) {
+        return sizeof(U) <= 4 ? BinaryArg::UInt32 : BinaryArg::UInt64;
+    } else if constexpr (std::is_same_v<U, float>) {
+        return BinaryArg::Float;
+    } else if constexpr (std::is_same_v<U, double>) {
+        return BinaryArg::Double;
+    } else if constexpr (std::is_same_v<U, char const*> ||
+                         std::is_same_v<U, char*> ||
+                         std::is_same_v<U, std::string> ||
+                         std::is_same_v<U, std::string_view>) {
+        return BinaryArg::String;
+    } else {
+        return BinaryArg::None;
+    }
+}
+
+/// \brief Returns the number of bytes an argument takes in the binary log.
+template <typename T>
+std::size_t binaryArgSize(T const& _arg) noexcept
+{
+    constexpr auto type = binaryArg<T>();
+    if constexpr (type == BinaryArg::Bool || type == BinaryArg::Char) {
+        return 1;
+    } else if constexpr (type == BinaryArg::Int32 ||
+                         type == BinaryArg::UInt32 ||
+                         type == BinaryArg::Float) {
+        return 4;
+    } else if constexpr (type == BinaryArg::String) {
+        return 4 + std::string_view(_arg).size();
+    } else {
+        return 8;
+    }
+}
+
+/// \brief Writes an argument in the binary log format.
+/// \returns The end of the written argument.
+template <typename T>
+char* encodeBinaryArg(char* _out, T const& _arg) noexcept
+{
+    constexpr auto type = binaryArg<T>();
+    auto const put = [_out](auto _value) {
+        std::memcpy(_out, &_value, sizeof(_value));
+        return _out + sizeof(_value);
+    };
+    if constexpr (type == BinaryArg::Bool || type == BinaryArg::Char) {
+        return put(static_cast<char>(_arg));
+    } else if constexpr (type == BinaryArg::Int32) {
+        return put(static_cast<std::int32_t>(_arg));
+    } else if constexpr (type == BinaryArg::UInt32) {
+        return put(static_cast<std::uint32_t>(_arg));
+    } else if constexpr (type == BinaryArg::Int64) {
+        return put(static_cast<std::int64_t>(_arg));
+    } else if constexpr (type == BinaryArg::UInt64) {
+        return put(static_cast<std::uint64_t>(_arg));
+    } else if constexpr (type == BinaryArg::String) {
+        std::string_view const text{_arg};
+        auto const out = put(static_cast<std::uint32_t>(text.size()));
+        std::memcpy(out, text.data(), text.size());
+        return out + text.size();
+    } else {
+        return put(_arg);
+    }
+}
+
+/// \brief Returns the current timestamp in ticks of the cheapest clock
+/// available, the time stamp counter on x86. The sink thread records pairs
+/// of ticks and wall clock time so that the decoder can convert them.
+inline std::uint64_t binaryLogTicks() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__) ||                                \
+    (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86)))
+    return __rdtsc();
+#else
+    return static_cast<std::uint64_t>(
+        std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+/// \brief A single-producer single-consumer byte ring which a logging thread
+/// writes its entries to. Entries are 8 byte aligned and never wrap, the
+/// rest of the ring is skipped with a padding marker instead.
+class StagingBuffer final
+{
+  public:
+    /// The size of the ring in bytes.
+    static constexpr std::size_t Capacity{1U << 20U};
+    /// The site id which marks the rest of the ring as unused.
+    static constexpr std::uint32_t Padding{~std::uint32_t{0}};
+
+    StagingBuffer()
+        : data_(std::make_unique<char[]>(Capacity))
+    {
+    }
+
+    /// \brief Reserves _size bytes for the next entry.
+    /// \returns nullptr if the ring is full.
+    char* reserve(std::size_t _size) noexcept
+    {
+        auto head = head_.load(std::memory_order_relaxed);
+        auto const offset = head & (Capacity - 1);
+        auto const contiguous = Capacity - offset;
+        auto const needed = _size <= contiguous ? _size : contiguous + _size;
+        if (head + needed - tail_ > Capacity) {
+            tail_ = consumed_.load(std::memory_order_acquire);
+            if (head + needed - tail_ > Capacity) {
+                return nullptr;
+            }
+        }
+        if (_size > contiguous) {
+            std::memcpy(data_.get() + offset, &Padding, sizeof(Padding));
+            head += contiguous;
+            head_.store(head, std::memory_order_release);
+        }
+        return data_.get() + (head & (Capacity - 1));
+    }
+
+    /// \brief Publishes the entry written to the last reservation.
+    void commit(std::size_t _size) noexcept
+    {
+        head_.store(head_.load(std::memory_order_relaxed) + _size,
+                    std::memory_order_release);
+    }
+
+    /// \brief Returns the position after the last published entry.
+    std::uint64_t head() const noexcept
+    {
+        return head_.load(std::memory_order_acquire);
+    }
+
+    /// \brief Returns the position of the first unread entry.
+    std::uint64_t consumed() const noexcept
+    {
+        return consumed_.load(std::memory_order_relaxed);
+    }
+
+    /// \brief Releases everything before _position to the producer.
+    void consume(std::uint64_t _position) noexcept
+    {
+        consumed_.store(_position, std::memory_order_release);
+    }
+
+    /// \brief Returns the byte at _position.
+    char const* at(std::uint64_t _position) const noexcept
+    {
+        return data_.get() + (_position & (Capacity - 1));
+    }
+
+    /// Set once the owning thread exits.
+    std::atomic<bool> retired{false};
+
+  private:
+    /// The ring.
+    std::unique_ptr<char[]> data_;
+    /// The producer position.
+    alignas(64) std::atomic<std::uint64_t> head_{0};
+    /// The consumer position as last seen by the producer.
+    std::uint64_t tail_{0};
+    /// The consumer position.
+    alignas(64) std::atomic<std::uint64_t> consumed_{0};
+};
+} // namespace details
+
+/// \brief A NanoLog style binary log with deferred formatting.
+/// Every call site registers its format string, source location and
+/// argument types once. Afterwards a call only copies a site id, a tick
+/// count and the raw arguments into a ring buffer owned by the calling
+/// thread; nothing is formatted or locked. The sink thread of the
+/// \ref Logger drains the rings into a compact binary file which the
+/// log-decode tool turns back into text. Arguments which are neither
+/// arithmetic nor strings are formatted by the logging thread.
+///
+/// File format, all integers in host byte order:
+///     file    := "AMBLOG01" record*
+///     record  := 'S' site | 'C' clock | 'B' batch
+///     site    := id:u32 severity:u8 line:u32 argc:u8 type[argc]:u8
+///                file:str function:str format:str
+///     clock   := ticks:u64 unixNanos:i64
+///     batch   := size:u32 entry*
+///     entry   := site:varint ticks:zigzag-varint arguments
+///     str     := size:u32 char[size]
+/// The ticks of an entry are relative to the previous entry of the batch,
+/// the first one to the clock record which precedes every batch. Strings
+/// among the arguments are stored as str.
+/// \remarks Thread-Safe. Only the sink thread may call \ref drain.
+class BinaryLog final
+{
+  public:
+    /// The first bytes of a binary log file.
+    static constexpr std::string_view Magic{"AMBLOG01"};
+    /// The size of the header of an entry in a staging buffer.
+    static constexpr std::size_t HeaderSize{16};
+
+    /// \brief Constructor.
+    /// \param _dropped The counter of dropped messages.
+    explicit BinaryLog(std::atomic<std::uint64_t>& _dropped);
+
+    /// \brief Closes the file.
+    ~BinaryLog();
+
+    BinaryLog(BinaryLog const&) = delete;
+    BinaryLog& operator=(BinaryLog const&) = delete;
+
+    /// \brief Opens the binary log file, from now on messages are logged to
+    /// it.
+    /// \returns false if the file cannot be created.
+    bool open(std::string const& _filename);
+
+    /// \brief Returns true if the binary log file is open.
+    bool isOpen() const noexcept
+    {
+        return open_.load(std::memory_order_relaxed);
+    }
+
+    /// \brief Logs a message.
+    /// \tparam Site A type unique to the call site.
+    /// \param _block Whether to wait for room if the buffer of the thread is
+    /// full, otherwise the message is dropped.
+    /// \param _full Called if the buffer of the thread is full.
+    /// \returns false if the calling thread has no staging buffer anymore
+    /// because it is exiting.
+    template <typename Site, typename Full, typename... Args>
+    bool write(bool _block, Full&& _full, source_location const& _loc,
+               std::uint8_t _severity, std::string_view _fmt,
+               Args const&... _args)
+    {
+        constexpr bool Deferred{
+            ((details::binaryArg<Args>() != BinaryArg::None) && ...)};
+
+        if constexpr (Deferred) {
+            static std::uint32_t const site = registerSite(
+                _loc, _severity, _fmt, {details::binaryArg<Args>()...});
+            return write(_block, _full, site, _args...);
+        } else {
+            // the site logs the formatted message
+            static std::uint32_t const site =
+                registerSite(_loc, _severity, "{}", {BinaryArg::String});
+            fmt::basic_memory_buffer<char, 256> text;
+            fmt::vformat_to(std::back_inserter(text), _fmt,
+                            fmt::make_format_args(_args...));
+            return write(_block, _full, site,
+                         std::string_view(text.data(), text.size()));
+        }
+    }
+
+    /// \brief Writes the entries of all threads to the file. Called by the
+    /// sink thread.
+    void drain();
+
+  private:
+    /// \brief A registered call site.
+    struct Site
+    {
+        std::uint8_t severity;
+        std::uint32_t line;
+        std::vector<BinaryArg> types;
+        std::string file;
+        std::string function;
+        std::string format;
+    };
+
+    /// \brief Copies an entry into the staging buffer of the thread.
+    template <typename Full, typename... Args>
+    bool write(bool _block, Full& _full, std::uint32_t _site,
+               Args const&... _args)
+    {
+        auto const ticks = details::binaryLogTicks();
+        auto const args = (std::size_t{0} + ... +
+                           details::binaryArgSize(_args));
+        auto const size = (HeaderSize + args + 7) & ~std::size_t{7};
+
+        auto const buffer = staging();
+        if (buffer == nullptr) {
+            return false;
+        }
+        auto out = buffer->reserve(size);
+        if (out == nullptr) {
+            _full();
+        }
+        while (out == nullptr) {
+            if (!_block || size > details::StagingBuffer::Capacity) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            std::this_thread::yield();
+            out = buffer->reserve(size);
+        }
+
+        auto const argsSize = static_cast<std::uint32_t>(args);
+        std::memcpy(out, &_site, sizeof(_site));
+        std::memcpy(out + 4, &argsSize, sizeof(argsSize));
+        std::memcpy(out + 8, &ticks, sizeof(ticks));
+        out += HeaderSize;
+        ((out = details::encodeBinaryArg(out, _args)), ...);
+        buffer->commit(size);
+        return true;
+    }
+
+    /// \brief Returns the staging buffer of the calling thread.
+    details::StagingBuffer* staging()
+    {
+        return staging_ != nullptr ? staging_ : attach();
+    }
+
+    /// \brief Creates the staging buffer of the calling thread.
+    /// \returns nullptr if the thread is exiting.
+    details::StagingBuffer* attach();
+
+    /// \brief Registers a call site.
+    /// \returns The site id.
+    std::uint32_t registerSite(source_location const& _loc,
+                               std::uint8_t _severity, std::string_view _fmt,
+                               std::vector<BinaryArg> _types);
+
+    /// \brief Appends the site records which have not been written yet.
+    void writeSites();
+
+    /// \brief Transcodes the entries of a staging buffer into \ref batch_.
+    void drain(details::StagingBuffer& _buffer);
+
+    /// The staging buffer of the calling thread.
+    static inline thread_local details::StagingBuffer* staging_{nullptr};
+
+    /// The counter of dropped messages.
+    std::atomic<std::uint64_t>& dropped_;
+    /// Whether the file is open.
+    std::atomic<bool> open_{false};
+    /// The binary log file, only accessed by the sink thread once it is
+    /// open.
+    std::FILE* file_{nullptr};
+    /// Protects the file and the staging buffers.
+    std::mutex mtx_;
+    /// The staging buffers of all threads.
+    std::vector<std::shared_ptr<details::StagingBuffer>> buffers_;
+    /// Protects the sites.
+    std::mutex sitesMtx_;
+    /// The registered call sites by id.
+    std::vector<Site> sites_;
+    /// The number of sites written to the file.
+    std::size_t sitesWritten_{0};
+    /// The ticks of the previous entry of the batch.
+    std::uint64_t lastTicks_{0};
+    /// The records of the next write.
+    std::vector<char> records_;
+    /// The entries of the next batch.
+    std::vector<char> batch_;
+};
+} // namespace amadeus
+
+#endif // !WEBSOCKET_SERVER_BINARY_LOG_HH
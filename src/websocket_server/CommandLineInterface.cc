@@ -50,6 +50,91 @@ void CommandLineInterface::parse(int _argc, char* _argv[])
         privKey = fmt::format("{}/{}", configPath,
                               config["privKey"].get<std::string>());
 
+        if (auto const it = config.find("sharding"); it != config.end()) {
+            sharded = it->value("enabled", false);
+            incomingCpu = it->value("incomingCpu", false);
+        }
+
+        if (auto const it = config.find("cache"); it != config.end()) {
+            cacheMaxAge = std::chrono::milliseconds(
+                it->value("maxAge", std::int64_t{0}));
+        }
+
+        if (auto const it = config.find("history"); it != config.end()) {
+            historyMaxBytes =
+                it->value("maxBytesPerStation", std::size_t{0});
+        }
+
+        if (auto const it = config.find("stream"); it != config.end()) {
+            stream.interval = it->value("interval", std::uint16_t{0});
+            stream.delta = it->value("delta", 0.0F);
+            if (!(stream.delta >= 0.0F)) {
+                throw std::invalid_argument(fmt::format(
+                    "Invalid stream delta '{}'.", stream.delta));
+            }
+        }
+
+        if (auto const it = config.find("websocket"); it != config.end()) {
+            outbound.maxMessages =
+                it->value("maxQueuedMessages", outbound.maxMessages);
+            outbound.maxBytes = it->value("maxQueuedBytes", outbound.maxBytes);
+            outbound.maxFlushWindow = std::chrono::milliseconds(it->value(
+                "maxFlushWindow", outbound.maxFlushWindow.count()));
+
+            auto const overflow =
+                it->value("overflow", std::string{"coalesce"});
+            if (overflow == "dropOldest") {
+                outbound.policy = OverflowPolicy::DropOldest;
+            } else if (overflow == "coalesce") {
+                outbound.policy = OverflowPolicy::Coalesce;
+            } else if (overflow == "disconnect") {
+                outbound.policy = OverflowPolicy::Disconnect;
+            } else {
+                throw std::invalid_argument(fmt::format(
+                    "Unknown websocket overflow policy '{}'.", overflow));
+            }
+        }
+
+        if (auto const it = config.find("store"); it != config.end()) {
+            parseStore(*it, configPath);
+        }
+
+        if (auto const it = config.find("log"); it != config.end()) {
+            auto const overflow = it->value("overflow", std::string{"count"});
+            if (overflow == "block") {
+                logOverflow = LogOverflowPolicy::Block;
+            } else if (overflow == "drop") {
+                logOverflow = LogOverflowPolicy::Drop;
+            } else if (overflow == "count") {
+                logOverflow = LogOverflowPolicy::Count;
+            } else {
+                throw std::invalid_argument(fmt::format(
+                    "Unknown log overflow policy '{}'.", overflow));
+            }
+
+            auto const severity = it->value("severity", std::string{"debug"});
+            if (severity == "trace") {
+                logSeverity = LoggerSeverity::Trace;
+            } else if (severity == "debug") {
+                logSeverity = LoggerSeverity::Debug;
+            } else if (severity == "info") {
+                logSeverity = LoggerSeverity::Info;
+            } else if (severity == "warn") {
+                logSeverity = LoggerSeverity::Warn;
+            } else if (severity == "error") {
+                logSeverity = LoggerSeverity::Error;
+            } else if (severity == "fatal") {
+                logSeverity = LoggerSeverity::Fatal;
+            } else if (severity == "off") {
+                logSeverity = LoggerSeverity::Off;
+            } else {
+                throw std::invalid_argument(
+                    fmt::format("Unknown log severity '{}'.", severity));
+            }
+
+            logBinaryFile = it->value("binary", std::string{});
+        }
+
         LOG_INFO("Config file '{}' successfully loaded with contents:\n{}\n",
                  configFile, config.dump(4));
     } catch (std::runtime_error const&) {
@@ -68,3 +153,48 @@ void CommandLineInterface::parse(int _argc, char* _argv[])
             "The given document root '{}' does not exist.", docRoot));
     }
 }
+
+void CommandLineInterface::parseStore(JSON const& _store,
+                                      std::string const& _configPath)
+{
+    namespace fs = std::filesystem;
+
+    fs::path directory{_store.value("directory", std::string{})};
+    if (!directory.empty() && directory.is_relative()) {
+        directory = fs::path(_configPath) / directory;
+    }
+    store.directory = std::move(directory);
+
+    auto const fsync = _store.value("fsync", std::string{"batch"});
+    if (fsync == "never") {
+        store.fsync = FsyncPolicy::Never;
+    } else if (fsync == "batch") {
+        store.fsync = FsyncPolicy::Batch;
+    } else if (fsync == "interval") {
+        store.fsync = FsyncPolicy::Interval;
+    } else {
+        throw std::invalid_argument(
+            fmt::format("Unknown fsync policy '{}'.", fsync));
+    }
+
+    store.fsyncInterval = std::chrono::milliseconds(
+        _store.value("fsyncInterval", store.fsyncInterval.count()));
+    store.segmentBytes = _store.value("segmentBytes", store.segmentBytes);
+    store.queueCapacity = _store.value("queueCapacity", store.queueCapacity);
+
+    if (auto const it = _store.find("retention"); it != _store.end()) {
+        store.rawRetention = std::chrono::seconds(
+            it->value("raw", store.rawRetention.count()));
+        store.compressedRetention = std::chrono::seconds(
+            it->value("compressed", store.compressedRetention.count()));
+
+        if (auto const rollups = it->find("rollups"); rollups != it->end()) {
+            for (std::size_t i = 0; i < RollupLevels; ++i) {
+                auto& retention = store.rollupRetention[i];
+                retention = std::chrono::seconds(rollups->value(
+                    std::string(rollupName(static_cast<RollupLevel>(i))),
+                    retention.count()));
+            }
+        }
+    }
+}
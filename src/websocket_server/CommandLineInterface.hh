@@ -2,11 +2,17 @@
 #define WEBSOCKET_SERVER_COMMAND_LINE_INTERFACE_HH
 
 #include "websocket_server/asiofwd.hh"
+#include "websocket_server/Logger.hh"
+#include "websocket_server/OutboundQueueOptions.hh"
+#include "websocket_server/ReadingStore.hh"
+#include "websocket_server/StreamConfig.hh"
 
 #include <boost/asio/ip/address.hpp>
 
 #include <nlohmann/json.hpp>
 
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <string>
 
@@ -36,11 +42,43 @@ struct CommandLineInterface
     std::string certChain;
     /// The server private key.
     std::string privKey;
+    /// Whether to run one io_context per thread ("sharded" mode) instead of a
+    /// single io_context shared between all threads.
+    bool sharded{false};
+    /// Whether the sharded listeners should steer connections to the shard
+    /// running on the CPU that received them (Linux only).
+    bool incomingCpu{false};
+    /// The maximum age of a cached station reading to be served without
+    /// polling the µc. Zero disables the cache.
+    std::chrono::milliseconds cacheMaxAge{0};
+    /// The memory ceiling of the reading history of a single station in
+    /// bytes. Zero disables the history.
+    std::size_t historyMaxBytes{0};
+    /// The options of the on-disk reading store.
+    ReadingStoreOptions store;
+    /// How the stations push their readings, until changed at runtime.
+    StreamConfig stream;
+    /// The high-water mark and overflow policy of the outbound queue of every
+    /// WebSocketSession.
+    OutboundQueueOptions outbound;
+    /// What happens to a log message if the queue of the logger is full.
+    LogOverflowPolicy logOverflow{LogOverflowPolicy::Count};
+    /// The minimum severity of the logged messages. Messages below the
+    /// LOG_LEVEL the server was built with are never logged.
+    LoggerSeverity logSeverity{LoggerSeverity::Debug};
+    /// The binary log file. Empty writes a text log.
+    std::string logBinaryFile;
 
     /// \brief Performs the actual command line parsing.
     /// \param _argc The number of arguments.
     /// \param _argv An array of arguments.
     void parse(int _argc, char* _argv[]);
+
+  private:
+    /// \brief Parses the "store" block of the config file.
+    /// \param _store The "store" block.
+    /// \param _configPath The directory of the config file.
+    void parseStore(JSON const& _store, std::string const& _configPath);
 };
 } // namespace amadeus
 
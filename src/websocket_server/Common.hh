@@ -18,6 +18,21 @@ auto constexpr IdleTimeout{10s};
 auto constexpr PingTimeout{30s};
 /// The timeout for whenever a pong packet is expected from the peer.
 auto constexpr PongTimeout{10s};
+/// The timeout for a weather status poll to be answered by a µc.
+auto constexpr PollTimeout{5s};
+/// Weather status requests within this window after a poll are attached to
+/// that poll instead of polling the µc again.
+auto constexpr PollCoalesceWindow{500ms};
+/// The maximum number of unanswered weather status polls per µc.
+auto constexpr MaxPendingPolls{16U};
+/// The granularity of the timing wheel which drives all session timers.
+auto constexpr TimerResolution{100ms};
+/// The maximum size of a MessagePack or CBOR message from a frontend, which
+/// may hold an array of requests. A larger message fails the connection.
+auto constexpr MaxBinaryMessageSize{64U * 1024U};
+/// The number of subscribers a single fan-out task delivers to. Larger
+/// subscriber lists are partitioned across the worker threads.
+auto constexpr FanOutChunkSize{256U};
 
 /// \def Identifies the API version of the server.
 #define SERVER_VERSION 10
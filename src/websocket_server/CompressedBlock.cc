@@ -0,0 +1,175 @@
+#include "websocket_server/CompressedBlock.hh"
+#include "websocket_server/utils/gorilla.hh"
+
+#include <boost/crc.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace amadeus;
+
+namespace {
+/// \brief Appends the bytes of a trivially copyable value.
+template <typename T>
+void put(std::vector<std::uint8_t>& _out, T const& _value)
+{
+    auto const bytes = reinterpret_cast<std::uint8_t const*>(&_value);
+    _out.insert(std::end(_out), bytes, bytes + sizeof(T));
+}
+} // namespace
+
+std::vector<std::uint8_t>
+CompressedBlock::encode(HistorySamples const& _samples)
+{
+    auto const records = _samples.times.size();
+    auto const chunks = (records + ChunkSize - 1) / ChunkSize;
+
+    std::vector<Chunk> table;
+    table.reserve(chunks);
+    std::vector<std::uint8_t> payload;
+    payload.reserve(records * 4);
+
+    for (std::size_t first = 0; first < records; first += ChunkSize) {
+        table.push_back(Chunk{_samples.times[first],
+                              static_cast<std::uint32_t>(payload.size())});
+
+        bit_writer bits{payload};
+        timestamp_encoder times;
+        float_encoder temperatures;
+        float_encoder humidities;
+
+        auto const last = std::min(first + ChunkSize, records);
+        for (auto i = first; i < last; ++i) {
+            times.encode(bits, _samples.times[i]);
+            temperatures.encode(bits, _samples.temperatures[i]);
+            humidities.encode(bits, _samples.humidities[i]);
+        }
+        bits.flush();
+    }
+
+    Header header{};
+    header.magic = Magic;
+    header.records = static_cast<std::uint32_t>(records);
+    header.chunks = static_cast<std::uint32_t>(chunks);
+    header.firstTime = records > 0 ? _samples.times.front() : 0;
+    header.lastTime = records > 0 ? _samples.times.back() : 0;
+    header.payloadSize = static_cast<std::uint32_t>(payload.size());
+
+    std::vector<std::uint8_t> block;
+    block.reserve(sizeof(Header) + chunks * sizeof(Chunk) + payload.size());
+    put(block, header);
+    for (auto const& c : table) {
+        put(block, c);
+    }
+    block.insert(std::end(block), std::begin(payload), std::end(payload));
+
+    boost::crc_32_type crc;
+    crc.process_bytes(block.data() + sizeof(Header),
+                      block.size() - sizeof(Header));
+    header.crc = crc.checksum();
+    std::memcpy(block.data(), &header, sizeof(Header));
+
+    return block;
+}
+
+CompressedBlock::CompressedBlock(std::uint8_t const* _data, std::size_t _size,
+                                 bool _verify)
+{
+    if (_size < sizeof(Header)) {
+        throw std::runtime_error("Compressed block is truncated.");
+    }
+    std::memcpy(&header_, _data, sizeof(Header));
+
+    if (header_.magic != Magic) {
+        throw std::runtime_error("Compressed block has an invalid magic.");
+    }
+
+    auto const tableSize = std::size_t{header_.chunks} * sizeof(Chunk);
+    if (_size != sizeof(Header) + tableSize + header_.payloadSize ||
+        header_.chunks != (header_.records + ChunkSize - 1) / ChunkSize) {
+        throw std::runtime_error("Compressed block is truncated.");
+    }
+
+    table_ = _data + sizeof(Header);
+    payload_ = table_ + tableSize;
+
+    if (_verify) {
+        boost::crc_32_type crc;
+        crc.process_bytes(table_, tableSize + header_.payloadSize);
+        if (crc.checksum() != header_.crc) {
+            throw std::runtime_error("Compressed block checksum mismatch.");
+        }
+    }
+}
+
+CompressedBlock::Header const& CompressedBlock::header() const noexcept
+{
+    return header_;
+}
+
+std::vector<std::uint32_t> CompressedBlock::chunkTimes() const
+{
+    std::vector<std::uint32_t> times(header_.chunks);
+    for (std::size_t i = 0; i < times.size(); ++i) {
+        times[i] = chunk(i).firstTime;
+    }
+    return times;
+}
+
+void CompressedBlock::decode(std::uint32_t _from, std::uint32_t _to,
+                             HistorySamples& _samples) const
+{
+    // find the last chunk which starts before _from
+    std::size_t first{0};
+    std::size_t count{header_.chunks};
+    while (count > 0) {
+        auto const step = count / 2;
+        if (chunk(first + step).firstTime < _from) {
+            first += step + 1;
+            count -= step + 1;
+        } else {
+            count = step;
+        }
+    }
+    if (first > 0) {
+        --first;
+    }
+
+    for (auto c = first; c < header_.chunks; ++c) {
+        auto const entry = chunk(c);
+        if (entry.firstTime > _to) {
+            return;
+        }
+
+        auto const end = c + 1 < header_.chunks ? chunk(c + 1).offset
+                                                : header_.payloadSize;
+        bit_reader bits{payload_ + entry.offset, end - entry.offset};
+        timestamp_decoder times;
+        float_decoder temperatures;
+        float_decoder humidities;
+
+        auto const samples =
+            std::min(ChunkSize, header_.records - c * ChunkSize);
+        for (std::size_t i = 0; i < samples; ++i) {
+            auto const time = times.decode(bits);
+            auto const temperature = temperatures.decode(bits);
+            auto const humidity = humidities.decode(bits);
+            if (time > _to) {
+                return;
+            }
+            if (time >= _from) {
+                _samples.times.push_back(time);
+                _samples.temperatures.push_back(temperature);
+                _samples.humidities.push_back(humidity);
+            }
+        }
+    }
+}
+
+CompressedBlock::Chunk CompressedBlock::chunk(std::size_t _index) const noexcept
+{
+    Chunk entry;
+    std::memcpy(&entry, table_ + _index * sizeof(Chunk), sizeof(Chunk));
+    return entry;
+}
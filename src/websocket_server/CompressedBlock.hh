@@ -0,0 +1,97 @@
+#ifndef WEBSOCKET_SERVER_COMPRESSED_BLOCK_HH
+#define WEBSOCKET_SERVER_COMPRESSED_BLOCK_HH
+
+#include "websocket_server/StationHistory.hh"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace amadeus {
+/// \brief A read-only view of a compressed block of readings, the sealed
+/// on-disk representation of a raw segment of the \ref ReadingStore.
+/// The samples are split into chunks of \ref ChunkSize samples. Each chunk is
+/// an independent Gorilla bit stream (see utils/gorilla.hh) of
+/// delta-of-delta timestamps and XOR compressed temperatures and humidities,
+/// so a range query only decodes the chunks it overlaps.
+///
+/// Layout, in host byte order:
+///
+/// Header
+/// Chunk[chunks]     first timestamp and payload offset of every chunk
+/// payload           the concatenated bit streams, each one byte aligned
+class CompressedBlock
+{
+  public:
+    /// The number of samples per chunk.
+    static constexpr std::size_t ChunkSize{256};
+    /// Identifies a block file.
+    static constexpr std::array<char, 4> Magic{{'W', 'S', 'C', 'B'}};
+
+    /// \brief The block header.
+    struct Header
+    {
+        /// Always \ref Magic.
+        std::array<char, 4> magic;
+        /// The number of samples.
+        std::uint32_t records;
+        /// The number of chunks.
+        std::uint32_t chunks;
+        /// The timestamp of the first sample.
+        std::uint32_t firstTime;
+        /// The timestamp of the last sample.
+        std::uint32_t lastTime;
+        /// The size of the payload.
+        std::uint32_t payloadSize;
+        /// The CRC-32 of the chunk table and the payload.
+        std::uint32_t crc;
+        /// Reserved, zero.
+        std::uint32_t reserved;
+    };
+
+    /// \brief An entry of the chunk table.
+    struct Chunk
+    {
+        /// The timestamp of the first sample of the chunk.
+        std::uint32_t firstTime;
+        /// The offset of the chunk within the payload.
+        std::uint32_t offset;
+    };
+
+    /// \brief Encodes samples in ascending order of time into a block.
+    /// \returns The complete block file contents.
+    static std::vector<std::uint8_t> encode(HistorySamples const& _samples);
+
+    /// \brief Parses a block.
+    /// \param _data The block, e.g. a memory mapped block file.
+    /// \param _size The size of the block.
+    /// \param _verify Whether to verify the checksum.
+    /// \throws std::runtime_error if the block is malformed.
+    CompressedBlock(std::uint8_t const* _data, std::size_t _size,
+                    bool _verify = false);
+
+    /// \brief Returns the header.
+    Header const& header() const noexcept;
+
+    /// \brief Returns the first timestamp of every chunk.
+    std::vector<std::uint32_t> chunkTimes() const;
+
+    /// \brief Appends all samples within [_from, _to] to _samples.
+    void decode(std::uint32_t _from, std::uint32_t _to,
+                HistorySamples& _samples) const;
+
+  private:
+    /// \brief Returns the _index th entry of the chunk table.
+    Chunk chunk(std::size_t _index) const noexcept;
+
+    /// The chunk table.
+    std::uint8_t const* table_;
+    /// The payload.
+    std::uint8_t const* payload_;
+    /// The header.
+    Header header_;
+};
+} // namespace amadeus
+
+#endif // !WEBSOCKET_SERVER_COMPRESSED_BLOCK_HH
@@ -1,5 +1,7 @@
 #include "websocket_server/HttpSession.hh"
 
+#include <charconv>
+
 using namespace amadeus;
 
 beast::string_view mime_type(beast::string_view path)
@@ -83,3 +85,60 @@ std::string path_cat(beast::string_view base, beast::string_view path)
 #endif
     return result;
 }
+
+std::optional<std::string>
+amadeus::query_rollups(ReadingStore const& store, beast::string_view target)
+{
+    auto const number = [](beast::string_view value, auto& out) {
+        auto const end = value.data() + value.size();
+        auto const [ptr, ec] = std::from_chars(value.data(), end, out);
+        return ec == std::errc{} && ptr == end;
+    };
+
+    std::optional<std::underlying_type_t<StationId>> station;
+    std::optional<RollupLevel> level;
+    std::optional<std::uint32_t> from;
+    std::optional<std::uint32_t> to;
+
+    auto query = target.substr(target.find('?') + 1);
+    while (!query.empty()) {
+        auto const end = std::min(query.find('&'), query.size());
+        auto const pair = query.substr(0, end);
+        query.remove_prefix(std::min(end + 1, query.size()));
+
+        auto const eq = pair.find('=');
+        if (eq == beast::string_view::npos) {
+            return std::nullopt;
+        }
+        auto const key = pair.substr(0, eq);
+        auto const value = pair.substr(eq + 1);
+
+        if (key == "stationId") {
+            station.emplace();
+            if (!number(value, *station)) {
+                return std::nullopt;
+            }
+        } else if (key == "resolution") {
+            level = parseRollupLevel({value.data(), value.size()});
+            if (!level) {
+                return std::nullopt;
+            }
+        } else if (key == "from" || key == "to") {
+            auto& bound = key == "from" ? from : to;
+            bound.emplace();
+            if (!number(value, *bound)) {
+                return std::nullopt;
+            }
+        }
+    }
+
+    if (!station || !level || !from || !to ||
+        *station >= static_cast<std::size_t>(StationId::Max)) {
+        return std::nullopt;
+    }
+
+    auto const id = static_cast<StationId>(*station);
+    return encodeRollups(id, *level, store.rollups().query(id, *level, *from,
+                                                           *to))
+        .dump();
+}
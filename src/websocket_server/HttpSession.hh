@@ -8,6 +8,7 @@
 #include "websocket_server/SharedState.hh"
 #include "websocket_server/Common.hh"
 #include "websocket_server/Logger.hh"
+#include "websocket_server/Metrics.hh"
 
 #include <boost/beast/core/stream_traits.hpp>
 #include <boost/beast/core/flat_buffer.hpp>
@@ -34,12 +35,19 @@ beast::string_view mime_type(beast::string_view path);
 std::string path_cat(beast::string_view base, beast::string_view path);
 
 namespace amadeus {
+/// \brief Answers a rollup query of the form
+/// /rollups?stationId=1&resolution=hour&from=1609459200&to=1609545600
+/// \returns The JSON response or an empty optional if the query is malformed.
+std::optional<std::string> query_rollups(ReadingStore const& store,
+                                         beast::string_view target);
+
 /// \brief This function produces an HTTP response for the given
 /// request. The type of the response object depends on the
 /// contents of the request, so the interface requires the
 /// caller to pass a generic lambda for receiving the response.
 template <class Body, class Allocator, class Send>
-void handle_request(beast::string_view doc_root,
+void handle_request(beast::string_view doc_root, Metrics const& metrics,
+                    ReadingStore const& store,
                     http::request<Body, http::basic_fields<Allocator>>&& req,
                     Send&& send)
 {
@@ -89,6 +97,34 @@ void handle_request(beast::string_view doc_root,
         req.target().find("..") != beast::string_view::npos)
         return send(bad_request("Illegal request-target"));
 
+    // Serve the server metrics
+    if (req.method() == http::verb::get && req.target() == "/metrics") {
+        http::response<http::string_body> res{http::status::ok, req.version()};
+        res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+        res.set(http::field::content_type, "text/plain; version=0.0.4");
+        res.keep_alive(req.keep_alive());
+        res.body() = metrics.format();
+        res.prepare_payload();
+        return send(std::move(res));
+    }
+
+    // Serve the rollups of a station
+    if (req.method() == http::verb::get &&
+        req.target().starts_with("/rollups?")) {
+        auto body = query_rollups(store, req.target());
+        if (!body) {
+            return send(bad_request("Illegal rollup query"));
+        }
+
+        http::response<http::string_body> res{http::status::ok, req.version()};
+        res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+        res.set(http::field::content_type, "application/json");
+        res.keep_alive(req.keep_alive());
+        res.body() = std::move(*body);
+        res.prepare_payload();
+        return send(std::move(res));
+    }
+
     // Build the path to the requested file
     std::string path = path_cat(doc_root, req.target());
     if (req.target().back() == '/')
@@ -184,7 +220,9 @@ class HttpSession
 
         // handle the request
         handle_request(
-            state_->docRoot(), parser_->release(), [this](auto&& response) {
+            state_->docRoot(), state_->metrics(), state_->readingStore(),
+            parser_->release(),
+            [this](auto&& response) {
                 // The lifetime of the message has to extend
                 // for the duration of the async operation so
                 // we use a shared_ptr to manage it.
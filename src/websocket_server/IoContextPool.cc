@@ -0,0 +1,90 @@
+#include "websocket_server/IoContextPool.hh"
+#include "websocket_server/Logger.hh"
+
+#include <stdexcept>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace amadeus;
+
+IoContextPool::IoContextPool(std::size_t _size, bool _pinThreads /*= false*/)
+    : pinThreads_(_pinThreads)
+{
+    if (_size == 0) {
+        throw std::invalid_argument("IoContextPool size must be at least 1.");
+    }
+
+    contexts_.reserve(_size);
+    guards_.reserve(_size);
+    for (std::size_t i = 0; i < _size; ++i) {
+        // Each io_context is only ever run by a single thread. The hint
+        // allows asio to elide most of its internal locking.
+        contexts_.emplace_back(std::make_unique<asio::io_context>(1));
+        guards_.emplace_back(asio::make_work_guard(*contexts_.back()));
+    }
+}
+
+IoContextPool::~IoContextPool()
+{
+    stop();
+    for (auto& t : threads_) {
+        if (t.joinable()) {
+            t.join();
+        }
+    }
+}
+
+std::size_t IoContextPool::size() const noexcept
+{
+    return contexts_.size();
+}
+
+asio::io_context& IoContextPool::at(std::size_t _shard) noexcept
+{
+    return *contexts_[_shard];
+}
+
+void IoContextPool::runShard(std::size_t _shard)
+{
+#if defined(__linux__)
+    if (pinThreads_) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(static_cast<int>(_shard % CPU_SETSIZE), &set);
+        if (auto const ec =
+                pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) {
+            LOG_WARN("Unable to pin shard {} to its CPU: {}\n", _shard, ec);
+        }
+    }
+#endif
+    contexts_[_shard]->run();
+}
+
+void IoContextPool::run()
+{
+    threads_.reserve(contexts_.size() - 1);
+    for (std::size_t i = 1; i < contexts_.size(); ++i) {
+        threads_.emplace_back([this, i] { runShard(i); });
+    }
+
+    runShard(0);
+
+    // Wait for the other shards to finish.
+    for (auto& t : threads_) {
+        t.join();
+    }
+    threads_.clear();
+}
+
+void IoContextPool::stop()
+{
+    for (auto& guard : guards_) {
+        guard.reset();
+    }
+    for (auto& ctx : contexts_) {
+        ctx->stop();
+    }
+}
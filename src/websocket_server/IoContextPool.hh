@@ -0,0 +1,69 @@
+#ifndef WEBSOCKET_SERVER_IO_CONTEXT_POOL_HH
+#define WEBSOCKET_SERVER_IO_CONTEXT_POOL_HH
+
+#include "websocket_server/asiofwd.hh"
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace amadeus {
+/// \brief A pool of io_contexts where each io_context is run by exactly one
+/// thread ("one io_context per core"). Every shard owns its own listeners and
+/// all sessions accepted by a shard stay on that shard for their entire
+/// lifetime. As a consequence, no handler of a session is ever executed
+/// concurrently and strands are not needed at all.
+class IoContextPool
+{
+    /// Keeps an io_context from running out of work.
+    using WorkGuard = asio::executor_work_guard<asio::io_context::executor_type>;
+
+  private:
+    /// The io_contexts, one per shard.
+    std::vector<std::unique_ptr<asio::io_context>> contexts_;
+    /// The work guards for each io_context.
+    std::vector<WorkGuard> guards_;
+    /// The threads running the shards 1..N-1. Shard 0 is run by the caller.
+    std::vector<std::thread> threads_;
+    /// Whether each shard thread should be pinned to the CPU with the same
+    /// index as the shard.
+    bool pinThreads_;
+
+    /// \brief Runs the given shard on the calling thread.
+    /// \param _shard The shard index.
+    void runShard(std::size_t _shard);
+
+  public:
+    /// \brief Creates the pool.
+    /// \param _size The number of shards. Must be at least 1.
+    /// \param _pinThreads Pin the thread of shard N to CPU N. This is required
+    /// for SO_INCOMING_CPU steering to be of any use.
+    explicit IoContextPool(std::size_t _size, bool _pinThreads = false);
+
+    /// \brief Destructor. Stops and joins all shards.
+    ~IoContextPool();
+
+    IoContextPool(IoContextPool const&) = delete;
+    IoContextPool& operator=(IoContextPool const&) = delete;
+
+    /// \brief Returns the number of shards.
+    std::size_t size() const noexcept;
+
+    /// \brief Returns the io_context for a given shard.
+    /// \param _shard The shard index.
+    asio::io_context& at(std::size_t _shard) noexcept;
+
+    /// \brief Runs all shards. Shard 0 is run on the calling thread, which
+    /// blocks until the pool has been stopped and all shards have returned.
+    void run();
+
+    /// \brief Stops all shards. Safe to call from any thread.
+    void stop();
+};
+} // namespace amadeus
+
+#endif // !WEBSOCKET_SERVER_IO_CONTEXT_POOL_HH
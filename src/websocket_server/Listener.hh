@@ -13,11 +13,27 @@
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/beast/core/error.hpp>
 
+#include <stdexcept>
 #include <type_traits>
 #include <optional>
 #include <memory>
 
 namespace amadeus {
+/// \brief Options describing how a Listener binds its acceptor and which
+/// executor the accepted sessions are bound to.
+struct ListenerOptions
+{
+    /// Whether every accepted connection is wrapped in its own strand. This is
+    /// required as long as the io_context is run by more than one thread.
+    bool strand{true};
+    /// Whether SO_REUSEPORT is set on the acceptor so that one acceptor per
+    /// shard can bind the very same endpoint.
+    bool reusePort{false};
+    /// If set, SO_INCOMING_CPU is set on the acceptor so that the kernel
+    /// prefers this acceptor for connections processed on the given CPU.
+    std::optional<int> incomingCpu;
+};
+
 /// \brief This class is responsible for accepting incoming connections. It is
 /// important to note, that this class does not 'manage' any newly created
 /// connection by any means. In fact, the connection itself is responsible for
@@ -38,17 +54,54 @@ class Listener
     tcp::endpoint endpoint_;
     /// The shared state for each session.
     std::shared_ptr<SharedState> state_;
+    /// The acceptor options.
+    ListenerOptions options_;
 
   private:
     /// \brief Accepts new incoming connections.
     void doAccept()
     {
-        // Every new connections gets its own strand to make sure that their
-        // handlers are not executed concurrently.
-        acceptor_.async_accept(asio::make_strand(io_),
-                               [this](auto&& ec, auto&& socket) {
-                                   onAccept(ec, std::move(socket));
-                               });
+        auto handler = [this](auto&& ec, auto&& socket) {
+            onAccept(ec, std::move(socket));
+        };
+
+        if (options_.strand) {
+            // Every new connections gets its own strand to make sure that
+            // their handlers are not executed concurrently.
+            acceptor_.async_accept(asio::make_strand(io_), std::move(handler));
+        } else {
+            // The io_context is run by a single thread, the session simply
+            // stays on it.
+            acceptor_.async_accept(io_, std::move(handler));
+        }
+    }
+
+    /// \brief Applies the socket options which are required for running one
+    /// acceptor per shard on the same endpoint.
+    /// \throw std::runtime_error if the platform lacks support for them.
+    void setShardingOptions()
+    {
+        if (options_.reusePort) {
+#if defined(SO_REUSEPORT)
+            using reuse_port =
+                asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+            acceptor_.set_option(reuse_port(true));
+#else
+            throw std::runtime_error(
+                "SO_REUSEPORT is not supported on this platform.");
+#endif
+        }
+
+        if (options_.incomingCpu) {
+#if defined(SO_INCOMING_CPU)
+            using incoming_cpu =
+                asio::detail::socket_option::integer<SOL_SOCKET,
+                                                     SO_INCOMING_CPU>;
+            acceptor_.set_option(incoming_cpu(*options_.incomingCpu));
+#else
+            LOG_WARN("SO_INCOMING_CPU is not supported on this platform.\n");
+#endif
+        }
     }
 
     /// \brief Called each time a new connection was accepted.
@@ -84,13 +137,18 @@ class Listener
     /// \param _io A reference to the main IO-Context.
     /// \param _ctx A reference to the main SSL-Context.
     /// \param _endpoint The endpoint to which the tcp acceptor will listen to.
+    /// \param _state The SharedState.
+    /// \param _options The acceptor options.
     Listener(asio::io_context& _io, ssl::context* _ctx, tcp::endpoint _endpoint,
-             std::shared_ptr<SharedState> _state)
+             std::shared_ptr<SharedState> _state,
+             ListenerOptions _options = {})
         : io_(_io)
         , ctx_(_ctx)
-        , acceptor_(asio::make_strand(_io))
+        , acceptor_(_options.strand ? tcp::acceptor(asio::make_strand(_io))
+                                    : tcp::acceptor(_io))
         , endpoint_(std::move(_endpoint))
         , state_(std::move(_state))
+        , options_(std::move(_options))
     {
     }
 
@@ -108,6 +166,7 @@ class Listener
         // listening for new connections.
         acceptor_.open(endpoint_.protocol());
         acceptor_.set_option(asio::socket_base::reuse_address(true));
+        setShardingOptions();
         acceptor_.bind(endpoint_);
         acceptor_.listen(asio::socket_base::max_listen_connections);
 
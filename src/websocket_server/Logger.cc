@@ -1,7 +1,10 @@
 #include "websocket_server/Logger.hh"
 
 #include <chrono>
+#include <ctime>
+#include <iterator>
 #include <ostream>
+#include <vector>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -12,23 +15,6 @@ using namespace std::string_view_literals;
 
 namespace amadeus {
 namespace details {
-template <typename T>
-std::string timeFormat(std::chrono::time_point<T> time)
-{
-    using namespace std::chrono;
-
-    auto curr_time = T::to_time_t(time);
-    char sRep[100];
-    strftime(sRep, sizeof(sRep), "%Y-%m-%d %H:%M:%S", localtime(&curr_time));
-
-    auto since_epoch = time.time_since_epoch();
-    auto const s = duration_cast<seconds>(since_epoch);
-    since_epoch -= s;
-    auto const milli = duration_cast<milliseconds>(since_epoch);
-
-    return fmt::format("{}:{}", sRep, milli.count());
-}
-
 LogMessage::LogMessage(ClockType::time_point _logTime, source_location _loc,
                        LoggerSeverity _severity, std::string_view const& _msg)
     : time_(_logTime)
@@ -69,16 +55,36 @@ static void setColorMode()
 }
 #endif
 
+Logger::Logger()
+    : sink_([this] { run(); })
+{
+#ifdef _WIN32
+    setColorMode();
+#endif
+}
+
 Logger::Logger(std::string const& _filename, bool _console /*= true*/)
     : filename_(_filename)
     , console_(_console)
     , fileStream_(_filename)
+    , fileOpen_(fileStream_.is_open())
+    , sink_([this] { run(); })
 {
 #ifdef _WIN32
     setColorMode();
 #endif
 }
 
+Logger::~Logger()
+{
+    running_.store(false, std::memory_order_release);
+    {
+        std::scoped_lock<std::mutex> lk(wakeMtx_);
+        wake_.notify_one();
+    }
+    sink_.join();
+}
+
 Logger& Logger::instance() noexcept
 {
     static Logger instance{};
@@ -87,12 +93,12 @@ Logger& Logger::instance() noexcept
 
 LoggerSeverity Logger::severity() const noexcept
 {
-    return severity_;
+    return severity_.load(std::memory_order_relaxed);
 }
 
 void Logger::severity(LoggerSeverity _severity) noexcept
 {
-    severity_ = _severity;
+    severity_.store(_severity, std::memory_order_relaxed);
 }
 
 std::string const& Logger::filename() const noexcept
@@ -102,23 +108,174 @@ std::string const& Logger::filename() const noexcept
 
 void Logger::open(std::string&& _filename)
 {
+    std::scoped_lock<std::mutex> lk(fileMtx_);
     filename_ = std::move(_filename);
     fileStream_.open(filename_);
+    fileOpen_.store(fileStream_.is_open(), std::memory_order_relaxed);
 }
 
 bool Logger::hasConsoleSink() const noexcept
 {
-    return console_;
+    return console_.load(std::memory_order_relaxed);
+}
+
+void Logger::console(bool _console) noexcept
+{
+    console_.store(_console, std::memory_order_relaxed);
+}
+
+bool Logger::binary(std::string const& _filename)
+{
+    return binary_.open(_filename);
+}
+
+LogOverflowPolicy Logger::overflow() const noexcept
+{
+    return overflow_.load(std::memory_order_relaxed);
+}
+
+void Logger::overflow(LogOverflowPolicy _policy) noexcept
+{
+    overflow_.store(_policy, std::memory_order_relaxed);
+}
+
+std::uint64_t Logger::dropped() const noexcept
+{
+    return dropped_.load(std::memory_order_relaxed);
+}
+
+void Logger::push(details::LogRecord&& _record)
+{
+    if (queue_.try_push(std::move(_record))) {
+        return;
+    }
+
+    // the queue is full, make sure the sink thread is awake
+    wake_.notify_one();
+
+    auto const block = _record.written != nullptr ||
+                       overflow_.load(std::memory_order_relaxed) ==
+                           LogOverflowPolicy::Block;
+    if (!block) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    while (!queue_.try_push(std::move(_record))) {
+        if (!running_.load(std::memory_order_acquire)) {
+            return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+void Logger::flush()
+{
+    if (!running_.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    std::atomic<bool> written{false};
+    details::LogRecord marker;
+    marker.written = &written;
+    push(std::move(marker));
+    wake_.notify_one();
+
+    while (!written.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+}
+
+void Logger::run()
+{
+    std::vector<std::atomic<bool>*> markers;
+
+    for (;;) {
+        auto const stopping = !running_.load(std::memory_order_acquire);
+
+        std::size_t count{0};
+        while (count < MaxBatch) {
+            auto record = queue_.try_pop();
+            if (!record) {
+                break;
+            }
+            ++count;
+            if (record->written != nullptr) {
+                markers.push_back(record->written);
+                continue;
+            }
+            details::LogMessage msg(record->time, record->source,
+                                    record->severity, record->message());
+            log(msg, record->severity);
+        }
+
+        // entries logged before a flush marker are visible by now
+        binary_.drain();
+
+        if (overflow_.load(std::memory_order_relaxed) ==
+            LogOverflowPolicy::Count) {
+            auto const dropped = dropped_.load(std::memory_order_relaxed);
+            if (dropped != reported_) {
+                auto const text = fmt::format("{} log messages dropped.\n",
+                                              dropped - reported_);
+                details::LogMessage msg(LoggerSeverity::Warn, text);
+                log(msg, LoggerSeverity::Warn);
+                reported_ = dropped;
+            }
+        }
+
+        write();
+        for (auto const written : markers) {
+            written->store(true, std::memory_order_release);
+        }
+        markers.clear();
+
+        if (count == MaxBatch) {
+            continue;
+        }
+        if (stopping) {
+            break;
+        }
+
+        std::unique_lock<std::mutex> lk(wakeMtx_);
+        wake_.wait_for(lk, FlushInterval, [this] {
+            return !running_.load(std::memory_order_relaxed);
+        });
+    }
+}
+
+void Logger::write()
+{
+    if (fileBatch_.size() > 0) {
+        std::scoped_lock<std::mutex> lk(fileMtx_);
+        if (fileStream_.is_open()) {
+            fileStream_.write(fileBatch_.data(),
+                              static_cast<std::streamsize>(fileBatch_.size()));
+            fileStream_.flush();
+        }
+        fileBatch_.clear();
+    }
+
+    if (consoleBatch_.size() > 0) {
+        if (console_.load(std::memory_order_relaxed)) {
+            std::fwrite(consoleBatch_.data(), sizeof(char),
+                        consoleBatch_.size(), stdout);
+            std::fflush(stdout);
+        }
+        consoleBatch_.clear();
+    }
 }
 
 constexpr auto severityName(LoggerSeverity _severity) noexcept
     -> std::string_view
 {
     switch (_severity) {
-    case LoggerSeverity::Info:
-        return "INFO"sv;
+    case LoggerSeverity::Trace:
+        return "TRACE"sv;
     case LoggerSeverity::Debug:
         return "DEBUG"sv;
+    case LoggerSeverity::Info:
+        return "INFO"sv;
     case LoggerSeverity::Warn:
         return "WARN"sv;
     case LoggerSeverity::Error:
@@ -133,10 +290,19 @@ constexpr auto severityName(LoggerSeverity _severity) noexcept
 
 void Logger::log(details::LogMessage const& _msg, LoggerSeverity _severity)
 {
-    auto const color = colorBySeverity(_severity);
-    // Example: [INFO] <-- With dedicated color
-    auto const severityColor = fmt::format(fmt::emphasis::bold | fmt::fg(color),
-                                           severityName(_severity));
+    // the date and time only change once per second
+    auto const time = details::ClockType::to_time_t(_msg.time());
+    if (time != prefixTime_) {
+        char buffer[32];
+        std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S",
+                      std::localtime(&time));
+        timePrefix_ = buffer;
+        prefixTime_ = time;
+    }
+    auto const milli = std::chrono::duration_cast<std::chrono::milliseconds>(
+                           _msg.time().time_since_epoch())
+                           .count() %
+                       1000;
 
     // ignore file path
     std::string_view fileName{_msg.source().file_name()};
@@ -148,21 +314,22 @@ void Logger::log(details::LogMessage const& _msg, LoggerSeverity _severity)
     auto const filePos = fileName.find_last_of(Delimiter) + 1;
     fileName = fileName.substr(filePos);
 
-    auto const formatted =
-        fmt::format("[{}] [{}] {} {}:{} {}", details::timeFormat(_msg.time()),
-                    severityColor, _msg.source().function_name(), fileName,
-                    _msg.source().line(), _msg.message());
-
-    // Write to file stream
-    auto const severityNoColor = fmt::format(severityName(_severity));
-
-    fileStream_ << fmt::format("[{}] [{}] {} {}:{} {}",
-                               details::timeFormat(_msg.time()),
-                               severityNoColor, _msg.source().function_name(),
-                               fileName, _msg.source().line(), _msg.message());
-    fileStream_.flush();
+    // Example: [INFO] <-- With dedicated color
+    if (console_.load(std::memory_order_relaxed)) {
+        auto const color = colorBySeverity(_severity);
+        fmt::format_to(std::back_inserter(consoleBatch_),
+                       "[{}:{}] [{}] {} {}:{} {}", timePrefix_, milli,
+                       fmt::format(fmt::emphasis::bold | fmt::fg(color),
+                                   severityName(_severity)),
+                       _msg.source().function_name(), fileName,
+                       _msg.source().line(), _msg.message());
+    }
 
-    // Write to console
-    std::fwrite(formatted.c_str(), sizeof(char), formatted.size(), stdout);
-    std::fflush(stdout);
-}
\ No newline at end of file
+    if (fileOpen_.load(std::memory_order_relaxed)) {
+        fmt::format_to(std::back_inserter(fileBatch_),
+                       "[{}:{}] [{}] {} {}:{} {}", timePrefix_, milli,
+                       severityName(_severity),
+                       _msg.source().function_name(), fileName,
+                       _msg.source().line(), _msg.message());
+    }
+}
@@ -1,6 +1,9 @@
 #ifndef WEBSOCKET_SERVER_LOGGER_HH
 #define WEBSOCKET_SERVER_LOGGER_HH
 
+#include "websocket_server/BinaryLog.hh"
+#include "websocket_server/utils/bounded_queue.hh"
+#include "websocket_server/utils/hex_dump.hh"
 #include "websocket_server/utils/source_location.hh"
 
 #include <fmt/color.h>
@@ -8,25 +11,59 @@
 #include <fmt/format.h>
 #include <fmt/ostream.h>
 
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
 #include <fstream>
+#include <iterator>
+#include <mutex>
 #include <string>
 #include <string_view>
 #include <fstream>
 #include <chrono>
+#include <thread>
 
 namespace amadeus {
 /// \brief Defines the LoggerSeverity enum which essentially represents the
 /// level for logging.
 enum class LoggerSeverity
 {
-    Info,
+    Trace,
     Debug,
+    Info,
     Warn,
     Error,
     Fatal,
     Off
 };
 
+#ifndef WEBSOCKET_SERVER_LOG_LEVEL
+/// \def The minimum severity which is compiled in, set by the LOG_LEVEL CMake
+/// option. Calls of the LOG_* macros below it compile to nothing, their
+/// arguments are not evaluated.
+#define WEBSOCKET_SERVER_LOG_LEVEL Trace
+#endif
+
+/// \brief The minimum severity which is compiled in.
+inline constexpr LoggerSeverity CompiledSeverity{
+    LoggerSeverity::WEBSOCKET_SERVER_LOG_LEVEL};
+
+/// \brief Defines what happens to a log message if the queue of the
+/// \ref Logger is full.
+enum class LogOverflowPolicy
+{
+    /// The logging thread waits until the sink thread made room.
+    Block,
+    /// The message is dropped.
+    Drop,
+    /// The message is dropped and the sink thread writes the number of
+    /// dropped messages to the log.
+    Count,
+};
+
 namespace details {
 using ClockType = std::chrono::system_clock;
 
@@ -69,35 +106,111 @@ class LogMessage final
     source_location source_;
     std::string_view message_;
 };
+
+/// \brief A formatted log message on its way from the logging thread to the
+/// sink thread. Short messages are stored inline so that logging does not
+/// allocate.
+struct LogRecord
+{
+    /// The number of characters stored inline.
+    static constexpr std::size_t InlineSize{168};
+
+    ClockType::time_point time;
+    source_location source;
+    LoggerSeverity severity{LoggerSeverity::Off};
+    /// The size of the inline message.
+    std::uint32_t size{0};
+    /// Set by the sink thread once it has written all prior messages, only
+    /// used by \ref Logger::flush.
+    std::atomic<bool>* written{nullptr};
+    /// Messages which do not fit inline.
+    std::string overflow;
+    /// The inline message.
+    std::array<char, InlineSize> text;
+
+    /// \brief Returns the message.
+    std::string_view message() const noexcept
+    {
+        return overflow.empty() ? std::string_view(text.data(), size)
+                                : std::string_view(overflow);
+    }
+};
 } // namespace details
 
 /// \brief Represents a simple singleton Logger class design for writing to
 /// stdout and files.
+/// Logging never touches the sinks: the calling thread only formats the
+/// message and hands it to a background sink thread through a lock-free
+/// queue. The sink thread writes the messages in the order they were queued
+/// and batches them, so the sinks are written and flushed at most once every
+/// \ref FlushInterval. Fatal messages are flushed before the call returns.
+/// \remarks Thread-Safe.
 class Logger final
 {
   public:
+    /// The number of messages which may be queued for the sink thread.
+    static constexpr std::size_t QueueCapacity{8192};
+    /// The maximum number of messages written at once.
+    static constexpr std::size_t MaxBatch{1024};
+    /// How long the sink thread sleeps if there are no messages.
+    static constexpr std::chrono::milliseconds FlushInterval{10};
+
     /// \brief The default constructor.
-    Logger() = default;
+    Logger();
     /// \brief Constructor.
     /// \param _filename The filename where the log file will be written and
     /// saved to. \param _console Whether to output the log to the console or
     /// not.
     Logger(std::string const& _filename, bool _console = true);
 
+    /// \brief Writes all queued messages and stops the sink thread.
+    ~Logger();
+
+    Logger(Logger const&) = delete;
+    Logger& operator=(Logger const&) = delete;
+
     /// \brief Creates an instance for the logger or returns the current
     /// instance if one has already been created.
     static Logger& instance() noexcept;
 
     /// \brief Helper function for logging to console.
-    template <typename FormatString, typename... Args>
-    void log(source_location const& _loc, LoggerSeverity _severity,
+    /// \tparam Site A type unique to the call site, used by the binary log.
+    template <typename Site, typename FormatString, typename... Args>
+    void log(Site, source_location const& _loc, LoggerSeverity _severity,
              FormatString const& _fmt, Args&&... _args)
     {
-        if (shouldLog(_severity) && console_ && fileStream_.is_open()) {
-            _log(_loc, _severity, _fmt, std::forward<Args>(_args)...);
+        if (!enabled(_severity)) {
+            return;
+        }
+
+        // only warnings and errors are also written as text
+        if (binary_.isOpen() &&
+            binary_.write<Site>(
+                overflow_.load(std::memory_order_relaxed) ==
+                    LogOverflowPolicy::Block,
+                [this] { wake_.notify_one(); }, _loc,
+                static_cast<std::uint8_t>(_severity), _fmt, _args...) &&
+            (_severity < LoggerSeverity::Warn || !hasTextSink())) {
+            if (_severity == LoggerSeverity::Fatal) {
+                flush();
+            }
+            return;
         }
+        _log(_loc, _severity, _fmt, std::forward<Args>(_args)...);
     }
 
+    /// \brief Returns true if a message of the given severity would be
+    /// written to any sink. The LOG_* macros check this before they evaluate
+    /// their arguments.
+    /// \param _severity The given log severity to check.
+    bool enabled(LoggerSeverity _severity) const noexcept
+    {
+        return shouldLog(_severity) && (hasTextSink() || binary_.isOpen());
+    }
+
+    /// \brief Blocks until all messages logged so far are written.
+    void flush();
+
     /// \brief Helper function for logging to console.
     template <typename... Args>
     void print(std::string_view _fmt, Args&&... _args)
@@ -134,12 +247,40 @@ class Logger final
     /// otherwise returns false.
     bool hasConsoleSink() const noexcept;
 
+    /// \brief Opens a binary log file. From now on messages are written to
+    /// it with deferred formatting, see \ref BinaryLog. Only warnings and
+    /// errors are still written to the console and the text log file.
+    /// \param _filename The file to create.
+    /// \returns false if the file cannot be created.
+    bool binary(std::string const& _filename);
+
+    /// \brief Sets whether the output should be written to the console.
+    void console(bool _console) noexcept;
+
+    /// \brief Returns the overflow policy.
+    LogOverflowPolicy overflow() const noexcept;
+
+    /// \brief Sets the overflow policy.
+    /// \param _policy The policy to set.
+    void overflow(LogOverflowPolicy _policy) noexcept;
+
+    /// \brief Returns the number of messages dropped because the queue was
+    /// full.
+    std::uint64_t dropped() const noexcept;
+
   private:
+    /// \brief Returns true if the console or the text log file is written.
+    bool hasTextSink() const noexcept
+    {
+        return console_.load(std::memory_order_relaxed) ||
+               fileOpen_.load(std::memory_order_relaxed);
+    }
+
     /// \brief Returns true if the given log severity is active.
     /// \param _severity The given log severity to check.
-    constexpr bool shouldLog(LoggerSeverity _severity) const noexcept
+    bool shouldLog(LoggerSeverity _severity) const noexcept
     {
-        return _severity >= severity_;
+        return _severity >= severity_.load(std::memory_order_relaxed);
     }
 
     /// \brief Returns the color by a given log severity.
@@ -147,10 +288,12 @@ class Logger final
     constexpr fmt::color colorBySeverity(LoggerSeverity _severity) noexcept
     {
         switch (_severity) {
-        case LoggerSeverity::Info:
-            return fmt::color::green;
+        case LoggerSeverity::Trace:
+            return fmt::color::gray;
         case LoggerSeverity::Debug:
             return fmt::color::aqua;
+        case LoggerSeverity::Info:
+            return fmt::color::green;
         case LoggerSeverity::Warn:
             return fmt::color::gold;
         case LoggerSeverity::Error:
@@ -163,7 +306,7 @@ class Logger final
         return fmt::color::white;
     }
 
-    /// \brief Helper function for logging to console.
+    /// \brief Formats a message into the batches of the sinks.
     void log(details::LogMessage const& _msg, LoggerSeverity _severity);
 
     /// \brief Helper function for logging to console.
@@ -171,35 +314,101 @@ class Logger final
     void _log(source_location _loc, LoggerSeverity _severity,
               FormatString const& _fmt, Args&&... _args)
     {
-        fmt::memory_buffer buf;
-        fmt::format_to(buf, _fmt, std::forward<Args>(_args)...);
-        details::LogMessage msg(_loc, _severity,
-                                std::string_view(buf.data(), buf.size()));
-        log(msg, _severity);
+        details::LogRecord record;
+        record.time = details::ClockType::now();
+        record.source = _loc;
+        record.severity = _severity;
+        fmt::basic_memory_buffer<char, details::LogRecord::InlineSize> buf;
+        fmt::format_to(std::back_inserter(buf), _fmt,
+                       std::forward<Args>(_args)...);
+        if (buf.size() > record.text.size()) {
+            record.overflow.assign(buf.data(), buf.size());
+        } else {
+            std::memcpy(record.text.data(), buf.data(), buf.size());
+            record.size = static_cast<std::uint32_t>(buf.size());
+        }
+        push(std::move(record));
+
+        if (_severity == LoggerSeverity::Fatal) {
+            flush();
+        }
     }
 
+    /// \brief Queues a record for the sink thread according to the overflow
+    /// policy.
+    void push(details::LogRecord&& _record);
+
+    /// \brief The sink thread.
+    void run();
+
+    /// \brief Writes the batches to the sinks.
+    void write();
+
     /// The file to save the log file.
     std::string filename_;
     /// Whether to write to the console or not.
-    bool console_{true};
-    /// The filestream.
+    std::atomic<bool> console_{true};
+    /// The filestream, only accessed by the sink thread once it is open.
     std::ofstream fileStream_;
+    /// Whether the filestream is open.
+    std::atomic<bool> fileOpen_{false};
+    /// Protects opening the filestream against the sink thread.
+    std::mutex fileMtx_;
     /// The logger severity.
-    LoggerSeverity severity_{LoggerSeverity::Info};
+    std::atomic<LoggerSeverity> severity_{LoggerSeverity::Debug};
+    /// What happens to a message if the queue is full.
+    std::atomic<LogOverflowPolicy> overflow_{LogOverflowPolicy::Count};
+    /// The messages handed from the logging threads to the sink thread.
+    bounded_queue<details::LogRecord> queue_{QueueCapacity};
+    /// The number of messages dropped because the queue was full.
+    std::atomic<std::uint64_t> dropped_{0};
+    /// The binary log, drained by the sink thread.
+    BinaryLog binary_{dropped_};
+    /// The number of dropped messages reported in the log.
+    std::uint64_t reported_{0};
+    /// The next batch of the file sink.
+    fmt::memory_buffer fileBatch_;
+    /// The next batch of the console sink.
+    fmt::memory_buffer consoleBatch_;
+    /// The second for which \ref timePrefix_ was formatted.
+    std::time_t prefixTime_{-1};
+    /// The formatted date and time of \ref prefixTime_.
+    std::string timePrefix_;
+    /// Whether the sink thread is running.
+    std::atomic<bool> running_{true};
+    /// Protects the wake-up of the sink thread.
+    std::mutex wakeMtx_;
+    /// Wakes up the sink thread early, e.g. if the queue is full.
+    std::condition_variable wake_;
+    /// The sink thread.
+    std::thread sink_;
 };
 } // namespace amadeus
 
 /// \def Internal macro for invoking the log function with the singleton and a
-/// given log severity.
+/// given log severity. Compiles to nothing if the severity is below
+/// \ref CompiledSeverity and does not evaluate the arguments unless the
+/// message is written.
 #define LOGGER_CALL(level, ...)                                                \
-    (Logger::instance()).log(source_location::current(), level, __VA_ARGS__)
-
-/// \def Macro for invoking the log function with the INFO severity.
-#define LOG_INFO(...) LOGGER_CALL(LoggerSeverity::Info, __VA_ARGS__)
+    do {                                                                       \
+        if constexpr (level >= CompiledSeverity) {                             \
+            if (auto& logger_ = Logger::instance(); logger_.enabled(level)) {  \
+                logger_.log([] {}, source_location::current(), level,          \
+                            __VA_ARGS__);                                      \
+            }                                                                  \
+        }                                                                      \
+    } while (false)
+
+/// \def Macro for invoking the log function with the TRACE severity, e.g. for
+/// dumping packets. Use \ref hex_dump for raw bytes.
+#define LOG_TRACE(...) LOGGER_CALL(LoggerSeverity::Trace, __VA_ARGS__)
 
 /// \def Macro for invoking the log function with the DEBUG severity.
 #define LOG_DEBUG(...) LOGGER_CALL(LoggerSeverity::Debug, __VA_ARGS__)
 
+/// \def Macro for invoking the log function with the INFO severity.
+#define LOG_INFO(...) LOGGER_CALL(LoggerSeverity::Info, __VA_ARGS__)
+
 /// \def Macro for invoking the log function with the WARN severity.
 #define LOG_WARN(...) LOGGER_CALL(LoggerSeverity::Warn, __VA_ARGS__)
 
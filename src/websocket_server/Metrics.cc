@@ -0,0 +1,140 @@
+#include "websocket_server/Metrics.hh"
+#include "websocket_server/Logger.hh"
+
+#include <fmt/format.h>
+
+#include <iterator>
+
+using namespace amadeus;
+
+double Metrics::collapseRatio() const noexcept
+{
+    auto const polls = weatherStatusPolls.load(std::memory_order_relaxed);
+    if (polls == 0) {
+        return 0.0;
+    }
+    return static_cast<double>(
+               weatherStatusRequests.load(std::memory_order_relaxed)) /
+           static_cast<double>(polls);
+}
+
+std::string Metrics::format() const
+{
+    fmt::memory_buffer out;
+
+    auto const counter = [&out](char const* _name, char const* _help,
+                                Counter const& _value) {
+        fmt::format_to(std::back_inserter(out),
+                       "# HELP {0} {1}\n# TYPE {0} counter\n{0} {2}\n", _name,
+                       _help, _value.load(std::memory_order_relaxed));
+    };
+    auto const gauge = [&out](char const* _name, char const* _help,
+                              Gauge const& _value) {
+        fmt::format_to(std::back_inserter(out),
+                       "# HELP {0} {1}\n# TYPE {0} gauge\n{0} {2}\n", _name,
+                       _help, _value.load(std::memory_order_relaxed));
+    };
+
+    counter("weather_status_requests_total",
+            "WeatherStatus requests for a single station from frontends.",
+            weatherStatusRequests);
+    counter("weather_status_coalesced_total",
+            "WeatherStatus requests attached to an outstanding poll.",
+            weatherStatusCoalesced);
+    counter("weather_status_polls_total", "WeatherStatus polls sent to µcs.",
+            weatherStatusPolls);
+    counter("weather_status_poll_timeouts_total",
+            "WeatherStatus polls not answered in time.",
+            weatherStatusPollTimeouts);
+    counter("weather_status_unmatched_replies_total",
+            "WeatherStatus replies which did not answer a pending poll.",
+            weatherStatusUnmatchedReplies);
+    counter("weather_status_pushes_total",
+            "WeatherStatus readings pushed by µcs without a poll.",
+            weatherStatusPushes);
+    counter("weather_status_batches_total",
+            "WeatherStatusBatch packets received from µcs.",
+            weatherStatusBatches);
+    counter("weather_status_batch_readings_total",
+            "Readings received in WeatherStatusBatch packets.",
+            weatherStatusBatchReadings);
+    counter("backfill_readings_total",
+            "Readings received in Backfill packets.", backfillReadings);
+    counter("backfill_duplicates_total",
+            "Backfill readings received before and skipped.",
+            backfillDuplicates);
+    counter("backfill_gaps_total",
+            "Backfill packets which did not continue the sequence.",
+            backfillGaps);
+    counter("tcp_packets_written_total", "Packets written to µcs.",
+            tcpPacketsWritten);
+    counter("tcp_writes_total", "Gathered writes to µcs.", tcpWrites);
+    counter("tcp_packets_dropped_total",
+            "Polls and backfill acks to µcs dropped on a full output queue.",
+            tcpPacketsDropped);
+    counter("ws_messages_written_total", "Messages written to frontends.",
+            wsMessagesWritten);
+    counter("ws_messages_dropped_total",
+            "Messages to frontends dropped because the queue was full.",
+            wsMessagesDropped);
+    counter("ws_messages_coalesced_total",
+            "Queued updates to frontends replaced by a newer one.",
+            wsMessagesCoalesced);
+    counter("ws_batched_notifications_total",
+            "Notifications to frontends merged into a batch message.",
+            wsBatchedNotifications);
+    counter("ws_updates_filtered_total",
+            "Updates not pushed to a subscriber because of its filter.",
+            wsUpdatesFiltered);
+    counter("ws_slow_consumer_disconnects_total",
+            "Frontends disconnected because their queue was full.",
+            wsSlowConsumerDisconnects);
+    gauge("ws_queued_messages", "Messages queued to frontends.",
+          wsQueuedMessages);
+    gauge("ws_queued_bytes", "The size of the messages queued to frontends.",
+          wsQueuedBytes);
+    counter("station_cache_hits_total",
+            "WeatherStatus requests answered from the station cache.",
+            stationCacheHits);
+    counter("station_cache_misses_total",
+            "WeatherStatus requests without a fresh cached reading.",
+            stationCacheMisses);
+    counter("store_readings_written_total",
+            "Readings written to the segment files.", storeReadingsWritten);
+    counter("store_readings_dropped_total",
+            "Readings dropped by the reading store.", storeReadingsDropped);
+    counter("store_readings_out_of_order_total",
+            "Readings stored in backfill segments, out of time order.",
+            storeReadingsOutOfOrder);
+    counter("store_batches_total", "Batches written by the reading store.",
+            storeBatches);
+    counter("store_fsyncs_total", "fsync calls of the reading store.",
+            storeFsyncs);
+    counter("store_compactions_total",
+            "Segments compacted into compressed blocks.", storeCompactions);
+    counter("store_compacted_raw_bytes_total",
+            "The size of all compacted segments.", storeCompactedRawBytes);
+    counter("store_compacted_block_bytes_total",
+            "The size of the compressed blocks written for them.",
+            storeCompactedBlockBytes);
+    counter("store_expirations_total",
+            "Segments and blocks deleted by the retention policy.",
+            storeExpirations);
+    counter("store_rollup_buckets_total",
+            "Finished rollup buckets written to the rollup files.",
+            storeRollupBuckets);
+
+    fmt::format_to(std::back_inserter(out),
+                   "# HELP log_messages_dropped_total Log messages dropped "
+                   "because the logger queue was full.\n# TYPE "
+                   "log_messages_dropped_total counter\n"
+                   "log_messages_dropped_total {}\n",
+                   Logger::instance().dropped());
+    fmt::format_to(std::back_inserter(out),
+                   "# HELP weather_status_collapse_ratio Frontend requests "
+                   "per µc poll.\n# TYPE weather_status_collapse_ratio "
+                   "gauge\nweather_status_collapse_ratio {}\n",
+                   collapseRatio());
+
+    return fmt::to_string(out);
+}
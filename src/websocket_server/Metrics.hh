@@ -0,0 +1,104 @@
+#ifndef WEBSOCKET_SERVER_METRICS_HH
+#define WEBSOCKET_SERVER_METRICS_HH
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace amadeus {
+/// \brief Server wide counters and gauges. They are updated with relaxed
+/// atomics from any thread and can be read at any time. They are served in the
+/// Prometheus text format under the HTTP target '/metrics'.
+struct Metrics
+{
+    /// The type of a single counter.
+    using Counter = std::atomic<std::uint64_t>;
+    /// The type of a single gauge, a value which goes up and down.
+    using Gauge = std::atomic<std::int64_t>;
+
+    /// WeatherStatus requests for a single station received from frontends.
+    Counter weatherStatusRequests{0};
+    /// WeatherStatus requests which were attached to an outstanding poll of
+    /// the same station instead of polling the µc again.
+    Counter weatherStatusCoalesced{0};
+    /// WeatherStatus polls sent to µcs.
+    Counter weatherStatusPolls{0};
+    /// WeatherStatus polls which were not answered in time.
+    Counter weatherStatusPollTimeouts{0};
+    /// WeatherStatus replies which did not answer a pending poll, e.g.
+    /// because the poll had timed out already.
+    Counter weatherStatusUnmatchedReplies{0};
+    /// WeatherStatus readings pushed by µcs without a poll.
+    Counter weatherStatusPushes{0};
+    /// WeatherStatusBatch packets received from µcs.
+    Counter weatherStatusBatches{0};
+    /// Readings received in WeatherStatusBatch packets.
+    Counter weatherStatusBatchReadings{0};
+    /// Readings received in Backfill packets.
+    Counter backfillReadings{0};
+    /// Backfill readings which had been received before and were skipped.
+    Counter backfillDuplicates{0};
+    /// Backfill packets which did not continue the sequence of the station.
+    Counter backfillGaps{0};
+    /// Packets written to µcs.
+    Counter tcpPacketsWritten{0};
+    /// Writes to µcs, each carrying all packets queued until then.
+    Counter tcpWrites{0};
+    /// Polls and backfill acknowledgements to µcs dropped because the output
+    /// queue was full. Control packets are never dropped.
+    Counter tcpPacketsDropped{0};
+    /// Messages written to frontends.
+    Counter wsMessagesWritten{0};
+    /// Messages to frontends dropped because the outbound queue of the
+    /// session was full.
+    Counter wsMessagesDropped{0};
+    /// Queued weather status updates to frontends which were replaced by a
+    /// newer update of the same station.
+    Counter wsMessagesCoalesced{0};
+    /// Notifications to frontends which were merged into a batch message,
+    /// see WebSocketSession::flushWindow.
+    Counter wsBatchedNotifications{0};
+    /// Weather status updates not pushed to a subscriber because its
+    /// subscription filter rejected them.
+    Counter wsUpdatesFiltered{0};
+    /// WebSocketSessions closed because their outbound queue was full.
+    Counter wsSlowConsumerDisconnects{0};
+    /// Messages queued to frontends which have not been written yet.
+    Gauge wsQueuedMessages{0};
+    /// The size of the messages queued to frontends.
+    Gauge wsQueuedBytes{0};
+    /// WeatherStatus requests answered from the station cache.
+    Counter stationCacheHits{0};
+    /// WeatherStatus requests which found no fresh reading in the cache.
+    Counter stationCacheMisses{0};
+    /// Readings written to the segment files of the reading store.
+    Counter storeReadingsWritten{0};
+    /// Readings dropped by the reading store, e.g. because its queue was full.
+    Counter storeReadingsDropped{0};
+    /// Readings written to a backfill segment by the reading store because
+    /// they were older than the last stored reading of their station.
+    Counter storeReadingsOutOfOrder{0};
+    /// Batches written by the writer thread of the reading store.
+    Counter storeBatches{0};
+    /// fsync calls issued by the reading store.
+    Counter storeFsyncs{0};
+    /// Sealed segments compacted into compressed blocks.
+    Counter storeCompactions{0};
+    /// The size of all compacted segments.
+    Counter storeCompactedRawBytes{0};
+    /// The size of the compressed blocks written for them.
+    Counter storeCompactedBlockBytes{0};
+    /// Segments and blocks deleted by the retention policy.
+    Counter storeExpirations{0};
+    /// Finished rollup buckets written to the rollup files.
+    Counter storeRollupBuckets{0};
+
+    /// \brief Returns the number of frontend requests per µc poll.
+    double collapseRatio() const noexcept;
+
+    /// \brief Renders all metrics in the Prometheus text exposition format.
+    std::string format() const;
+};
+} // namespace amadeus
+
+#endif // !WEBSOCKET_SERVER_METRICS_HH
@@ -0,0 +1,46 @@
+#ifndef WEBSOCKET_SERVER_OUTBOUND_QUEUE_OPTIONS_HH
+#define WEBSOCKET_SERVER_OUTBOUND_QUEUE_OPTIONS_HH
+
+#include <chrono>
+#include <cstddef>
+
+namespace amadeus {
+/// \brief Defines what a WebSocketSession does with a new message once its
+/// outbound queue reached the high-water mark, i.e. its frontend does not
+/// read fast enough.
+enum class OverflowPolicy
+{
+    /// The oldest queued messages are dropped until the new one fits. If it
+    /// does not even fit next to the message being written, the new message
+    /// is dropped.
+    DropOldest,
+    /// A weather status update replaces the newest queued update of the same
+    /// station in place, since only the latest reading of a station matters.
+    /// A bigger replacement drops the oldest queued messages like with \ref
+    /// DropOldest. Any other message is queued like with \ref DropOldest.
+    Coalesce,
+    /// The new message is dropped and the session is closed.
+    Disconnect,
+};
+
+/// \brief The high-water mark of the messages queued for a single
+/// WebSocketSession which have not been written yet. A new message which
+/// would exceed either limit is handled by the \ref OverflowPolicy. The
+/// message being written is never dropped, so a message is always queued
+/// into an empty queue, even if it is bigger than maxBytes. Also limits how
+/// long a session may batch its notifications.
+struct OutboundQueueOptions
+{
+    /// The maximum number of queued messages.
+    std::size_t maxMessages{1024};
+    /// The maximum number of queued bytes.
+    std::size_t maxBytes{std::size_t{4} << 20U};
+    /// What happens once the queue is full.
+    OverflowPolicy policy{OverflowPolicy::Coalesce};
+    /// The longest flush window a frontend may negotiate, zero disables
+    /// batching. Notifications are delayed by at most this long.
+    std::chrono::milliseconds maxFlushWindow{1000};
+};
+} // namespace amadeus
+
+#endif // !WEBSOCKET_SERVER_OUTBOUND_QUEUE_OPTIONS_HH
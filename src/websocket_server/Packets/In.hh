@@ -2,39 +2,36 @@
 #define WEBSOCKET_SERVER_IN_HH
 
 #include "websocket_server/Packets/Common.hh"
+#include "websocket_server/Packets/In/BackfillPacket.hh"
 #include "websocket_server/Packets/In/HandshakePacket.hh"
+#include "websocket_server/Packets/In/PacketType.hh"
 #include "websocket_server/Packets/In/PongPacket.hh"
+#include "websocket_server/Packets/In/WeatherStatusBatchPacket.hh"
 #include "websocket_server/Packets/In/WeatherStatusPacket.hh"
+#include "websocket_server/Packets/Schema.hh"
 
 #include <string_view>
 
 namespace amadeus {
 namespace in {
-/// \brief Defines the PacketType enum which represents all outgoing packets
-/// from the server.
-enum class PacketType : std::uint8_t
-{
-    Handshake = 0x00,
-    Pong = 0x01,
-    WeatherStatus = 0x02,
-};
+/// All incoming packets. A new packet only needs to be added here and be
+/// handled by the TCPRequestHandler.
+using Packets = PacketList<HandshakePacket, PongPacket, WeatherStatusPacket,
+                           WeatherStatusBatchPacket, BackfillPacket>;
+
+static_assert(uniquePacketIds(Packets{}), "Packet ids need to be unique.");
+
+/// The size and the name of every incoming packet by its id.
+inline constexpr PacketTable Table{makePacketTable(Packets{})};
 
-/// \brief Returns the exact size of the packet by a given valid PacketId.
+/// \brief Returns the exact size of the packet by a given valid PacketId. For
+/// a WeatherStatusBatchPacket or a BackfillPacket, this is the size of its
+/// fixed part only.
 /// \param _id The packet id.
 /// \return Exact size of the packet or 0 if packet id is not valid.
 constexpr std::size_t sizeByPacketId(PacketType _id) noexcept
 {
-    switch (_id) {
-    case PacketType::Handshake:
-        return sizeof(HandshakePacket);
-    case PacketType::Pong:
-        return sizeof(PongPacket);
-    case PacketType::WeatherStatus:
-        return sizeof(WeatherStatusPacket);
-    default:
-        break;
-    }
-    return 0;
+    return Table[static_cast<std::uint8_t>(_id)].size;
 }
 
 /// \brief Helper function for retrieving the packet name by a given packet id.
@@ -43,15 +40,7 @@ constexpr std::size_t sizeByPacketId(PacketType _id) noexcept
 /// 'unknown' if the supplied packet id is not valid.
 constexpr std::string_view packetNameById(PacketType _id) noexcept
 {
-    switch (_id) {
-    case PacketType::Handshake:
-        return "Handshake";
-    case PacketType::Pong:
-        return "Pong";
-    case PacketType::WeatherStatus:
-        return "WeatherStatus";
-    }
-    return "unknown";
+    return Table[static_cast<std::uint8_t>(_id)].name;
 }
 } // namespace in
 } // namespace amadeus
@@ -0,0 +1,52 @@
+#ifndef WEBSOCKET_SERVER_IN_BACKFILL_PACKET_HH
+#define WEBSOCKET_SERVER_IN_BACKFILL_PACKET_HH
+
+#include "websocket_server/Packets/In/PacketType.hh"
+#include "websocket_server/Packets/In/WeatherStatusBatchPacket.hh"
+#include "websocket_server/Packets/Schema.hh"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace amadeus {
+namespace in {
+/// \brief Defines the BackfillPacket which is sent by the TCP Client to
+/// upload readings it buffered while it was offline. The fixed part below is
+/// followed by 'count' packed WeatherReadings, the i th reading has the
+/// sequence number 'sequence' + i. Sequence numbers are per station and
+/// contiguous over all BackfillPackets of the station.
+struct BackfillPacket
+{
+    /// Packet header.
+    std::uint8_t header;
+    /// The sequence number of the first reading.
+    std::uint32_t sequence;
+    /// The number of readings following the packet.
+    std::uint16_t count;
+};
+} // namespace in
+
+template <>
+struct Schema<in::BackfillPacket>
+{
+    static constexpr auto id{in::PacketType::Backfill};
+    static constexpr std::string_view name{"Backfill"};
+    using fields =
+        Fields<&in::BackfillPacket::header, &in::BackfillPacket::sequence,
+               &in::BackfillPacket::count>;
+};
+
+namespace in {
+/// The maximum number of readings of a single BackfillPacket.
+inline constexpr std::size_t MaxBackfillReadings{256};
+
+/// \brief Returns the size of a BackfillPacket with the given number of
+/// readings.
+constexpr std::size_t backfillPacketSize(std::size_t _count) noexcept
+{
+    return wireSize<BackfillPacket> + _count * wireSize<WeatherReading>;
+}
+} // namespace in
+} // namespace amadeus
+
+#endif // !WEBSOCKET_SERVER_IN_BACKFILL_PACKET_HH
@@ -1,7 +1,11 @@
 #ifndef WEBSOCKET_SERVER_IN_HANDSHAKE_PACKET_HH
 #define WEBSOCKET_SERVER_IN_HANDSHAKE_PACKET_HH
 
+#include "websocket_server/Packets/In/PacketType.hh"
+#include "websocket_server/Packets/Schema.hh"
+
 #include <array>
+#include <cstdint>
 
 namespace amadeus {
 /// \brief Defines the available station ids.
@@ -13,7 +17,6 @@ enum class StationId : std::uint8_t
     Max,
 };
 
-#pragma pack(push, 1)
 namespace in {
 /// \brief Defines the HandshakePacket which is received from a connected TPC Client.
 struct HandshakePacket
@@ -25,8 +28,17 @@ struct HandshakePacket
     /// Another unique identifier to map the TCP Client.
     StationId stationId;
 };
-#pragma pack(pop)
 } // namespace in
+
+template <>
+struct Schema<in::HandshakePacket>
+{
+    static constexpr auto id{in::PacketType::Handshake};
+    static constexpr std::string_view name{"Handshake"};
+    using fields =
+        Fields<&in::HandshakePacket::header, &in::HandshakePacket::uuid,
+               &in::HandshakePacket::stationId>;
+};
 } // namespace amadeus
 
 #endif // !WEBSOCKET_SERVER_IN_HANDSHAKE_PACKET_HH
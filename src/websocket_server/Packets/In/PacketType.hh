@@ -0,0 +1,21 @@
+#ifndef WEBSOCKET_SERVER_IN_PACKET_TYPE_HH
+#define WEBSOCKET_SERVER_IN_PACKET_TYPE_HH
+
+#include <cstdint>
+
+namespace amadeus {
+namespace in {
+/// \brief Defines the PacketType enum which represents all incoming packets
+/// from the TCP connections.
+enum class PacketType : std::uint8_t
+{
+    Handshake = 0x00,
+    Pong = 0x01,
+    WeatherStatus = 0x02,
+    WeatherStatusBatch = 0x03,
+    Backfill = 0x04,
+};
+} // namespace in
+} // namespace amadeus
+
+#endif // !WEBSOCKET_SERVER_IN_PACKET_TYPE_HH
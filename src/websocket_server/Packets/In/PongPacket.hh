@@ -1,8 +1,12 @@
 #ifndef WEBSOCKET_SERVER_OUT_PONG_PACKET_HH
 #define WEBSOCKET_SERVER_OUT_PONG_PACKET_HH
 
+#include "websocket_server/Packets/In/PacketType.hh"
+#include "websocket_server/Packets/Schema.hh"
+
+#include <cstdint>
+
 namespace amadeus {
-#pragma pack(push, 1)
 namespace in {
 /// \brief Defines the PongPacket which is received from a TCP Client.
 struct PongPacket
@@ -10,8 +14,15 @@ struct PongPacket
     /// Packet header.
     std::uint8_t header;
 };
-#pragma pack(pop)
 } // namespace in
+
+template <>
+struct Schema<in::PongPacket>
+{
+    static constexpr auto id{in::PacketType::Pong};
+    static constexpr std::string_view name{"Pong"};
+    using fields = Fields<&in::PongPacket::header>;
+};
 } // namespace amadeus
 
 #endif // !WEBSOCKET_SERVER_OUT_PONG_PACKET_HH
@@ -0,0 +1,88 @@
+#ifndef WEBSOCKET_SERVER_IN_WEATHER_STATUS_BATCH_PACKET_HH
+#define WEBSOCKET_SERVER_IN_WEATHER_STATUS_BATCH_PACKET_HH
+
+#include "websocket_server/Packets/In/PacketType.hh"
+#include "websocket_server/Packets/Schema.hh"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace amadeus {
+namespace in {
+/// \brief A single compact reading of a WeatherStatusBatchPacket. The station
+/// is known from the handshake, so a reading only carries its values.
+struct WeatherReading
+{
+    /// The temperature ranging from 40°C - 100°C
+    float temperature;
+    /// The humidity in percentage ranging from 0% - 100%.
+    float humidity;
+    /// The time represented as a UNIX timestamp (epoch time since 01/01/1970).
+    std::uint32_t time;
+};
+
+/// \brief Defines the WeatherStatusBatchPacket which is sent by the TCP Client
+/// to push several readings at once, e.g. after sampling the sensor for a
+/// while. The fixed part below is followed by 'count' packed WeatherReadings.
+struct WeatherStatusBatchPacket
+{
+    /// Packet header.
+    std::uint8_t header;
+    /// The number of readings following the packet.
+    std::uint16_t count;
+};
+} // namespace in
+
+template <>
+struct Schema<in::WeatherReading>
+{
+    using fields =
+        Fields<&in::WeatherReading::temperature, &in::WeatherReading::humidity,
+               &in::WeatherReading::time>;
+};
+
+template <>
+struct Schema<in::WeatherStatusBatchPacket>
+{
+    static constexpr auto id{in::PacketType::WeatherStatusBatch};
+    static constexpr std::string_view name{"WeatherStatusBatch"};
+    using fields = Fields<&in::WeatherStatusBatchPacket::header,
+                          &in::WeatherStatusBatchPacket::count>;
+};
+
+namespace in {
+/// The maximum number of readings of a single WeatherStatusBatchPacket.
+inline constexpr std::size_t MaxBatchReadings{256};
+
+/// \brief Returns the size of a WeatherStatusBatchPacket with the given
+/// number of readings.
+constexpr std::size_t batchPacketSize(std::size_t _count) noexcept
+{
+    return wireSize<WeatherStatusBatchPacket> +
+           _count * wireSize<WeatherReading>;
+}
+
+/// \brief Decodes the packed readings of a WeatherStatusBatchPacket into
+/// three columns in a single pass.
+/// \param _readings The first packed reading (no alignment required).
+/// \param _count The number of readings.
+/// \param _times Receives the unix timestamps.
+/// \param _temperatures Receives the temperatures.
+/// \param _humidities Receives the humidities.
+inline void decodeReadings(void const* _readings, std::size_t _count,
+                           std::uint32_t* _times, float* _temperatures,
+                           float* _humidities) noexcept
+{
+    auto const* data = static_cast<unsigned char const*>(_readings);
+    for (std::size_t i = 0; i < _count; ++i) {
+        auto const reading =
+            decode<WeatherReading>(data + i * wireSize<WeatherReading>);
+        _temperatures[i] = reading.temperature;
+        _humidities[i] = reading.humidity;
+        _times[i] = reading.time;
+    }
+}
+} // namespace in
+} // namespace amadeus
+
+#endif // !WEBSOCKET_SERVER_IN_WEATHER_STATUS_BATCH_PACKET_HH
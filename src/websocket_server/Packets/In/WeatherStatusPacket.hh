@@ -1,7 +1,11 @@
 #ifndef WEBSOCKET_SERVER_IN_WEATHER_STATUS_PACKET_HH
 #define WEBSOCKET_SERVER_IN_WEATHER_STATUS_PACKET_HH
 
+#include "websocket_server/Packets/In/PacketType.hh"
+#include "websocket_server/Packets/Schema.hh"
+
 #include <array>
+#include <cstdint>
 
 namespace amadeus {
 /// \brief Reserved, not used anymore.
@@ -11,11 +15,12 @@ enum class WebSocketSessionFlag : std::uint8_t
     SSL = 1 << 1,
 };
 
-#pragma pack(push, 1)
 namespace in {
 /// \brief Defines the WeatherStatusPacket which is sent by the TCP Client to
 /// notify the server about the temperature, humidity and the time the sensor
-/// data were read.
+/// data were read. It answers the out::WeatherStatusPacket with the same
+/// request id, or is pushed by the TCP Client on its own with \ref
+/// PushRequestId (see out::StreamConfigPacket).
 struct WeatherStatusPacket
 {
     /// Packet header.
@@ -30,9 +35,28 @@ struct WeatherStatusPacket
     std::uint32_t time;
     /// A reserved server internal flag, not used anymore.
     WebSocketSessionFlag flag;
+    /// The request id of the WeatherStatusPacket this packet answers.
+    std::uint32_t requestId;
 };
-#pragma pack(pop)
+
+/// The request id of a WeatherStatusPacket which answers no request. The
+/// server never uses it for a poll.
+inline constexpr std::uint32_t PushRequestId{0xFFFFFFFF};
 } // namespace in
+
+template <>
+struct Schema<in::WeatherStatusPacket>
+{
+    static constexpr auto id{in::PacketType::WeatherStatus};
+    static constexpr std::string_view name{"WeatherStatus"};
+    using fields = Fields<&in::WeatherStatusPacket::header,
+                          &in::WeatherStatusPacket::uuid,
+                          &in::WeatherStatusPacket::temperature,
+                          &in::WeatherStatusPacket::humidity,
+                          &in::WeatherStatusPacket::time,
+                          &in::WeatherStatusPacket::flag,
+                          &in::WeatherStatusPacket::requestId>;
+};
 } // namespace amadeus
 
 #endif // !WEBSOCKET_SERVER_IN_WEATHER_STATUS_PACKET_HH
@@ -2,24 +2,32 @@
 #define WEBSOCKET_SERVER_OUT_HH
 
 #include "websocket_server/Packets/Common.hh"
+#include "websocket_server/Packets/Out/BackfillACKPacket.hh"
 #include "websocket_server/Packets/Out/HandshakeACKPacket.hh"
 #include "websocket_server/Packets/Out/HandshakeNAKPacket.hh"
 #include "websocket_server/Packets/Out/HandshakePacket.hh"
+#include "websocket_server/Packets/Out/PacketType.hh"
 #include "websocket_server/Packets/Out/PingPacket.hh"
+#include "websocket_server/Packets/Out/StreamConfigPacket.hh"
 #include "websocket_server/Packets/Out/WeatherStatusPacket.hh"
+#include "websocket_server/Packets/Schema.hh"
 
 namespace amadeus {
 namespace out {
-/// \brief Defines the PacketType enum which represents all incoming packets
-/// from the TCP connections.
-enum class PacketType : std::uint8_t
-{
-    Handshake = 0x00,
-    HandshakeACK = 0x01,
-    HandshakeNAK = 0x02,
-    Ping = 0x03,
-    WeatherStatus = 0x04,
-};
+/// All outgoing packets.
+using Packets = PacketList<HandshakePacket, HandshakeACKPacket,
+                           HandshakeNAKPacket, PingPacket, WeatherStatusPacket,
+                           BackfillACKPacket, StreamConfigPacket>;
+
+static_assert(uniquePacketIds(Packets{}), "Packet ids need to be unique.");
+
+/// The HandshakePacket as sent to the TCP Client.
+inline constexpr auto EncodedHandshakePacket{encodeHeader<HandshakePacket>()};
+/// The HandshakeACKPacket as sent to the TCP Client.
+inline constexpr auto EncodedHandshakeACKPacket{
+    encodeHeader<HandshakeACKPacket>()};
+/// The PingPacket as sent to the TCP Client.
+inline constexpr auto EncodedPingPacket{encodeHeader<PingPacket>()};
 } // namespace out
 } // namespace amadeus
 
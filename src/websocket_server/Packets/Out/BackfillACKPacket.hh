@@ -0,0 +1,34 @@
+#ifndef WEBSOCKET_SERVER_OUT_BACKFILL_ACK_PACKET_HH
+#define WEBSOCKET_SERVER_OUT_BACKFILL_ACK_PACKET_HH
+
+#include "websocket_server/Packets/Out/PacketType.hh"
+#include "websocket_server/Packets/Schema.hh"
+
+#include <cstdint>
+
+namespace amadeus {
+namespace out {
+/// \brief Defines the BackfillACKPacket which is sent by the server in reply
+/// to BackfillPackets. All readings of the station up to and including the
+/// acknowledged sequence number are stored, so that the TCP Client can free
+/// them.
+struct BackfillACKPacket
+{
+    /// Packet header.
+    std::uint8_t header{0x05};
+    /// The highest contiguous sequence number received.
+    std::uint32_t sequence;
+};
+} // namespace out
+
+template <>
+struct Schema<out::BackfillACKPacket>
+{
+    static constexpr auto id{out::PacketType::BackfillACK};
+    static constexpr std::string_view name{"BackfillACK"};
+    using fields = Fields<&out::BackfillACKPacket::header,
+                          &out::BackfillACKPacket::sequence>;
+};
+} // namespace amadeus
+
+#endif // !WEBSOCKET_SERVER_OUT_BACKFILL_ACK_PACKET_HH
@@ -1,8 +1,10 @@
 #ifndef WEBSOCKET_SERVER_OUT_HANDSHAKE_ACK_PACKET_HH
 #define WEBSOCKET_SERVER_OUT_HANDSHAKE_ACK_PACKET_HH
 
+#include "websocket_server/Packets/Out/PacketType.hh"
+#include "websocket_server/Packets/Schema.hh"
+
 namespace amadeus {
-#pragma pack(push, 1)
 namespace out {
 /// Defines the HandshakeACKPacket which is sent by the server if the TCP Client
 /// was successfully authenticated.
@@ -11,8 +13,15 @@ struct HandshakeACKPacket
     /// Packet header.
     std::uint8_t header{0x01};
 };
-#pragma pack(pop)
 } // namespace out
+
+template <>
+struct Schema<out::HandshakeACKPacket>
+{
+    static constexpr auto id{out::PacketType::HandshakeACK};
+    static constexpr std::string_view name{"HandshakeACK"};
+    using fields = Fields<&out::HandshakeACKPacket::header>;
+};
 } // namespace amadeus
 
 #endif // !WEBSOCKET_SERVER_OUT_HANDSHAKE_ACK_PACKET_HH
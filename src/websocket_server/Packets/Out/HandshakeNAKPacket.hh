@@ -1,8 +1,10 @@
 #ifndef WEBSOCKET_SERVER_OUT_HANDSHAKE_NAK_PACKET_HH
 #define WEBSOCKET_SERVER_OUT_HANDSHAKE_NAK_PACKET_HH
 
+#include "websocket_server/Packets/Out/PacketType.hh"
+#include "websocket_server/Packets/Schema.hh"
+
 namespace amadeus {
-#pragma pack(push, 1)
 /// \brief Defines the HandshakeReason enum which describes the reason for the
 /// HandshakeNAKPacket in detail.
 enum class HandshakeReason : std::uint8_t
@@ -26,8 +28,16 @@ struct HandshakeNAKPacket
     /// The reason for the handshake failure.
     HandshakeReason reason;
 };
-#pragma pack(pop)
 } // namespace out
+
+template <>
+struct Schema<out::HandshakeNAKPacket>
+{
+    static constexpr auto id{out::PacketType::HandshakeNAK};
+    static constexpr std::string_view name{"HandshakeNAK"};
+    using fields = Fields<&out::HandshakeNAKPacket::header,
+                          &out::HandshakeNAKPacket::reason>;
+};
 } // namespace amadeus
 
 #endif // !WEBSOCKET_SERVER_OUT_HANDSHAKE_NAK_PACKET_HH
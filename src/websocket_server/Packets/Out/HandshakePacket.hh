@@ -1,8 +1,10 @@
 #ifndef WEBSOCKET_SERVER_OUT_HANDSHAKE_PACKET_HH
 #define WEBSOCKET_SERVER_OUT_HANDSHAKE_PACKET_HH
 
+#include "websocket_server/Packets/Out/PacketType.hh"
+#include "websocket_server/Packets/Schema.hh"
+
 namespace amadeus {
-#pragma pack(push, 1)
 namespace out {
 /// \brief Defines the HandshakePacket which is immediately sent by the server
 /// once a TCP connection has been established.
@@ -11,8 +13,15 @@ struct HandshakePacket
     /// Packet header.
     std::uint8_t header{0x00};
 };
-#pragma pack(pop)
 } // namespace out
+
+template <>
+struct Schema<out::HandshakePacket>
+{
+    static constexpr auto id{out::PacketType::Handshake};
+    static constexpr std::string_view name{"Handshake"};
+    using fields = Fields<&out::HandshakePacket::header>;
+};
 } // namespace amadeus
 
 #endif // !WEBSOCKET_SERVER_OUT_HANDSHAKE_PACKET_HH
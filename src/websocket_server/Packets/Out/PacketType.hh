@@ -0,0 +1,23 @@
+#ifndef WEBSOCKET_SERVER_OUT_PACKET_TYPE_HH
+#define WEBSOCKET_SERVER_OUT_PACKET_TYPE_HH
+
+#include <cstdint>
+
+namespace amadeus {
+namespace out {
+/// \brief Defines the PacketType enum which represents all outgoing packets
+/// from the server.
+enum class PacketType : std::uint8_t
+{
+    Handshake = 0x00,
+    HandshakeACK = 0x01,
+    HandshakeNAK = 0x02,
+    Ping = 0x03,
+    WeatherStatus = 0x04,
+    BackfillACK = 0x05,
+    StreamConfig = 0x06,
+};
+} // namespace out
+} // namespace amadeus
+
+#endif // !WEBSOCKET_SERVER_OUT_PACKET_TYPE_HH
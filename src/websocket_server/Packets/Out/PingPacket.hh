@@ -1,8 +1,10 @@
 #ifndef WEBSOCKET_SERVER_OUT_PING_PACKET_HH
 #define WEBSOCKET_SERVER_OUT_PING_PACKET_HH
 
+#include "websocket_server/Packets/Out/PacketType.hh"
+#include "websocket_server/Packets/Schema.hh"
+
 namespace amadeus {
-#pragma pack(push, 1)
 namespace out {
 /// \brief Defines the PingPacket which is sent by the server every 30 seconds
 /// to the TCP Client. This mechanism (ping - pong) ensures that both sides are
@@ -12,8 +14,15 @@ struct PingPacket
     /// Packet header.
     std::uint8_t header{0x03};
 };
-#pragma pack(pop)
 } // namespace out
+
+template <>
+struct Schema<out::PingPacket>
+{
+    static constexpr auto id{out::PacketType::Ping};
+    static constexpr std::string_view name{"Ping"};
+    using fields = Fields<&out::PingPacket::header>;
+};
 } // namespace amadeus
 
 #endif // !WEBSOCKET_SERVER_OUT_PING_PACKET_HH
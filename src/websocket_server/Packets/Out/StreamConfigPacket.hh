@@ -0,0 +1,39 @@
+#ifndef WEBSOCKET_SERVER_OUT_STREAM_CONFIG_PACKET_HH
+#define WEBSOCKET_SERVER_OUT_STREAM_CONFIG_PACKET_HH
+
+#include "websocket_server/Packets/Out/PacketType.hh"
+#include "websocket_server/Packets/Schema.hh"
+
+#include <cstdint>
+
+namespace amadeus {
+namespace out {
+/// \brief Defines the StreamConfigPacket which is sent by the server after
+/// the handshake and whenever the configuration changes. It tells the TCP
+/// Client to push WeatherStatusPackets on its own, see \ref StreamConfig. A
+/// packet with both fields zero stops the pushes.
+struct StreamConfigPacket
+{
+    /// Packet header.
+    std::uint8_t header{0x06};
+    /// The interval in seconds at which a reading is pushed, zero disables
+    /// the periodic push.
+    std::uint16_t interval;
+    /// The change of the temperature or the humidity which triggers a push,
+    /// zero disables it.
+    float delta;
+};
+} // namespace out
+
+template <>
+struct Schema<out::StreamConfigPacket>
+{
+    static constexpr auto id{out::PacketType::StreamConfig};
+    static constexpr std::string_view name{"StreamConfig"};
+    using fields = Fields<&out::StreamConfigPacket::header,
+                          &out::StreamConfigPacket::interval,
+                          &out::StreamConfigPacket::delta>;
+};
+} // namespace amadeus
+
+#endif // !WEBSOCKET_SERVER_OUT_STREAM_CONFIG_PACKET_HH
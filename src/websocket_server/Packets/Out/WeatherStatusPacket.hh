@@ -1,11 +1,14 @@
 #ifndef WEBSOCKET_SERVER_OUT_WEATHER_STATUS_PACKET_HH
 #define WEBSOCKET_SERVER_OUT_WEATHER_STATUS_PACKET_HH
 
+#include "websocket_server/Packets/Out/PacketType.hh"
+#include "websocket_server/Packets/Schema.hh"
+
 #include <array>
+#include <cstdint>
 
 namespace amadeus {
 enum class WebSocketSessionFlag : std::uint8_t;
-#pragma pack(push, 1)
 namespace out {
 /// \brief Defines the WeatherStatusPacket which is sent by the server if a
 /// WebSocketSession requested a weather update for a specific TCP connection
@@ -19,9 +22,21 @@ struct WeatherStatusPacket
     std::array<std::uint8_t, 16> uuid;
     /// Reserved server specific flag, not used anymore.
     WebSocketSessionFlag flag;
+    /// Identifies the request, the TCP Client echoes it in its reply.
+    std::uint32_t requestId;
 };
-#pragma pack(pop)
 } // namespace out
+
+template <>
+struct Schema<out::WeatherStatusPacket>
+{
+    static constexpr auto id{out::PacketType::WeatherStatus};
+    static constexpr std::string_view name{"WeatherStatus"};
+    using fields = Fields<&out::WeatherStatusPacket::header,
+                          &out::WeatherStatusPacket::uuid,
+                          &out::WeatherStatusPacket::flag,
+                          &out::WeatherStatusPacket::requestId>;
+};
 } // namespace amadeus
 
 #endif // !WEBSOCKET_SERVER_OUT_WEATHER_STATUS_PACKET_HH
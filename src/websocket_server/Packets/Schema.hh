@@ -0,0 +1,164 @@
+#ifndef WEBSOCKET_SERVER_SCHEMA_HH
+#define WEBSOCKET_SERVER_SCHEMA_HH
+
+#include "websocket_server/utils/endian.hh"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+namespace amadeus {
+/// \brief The fields of a packet in the order in which they are sent, given
+/// as pointers to its members.
+template <auto... Members>
+struct Fields
+{
+};
+
+/// \brief Describes the wire format of a packet. Every packet specializes it
+/// next to its declaration. The fields are packed little-endian on the wire,
+/// the struct itself is an ordinary aligned struct. Types which are only part
+/// of a packet (e.g. the readings of a batch) only declare their fields.
+/* Example:
+ *
+ *  template <>
+ *  struct Schema<in::PongPacket>
+ *  {
+ *      static constexpr auto id{in::PacketType::Pong};
+ *      static constexpr std::string_view name{"Pong"};
+ *      using fields = Fields<&in::PongPacket::header>;
+ *  };
+ */
+template <typename Packet>
+struct Schema;
+
+namespace detail {
+template <typename>
+struct member_traits;
+
+template <typename Class, typename Member>
+struct member_traits<Member Class::*>
+{
+    using type = Member;
+};
+
+template <auto Member>
+using member_type = typename member_traits<decltype(Member)>::type;
+
+template <auto... Members>
+constexpr std::size_t wireSize(Fields<Members...>) noexcept
+{
+    static_assert((is_wire_type_v<member_type<Members>> && ...),
+                  "A field needs to be a wire type.");
+    return (std::size_t{0} + ... + sizeof(member_type<Members>));
+}
+
+template <typename Packet, auto... Members>
+void decode(Packet& _packet, unsigned char const* _data,
+            Fields<Members...>) noexcept
+{
+    std::size_t offset{0};
+    ((_packet.*Members = load_le<member_type<Members>>(_data + offset),
+      offset += sizeof(member_type<Members>)),
+     ...);
+}
+
+template <typename Packet, auto... Members>
+void encode(Packet const& _packet, unsigned char* _data,
+            Fields<Members...>) noexcept
+{
+    std::size_t offset{0};
+    ((store_le(_data + offset, _packet.*Members),
+      offset += sizeof(member_type<Members>)),
+     ...);
+}
+} // namespace detail
+
+/// The size of a packet on the wire.
+template <typename Packet>
+inline constexpr std::size_t wireSize{
+    detail::wireSize(typename Schema<Packet>::fields{})};
+
+/// \brief A packet encoded for the wire.
+template <typename Packet>
+using EncodedPacket = std::array<std::uint8_t, wireSize<Packet>>;
+
+/// \brief Decodes a packet from memory of any alignment.
+/// \param _data The first byte of the packet, at least \ref wireSize bytes.
+template <typename Packet>
+[[nodiscard]] Packet decode(void const* _data) noexcept
+{
+    Packet packet{};
+    detail::decode(packet, static_cast<unsigned char const*>(_data),
+                   typename Schema<Packet>::fields{});
+    return packet;
+}
+
+/// \brief Encodes a packet into memory of any alignment.
+/// \param _packet The packet.
+/// \param _data The first byte of the packet, at least \ref wireSize bytes.
+template <typename Packet>
+void encode(Packet const& _packet, void* _data) noexcept
+{
+    detail::encode(_packet, static_cast<unsigned char*>(_data),
+                   typename Schema<Packet>::fields{});
+}
+
+/// \brief Encodes a packet which only consists of its header at compile time.
+template <typename Packet>
+constexpr EncodedPacket<Packet> encodeHeader() noexcept
+{
+    static_assert(wireSize<Packet> == 1, "Packet needs to be header only.");
+    return {Packet{}.header};
+}
+
+/// \brief A list of packet types.
+template <typename... Packets>
+struct PacketList
+{
+};
+
+/// \brief An entry of a \ref PacketTable.
+struct PacketInfo
+{
+    /// The size of the packet on the wire, its fixed part for packets of
+    /// variable size. 0 if the id is unknown.
+    std::size_t size;
+    /// The name of the packet.
+    std::string_view name;
+};
+
+/// \brief A lookup table from packet ids to \ref PacketInfo.
+using PacketTable = std::array<PacketInfo, 256>;
+
+/// \brief Returns the \ref PacketTable for a list of packets.
+template <typename... Packets>
+constexpr PacketTable makePacketTable(PacketList<Packets...>) noexcept
+{
+    PacketTable table{};
+    for (auto& info : table) {
+        info = PacketInfo{0, "unknown"};
+    }
+    ((table[static_cast<std::uint8_t>(Schema<Packets>::id)] =
+          PacketInfo{wireSize<Packets>, Schema<Packets>::name}),
+     ...);
+    return table;
+}
+
+/// \brief Returns whether the ids of a list of packets are unique.
+template <typename... Packets>
+constexpr bool uniquePacketIds(PacketList<Packets...>) noexcept
+{
+    std::array<bool, 256> seen{};
+    bool unique{true};
+    ((unique = unique &&
+               !seen[static_cast<std::uint8_t>(Schema<Packets>::id)],
+      seen[static_cast<std::uint8_t>(Schema<Packets>::id)] = true),
+     ...);
+    return unique;
+}
+} // namespace amadeus
+
+#endif // !WEBSOCKET_SERVER_SCHEMA_HH
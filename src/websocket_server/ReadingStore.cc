@@ -0,0 +1,888 @@
+#include "websocket_server/ReadingStore.hh"
+#include "websocket_server/CompressedBlock.hh"
+#include "websocket_server/Logger.hh"
+
+#include <boost/crc.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <fmt/format.h>
+#include <magic_enum.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+#if defined(_WIN32)
+#include <io.h>
+#elif defined(__APPLE__)
+#include <fcntl.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace amadeus;
+namespace fs = std::filesystem;
+namespace ipc = boost::interprocess;
+
+namespace {
+/// The number of bytes covered by the checksum of a record.
+constexpr std::size_t PayloadSize{12};
+
+/// \brief Returns the CRC-32 of the payload of a record.
+std::uint32_t checksum(char const* _record) noexcept
+{
+    boost::crc_32_type crc;
+    crc.process_bytes(_record, PayloadSize);
+    return crc.checksum();
+}
+
+/// \brief Encodes a record in host byte order.
+void encodeRecord(char* _out, std::uint32_t _time, float _temperature,
+                  float _humidity) noexcept
+{
+    std::memcpy(_out, &_time, sizeof(_time));
+    std::memcpy(_out + 4, &_temperature, sizeof(_temperature));
+    std::memcpy(_out + 8, &_humidity, sizeof(_humidity));
+    auto const crc = checksum(_out);
+    std::memcpy(_out + PayloadSize, &crc, sizeof(crc));
+}
+
+/// \brief Returns the timestamp of the _index th record.
+std::uint32_t recordTime(char const* _data, std::size_t _index) noexcept
+{
+    std::uint32_t time;
+    std::memcpy(&time, _data + _index * ReadingStore::RecordSize,
+                sizeof(time));
+    return time;
+}
+
+/// \brief Returns whether the checksum of the _index th record matches.
+bool validRecord(char const* _data, std::size_t _index) noexcept
+{
+    auto const record = _data + _index * ReadingStore::RecordSize;
+    std::uint32_t crc;
+    std::memcpy(&crc, record + PayloadSize, sizeof(crc));
+    return crc == checksum(record);
+}
+
+/// \brief Forces the written data of a file to disk.
+void syncFile(std::FILE* _file) noexcept
+{
+#if defined(_WIN32)
+    ::_commit(::_fileno(_file));
+#elif defined(__APPLE__)
+    ::fcntl(::fileno(_file), F_FULLFSYNC);
+#else
+    ::fdatasync(::fileno(_file));
+#endif
+}
+} // namespace
+
+ReadingStore::ReadingStore(ReadingStoreOptions _options, Metrics& _metrics)
+    : options_(std::move(_options))
+    , segmentRecords_(std::max<std::size_t>(
+          options_.segmentBytes / RecordSize, IndexInterval))
+    , metrics_(_metrics)
+    , queue_(options_.queueCapacity)
+    , rollups_(options_.rollupRetention, _metrics)
+{
+}
+
+ReadingStore::~ReadingStore()
+{
+    stop();
+}
+
+bool ReadingStore::enabled() const noexcept
+{
+    return !options_.directory.empty();
+}
+
+void ReadingStore::start()
+{
+    if (!enabled() || running_.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    for (std::size_t i = 0; i < stations_.size(); ++i) {
+        auto const id = static_cast<StationId>(i);
+        recover(stations_[i], id);
+
+        // rebuild the open buckets and the ones lost in a crash
+        auto const from = rollups_.open(id, stations_[i].directory);
+        auto const samples = query(id, from, ~0U);
+        for (std::size_t j = 0; j < samples.times.size(); ++j) {
+            rollups_.add(id, samples.times[j], samples.temperatures[j],
+                         samples.humidities[j]);
+        }
+        rollups_.publish(id);
+    }
+
+    // compact the segments sealed before the last shutdown right away
+    sealed_ = true;
+    running_.store(true, std::memory_order_release);
+    writer_ = std::thread([this] { run(); });
+    compactor_ = std::thread([this] { runCompactor(); });
+
+    LOG_INFO("ReadingStore started in '{}' with fsync policy {}.\n",
+             options_.directory.string(),
+             magic_enum::enum_name(options_.fsync));
+}
+
+void ReadingStore::stop()
+{
+    if (!running_.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
+
+    {
+        std::scoped_lock<std::mutex> lk(wakeMtx_);
+        wake_.notify_one();
+    }
+    {
+        std::scoped_lock<std::mutex> lk(compactMtx_);
+        compactWake_.notify_one();
+    }
+    writer_.join();
+    compactor_.join();
+}
+
+bool ReadingStore::append(WeatherStatusNotification const& _reading) noexcept
+{
+    if (!running_.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    if (!queue_.try_push(_reading)) {
+        metrics_.storeReadingsDropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    wakeWriter();
+    return true;
+}
+
+std::size_t ReadingStore::append(StationId _id,
+                                 HistorySamples const& _samples) noexcept
+{
+    if (!running_.load(std::memory_order_acquire)) {
+        return 0;
+    }
+
+    auto const count = _samples.times.size();
+    std::size_t queued{0};
+    for (; queued < count; ++queued) {
+        WeatherStatusNotification const reading{
+            _id, _samples.temperatures[queued], _samples.humidities[queued],
+            _samples.times[queued]};
+        if (!queue_.try_push(reading)) {
+            break;
+        }
+    }
+
+    if (queued < count) {
+        metrics_.storeReadingsDropped.fetch_add(count - queued,
+                                                std::memory_order_relaxed);
+    }
+    if (queued > 0) {
+        wakeWriter();
+    }
+    return queued;
+}
+
+void ReadingStore::wakeWriter() noexcept
+{
+    // Pairs with the fence in run(): either the writer sees the reading
+    // before it goes to sleep or we see that it is sleeping.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_relaxed) &&
+        sleeping_.exchange(false, std::memory_order_relaxed)) {
+        std::scoped_lock<std::mutex> lk(wakeMtx_);
+        wake_.notify_one();
+    }
+}
+
+HistorySamples ReadingStore::query(StationId _id, std::uint32_t _from,
+                                   std::uint32_t _to) const
+{
+    HistorySamples samples;
+
+    auto const index = static_cast<std::size_t>(_id);
+    if (!enabled() || index >= stations_.size() || _from > _to) {
+        return samples;
+    }
+
+    // copy the metadata of the overlapping segments, the files are read
+    // without holding the lock
+    std::vector<Segment> segments;
+    {
+        auto const& s = stations_[index];
+        std::shared_lock<std::shared_mutex> lk(s.mtx);
+        for (auto const& segment : s.segments) {
+            if (segment.records > 0 && segment.index.front() <= _to &&
+                segment.lastTime >= _from) {
+                segments.push_back(segment);
+            }
+        }
+    }
+
+    for (auto& segment : segments) {
+        try {
+            // the compactor may have replaced the segment in the meantime
+            if (!segment.compressed && !fs::exists(segment.path)) {
+                segment.path.replace_extension(".blk");
+                segment.compressed = true;
+            }
+            read(segment, _from, _to, samples);
+        } catch (std::exception const& e) {
+            LOG_ERROR("Failed to read segment '{}': {}\n",
+                      segment.path.string(), e.what());
+        }
+    }
+
+    // backfill segments overlap the others
+    auto& times = samples.times;
+    if (!std::is_sorted(std::begin(times), std::end(times))) {
+        std::vector<std::size_t> order(times.size());
+        std::iota(std::begin(order), std::end(order), std::size_t{0});
+        std::stable_sort(std::begin(order), std::end(order),
+                         [&times](std::size_t _a, std::size_t _b) {
+                             return times[_a] < times[_b];
+                         });
+
+        HistorySamples sorted;
+        sorted.times.reserve(order.size());
+        sorted.temperatures.reserve(order.size());
+        sorted.humidities.reserve(order.size());
+        for (auto const i : order) {
+            sorted.times.push_back(samples.times[i]);
+            sorted.temperatures.push_back(samples.temperatures[i]);
+            sorted.humidities.push_back(samples.humidities[i]);
+        }
+        samples = std::move(sorted);
+    }
+
+    return samples;
+}
+
+StationRollups const& ReadingStore::rollups() const noexcept
+{
+    return rollups_;
+}
+
+void ReadingStore::run()
+{
+    std::vector<WeatherStatusNotification> batch;
+    batch.reserve(MaxBatch);
+    auto lastSync = ClockType::now();
+    auto const idleWait = options_.fsync == FsyncPolicy::Interval
+                              ? options_.fsyncInterval
+                              : std::chrono::milliseconds{1000};
+
+    for (;;) {
+        auto const stopping = !running_.load(std::memory_order_acquire);
+
+        while (batch.size() < MaxBatch) {
+            auto reading = queue_.try_pop();
+            if (!reading) {
+                break;
+            }
+            batch.push_back(*reading);
+        }
+
+        auto const full = batch.size() == MaxBatch;
+        if (!batch.empty()) {
+            write(batch);
+            batch.clear();
+        }
+
+        if (options_.fsync == FsyncPolicy::Interval &&
+            ClockType::now() - lastSync >= options_.fsyncInterval) {
+            for (auto& s : stations_) {
+                sync(s.active);
+                sync(s.backfill);
+            }
+            lastSync = ClockType::now();
+        }
+
+        if (full) {
+            continue;
+        }
+        if (stopping) {
+            break;
+        }
+
+        // nothing to do, sleep until the next append
+        sleeping_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (auto reading = queue_.try_pop()) {
+            sleeping_.store(false, std::memory_order_relaxed);
+            batch.push_back(*reading);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lk(wakeMtx_);
+        wake_.wait_for(lk, idleWait, [this] {
+            return !sleeping_.load(std::memory_order_relaxed) ||
+                   !running_.load(std::memory_order_relaxed);
+        });
+        sleeping_.store(false, std::memory_order_relaxed);
+    }
+
+    for (auto& s : stations_) {
+        for (auto* writer : {&s.active, &s.backfill}) {
+            if (writer->file == nullptr) {
+                continue;
+            }
+            if (options_.fsync != FsyncPolicy::Never) {
+                sync(*writer);
+            }
+            std::fclose(writer->file);
+            writer->file = nullptr;
+        }
+    }
+    rollups_.close();
+}
+
+void ReadingStore::recover(Station& _station, StationId _id)
+{
+    _station.directory =
+        options_.directory / std::string(magic_enum::enum_name(_id));
+    fs::create_directories(_station.directory);
+
+    // the segment file and the block file of every sequence number
+    std::map<std::uint64_t, std::pair<fs::path, fs::path>> files;
+    for (auto const& entry : fs::directory_iterator(_station.directory)) {
+        auto const extension = entry.path().extension();
+        if (extension == ".tmp") {
+            // an interrupted compaction
+            fs::remove(entry.path());
+        } else if (extension == ".seg" || extension == ".bkf" ||
+                   extension == ".blk") {
+            auto& pair = files[std::stoull(entry.path().stem().string())];
+            (extension == ".blk" ? pair.second : pair.first) = entry.path();
+        }
+    }
+
+    // the active segment is the newest one which is no backfill segment
+    std::optional<std::uint64_t> active;
+    for (auto const& [sequence, pair] : files) {
+        if (pair.first.extension() == ".seg") {
+            active = sequence;
+        }
+    }
+
+    std::optional<std::size_t> activeIndex;
+    for (auto it = std::begin(files); it != std::end(files); ++it) {
+        auto const last = it->first == active;
+        auto const& [segmentPath, blockPath] = it->second;
+        _station.sequence = it->first;
+
+        if (!blockPath.empty()) {
+            Segment block;
+            block.path = blockPath;
+            block.compressed = true;
+            if (load(block, false)) {
+                // the compactor was interrupted before removing the segment
+                if (!segmentPath.empty()) {
+                    fs::remove(segmentPath);
+                }
+                _station.active.lastTime =
+                    std::max(_station.active.lastTime, block.lastTime);
+                _station.segments.push_back(std::move(block));
+                continue;
+            }
+            LOG_WARN("Discarding invalid block '{}'.\n", blockPath.string());
+            fs::remove(blockPath);
+            if (segmentPath.empty()) {
+                continue;
+            }
+        }
+
+        // a backfill segment is never reopened, but may end with a torn
+        // write as well
+        Segment segment;
+        segment.path = segmentPath;
+        auto const backfill = segmentPath.extension() == ".bkf";
+        if (!load(segment, last || backfill) && !last) {
+            fs::remove(segmentPath);
+            continue;
+        }
+
+        _station.active.lastTime =
+            std::max(_station.active.lastTime, segment.lastTime);
+        if (last) {
+            activeIndex = _station.segments.size();
+        }
+        _station.segments.push_back(std::move(segment));
+    }
+
+    if (!activeIndex) {
+        openSegment(_station, _station.active);
+    } else {
+        // backfill segments opened after the active one come before it
+        auto const it = std::begin(_station.segments) +
+                        static_cast<std::ptrdiff_t>(*activeIndex);
+        std::rotate(it, std::next(it), std::end(_station.segments));
+
+        auto& segment = _station.segments.back();
+        segment.appending = true;
+        _station.active.path = segment.path;
+        _station.active.file = std::fopen(segment.path.string().c_str(), "ab");
+        _station.active.written = segment.records;
+    }
+
+    if (_station.active.file == nullptr) {
+        throw std::runtime_error(
+            fmt::format("Failed to open the active segment of station {} in "
+                        "'{}'.",
+                        magic_enum::enum_name(_id),
+                        _station.directory.string()));
+    }
+}
+
+bool ReadingStore::load(Segment& _segment, bool _active) const
+{
+    auto const size = static_cast<std::size_t>(fs::file_size(_segment.path));
+
+    if (_segment.compressed) {
+        if (size == 0) {
+            return false;
+        }
+        try {
+            ipc::file_mapping mapping(_segment.path.string().c_str(),
+                                      ipc::read_only);
+            ipc::mapped_region region(mapping, ipc::read_only, 0, size);
+            CompressedBlock const block{
+                static_cast<std::uint8_t const*>(region.get_address()), size,
+                true};
+            _segment.records = block.header().records;
+            _segment.index = block.chunkTimes();
+            _segment.lastTime = block.header().lastTime;
+        } catch (std::exception const& e) {
+            LOG_ERROR("Failed to load block '{}': {}\n",
+                      _segment.path.string(), e.what());
+            return false;
+        }
+        return _segment.records > 0;
+    }
+
+    _segment.records = size / RecordSize;
+    if (_segment.records > 0) {
+        ipc::file_mapping mapping(_segment.path.string().c_str(),
+                                  ipc::read_only);
+        ipc::mapped_region region(mapping, ipc::read_only, 0,
+                                  _segment.records * RecordSize);
+        auto const data = static_cast<char const*>(region.get_address());
+
+        // only the active segment can end with a torn write
+        if (_active) {
+            std::size_t valid{0};
+            while (valid < _segment.records && validRecord(data, valid)) {
+                ++valid;
+            }
+            _segment.records = valid;
+        }
+
+        for (std::size_t r = 0; r < _segment.records; r += IndexInterval) {
+            _segment.index.push_back(recordTime(data, r));
+        }
+        if (_segment.records > 0) {
+            _segment.lastTime = recordTime(data, _segment.records - 1);
+        }
+    }
+
+    if (_active && _segment.records * RecordSize != size) {
+        LOG_WARN("Truncating torn segment '{}' from {} to {} bytes.\n",
+                 _segment.path.string(), size, _segment.records * RecordSize);
+        fs::resize_file(_segment.path, _segment.records * RecordSize);
+    }
+
+    return _segment.records > 0;
+}
+
+void ReadingStore::openSegment(Station& _station, Writer& _writer)
+{
+    auto const backfill = &_writer == &_station.backfill;
+
+    Segment segment;
+    segment.path = _station.directory /
+                   fmt::format("{:020}{}", ++_station.sequence,
+                               backfill ? ".bkf" : ".seg");
+    segment.appending = true;
+
+    _writer.path = segment.path;
+    _writer.file = std::fopen(segment.path.string().c_str(), "ab");
+    _writer.written = 0;
+    if (_writer.file == nullptr) {
+        LOG_ERROR("Failed to open segment '{}'.\n", segment.path.string());
+        return;
+    }
+
+    // the active segment stays the last one
+    std::unique_lock<std::shared_mutex> lk(_station.mtx);
+    auto const position = backfill && !_station.segments.empty()
+                              ? std::prev(std::end(_station.segments))
+                              : std::end(_station.segments);
+    _station.segments.insert(position, std::move(segment));
+}
+
+void ReadingStore::write(std::vector<WeatherStatusNotification> const& _batch)
+{
+    std::array<bool, static_cast<std::size_t>(StationId::Max)> touched{};
+
+    for (auto const& reading : _batch) {
+        auto const index = static_cast<std::size_t>(reading.id);
+        if (index >= stations_.size()) {
+            continue;
+        }
+
+        auto& s = stations_[index];
+        auto const time = reading.time;
+
+        // The records of a segment are ordered by time. A reading older than
+        // the last one of the station, e.g. a backfilled reading after a live
+        // one, goes to the backfill segment, which is sealed once it would
+        // get out of order itself.
+        auto const backfill = time < s.active.lastTime;
+        auto& w = backfill ? s.backfill : s.active;
+        auto const full =
+            w.written + w.buffer.size() / RecordSize >= segmentRecords_;
+        if (backfill) {
+            if (w.file == nullptr || full || time < w.lastTime) {
+                roll(s, w);
+            }
+            metrics_.storeReadingsOutOfOrder.fetch_add(
+                1, std::memory_order_relaxed);
+        } else if (full) {
+            roll(s, w);
+        }
+        if (w.file == nullptr) {
+            metrics_.storeReadingsDropped.fetch_add(1,
+                                                    std::memory_order_relaxed);
+            continue;
+        }
+
+        auto const record = w.written + w.buffer.size() / RecordSize;
+        if (record % IndexInterval == 0) {
+            w.pendingIndex.push_back(time);
+        }
+        w.lastTime = time;
+
+        auto const offset = w.buffer.size();
+        w.buffer.resize(offset + RecordSize);
+        encodeRecord(w.buffer.data() + offset, time, reading.temperature,
+                     reading.humidity);
+        // the rollups need the readings in order
+        if (!backfill) {
+            rollups_.add(reading.id, time, reading.temperature,
+                         reading.humidity);
+        }
+        touched[index] = true;
+    }
+
+    for (std::size_t i = 0; i < stations_.size(); ++i) {
+        if (touched[i]) {
+            flush(stations_[i].active);
+            flush(stations_[i].backfill);
+        }
+    }
+
+    // group commit: a single sync per segment covers the whole batch
+    if (options_.fsync == FsyncPolicy::Batch) {
+        for (std::size_t i = 0; i < stations_.size(); ++i) {
+            if (touched[i]) {
+                sync(stations_[i].active);
+                sync(stations_[i].backfill);
+            }
+        }
+    }
+
+    for (std::size_t i = 0; i < stations_.size(); ++i) {
+        if (touched[i]) {
+            publish(stations_[i], stations_[i].active);
+            publish(stations_[i], stations_[i].backfill);
+            rollups_.publish(static_cast<StationId>(i));
+        }
+    }
+
+    metrics_.storeBatches.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ReadingStore::flush(Writer& _writer)
+{
+    if (_writer.buffer.empty() || _writer.file == nullptr) {
+        return;
+    }
+
+    auto const records = _writer.buffer.size() / RecordSize;
+    auto const written = std::fwrite(_writer.buffer.data(), 1,
+                                     _writer.buffer.size(), _writer.file);
+    _writer.buffer.clear();
+
+    if (written != records * RecordSize || std::fflush(_writer.file) != 0) {
+        LOG_ERROR("Failed to write {} readings to '{}'.\n", records,
+                  _writer.path.string());
+        metrics_.storeReadingsDropped.fetch_add(records,
+                                                std::memory_order_relaxed);
+        _writer.pendingIndex.clear();
+        return;
+    }
+
+    _writer.written += records;
+    _writer.dirty = true;
+    metrics_.storeReadingsWritten.fetch_add(records, std::memory_order_relaxed);
+}
+
+void ReadingStore::sync(Writer& _writer)
+{
+    if (!_writer.dirty || _writer.file == nullptr) {
+        return;
+    }
+
+    syncFile(_writer.file);
+    _writer.dirty = false;
+    metrics_.storeFsyncs.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ReadingStore::publish(Station& _station, Writer& _writer)
+{
+    if (_writer.path.empty()) {
+        return;
+    }
+
+    // the backfill segment is right before the active one
+    std::unique_lock<std::shared_mutex> lk(_station.mtx);
+    auto const it = std::find_if(
+        std::rbegin(_station.segments), std::rend(_station.segments),
+        [&_writer](Segment const& _s) { return _s.path == _writer.path; });
+    if (it != std::rend(_station.segments)) {
+        it->records = _writer.written;
+        it->index.insert(std::end(it->index),
+                         std::begin(_writer.pendingIndex),
+                         std::end(_writer.pendingIndex));
+        it->lastTime = _writer.lastTime;
+        it->appending = _writer.file != nullptr;
+    }
+    _writer.pendingIndex.clear();
+}
+
+void ReadingStore::roll(Station& _station, Writer& _writer)
+{
+    if (_writer.file != nullptr) {
+        flush(_writer);
+        if (options_.fsync != FsyncPolicy::Never) {
+            sync(_writer);
+        }
+        std::fclose(_writer.file);
+        _writer.file = nullptr;
+        publish(_station, _writer);
+
+        {
+            std::scoped_lock<std::mutex> lk(compactMtx_);
+            sealed_ = true;
+        }
+        compactWake_.notify_one();
+    }
+
+    // a new backfill segment starts from scratch, the active one continues
+    // the timestamps of the station
+    if (&_writer == &_station.backfill) {
+        _writer.lastTime = 0;
+    }
+    openSegment(_station, _writer);
+}
+
+void ReadingStore::read(Segment const& _segment, std::uint32_t _from,
+                        std::uint32_t _to, HistorySamples& _samples) const
+{
+    if (_segment.compressed) {
+        ipc::file_mapping mapping(_segment.path.string().c_str(),
+                                  ipc::read_only);
+        ipc::mapped_region region(mapping, ipc::read_only);
+        CompressedBlock const block{
+            static_cast<std::uint8_t const*>(region.get_address()),
+            region.get_size()};
+        block.decode(_from, _to, _samples);
+        return;
+    }
+
+    ipc::file_mapping mapping(_segment.path.string().c_str(), ipc::read_only);
+    ipc::mapped_region region(mapping, ipc::read_only, 0,
+                              _segment.records * RecordSize);
+    auto const data = static_cast<char const*>(region.get_address());
+
+    // The sparse index narrows the first record >= _from down to a single
+    // page, which is then binary searched.
+    auto const entry = static_cast<std::size_t>(
+        std::lower_bound(std::begin(_segment.index), std::end(_segment.index),
+                         _from) -
+        std::begin(_segment.index));
+    auto first = entry == 0 ? 0 : (entry - 1) * IndexInterval;
+    auto count = std::min(entry * IndexInterval, _segment.records) - first;
+    while (count > 0) {
+        auto const step = count / 2;
+        if (recordTime(data, first + step) < _from) {
+            first += step + 1;
+            count -= step + 1;
+        } else {
+            count = step;
+        }
+    }
+
+    for (auto r = first; r < _segment.records; ++r) {
+        auto const record = data + r * RecordSize;
+        std::uint32_t time;
+        float temperature;
+        float humidity;
+        std::memcpy(&time, record, sizeof(time));
+        if (time > _to) {
+            break;
+        }
+        std::memcpy(&temperature, record + 4, sizeof(temperature));
+        std::memcpy(&humidity, record + 8, sizeof(humidity));
+        _samples.times.push_back(time);
+        _samples.temperatures.push_back(temperature);
+        _samples.humidities.push_back(humidity);
+    }
+}
+
+void ReadingStore::runCompactor()
+{
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lk(compactMtx_);
+            compactWake_.wait_for(lk, CompactInterval, [this] {
+                return sealed_ || !running_.load(std::memory_order_acquire);
+            });
+            if (!running_.load(std::memory_order_acquire)) {
+                return;
+            }
+            sealed_ = false;
+        }
+
+        for (auto& s : stations_) {
+            compact(s);
+        }
+    }
+}
+
+void ReadingStore::compact(Station& _station)
+{
+    auto const now = std::chrono::duration_cast<std::chrono::seconds>(
+                         std::chrono::system_clock::now().time_since_epoch())
+                         .count();
+
+    // the segments being appended to are never touched
+    std::vector<Segment> sealed;
+    {
+        std::shared_lock<std::shared_mutex> lk(_station.mtx);
+        std::copy_if(std::begin(_station.segments),
+                     std::end(_station.segments), std::back_inserter(sealed),
+                     [](Segment const& _s) { return !_s.appending; });
+    }
+
+    auto const replace = [&_station](fs::path const& _path,
+                                     Segment* _replacement) {
+        std::unique_lock<std::shared_mutex> lk(_station.mtx);
+        auto const it = std::find_if(
+            std::begin(_station.segments), std::end(_station.segments),
+            [&_path](Segment const& _s) { return _s.path == _path; });
+        if (it == std::end(_station.segments)) {
+            return;
+        }
+        if (_replacement != nullptr) {
+            *it = std::move(*_replacement);
+        } else {
+            _station.segments.erase(it);
+        }
+    };
+
+    for (auto const& segment : sealed) {
+        auto const age = now - static_cast<std::int64_t>(segment.lastTime);
+
+        if (options_.compressedRetention.count() > 0 &&
+            age > options_.compressedRetention.count()) {
+            replace(segment.path, nullptr);
+            std::error_code ec;
+            fs::remove(segment.path, ec);
+            if (ec) {
+                LOG_WARN("Failed to remove expired '{}': {}\n",
+                         segment.path.string(), ec.message());
+            }
+            metrics_.storeExpirations.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        if (segment.compressed || age < options_.rawRetention.count()) {
+            continue;
+        }
+
+        try {
+            auto block = compress(segment);
+            auto const blockSize = fs::file_size(block.path);
+            replace(segment.path, &block);
+
+            std::error_code ec;
+            fs::remove(segment.path, ec);
+            if (ec) {
+                LOG_WARN("Failed to remove compacted '{}': {}\n",
+                         segment.path.string(), ec.message());
+            }
+
+            metrics_.storeCompactions.fetch_add(1, std::memory_order_relaxed);
+            metrics_.storeCompactedRawBytes.fetch_add(
+                segment.records * RecordSize, std::memory_order_relaxed);
+            metrics_.storeCompactedBlockBytes.fetch_add(
+                blockSize, std::memory_order_relaxed);
+        } catch (std::exception const& e) {
+            LOG_ERROR("Failed to compact '{}': {}\n", segment.path.string(),
+                      e.what());
+        }
+    }
+}
+
+ReadingStore::Segment ReadingStore::compress(Segment const& _segment) const
+{
+    HistorySamples samples;
+    read(_segment, 0, std::numeric_limits<std::uint32_t>::max(), samples);
+    auto const bytes = CompressedBlock::encode(samples);
+
+    Segment block;
+    block.path = _segment.path;
+    block.path.replace_extension(".blk");
+    block.records = samples.times.size();
+    block.index = CompressedBlock{bytes.data(), bytes.size()}.chunkTimes();
+    block.lastTime = _segment.lastTime;
+    block.compressed = true;
+
+    // Write the block under a temporary name and sync it before it replaces
+    // the segment, a crash in between leaves the segment intact.
+    auto tmp = block.path;
+    tmp += ".tmp";
+
+    auto const file = std::fopen(tmp.string().c_str(), "wb");
+    if (file == nullptr) {
+        throw std::runtime_error(
+            fmt::format("Failed to open '{}'.", tmp.string()));
+    }
+    auto const written = std::fwrite(bytes.data(), 1, bytes.size(), file);
+    auto const flushed = std::fflush(file) == 0;
+    syncFile(file);
+    std::fclose(file);
+    if (written != bytes.size() || !flushed) {
+        fs::remove(tmp);
+        throw std::runtime_error(
+            fmt::format("Failed to write '{}'.", tmp.string()));
+    }
+
+    fs::rename(tmp, block.path);
+    return block;
+}
@@ -0,0 +1,296 @@
+#ifndef WEBSOCKET_SERVER_READING_STORE_HH
+#define WEBSOCKET_SERVER_READING_STORE_HH
+
+#include "websocket_server/Metrics.hh"
+#include "websocket_server/StationHistory.hh"
+#include "websocket_server/StationRollups.hh"
+#include "websocket_server/WeatherStatusNotification.hh"
+#include "websocket_server/utils/bounded_queue.hh"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace amadeus {
+/// \brief Defines when the \ref ReadingStore forces written readings to disk.
+enum class FsyncPolicy
+{
+    /// Never, the OS writes the pages back on its own.
+    Never,
+    /// Once per batch taken from the queue (group commit).
+    Batch,
+    /// At most once per \ref ReadingStoreOptions::fsyncInterval.
+    Interval,
+};
+
+/// \brief The options of the \ref ReadingStore.
+struct ReadingStoreOptions
+{
+    /// The directory of the segment files. An empty directory disables the
+    /// store.
+    std::filesystem::path directory;
+    /// When to force written readings to disk.
+    FsyncPolicy fsync{FsyncPolicy::Batch};
+    /// The fsync interval for \ref FsyncPolicy::Interval.
+    std::chrono::milliseconds fsyncInterval{100};
+    /// The size at which a segment file is sealed and a new one is started.
+    std::size_t segmentBytes{1U << 20U};
+    /// The number of readings which may be queued for the writer thread.
+    std::size_t queueCapacity{1U << 16U};
+    /// How long sealed segments are kept raw before they are compacted into
+    /// compressed blocks, by the age of their last reading.
+    std::chrono::seconds rawRetention{0};
+    /// How long sealed segments and compressed blocks are kept at all, by
+    /// the age of their last reading. Zero keeps them forever.
+    std::chrono::seconds compressedRetention{0};
+    /// How long the finished rollup buckets of each resolution are kept, by
+    /// the end of the bucket. Zero keeps them forever.
+    std::array<std::chrono::seconds, RollupLevels> rollupRetention{};
+};
+
+/// \brief An append-only on-disk store of all station readings, so that they
+/// survive restarts.
+/// Every station has its own directory of segment files. A segment is a flat
+/// array of fixed-size records (timestamp, temperature, humidity, CRC-32)
+/// which is only ever appended to until it reaches its size limit. The
+/// timestamps within a segment are monotonic and each segment keeps a sparse
+/// index of every \ref IndexInterval th timestamp in memory: a seek is a
+/// binary search in the index followed by a binary search within a single
+/// page of the memory-mapped segment.
+/// A reading older than the last one of its station, e.g. a backfilled
+/// reading after a live one, is appended to a separate backfill segment
+/// (".bkf") instead. A backfill segment is sealed as soon as a reading older
+/// than its own last one arrives, so it is monotonic as well; it may overlap
+/// the other segments in time and is merged with them by \ref query.
+/// The I/O threads never touch the disk. \ref append only hands the reading
+/// to a dedicated writer thread through a lock-free queue. The writer drains
+/// the queue in batches, writes each station's records of a batch with a
+/// single write and syncs them according to the \ref FsyncPolicy.
+/// A background compactor turns sealed segments into \ref CompressedBlock
+/// files once they are older than the raw retention and deletes everything
+/// older than the compressed retention. A block replaces its segment with
+/// the same sequence number (".seg" or ".bkf" becomes ".blk").
+/// The writer thread also maintains the \ref StationRollups of every station,
+/// their rollup files are kept next to the segments. Backfilled readings are
+/// left out of the rollups, except for the buckets which are still open when
+/// the rollups are rebuilt after a restart.
+/// \remarks Thread-Safe.
+class ReadingStore
+{
+  public:
+    /// The size of a single record on disk.
+    static constexpr std::size_t RecordSize{16};
+    /// The number of records per sparse index entry, one page.
+    static constexpr std::size_t IndexInterval{4096 / RecordSize};
+    /// The maximum number of readings the writer takes from the queue at
+    /// once.
+    static constexpr std::size_t MaxBatch{4096};
+    /// How often the compactor checks for sealed segments.
+    static constexpr std::chrono::seconds CompactInterval{60};
+
+    /// \brief Constructor.
+    /// \param _options The options.
+    /// \param _metrics The metrics to update.
+    ReadingStore(ReadingStoreOptions _options, Metrics& _metrics);
+
+    /// \brief Stops the writer thread.
+    ~ReadingStore();
+
+    ReadingStore(ReadingStore const&) = delete;
+    ReadingStore& operator=(ReadingStore const&) = delete;
+
+    /// \brief Returns whether the store is enabled.
+    bool enabled() const noexcept;
+
+    /// \brief Recovers the segments of all stations and starts the writer and
+    /// the compactor thread. A torn record at the end of the active segment
+    /// is truncated, a block which was not completely written is discarded.
+    /// \throws std::filesystem::filesystem_error or std::runtime_error if
+    /// the directory or the segment files cannot be opened.
+    void start();
+
+    /// \brief Writes all queued readings, syncs them to disk unless the
+    /// policy is \ref FsyncPolicy::Never and stops the writer and the
+    /// compactor thread.
+    void stop();
+
+    /// \brief Queues a reading for the writer thread. Never blocks.
+    /// \returns false if the store is not running or the queue is full, in
+    /// which case the reading is dropped.
+    bool append(WeatherStatusNotification const& _reading) noexcept;
+
+    /// \brief Queues several readings of a single station and wakes the
+    /// writer thread at most once. Never blocks.
+    /// \param _id The stationId.
+    /// \param _samples The readings.
+    /// \returns The number of readings queued, the rest is dropped. Every
+    /// queued reading is written, older ones to the backfill segment.
+    std::size_t append(StationId _id, HistorySamples const& _samples) noexcept;
+
+    /// \brief Returns all stored samples of a station within [_from, _to],
+    /// in ascending order of time.
+    /// \param _id The stationId.
+    /// \param _from The first unix timestamp to include.
+    /// \param _to The last unix timestamp to include.
+    HistorySamples query(StationId _id, std::uint32_t _from,
+                         std::uint32_t _to) const;
+
+    /// \brief Returns the rollups of all stations.
+    StationRollups const& rollups() const noexcept;
+
+  private:
+    using ClockType = std::chrono::steady_clock;
+
+    /// \brief The published state of a single segment file or compressed
+    /// block.
+    struct Segment
+    {
+        /// The path of the segment file.
+        std::filesystem::path path;
+        /// The number of records in the file.
+        std::size_t records{0};
+        /// The timestamp of every IndexInterval th record, or of the first
+        /// record of every chunk of a compressed block.
+        std::vector<std::uint32_t> index;
+        /// The timestamp of the last record.
+        std::uint32_t lastTime{0};
+        /// Whether the file is a \ref CompressedBlock.
+        bool compressed{false};
+        /// Whether the writer thread still appends to the segment.
+        bool appending{false};
+    };
+
+    /// \brief The state of a segment file the writer thread appends to.
+    struct Writer
+    {
+        /// The path of the segment file.
+        std::filesystem::path path;
+        /// The segment file.
+        std::FILE* file{nullptr};
+        /// The number of records written to the segment.
+        std::size_t written{0};
+        /// The records of the current batch which are not written yet.
+        std::vector<char> buffer;
+        /// The index entries which are not published yet.
+        std::vector<std::uint32_t> pendingIndex;
+        /// The timestamp of the last record.
+        std::uint32_t lastTime{0};
+        /// Whether the segment has written records which are not synced yet.
+        bool dirty{false};
+    };
+
+    /// \brief The segments of a single station.
+    struct Station
+    {
+        /// Protects the segments.
+        mutable std::shared_mutex mtx;
+        /// The segments, ordered by sequence number. The last one is the
+        /// active segment.
+        std::vector<Segment> segments;
+
+        // Only accessed by the writer thread.
+
+        /// The station's directory.
+        std::filesystem::path directory;
+        /// The highest sequence number in use.
+        std::uint64_t sequence{0};
+        /// The active segment, its last record is the newest reading of the
+        /// station.
+        Writer active;
+        /// The backfill segment, closed until an older reading arrives.
+        Writer backfill;
+    };
+
+    /// \brief The writer thread.
+    void run();
+
+    /// \brief Recovers the segments of a station and opens the active one.
+    void recover(Station& _station, StationId _id);
+
+    /// \brief Loads the metadata of a sealed segment or block.
+    /// \returns false if the file is empty or invalid.
+    bool load(Segment& _segment, bool _active) const;
+
+    /// \brief Opens a new segment file with the next sequence number.
+    /// \param _station The station.
+    /// \param _writer The active or the backfill writer of the station.
+    void openSegment(Station& _station, Writer& _writer);
+
+    /// \brief Wakes up the writer thread if it is sleeping.
+    void wakeWriter() noexcept;
+
+    /// \brief Writes a batch of readings.
+    void write(std::vector<WeatherStatusNotification> const& _batch);
+
+    /// \brief Writes the buffered records of a segment.
+    void flush(Writer& _writer);
+
+    /// \brief Syncs a segment if it is dirty.
+    void sync(Writer& _writer);
+
+    /// \brief Makes the written records of a segment visible to queries.
+    void publish(Station& _station, Writer& _writer);
+
+    /// \brief Seals a segment of a station and opens the next one.
+    /// \param _station The station.
+    /// \param _writer The active or the backfill writer of the station.
+    void roll(Station& _station, Writer& _writer);
+
+    /// \brief Copies the samples within [_from, _to] of a segment.
+    void read(Segment const& _segment, std::uint32_t _from, std::uint32_t _to,
+              HistorySamples& _samples) const;
+
+    /// \brief The compactor thread.
+    void runCompactor();
+
+    /// \brief Compacts and expires the sealed segments of a station.
+    void compact(Station& _station);
+
+    /// \brief Writes the compressed block of a sealed segment.
+    /// \returns The metadata of the block.
+    Segment compress(Segment const& _segment) const;
+
+    /// The options.
+    ReadingStoreOptions options_;
+    /// The number of records per segment.
+    std::size_t segmentRecords_;
+    /// The server wide metrics.
+    Metrics& metrics_;
+    /// The readings handed from the I/O threads to the writer thread.
+    bounded_queue<WeatherStatusNotification> queue_;
+    /// The segments of every station.
+    std::array<Station, static_cast<std::size_t>(StationId::Max)> stations_;
+    /// The rollups of every station, updated by the writer thread.
+    StationRollups rollups_;
+    /// The writer thread.
+    std::thread writer_;
+    /// Whether the store accepts readings.
+    std::atomic<bool> running_{false};
+    /// Set by the writer thread before it goes to sleep.
+    std::atomic<bool> sleeping_{false};
+    /// Protects the wake-up of the writer thread.
+    std::mutex wakeMtx_;
+    /// Wakes up the writer thread.
+    std::condition_variable wake_;
+    /// The compactor thread.
+    std::thread compactor_;
+    /// Protects the wake-up of the compactor thread.
+    std::mutex compactMtx_;
+    /// Wakes up the compactor thread, e.g. after a segment was sealed.
+    std::condition_variable compactWake_;
+    /// Whether a segment was sealed since the last compaction.
+    bool sealed_{false};
+};
+} // namespace amadeus
+
+#endif // !WEBSOCKET_SERVER_READING_STORE_HH
@@ -32,7 +32,7 @@ beast::ssl_stream<beast::tcp_stream> SSLTCPSession::releaseStream() noexcept
 
 void SSLTCPSession::run()
 {
-    beast::get_lowest_layer(stream_).expires_after(Timeout);
+    startTimeout();
 
     // Perform the async SSL handshake.
     stream_.async_handshake(
@@ -42,7 +42,7 @@ void SSLTCPSession::run()
 
 void SSLTCPSession::disconnect()
 {
-    beast::get_lowest_layer(stream_).expires_after(Timeout);
+    startTimeout();
 
     stream_.next_layer().cancel();
 
@@ -53,6 +53,8 @@ void SSLTCPSession::disconnect()
 
 void SSLTCPSession::onHandshake(beast::error_code const& _error)
 {
+    cancelTimeout();
+
     if (_error) {
         LOG_ERROR("SSL Handshake error: {}\n", _error.message());
         return;
@@ -81,6 +83,8 @@ void SSLTCPSession::onHandshake(beast::error_code const& _error)
 
 void SSLTCPSession::onShutdown(beast::error_code const& _error)
 {
+    cancelTimeout();
+
     if (_error) {
         LOG_ERROR("SSL Shutdown error: {}\n", _error.message());
         return;
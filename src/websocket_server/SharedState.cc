@@ -4,13 +4,101 @@
 #include "websocket_server/PlainTCPSession.hh"
 #include "websocket_server/SSLTCPSession.hh"
 
+#include <boost/asio/post.hpp>
+
+#include <algorithm>
+#include <ctime>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+
 using namespace amadeus;
 
-SharedState::SharedState(std::string _docRoot, JSON const& _config)
+SharedMessage
+amadeus::encodeWeatherStatus(WeatherStatusNotification const& _notification)
+{
+    auto const time = static_cast<std::time_t>(_notification.time);
+    auto const t = std::gmtime(&time);
+    std::stringstream ss;
+    ss << std::put_time(t, "%Y-%m-%d %H:%M:%S");
+
+    // Prepare JSON response for frontend.
+    auto response = JSON::object();
+    response["id"] = ResponseType::WeatherStatus;
+    response["stationId"] = _notification.id;
+    response["temperature"] = _notification.temperature;
+    response["humidity"] = _notification.humidity;
+    response["time"] = ss.str();
+
+    return std::make_shared<FrontendMessage const>(std::move(response));
+}
+
+SharedMessage amadeus::encodeWeatherStatusError(StationId _id,
+                                                std::string_view _error)
+{
+    auto response = JSON::object();
+    response["id"] = ResponseType::WeatherStatus;
+    response["stationId"] = _id;
+    response["error"] = _error;
+
+    return std::make_shared<FrontendMessage const>(std::move(response));
+}
+
+JSON amadeus::encodeRollups(StationId _id, RollupLevel _level,
+                            std::vector<RollupBucket> const& _buckets)
+{
+    auto column = [&_buckets](auto _member) {
+        auto values = JSON::array();
+        for (auto const& bucket : _buckets) {
+            values.push_back(bucket.*_member);
+        }
+        return values;
+    };
+
+    auto response = JSON::object();
+    response["stationId"] = _id;
+    response["resolution"] = rollupName(_level);
+    response["times"] = column(&RollupBucket::start);
+    response["counts"] = column(&RollupBucket::count);
+    response["temperature"] = {
+        {"min", column(&RollupBucket::minTemperature)},
+        {"max", column(&RollupBucket::maxTemperature)},
+        {"avg", column(&RollupBucket::avgTemperature)}};
+    response["humidity"] = {{"min", column(&RollupBucket::minHumidity)},
+                            {"max", column(&RollupBucket::maxHumidity)},
+                            {"avg", column(&RollupBucket::avgHumidity)}};
+    return response;
+}
+
+namespace {
+/// \brief Orders subscribers by UUID.
+struct SubscriberLess
+{
+    template <typename Subscriber>
+    bool operator()(Subscriber const& _lhs,
+                    boost::uuids::uuid const& _rhs) const noexcept
+    {
+        return _lhs.uuid < _rhs;
+    }
+};
+} // namespace
+
+SharedState::SharedState(std::string _docRoot, JSON const& _config,
+                         std::chrono::milliseconds _cacheMaxAge,
+                         std::size_t _historyMaxBytes,
+                         ReadingStoreOptions _storeOptions,
+                         StreamConfig _stream)
     : docRoot_(std::move(_docRoot))
     , config_(_config)
+    , cache_(_cacheMaxAge)
+    , history_(_historyMaxBytes)
+    , store_(std::move(_storeOptions), metrics_)
 {
     LOG_DEBUG("SharedState::SharedState()\n");
+
+    for (auto& stream : streams_) {
+        stream.store(_stream);
+    }
 }
 
 SharedState::~SharedState()
@@ -53,35 +141,367 @@ JSON const& SharedState::config() const noexcept
     return config_;
 }
 
+Metrics& SharedState::metrics() noexcept
+{
+    return metrics_;
+}
+
+Metrics const& SharedState::metrics() const noexcept
+{
+    return metrics_;
+}
+
+StationCache& SharedState::stationCache() noexcept
+{
+    return cache_;
+}
+
+StationHistory& SharedState::stationHistory() noexcept
+{
+    return history_;
+}
+
+ReadingStore& SharedState::readingStore() noexcept
+{
+    return store_;
+}
+
+std::optional<std::uint32_t>
+SharedState::backfillSequence(StationId _id) const noexcept
+{
+    auto const index = static_cast<std::size_t>(_id);
+    if (index >= backfillNext_.size()) {
+        return std::nullopt;
+    }
+    auto const next = backfillNext_[index].load(std::memory_order_acquire);
+    if (next == 0) {
+        return std::nullopt;
+    }
+    return static_cast<std::uint32_t>(next - 1);
+}
+
+void SharedState::backfillSequence(StationId _id, std::uint32_t _next) noexcept
+{
+    auto const index = static_cast<std::size_t>(_id);
+    if (index < backfillNext_.size()) {
+        backfillNext_[index].store(std::uint64_t{_next} + 1,
+                                   std::memory_order_release);
+    }
+}
+
+StreamConfig SharedState::streamConfig(StationId _id) const noexcept
+{
+    auto const index = static_cast<std::size_t>(_id);
+    if (index >= streams_.size()) {
+        return StreamConfig{};
+    }
+    return streams_[index].load();
+}
+
+void SharedState::streamConfig(StationId _id,
+                               StreamConfig const& _config) noexcept
+{
+    auto const index = static_cast<std::size_t>(_id);
+    if (index < streams_.size()) {
+        streams_[index].store(_config);
+    }
+}
+
+void SharedState::setFanOutExecutors(
+    std::vector<asio::any_io_executor> _executors)
+{
+    fanOutExecutors_ = std::move(_executors);
+}
+
+void SharedState::setOutboundQueueOptions(
+    OutboundQueueOptions const& _options) noexcept
+{
+    outbound_ = _options;
+}
+
+OutboundQueueOptions const& SharedState::outboundQueueOptions() const noexcept
+{
+    return outbound_;
+}
+
 bool SharedState::join(boost::uuids::uuid _uuid,
                        WebSocketSessionCtx<PlainWebSocketSession> _ctx)
 {
-    std::scoped_lock<std::mutex> lk(mtx_);
-    auto const [_, joined] =
-        plain_sessions_.try_emplace(std::move(_uuid), std::move(_ctx));
-    return joined;
+    return plain_sessions_.try_emplace(std::move(_uuid), std::move(_ctx));
 }
 
 bool SharedState::join(boost::uuids::uuid _uuid,
                        WebSocketSessionCtx<SSLWebSocketSession> _ctx)
 {
-    std::scoped_lock<std::mutex> lk(mtx_);
-    auto const [_, joined] =
-        ssl_sessions_.try_emplace(std::move(_uuid), std::move(_ctx));
-    return joined;
+    return ssl_sessions_.try_emplace(std::move(_uuid), std::move(_ctx));
 }
 
 bool SharedState::join(StationId _id, PlainTCPSession* _session)
 {
-    std::scoped_lock<std::mutex> lk(mtx_);
-    auto const [_, joined] = plain_tcp_sessions_.try_emplace(_id, _session);
-    return joined;
+    return plain_tcp_sessions_.try_emplace(_id, weak_from_this(_session));
 }
 
 bool SharedState::join(StationId _id, SSLTCPSession* _session)
 {
-    std::scoped_lock<std::mutex> lk(mtx_);
-    auto const [_, joined] = ssl_tcp_sessions_.try_emplace(_id, _session);
-    return joined;
+    return ssl_tcp_sessions_.try_emplace(_id, weak_from_this(_session));
+}
+
+SharedState::VariantType SharedState::findStation(StationId _id)
+{
+    if (auto sp = lockStation(plain_tcp_sessions_, _id)) {
+        return sp;
+    }
+    if (auto sp = lockStation(ssl_tcp_sessions_, _id)) {
+        return sp;
+    }
+    return std::monostate();
+}
+
+std::vector<SharedState::VariantType>
+SharedState::findStations(std::vector<StationId> const& _ids)
+{
+    std::vector<VariantType> stations(_ids.size(), std::monostate());
+
+    plain_tcp_sessions_.visit_many(
+        std::begin(_ids), std::end(_ids),
+        [&](std::size_t _index, std::weak_ptr<PlainTCPSession> const& _wp) {
+            if (auto sp = _wp.lock()) {
+                stations[_index] = std::move(sp);
+            }
+        });
+    ssl_tcp_sessions_.visit_many(
+        std::begin(_ids), std::end(_ids),
+        [&](std::size_t _index, std::weak_ptr<SSLTCPSession> const& _wp) {
+            // a plain station takes precedence, just like in findStation
+            if (!std::holds_alternative<std::monostate>(stations[_index])) {
+                return;
+            }
+            if (auto sp = _wp.lock()) {
+                stations[_index] = std::move(sp);
+            }
+        });
+
+    return stations;
+}
+
+std::vector<StationId> SharedState::allStationIds()
+{
+    std::vector<StationId> ids;
+    ids.reserve(plain_tcp_sessions_.size() + ssl_tcp_sessions_.size());
+
+    auto const collect = [&](StationId _id, auto const&) {
+        ids.emplace_back(_id);
+    };
+    plain_tcp_sessions_.for_each(collect);
+    ssl_tcp_sessions_.for_each(collect);
+
+    return ids;
+}
+
+SharedState::Topic* SharedState::topic(StationId _id) noexcept
+{
+    auto const index = static_cast<std::size_t>(_id);
+    if (index >= topics_.size()) {
+        return nullptr;
+    }
+    return &topics_[index];
+}
+
+std::shared_ptr<SharedState::Subscribers const>
+SharedState::subscribers(StationId _id)
+{
+    auto* const t = topic(_id);
+    if (t == nullptr) {
+        return nullptr;
+    }
+    std::scoped_lock<std::mutex> lk(t->mtx);
+    return t->subscribers;
+}
+
+bool SharedState::subscribe(StationId _id, boost::uuids::uuid const& _uuid,
+                            NotificationCallback _callback,
+                            std::shared_ptr<SubscriptionFilter> _filter)
+{
+    auto* const t = topic(_id);
+    if (t == nullptr) {
+        return false;
+    }
+
+    std::scoped_lock<std::mutex> lk(t->mtx);
+    auto const& current = *t->subscribers;
+    auto const it = std::lower_bound(std::begin(current), std::end(current),
+                                     _uuid, SubscriberLess{});
+    // subscribing again replaces the subscriber and thereby its filter
+    auto const found = it != std::end(current) && it->uuid == _uuid;
+
+    auto next = std::make_shared<Subscribers>();
+    next->reserve(current.size() + (found ? 0 : 1));
+    next->insert(std::end(*next), std::begin(current), it);
+    next->push_back(
+        Subscriber{_uuid, std::move(_callback), std::move(_filter)});
+    next->insert(std::end(*next), found ? std::next(it) : it,
+                 std::end(current));
+    t->subscribers = std::move(next);
+    return true;
+}
+
+bool SharedState::unsubscribe(StationId _id, boost::uuids::uuid const& _uuid)
+{
+    auto* const t = topic(_id);
+    if (t == nullptr) {
+        return false;
+    }
+
+    std::scoped_lock<std::mutex> lk(t->mtx);
+    auto const& current = *t->subscribers;
+    auto const it = std::lower_bound(std::begin(current), std::end(current),
+                                     _uuid, SubscriberLess{});
+    if (it == std::end(current) || it->uuid != _uuid) {
+        return false;
+    }
+
+    auto next = std::make_shared<Subscribers>();
+    next->reserve(current.size() - 1);
+    next->insert(std::end(*next), std::begin(current), it);
+    next->insert(std::end(*next), std::next(it), std::end(current));
+    t->subscribers = std::move(next);
+    return true;
+}
+
+void SharedState::unsubscribeAll(boost::uuids::uuid const& _uuid)
+{
+    for (std::size_t i = 0; i < topics_.size(); ++i) {
+        unsubscribe(static_cast<StationId>(i), _uuid);
+    }
+}
+
+void SharedState::fanOut(
+    std::shared_ptr<Subscribers const> _subscribers,
+    std::shared_ptr<std::vector<std::uint32_t> const> _selection,
+    SharedMessage _message, StationId _id)
+{
+    auto const deliver = [_id](Subscribers const& _subs,
+                               std::vector<std::uint32_t> const* _sel,
+                               std::size_t _begin, std::size_t _end,
+                               SharedMessage const& _msg) {
+        for (auto i = _begin; i < _end; ++i) {
+            _subs[_sel != nullptr ? (*_sel)[i] : i].callback(_msg, _id);
+        }
+    };
+
+    auto const count = _selection ? _selection->size() : _subscribers->size();
+    if (count <= FanOutChunkSize || fanOutExecutors_.empty()) {
+        deliver(*_subscribers, _selection.get(), 0, count, _message);
+        return;
+    }
+
+    // Hand all but the first chunk to the worker threads, the first chunk is
+    // delivered right away on the calling thread.
+    for (std::size_t begin = FanOutChunkSize; begin < count;
+         begin += FanOutChunkSize) {
+        auto const end = std::min<std::size_t>(begin + FanOutChunkSize, count);
+        auto const index = nextFanOutExecutor_.fetch_add(
+                               1, std::memory_order_relaxed) %
+                           fanOutExecutors_.size();
+        asio::post(fanOutExecutors_[index], [deliver, _subscribers, _selection,
+                                             _message, begin, end] {
+            deliver(*_subscribers, _selection.get(), begin, end, _message);
+        });
+    }
+    deliver(*_subscribers, _selection.get(), 0, FanOutChunkSize, _message);
+}
+
+std::size_t
+SharedState::publish(WeatherStatusNotification const& _notification,
+                     std::vector<boost::uuids::uuid> const& _requesters)
+{
+    auto subs = subscribers(_notification.id);
+    auto const total = subs ? subs->size() : std::size_t{0};
+
+    auto const requested = [&_requesters](boost::uuids::uuid const& _uuid) {
+        return std::find(std::begin(_requesters), std::end(_requesters),
+                         _uuid) != std::end(_requesters);
+    };
+
+    // Evaluate the filters on the raw reading. The selection is only built
+    // once a filter rejected the update, until then every subscriber
+    // receives it.
+    std::shared_ptr<std::vector<std::uint32_t>> selection;
+    for (std::size_t i = 0; i < total; ++i) {
+        auto const& subscriber = (*subs)[i];
+        auto const pass = !subscriber.filter ||
+                          subscriber.filter->accept(
+                              _notification, requested(subscriber.uuid));
+        if (!pass && !selection) {
+            selection = std::make_shared<std::vector<std::uint32_t>>();
+            selection->reserve(total);
+            selection->resize(i);
+            std::iota(std::begin(*selection), std::end(*selection), 0U);
+        } else if (pass && selection) {
+            selection->push_back(static_cast<std::uint32_t>(i));
+        }
+    }
+    auto const selected = selection ? selection->size() : total;
+    if (selected < total) {
+        metrics_.wsUpdatesFiltered.fetch_add(total - selected,
+                                             std::memory_order_relaxed);
+    }
+
+    auto const subscribed = [&subs](boost::uuids::uuid const& _uuid) {
+        if (!subs) {
+            return false;
+        }
+        auto const it = std::lower_bound(std::begin(*subs), std::end(*subs),
+                                         _uuid, SubscriberLess{});
+        return it != std::end(*subs) && it->uuid == _uuid;
+    };
+
+    // requesters which are subscribed receive the update through the topic
+    std::vector<boost::uuids::uuid> requesters;
+    requesters.reserve(_requesters.size());
+    for (auto const& uuid : _requesters) {
+        if (!subscribed(uuid)) {
+            requesters.push_back(uuid);
+        }
+    }
+
+    if (selected == 0 && requesters.empty()) {
+        return 0;
+    }
+
+    auto message = encodeWeatherStatus(_notification);
+    if (selected > 0) {
+        fanOut(std::move(subs), std::move(selection), message,
+               _notification.id);
+    }
+
+    return selected + notify(requesters, message, _notification.id);
 }
 
+std::size_t
+SharedState::notify(std::vector<boost::uuids::uuid> const& _sessions,
+                    SharedMessage const& _message,
+                    std::optional<StationId> _id)
+{
+    // resolve all sessions in one batched lookup per registry
+    std::vector<NotificationCallback> callbacks(_sessions.size());
+    auto const collect = [&](std::size_t _index, auto const& _ctx) {
+        if (weak_from_this(_ctx.session).lock()) {
+            callbacks[_index] = _ctx.callback;
+        }
+    };
+    plain_sessions_.visit_many(std::begin(_sessions), std::end(_sessions),
+                               collect);
+    ssl_sessions_.visit_many(std::begin(_sessions), std::end(_sessions),
+                             collect);
+
+    std::size_t recipients{};
+    for (auto const& callback : callbacks) {
+        if (callback) {
+            callback(_message, _id);
+            ++recipients;
+        }
+    }
+
+    return recipients;
+}
@@ -1,38 +1,61 @@
 #ifndef WEBSOCKET_SERVER_SHARED_STATE_HH
 #define WEBSOCKET_SERVER_SHARED_STATE_HH
 
+#include "websocket_server/asiofwd.hh"
 #include "websocket_server/CommandLineInterface.hh"
-
+#include "websocket_server/Metrics.hh"
+#include "websocket_server/OutboundQueueOptions.hh"
+#include "websocket_server/ReadingStore.hh"
+#include "websocket_server/StationCache.hh"
+#include "websocket_server/StationHistory.hh"
+#include "websocket_server/StreamConfig.hh"
+#include "websocket_server/SubscriptionFilter.hh"
+#include "websocket_server/WeatherStatusNotification.hh"
+#include "websocket_server/WireFormat.hh"
+#include "websocket_server/Packets/In/HandshakePacket.hh"
+#include "websocket_server/utils/seqlock.hh"
+#include "websocket_server/utils/sharded_map.hh"
+#include "websocket_server/utils/uuid_hash.hh"
+
+#include <boost/asio/any_io_executor.hpp>
 #include <boost/uuid/uuid.hpp>
-#include <boost/functional/hash.hpp>
 
+#include <array>
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <type_traits>
-#include <unordered_map>
-#include <unordered_set>
 #include <variant>
 #include <vector>
 
 namespace amadeus {
-/// Forward declaration.
-enum class StationId : std::uint8_t;
-
-/// \brief Represents a 'notification' from a TCP connection, whenever a new
-/// weather status update is received.
-struct WeatherStatusNotification
-{
-    /// The unique station id which identifies the TCP connection.
-    StationId id;
-    /// The temperature read from the sensor.
-    float temperature;
-    /// The humidity read from the sensor.
-    float humidity;
-    /// The unix timestamp from when the sensor read the data.
-    std::uint32_t time;
-};
+/// \brief Builds the weather status response for the frontend. It is
+/// serialized once per wire format of its recipients.
+/// \param _notification The weather status update.
+SharedMessage
+encodeWeatherStatus(WeatherStatusNotification const& _notification);
+
+/// \brief Builds the weather status response for a poll which failed.
+/// \param _id The stationId.
+/// \param _error Why the poll failed, e.g. "timeout".
+SharedMessage encodeWeatherStatusError(StationId _id, std::string_view _error);
+
+/// \brief Serializes rollup buckets for the frontend, one array per column.
+/// \param _id The stationId.
+/// \param _level The resolution of the buckets.
+/// \param _buckets The buckets.
+JSON encodeRollups(StationId _id, RollupLevel _level,
+                   std::vector<RollupBucket> const& _buckets);
+
+/// \brief Queues a message on a WebSocketSession, which serializes it in its
+/// wire format. Can be called from any thread. The second argument is the
+/// station of a weather status update, which a slow session may coalesce with
+/// a queued update of the same station, or std::nullopt for any other message.
+using NotificationCallback =
+    std::function<void(SharedMessage const&, std::optional<StationId>)>;
 
 /// \brief Represents a simple WebSocketSession Context which is filled in by
 /// the WebSocketSession itself whenever an asynchronous accept operation is
@@ -41,13 +64,10 @@ struct WeatherStatusNotification
 template <typename SessionType>
 struct WebSocketSessionCtx
 {
-    /// The callback whenever a new weather response is received from the TCP
-    /// Session.
-    using NotificationCallback = std::function<void(WeatherStatusNotification)>;
     /// Can either be PlainWebSocketSession or SSLWebSocketSession.
     SessionType* session;
-    /// Called each time a new weather response was received from the TCP
-    /// Session.
+    /// Called with the serialized weather response whenever the TCP Session
+    /// receives the answer to a request of this session.
     NotificationCallback callback;
 };
 
@@ -71,22 +91,69 @@ class SharedState
     std::string const docRoot_;
     /// The JSON config.
     JSON const& config_;
-    /// Protects the sessions list.
-    std::mutex mtx_;
-    /// A set to track all plain websockets.
-    std::unordered_map<boost::uuids::uuid,
-                       WebSocketSessionCtx<PlainWebSocketSession>,
-                       boost::hash<boost::uuids::uuid>>
+    /// The server wide metrics.
+    Metrics metrics_;
+    /// The latest reading of every station.
+    StationCache cache_;
+    /// The recent readings of every station.
+    StationHistory history_;
+    /// The on-disk store of all readings.
+    ReadingStore store_;
+    /// Tracks all plain websockets.
+    sharded_map<boost::uuids::uuid, PlainWebSocketSessionCtx,
+                uuid_hash>
         plain_sessions_;
-    /// A set to track all ssl websockets.
-    std::unordered_map<boost::uuids::uuid,
-                       WebSocketSessionCtx<SSLWebSocketSession>,
-                       boost::hash<boost::uuids::uuid>>
+    /// Tracks all ssl websockets.
+    sharded_map<boost::uuids::uuid, SSLWebSocketSessionCtx,
+                uuid_hash>
         ssl_sessions_;
-    /// A hashmap for all plain tcp sessions bound to a unique stationId.
-    std::unordered_map<StationId, PlainTCPSession*> plain_tcp_sessions_;
-    /// A hashmap for all ssl tcp sessions bound to a unique stationId.
-    std::unordered_map<StationId, SSLTCPSession*> ssl_tcp_sessions_;
+    /// Tracks all plain tcp sessions bound to a unique stationId.
+    sharded_map<StationId, std::weak_ptr<PlainTCPSession>> plain_tcp_sessions_;
+    /// Tracks all ssl tcp sessions bound to a unique stationId.
+    sharded_map<StationId, std::weak_ptr<SSLTCPSession>> ssl_tcp_sessions_;
+
+    /// \brief A WebSocketSession which subscribed to a station.
+    struct Subscriber
+    {
+        /// The UUID of the WebSocketSession.
+        boost::uuids::uuid uuid;
+        /// Queues a notification on the WebSocketSession.
+        NotificationCallback callback;
+        /// Decides which updates are pushed to the WebSocketSession, null
+        /// pushes every update.
+        std::shared_ptr<SubscriptionFilter> filter;
+    };
+    /// The subscribers of a topic, sorted by UUID.
+    using Subscribers = std::vector<Subscriber>;
+
+    /// \brief The subscribers of a single station. The subscriber list is
+    /// copy-on-write: (un-)subscribing replaces the whole list, publishing
+    /// only grabs a reference to the current list and iterates it without
+    /// holding the lock.
+    struct alignas(64) Topic
+    {
+        /// Protects the pointer to the subscriber list.
+        std::mutex mtx;
+        /// The current subscriber list, never null.
+        std::shared_ptr<Subscribers const> subscribers{
+            std::make_shared<Subscribers const>()};
+    };
+    /// One topic per station.
+    std::array<Topic, static_cast<std::size_t>(StationId::Max)> topics_;
+    /// The next backfill sequence number expected from every station plus
+    /// one, zero until the first backfill of the station.
+    std::array<std::atomic<std::uint64_t>,
+               static_cast<std::size_t>(StationId::Max)>
+        backfillNext_{};
+    /// The stream configuration of every station.
+    std::array<seqlock<StreamConfig>, static_cast<std::size_t>(StationId::Max)>
+        streams_;
+    /// The executors large fan-outs are partitioned across.
+    std::vector<asio::any_io_executor> fanOutExecutors_;
+    /// The limits of the outbound queue of every WebSocketSession.
+    OutboundQueueOptions outbound_;
+    /// Round-robin index into fanOutExecutors_.
+    std::atomic<std::size_t> nextFanOutExecutor_{0};
 
     /// \brief Returns a weak_ptr for a PlainWebSocketSession.
     std::weak_ptr<PlainWebSocketSession>
@@ -104,104 +171,51 @@ class SharedState
     std::weak_ptr<SSLTCPSession>
     weak_from_this(SSLTCPSession* _session) noexcept;
 
-    /// \brief For performance reasons we'll copy all weak_ptr from the session
-    /// list into a local vector. This is done to avoid holding a lock while
-    /// broadcasting the message.
-    /// \tparam SessionType The SessionType can either be PlainWebSocketSession
-    /// or SSLWebSocketSession.
-    /// \tparam ContainerSequence The container in which to copy the sessions
-    /// to. The container must be of type std::vector<SessionType*>.
-    template <typename SessionType, typename ContainerSequence>
-    inline void copySessions(ContainerSequence&& _sequence)
-    {
-        static_assert(
-            std::is_same_v<ContainerSequence, std::vector<SessionType*>>,
-            "The ContainerSequence must be of type std::vector<SessionType*>!");
-
-        if constexpr (std::is_same_v<SessionType, PlainWebSocketSession>) {
-            _sequence.reserve(plain_sessions_.size());
-            for (auto [_, ctx] : plain_sessions_) {
-                _sequence.emplace_back(weak_from_this(ctx.session));
-            }
-        } else if constexpr (std::is_same_v<SessionType, SSLWebSocketSession>) {
-            _sequence.reserve(ssl_sessions_.size());
-            for (auto [_, ctx] : ssl_sessions_) {
-                _sequence.emplace_back(weak_from_this(ctx.session));
-            }
-        }
-    }
-
-    /// \brief Returns the callback for the PlainWebSocketSession by a given
-    /// UUID.
-    /// \param _uuid The specific UUID bound to the PlainWebSocketSession.
-    /// \remarks Not Thread-Safe. Must be called with a held lock.
-    PlainWebSocketSessionCtx::NotificationCallback
-    findPlainWebSocketSession(boost::uuids::uuid const& _uuid)
-    {
-        if (auto const it = plain_sessions_.find(_uuid);
-            it != std::end(plain_sessions_)) {
-            auto wp = weak_from_this(it->second.session);
-            if (auto sp = wp.lock()) {
-                return it->second.callback;
-            }
-            // sp has expired
-            return nullptr;
-        }
-        // not found
-        return nullptr;
-    }
-
-    /// \brief Returns the callback for the SSLWebSocketSession by a given UUID.
-    /// \param _uuid The specific UUID bound to the SSLWebSocketSession.
-    /// \remarks Not Thread-Safe. Must be called with a held lock.
-    SSLWebSocketSessionCtx::NotificationCallback
-    findSSLWebSocketSession(boost::uuids::uuid const& _uuid)
-    {
-        if (auto const it = ssl_sessions_.find(_uuid);
-            it != std::end(ssl_sessions_)) {
-            auto wp = weak_from_this(it->second.session);
-            if (auto sp = wp.lock()) {
-                return it->second.callback;
-            }
-            // sp has expired
-            return nullptr;
-        }
-        // not found
-        return nullptr;
-    }
-
-    /// \brief Finds a PlainTCPSession by a given stationId.
-    /// \param _key The unique stationId.
-    std::shared_ptr<PlainTCPSession> findPlainStation(StationId _key)
+    /// \brief Returns the topic of the given station or nullptr if the
+    /// stationId is invalid.
+    Topic* topic(StationId _id) noexcept;
+
+    /// \brief Returns the current subscriber list of the given station.
+    std::shared_ptr<Subscribers const> subscribers(StationId _id);
+
+    /// \brief Queues the message to all subscribers, or to the selected ones.
+    /// Large subscriber lists are split into chunks of \ref FanOutChunkSize
+    /// which are delivered on the fan-out executors.
+    /// \param _subscribers The subscribers.
+    /// \param _selection The indices of the subscribers which receive the
+    /// update, null for all of them.
+    /// \param _message The weather status update.
+    /// \param _id The station of the update.
+    void fanOut(std::shared_ptr<Subscribers const> _subscribers,
+                std::shared_ptr<std::vector<std::uint32_t> const> _selection,
+                SharedMessage _message, StationId _id);
+
+    /// \brief Returns the callback for a WebSocketSession by a given UUID.
+    /// \param _sessions The session registry to search.
+    /// \param _uuid The specific UUID bound to the WebSocketSession.
+    template <typename Sessions>
+    NotificationCallback findCallback(Sessions const& _sessions,
+                                      boost::uuids::uuid const& _uuid)
     {
-        if (auto const it = plain_tcp_sessions_.find(_key);
-            it != std::end(plain_tcp_sessions_)) {
-            auto wp = weak_from_this(it->second);
-            if (auto sp = wp.lock()) {
-                return sp;
+        NotificationCallback callback;
+        _sessions.visit(_uuid, [&](auto const& _ctx) {
+            // only hand out the callback if the session is still alive
+            if (auto sp = weak_from_this(_ctx.session).lock()) {
+                callback = _ctx.callback;
             }
-            // sp has expired
-            return nullptr;
-        }
-        // not found
-        return nullptr;
+        });
+        return callback;
     }
 
-    /// \brief Finds an SSLTCPSession by a given stationId.
+    /// \brief Finds a TCPSession by a given stationId.
+    /// \param _stations The station registry to search.
     /// \param _key The unique stationId.
-    std::shared_ptr<SSLTCPSession> findSSLStation(StationId _key)
+    template <typename Stations>
+    static auto lockStation(Stations const& _stations, StationId _key)
     {
-        if (auto const it = ssl_tcp_sessions_.find(_key);
-            it != std::end(ssl_tcp_sessions_)) {
-            auto wp = weak_from_this(it->second);
-            if (auto sp = wp.lock()) {
-                return sp;
-            }
-            // sp has expired
-            return nullptr;
-        }
-        // not found
-        return nullptr;
+        typename Stations::mapped_type wp;
+        _stations.visit(_key, [&](auto const& _wp) { wp = _wp; });
+        return wp.lock();
     }
 
   public:
@@ -214,7 +228,16 @@ class SharedState
 
     /// \brief Constructor.
     /// \param _docRoot The document resources directory.
-    SharedState(std::string _docRoot, JSON const& _config);
+    /// \param _config The JSON config.
+    /// \param _cacheMaxAge The max-age of cached station readings.
+    /// \param _historyMaxBytes The memory ceiling of the reading history of
+    /// a single station.
+    /// \param _storeOptions The options of the on-disk reading store.
+    /// \param _stream The initial stream configuration of every station.
+    SharedState(std::string _docRoot, JSON const& _config,
+                std::chrono::milliseconds _cacheMaxAge,
+                std::size_t _historyMaxBytes,
+                ReadingStoreOptions _storeOptions, StreamConfig _stream);
 
     /// \brief Destructor.
     ~SharedState();
@@ -225,6 +248,64 @@ class SharedState
     /// \brief Returns the JSON config.
     JSON const& config() const noexcept;
 
+    /// \brief Returns the server wide metrics.
+    Metrics& metrics() noexcept;
+
+    /// \brief Returns the server wide metrics.
+    Metrics const& metrics() const noexcept;
+
+    /// \brief Returns the cache of the latest station readings.
+    StationCache& stationCache() noexcept;
+
+    /// \brief Returns the reading history of all stations.
+    StationHistory& stationHistory() noexcept;
+
+    /// \brief Returns the on-disk reading store.
+    ReadingStore& readingStore() noexcept;
+
+    /// \brief Returns the next backfill sequence number expected from a
+    /// station, i.e. all readings before it have been stored. It survives
+    /// reconnects of the station, but not restarts of the server.
+    /// \param _id The stationId.
+    /// \returns std::nullopt if the station has not uploaded a backfill yet
+    /// or the stationId is invalid.
+    /// \remarks Thread-Safe.
+    std::optional<std::uint32_t> backfillSequence(StationId _id) const noexcept;
+
+    /// \brief Sets the next backfill sequence number expected from a station.
+    /// \param _id The stationId.
+    /// \param _next The next sequence number.
+    /// \remarks Thread-Safe.
+    void backfillSequence(StationId _id, std::uint32_t _next) noexcept;
+
+    /// \brief Returns how a station pushes its readings. It is sent to the
+    /// station after the handshake.
+    /// \param _id The stationId.
+    /// \remarks Thread-Safe.
+    StreamConfig streamConfig(StationId _id) const noexcept;
+
+    /// \brief Changes how a station pushes its readings. The connected
+    /// station is not told by this call.
+    /// \param _id The stationId.
+    /// \param _config The stream configuration.
+    /// \remarks Thread-Safe.
+    void streamConfig(StationId _id, StreamConfig const& _config) noexcept;
+
+    /// \brief Sets the executors large fan-outs are partitioned across. Must
+    /// be called before any session is started.
+    /// \param _executors One executor per worker thread (or one executor of
+    /// an io_context which is run by several threads).
+    void setFanOutExecutors(std::vector<asio::any_io_executor> _executors);
+
+    /// \brief Sets the limits of the outbound queue of every WebSocketSession.
+    /// Must be called before any session is started.
+    /// \param _options The limits.
+    void setOutboundQueueOptions(OutboundQueueOptions const& _options) noexcept;
+
+    /// \brief Returns the limits of the outbound queue of every
+    /// WebSocketSession.
+    OutboundQueueOptions const& outboundQueueOptions() const noexcept;
+
     /// \brief Join a PlainWebSocketSession and insert it into the list.
     /// \param _uuid The UUID for the PlainWebSocketSession.
     /// \param _ctx The PlainWebSocketSessionCtx.
@@ -257,13 +338,12 @@ class SharedState
     template <typename SessionType>
     void leave(boost::uuids::uuid const& _uuid)
     {
-        std::scoped_lock<std::mutex> lk(mtx_);
-
         if constexpr (std::is_same_v<SessionType, PlainWebSocketSession>) {
             plain_sessions_.erase(_uuid);
         } else if constexpr (std::is_same_v<SessionType, SSLWebSocketSession>) {
             ssl_sessions_.erase(_uuid);
         }
+        unsubscribeAll(_uuid);
     }
 
     /// \brief Leaves a PlainTCPSession or SSLTCPSession by a given UUID.
@@ -271,8 +351,6 @@ class SharedState
     template <typename SessionType>
     void leave(StationId _id)
     {
-        std::scoped_lock<std::mutex> lk(mtx_);
-
         if constexpr (std::is_same_v<SessionType, PlainTCPSession>) {
             plain_tcp_sessions_.erase(_id);
         } else if constexpr (std::is_same_v<SessionType, SSLTCPSession>) {
@@ -284,16 +362,14 @@ class SharedState
     /// (PlainWebSocketSession or SSLWebSocketSession) and UUID and returns the
     /// callback function for the weather status notification.
     /// \param _uuid The given UUID.
+    /// \remarks Thread-Safe.
     template <typename SessionType>
-    std::function<void(WeatherStatusNotification)>
-    findWebSocketSession(boost::uuids::uuid const& _uuid)
+    NotificationCallback findWebSocketSession(boost::uuids::uuid const& _uuid)
     {
-        std::scoped_lock<std::mutex> lk(mtx_);
-
         if constexpr (std::is_same_v<SessionType, PlainWebSocketSession>) {
-            return findPlainWebSocketSession(_uuid);
+            return findCallback(plain_sessions_, _uuid);
         } else if constexpr (std::is_same_v<SessionType, SSLWebSocketSession>) {
-            return findSSLWebSocketSession(_uuid);
+            return findCallback(ssl_sessions_, _uuid);
         }
         return nullptr;
     }
@@ -301,37 +377,65 @@ class SharedState
     /// \brief Finds a specific PlainTCPSession or SSLTCPSession by a given
     /// stationId.
     /// \param _id The stationId.
-    VariantType findStation(StationId _id)
-    {
-        auto sp = findPlainStation(_id);
-        if (sp) {
-            return sp;
-        } else {
-            auto sp = findSSLStation(_id);
-            return sp;
-        }
-        return std::monostate();
-    }
+    /// \remarks Thread-Safe.
+    VariantType findStation(StationId _id);
 
-    /// \brief Returns all registered station ids as a vector.
-    std::vector<StationId> allStationIds()
-    {
-        std::vector<StationId> ids;
+    /// \brief Batched version of \ref findStation. Resolves all given
+    /// stationIds at once, locking every registry shard at most once.
+    /// \param _ids The stationIds.
+    /// \returns The sessions in the same order as _ids. Unknown or expired
+    /// stations are std::monostate.
+    /// \remarks Thread-Safe.
+    std::vector<VariantType> findStations(std::vector<StationId> const& _ids);
 
-        std::scoped_lock<std::mutex> lk(mtx_);
-        {
-            ids.reserve(plain_tcp_sessions_.size() + ssl_tcp_sessions_.size());
+    /// \brief Subscribes a WebSocketSession to the weather status updates of a
+    /// station. Subscribing twice replaces the filter.
+    /// \param _id The stationId.
+    /// \param _uuid The UUID of the WebSocketSession.
+    /// \param _callback Queues a notification on the WebSocketSession.
+    /// \param _filter Decides which updates are pushed to the
+    /// WebSocketSession, null pushes every update.
+    /// \returns false if the stationId is invalid.
+    /// \remarks Thread-Safe.
+    bool subscribe(StationId _id, boost::uuids::uuid const& _uuid,
+                   NotificationCallback _callback,
+                   std::shared_ptr<SubscriptionFilter> _filter = nullptr);
 
-            for (auto const& [stationId, _] : plain_tcp_sessions_) {
-                ids.emplace_back(stationId);
-            }
-            for (auto const& [stationId, _] : ssl_tcp_sessions_) {
-                ids.emplace_back(stationId);
-            }
-        }
+    /// \brief Unsubscribes a WebSocketSession from a station.
+    /// \returns true if the session was subscribed.
+    /// \remarks Thread-Safe.
+    bool unsubscribe(StationId _id, boost::uuids::uuid const& _uuid);
 
-        return ids;
-    }
+    /// \brief Unsubscribes a WebSocketSession from all stations.
+    /// \remarks Thread-Safe.
+    void unsubscribeAll(boost::uuids::uuid const& _uuid);
+
+    /// \brief Queues the notification to every subscriber of the station
+    /// whose filter passes it. It is serialized once per wire format of the
+    /// recipients. The filters are evaluated first, a notification nobody
+    /// receives is never built. The WebSocketSessions which requested the
+    /// weather status receive the same message regardless of their filters.
+    /// \param _notification The weather status update.
+    /// \param _requesters The UUIDs of the requesting WebSocketSessions.
+    /// \returns The number of recipients.
+    /// \remarks Thread-Safe.
+    std::size_t publish(WeatherStatusNotification const& _notification,
+                        std::vector<boost::uuids::uuid> const& _requesters);
+
+    /// \brief Queues a message to the given WebSocketSessions.
+    /// \param _sessions The UUIDs of the WebSocketSessions.
+    /// \param _message The message.
+    /// \param _id The station if the message is a weather status update,
+    /// see \ref NotificationCallback.
+    /// \returns The number of recipients.
+    /// \remarks Thread-Safe.
+    std::size_t notify(std::vector<boost::uuids::uuid> const& _sessions,
+                       SharedMessage const& _message,
+                       std::optional<StationId> _id);
+
+    /// \brief Returns all registered station ids as a vector.
+    /// \remarks Thread-Safe.
+    std::vector<StationId> allStationIds();
 };
 } // namespace amadeus
 
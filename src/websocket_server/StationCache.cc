@@ -0,0 +1,46 @@
+#include "websocket_server/StationCache.hh"
+
+using namespace amadeus;
+
+StationCache::StationCache(std::chrono::milliseconds _maxAge) noexcept
+    : maxAge_(_maxAge)
+{
+}
+
+std::chrono::milliseconds StationCache::maxAge() const noexcept
+{
+    return maxAge_;
+}
+
+void StationCache::update(WeatherStatusNotification const& _reading,
+                          ClockType::time_point _now) noexcept
+{
+    auto const index = static_cast<std::size_t>(_reading.id);
+    if (index >= slots_.size()) {
+        return;
+    }
+
+    slots_[index].entry.store(Entry{_reading, _now.time_since_epoch().count()});
+}
+
+std::optional<WeatherStatusNotification>
+StationCache::lookup(StationId _id, ClockType::time_point _now) const noexcept
+{
+    auto const index = static_cast<std::size_t>(_id);
+    if (maxAge_.count() <= 0 || index >= slots_.size()) {
+        return std::nullopt;
+    }
+
+    auto const entry = slots_[index].entry.load();
+    if (entry.receivedAt == 0) {
+        return std::nullopt;
+    }
+
+    auto const receivedAt =
+        ClockType::time_point{ClockType::duration{entry.receivedAt}};
+    if (_now - receivedAt > maxAge_) {
+        return std::nullopt;
+    }
+
+    return entry.reading;
+}
@@ -0,0 +1,74 @@
+#ifndef WEBSOCKET_SERVER_STATION_CACHE_HH
+#define WEBSOCKET_SERVER_STATION_CACHE_HH
+
+#include "websocket_server/WeatherStatusNotification.hh"
+#include "websocket_server/utils/seqlock.hh"
+
+#include <array>
+#include <chrono>
+#include <optional>
+
+namespace amadeus {
+/// \brief Holds the latest reading of every station together with the point
+/// in time it was received. A WeatherStatus request for a station whose
+/// latest reading is younger than the configured max-age is answered straight
+/// from memory instead of polling the µc.
+/// Each station slot is a \ref seqlock on its own cache line: updates come
+/// from the TCP session of the station, lookups from any number of
+/// WebSocketSessions and never block.
+/// \remarks Thread-Safe.
+class StationCache
+{
+  public:
+    using ClockType = std::chrono::steady_clock;
+
+    /// \brief Constructor.
+    /// \param _maxAge The maximum age of a reading to be served from the
+    /// cache. A max-age of zero disables the cache.
+    explicit StationCache(std::chrono::milliseconds _maxAge) noexcept;
+
+    StationCache(StationCache const&) = delete;
+    StationCache& operator=(StationCache const&) = delete;
+
+    /// \brief Returns the configured max-age.
+    std::chrono::milliseconds maxAge() const noexcept;
+
+    /// \brief Stores the latest reading of a station.
+    /// \param _reading The reading.
+    /// \param _now The point in time the reading was received.
+    void update(WeatherStatusNotification const& _reading,
+                ClockType::time_point _now = ClockType::now()) noexcept;
+
+    /// \brief Returns the latest reading of a station if it is younger than
+    /// the max-age.
+    /// \param _id The stationId.
+    /// \param _now The current point in time.
+    std::optional<WeatherStatusNotification>
+    lookup(StationId _id,
+           ClockType::time_point _now = ClockType::now()) const noexcept;
+
+  private:
+    /// \brief A cached reading.
+    struct Entry
+    {
+        /// The reading.
+        WeatherStatusNotification reading;
+        /// The point in time the reading was received, in ticks of
+        /// ClockType since its epoch. Zero if the slot is empty.
+        ClockType::rep receivedAt;
+    };
+
+    /// \brief The slot of a single station.
+    struct alignas(64) Slot
+    {
+        seqlock<Entry> entry;
+    };
+
+    /// One slot per station.
+    std::array<Slot, static_cast<std::size_t>(StationId::Max)> slots_;
+    /// The maximum age of a reading to be served.
+    std::chrono::milliseconds maxAge_;
+};
+} // namespace amadeus
+
+#endif // !WEBSOCKET_SERVER_STATION_CACHE_HH
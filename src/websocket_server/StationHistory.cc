@@ -0,0 +1,298 @@
+#include "websocket_server/StationHistory.hh"
+
+#include <algorithm>
+#include <array>
+#include <thread>
+
+using namespace amadeus;
+
+namespace {
+/// \brief A single sample of a series.
+struct Sample
+{
+    /// The unix timestamp.
+    std::uint32_t time;
+    /// The temperature.
+    float temperature;
+    /// The humidity.
+    float humidity;
+};
+
+/// \brief Returns the largest power of two not greater than _n, or zero.
+std::size_t floorPowerOfTwo(std::size_t _n) noexcept
+{
+    std::size_t p{1};
+    if (_n == 0) {
+        return 0;
+    }
+    while (p <= _n / 2) {
+        p *= 2;
+    }
+    return p;
+}
+} // namespace
+
+StationHistory::StationHistory(std::size_t _maxBytesPerStation)
+    : capacity_(floorPowerOfTwo(_maxBytesPerStation / SampleSize))
+    , mask_(capacity_ == 0 ? 0 : capacity_ - 1)
+{
+    if (capacity_ == 0) {
+        return;
+    }
+
+    for (auto& s : series_) {
+        s.times = std::make_unique<std::atomic<std::uint32_t>[]>(capacity_);
+        s.temperatures = std::make_unique<std::atomic<float>[]>(capacity_);
+        s.humidities = std::make_unique<std::atomic<float>[]>(capacity_);
+    }
+}
+
+std::size_t StationHistory::capacity() const noexcept
+{
+    return capacity_;
+}
+
+void StationHistory::append(WeatherStatusNotification const& _reading) noexcept
+{
+    auto const index = static_cast<std::size_t>(_reading.id);
+    if (capacity_ == 0 || index >= series_.size()) {
+        return;
+    }
+
+    auto& s = series_[index];
+    auto const time = _reading.time;
+    if (time < s.lastTime) {
+        merge(s, &time, &_reading.temperature, &_reading.humidity, 1);
+        return;
+    }
+    auto const head = s.head.load(std::memory_order_relaxed);
+    auto const slot = static_cast<std::size_t>(head) & mask_;
+
+    // Orders the previous publication of head before the stores below: a
+    // reader which observes any of them also observes head >= this index
+    // and discards the overwritten sample.
+    std::atomic_thread_fence(std::memory_order_release);
+    s.times[slot].store(time, std::memory_order_relaxed);
+    s.temperatures[slot].store(_reading.temperature, std::memory_order_relaxed);
+    s.humidities[slot].store(_reading.humidity, std::memory_order_relaxed);
+    s.head.store(head + 1, std::memory_order_release);
+
+    s.lastTime = time;
+}
+
+void StationHistory::append(StationId _id,
+                            HistorySamples const& _samples) noexcept
+{
+    auto const index = static_cast<std::size_t>(_id);
+    if (capacity_ == 0 || index >= series_.size()) {
+        return;
+    }
+
+    auto& s = series_[index];
+    auto head = s.head.load(std::memory_order_relaxed);
+    auto lastTime = s.lastTime;
+    auto const count = _samples.times.size();
+    for (std::size_t i = 0; i < count; ++i) {
+        auto const time = _samples.times[i];
+        if (time < lastTime) {
+            // merge the whole ascending run of older samples at once
+            auto end = i + 1;
+            while (end < count && _samples.times[end] < lastTime &&
+                   _samples.times[end] >= _samples.times[end - 1]) {
+                ++end;
+            }
+            merge(s, &_samples.times[i], &_samples.temperatures[i],
+                  &_samples.humidities[i], end - i);
+            head = s.head.load(std::memory_order_relaxed);
+            i = end - 1;
+            continue;
+        }
+        auto const slot = static_cast<std::size_t>(head) & mask_;
+
+        // same protocol as a single append, see above
+        std::atomic_thread_fence(std::memory_order_release);
+        s.times[slot].store(time, std::memory_order_relaxed);
+        s.temperatures[slot].store(_samples.temperatures[i],
+                                   std::memory_order_relaxed);
+        s.humidities[slot].store(_samples.humidities[i],
+                                 std::memory_order_relaxed);
+        s.head.store(++head, std::memory_order_release);
+        lastTime = time;
+    }
+    s.lastTime = lastTime;
+}
+
+void StationHistory::merge(Series& _series, std::uint32_t const* _times,
+                           float const* _temperatures,
+                           float const* _humidities,
+                           std::size_t _count) noexcept
+{
+    // The merge writes up to Chunk slots beyond the head, which wrap around
+    // onto the oldest samples. Those are saved first, so the samples are
+    // merged in chunks.
+    auto constexpr Chunk = std::size_t{64};
+    if (capacity_ < 2) {
+        return;
+    }
+
+    auto const version = _series.version.load(std::memory_order_relaxed);
+    _series.version.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    while (_count > 0) {
+        auto const n = std::min({_count, Chunk, capacity_ - 1});
+        auto const head = _series.head.load(std::memory_order_relaxed);
+        auto const oldest = head >= capacity_ ? head - capacity_ + 1 : 0;
+
+        auto const load = [this, &_series](std::uint64_t _index) {
+            auto const slot = static_cast<std::size_t>(_index) & mask_;
+            return Sample{
+                _series.times[slot].load(std::memory_order_relaxed),
+                _series.temperatures[slot].load(std::memory_order_relaxed),
+                _series.humidities[slot].load(std::memory_order_relaxed)};
+        };
+
+        std::array<Sample, Chunk> saved{};
+        auto const savedCount = std::min<std::uint64_t>(head - oldest, n);
+        for (std::uint64_t k = 0; k < savedCount; ++k) {
+            saved[static_cast<std::size_t>(k)] = load(oldest + k);
+        }
+
+        // Merge from the back into [oldest, head + n), the samples which
+        // fall below the new oldest slot are evicted.
+        auto const end = head + n;
+        auto const evicted = end >= capacity_ ? end - capacity_ + 1 : 0;
+        auto i = head;
+        auto j = n;
+        for (auto w = end; w > evicted && j > 0;) {
+            --w;
+            Sample sample{_times[j - 1], _temperatures[j - 1],
+                          _humidities[j - 1]};
+            if (i > oldest) {
+                auto const k = i - 1 - oldest;
+                auto const previous = k < savedCount
+                                          ? saved[static_cast<std::size_t>(k)]
+                                          : load(i - 1);
+                if (previous.time > sample.time) {
+                    sample = previous;
+                    --i;
+                } else {
+                    --j;
+                }
+            } else {
+                --j;
+            }
+
+            auto const slot = static_cast<std::size_t>(w) & mask_;
+            _series.times[slot].store(sample.time, std::memory_order_relaxed);
+            _series.temperatures[slot].store(sample.temperature,
+                                             std::memory_order_relaxed);
+            _series.humidities[slot].store(sample.humidity,
+                                           std::memory_order_relaxed);
+        }
+        _series.head.store(end, std::memory_order_relaxed);
+
+        _times += n;
+        _temperatures += n;
+        _humidities += n;
+        _count -= n;
+    }
+
+    _series.version.store(version + 2, std::memory_order_release);
+}
+
+HistorySamples StationHistory::query(StationId _id, std::uint32_t _from,
+                                     std::uint32_t _to) const
+{
+    HistorySamples samples;
+
+    auto const index = static_cast<std::size_t>(_id);
+    if (capacity_ == 0 || index >= series_.size() || _from > _to) {
+        return samples;
+    }
+
+    auto const& s = series_[index];
+    for (;;) {
+        auto const version = s.version.load(std::memory_order_acquire);
+        if ((version & 1U) != 0U) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        read(s, _from, _to, samples);
+
+        // a merge moved the samples while they were copied
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (s.version.load(std::memory_order_relaxed) == version) {
+            return samples;
+        }
+        samples = HistorySamples{};
+    }
+}
+
+void StationHistory::read(Series const& _series, std::uint32_t _from,
+                          std::uint32_t _to,
+                          HistorySamples& _samples) const
+{
+    auto const head = _series.head.load(std::memory_order_acquire);
+    // the slot of the oldest sample is the next one to be overwritten
+    auto const oldest = head >= capacity_ ? head - capacity_ + 1 : 0;
+
+    auto const first = bound(_series, oldest, head, _from, false);
+    auto const last = bound(_series, first, head, _to, true);
+    if (first == last) {
+        return;
+    }
+
+    auto const count = static_cast<std::size_t>(last - first);
+    _samples.times.resize(count);
+    _samples.temperatures.resize(count);
+    _samples.humidities.resize(count);
+
+    for (std::size_t i = 0; i < count; ++i) {
+        auto const slot = static_cast<std::size_t>(first + i) & mask_;
+        _samples.times[i] = _series.times[slot].load(std::memory_order_relaxed);
+        _samples.temperatures[i] =
+            _series.temperatures[slot].load(std::memory_order_relaxed);
+        _samples.humidities[i] =
+            _series.humidities[slot].load(std::memory_order_relaxed);
+    }
+
+    // The writer may have overwritten the oldest copied samples in the
+    // meantime, including the one it is writing right now.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    auto const now = _series.head.load(std::memory_order_relaxed);
+    auto const valid = now >= capacity_ ? now - capacity_ + 1 : 0;
+    if (valid > first) {
+        auto const stale =
+            static_cast<std::size_t>(std::min<std::uint64_t>(valid - first,
+                                                             count));
+        _samples.times.erase(_samples.times.begin(),
+                             _samples.times.begin() + stale);
+        _samples.temperatures.erase(_samples.temperatures.begin(),
+                                    _samples.temperatures.begin() + stale);
+        _samples.humidities.erase(_samples.humidities.begin(),
+                                  _samples.humidities.begin() + stale);
+    }
+}
+
+std::uint64_t StationHistory::bound(Series const& _series,
+                                    std::uint64_t _first, std::uint64_t _last,
+                                    std::uint32_t _time,
+                                    bool _upper) const noexcept
+{
+    auto count = _last - _first;
+    while (count > 0) {
+        auto const step = count / 2;
+        auto const it = _first + step;
+        auto const t = _series.times[static_cast<std::size_t>(it) & mask_].load(
+            std::memory_order_relaxed);
+        if (_upper ? t <= _time : t < _time) {
+            _first = it + 1;
+            count -= step + 1;
+        } else {
+            count = step;
+        }
+    }
+    return _first;
+}
@@ -0,0 +1,130 @@
+#ifndef WEBSOCKET_SERVER_STATION_HISTORY_HH
+#define WEBSOCKET_SERVER_STATION_HISTORY_HH
+
+#include "websocket_server/WeatherStatusNotification.hh"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace amadeus {
+/// \brief A copy of a range of samples of a single station, in the same
+/// column layout as the history itself.
+struct HistorySamples
+{
+    /// The unix timestamps, in ascending order.
+    std::vector<std::uint32_t> times;
+    /// The temperatures.
+    std::vector<float> temperatures;
+    /// The humidities.
+    std::vector<float> humidities;
+};
+
+/// \brief Keeps the most recent readings of every station in a fixed-capacity
+/// ring buffer per station. The samples are stored column-wise (structure of
+/// arrays): a range query binary searches the time column only and copies the
+/// value columns with sequential reads.
+/// Appends come from the TCP session of the station and are wait-free, range
+/// queries may run concurrently on any thread and never block the writer. A
+/// query racing with the eviction of the oldest samples simply omits them.
+/// Readings older than the newest sample, e.g. backfilled ones, are merged
+/// into place instead; a query racing with a merge is retried.
+/// \remarks Thread-Safe, with at most one writer per station.
+class StationHistory
+{
+  public:
+    /// The size of a single sample over all columns.
+    static constexpr std::size_t SampleSize{sizeof(std::uint32_t) +
+                                            2 * sizeof(float)};
+
+    /// \brief Constructor. Allocates the ring buffers of all stations up
+    /// front.
+    /// \param _maxBytesPerStation The memory ceiling of a single station.
+    /// The capacity is the largest power of two of samples which fits. Zero
+    /// disables the history.
+    explicit StationHistory(std::size_t _maxBytesPerStation);
+
+    StationHistory(StationHistory const&) = delete;
+    StationHistory& operator=(StationHistory const&) = delete;
+
+    /// \brief Returns the number of slots per station. One slot is reserved
+    /// for the append in progress, so a query returns at most capacity() - 1
+    /// samples.
+    std::size_t capacity() const noexcept;
+
+    /// \brief Appends a reading to the ring buffer of its station, evicting
+    /// the oldest sample once the buffer is full. A reading older than the
+    /// previous one is merged into place so that the time column stays
+    /// monotonic, in O(n) of the newer samples.
+    /// \param _reading The reading.
+    void append(WeatherStatusNotification const& _reading) noexcept;
+
+    /// \brief Appends several readings of a single station, see \ref append.
+    /// Each sample is still published on its own, so concurrent queries see
+    /// the same states as with single appends.
+    /// \param _id The stationId.
+    /// \param _samples The readings in the order they were taken.
+    void append(StationId _id, HistorySamples const& _samples) noexcept;
+
+    /// \brief Returns all samples of a station within [_from, _to].
+    /// \param _id The stationId.
+    /// \param _from The first unix timestamp to include.
+    /// \param _to The last unix timestamp to include.
+    HistorySamples query(StationId _id, std::uint32_t _from,
+                         std::uint32_t _to) const;
+
+  private:
+    /// \brief The ring buffer of a single station.
+    struct Series
+    {
+        /// The unix timestamps.
+        std::unique_ptr<std::atomic<std::uint32_t>[]> times;
+        /// The temperatures.
+        std::unique_ptr<std::atomic<float>[]> temperatures;
+        /// The humidities.
+        std::unique_ptr<std::atomic<float>[]> humidities;
+        /// The total number of samples ever appended, published by the
+        /// writer after each append.
+        alignas(64) std::atomic<std::uint64_t> head{0};
+        /// Odd while older samples are merged in, see \ref merge.
+        std::atomic<std::uint32_t> version{0};
+        /// The last appended timestamp, only touched by the writer.
+        std::uint32_t lastTime{0};
+    };
+
+    /// \brief Copies the samples of a series within [_from, _to] into
+    /// _samples, see \ref query.
+    void read(Series const& _series, std::uint32_t _from, std::uint32_t _to,
+              HistorySamples& _samples) const;
+
+    /// \brief Merges samples which are older than the newest sample of a
+    /// series into place, evicting the oldest samples of the union once the
+    /// buffer is full.
+    /// \param _series The series.
+    /// \param _times The timestamps, in ascending order.
+    /// \param _temperatures The temperatures.
+    /// \param _humidities The humidities.
+    /// \param _count The number of samples.
+    void merge(Series& _series, std::uint32_t const* _times,
+               float const* _temperatures, float const* _humidities,
+               std::size_t _count) noexcept;
+
+    /// \brief Returns the first index in [_first, _last) whose timestamp is
+    /// not less than (or, if _upper is set, greater than) _time.
+    std::uint64_t bound(Series const& _series, std::uint64_t _first,
+                        std::uint64_t _last, std::uint32_t _time,
+                        bool _upper) const noexcept;
+
+    /// One ring buffer per station.
+    std::array<Series, static_cast<std::size_t>(StationId::Max)> series_;
+    /// The number of samples per station, a power of two.
+    std::size_t capacity_;
+    /// capacity_ - 1.
+    std::size_t mask_;
+};
+} // namespace amadeus
+
+#endif // !WEBSOCKET_SERVER_STATION_HISTORY_HH
@@ -0,0 +1,366 @@
+#include "websocket_server/StationRollups.hh"
+#include "websocket_server/Logger.hh"
+
+#include <boost/crc.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <iterator>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+using namespace amadeus;
+namespace fs = std::filesystem;
+
+namespace {
+/// The number of bytes covered by the checksum of a bucket.
+constexpr std::size_t PayloadSize{StationRollups::RecordSize - 4};
+
+/// The file names of the resolutions.
+constexpr std::array<char const*, RollupLevels> FileNames{
+    {"minute.rollup", "hour.rollup", "day.rollup"}};
+
+/// \brief Returns the CRC-32 of the payload of a bucket record.
+std::uint32_t checksum(char const* _record) noexcept
+{
+    boost::crc_32_type crc;
+    crc.process_bytes(_record, PayloadSize);
+    return crc.checksum();
+}
+
+/// \brief Encodes a bucket record in host byte order.
+void encodeBucket(char* _out, RollupBucket const& _bucket) noexcept
+{
+    static_assert(sizeof(RollupBucket) == PayloadSize);
+    std::memcpy(_out, &_bucket, PayloadSize);
+    auto const crc = checksum(_out);
+    std::memcpy(_out + PayloadSize, &crc, sizeof(crc));
+}
+
+/// \brief Decodes a bucket record.
+/// \returns false if the checksum does not match.
+bool decodeBucket(char const* _record, RollupBucket& _bucket) noexcept
+{
+    std::uint32_t crc;
+    std::memcpy(&crc, _record + PayloadSize, sizeof(crc));
+    if (crc != checksum(_record)) {
+        return false;
+    }
+    std::memcpy(&_bucket, _record, PayloadSize);
+    return true;
+}
+
+/// \brief Returns the current unix timestamp.
+std::int64_t now() noexcept
+{
+    return std::chrono::duration_cast<std::chrono::seconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+} // namespace
+
+std::uint32_t amadeus::rollupWidth(RollupLevel _level) noexcept
+{
+    switch (_level) {
+    case RollupLevel::Minute:
+        return 60;
+    case RollupLevel::Hour:
+        return 3600;
+    default:
+        return 86400;
+    }
+}
+
+std::string_view amadeus::rollupName(RollupLevel _level) noexcept
+{
+    switch (_level) {
+    case RollupLevel::Minute:
+        return "minute";
+    case RollupLevel::Hour:
+        return "hour";
+    default:
+        return "day";
+    }
+}
+
+std::optional<RollupLevel>
+amadeus::parseRollupLevel(std::string_view _name) noexcept
+{
+    for (std::size_t i = 0; i < RollupLevels; ++i) {
+        auto const level = static_cast<RollupLevel>(i);
+        if (rollupName(level) == _name) {
+            return level;
+        }
+    }
+    return std::nullopt;
+}
+
+RollupBucket StationRollups::Accumulator::bucket() const noexcept
+{
+    return RollupBucket{start,
+                        count,
+                        minTemperature,
+                        maxTemperature,
+                        static_cast<float>(sumTemperature / count),
+                        minHumidity,
+                        maxHumidity,
+                        static_cast<float>(sumHumidity / count)};
+}
+
+StationRollups::StationRollups(
+    std::array<std::chrono::seconds, RollupLevels> _retention,
+    Metrics& _metrics)
+    : retention_(_retention)
+    , metrics_(_metrics)
+{
+}
+
+StationRollups::~StationRollups()
+{
+    close();
+}
+
+std::uint32_t StationRollups::open(StationId _id, fs::path const& _directory)
+{
+    auto& s = stations_[static_cast<std::size_t>(_id)];
+
+    auto replay = std::numeric_limits<std::uint32_t>::max();
+    for (std::size_t i = 0; i < RollupLevels; ++i) {
+        auto& level = s.levels[i];
+        level.path = _directory / FileNames[i];
+        load(level, static_cast<RollupLevel>(i));
+        replay = std::min(replay, level.floor);
+    }
+    return replay;
+}
+
+void StationRollups::load(Level& _level, RollupLevel _resolution)
+{
+    std::vector<char> data;
+    if (auto const file = std::fopen(_level.path.string().c_str(), "rb")) {
+        char buffer[4096];
+        std::size_t n;
+        while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            data.insert(std::end(data), buffer, buffer + n);
+        }
+        std::fclose(file);
+    }
+
+    std::size_t valid{0};
+    RollupBucket bucket;
+    while ((valid + 1) * RecordSize <= data.size() &&
+           decodeBucket(data.data() + valid * RecordSize, bucket)) {
+        _level.buckets.push_back(bucket);
+        ++valid;
+    }
+
+    if (valid * RecordSize != data.size()) {
+        LOG_WARN("Truncating {} torn bytes of rollup file '{}'.\n",
+                 data.size() - valid * RecordSize, _level.path.string());
+        fs::resize_file(_level.path, valid * RecordSize);
+    }
+
+    if (!_level.buckets.empty()) {
+        _level.floor = _level.buckets.back().start + rollupWidth(_resolution);
+    }
+
+    expire(_level, _resolution);
+
+    _level.file = std::fopen(_level.path.string().c_str(), "ab");
+    if (_level.file == nullptr) {
+        throw std::runtime_error(fmt::format("Failed to open rollup file '{}'",
+                                             _level.path.string()));
+    }
+}
+
+void StationRollups::add(StationId _id, std::uint32_t _time,
+                         float _temperature, float _humidity) noexcept
+{
+    auto& s = stations_[static_cast<std::size_t>(_id)];
+
+    for (std::size_t i = 0; i < RollupLevels; ++i) {
+        auto& level = s.levels[i];
+        if (_time < level.floor) {
+            continue;
+        }
+
+        auto& acc = level.accumulator;
+        auto const start =
+            _time - _time % rollupWidth(static_cast<RollupLevel>(i));
+        if (acc.count > 0 && start != acc.start) {
+            level.finished.push_back(acc.bucket());
+            acc.count = 0;
+        }
+
+        if (acc.count == 0) {
+            acc.start = start;
+            acc.minTemperature = acc.maxTemperature = _temperature;
+            acc.minHumidity = acc.maxHumidity = _humidity;
+            acc.sumTemperature = acc.sumHumidity = 0;
+        } else {
+            acc.minTemperature = std::min(acc.minTemperature, _temperature);
+            acc.maxTemperature = std::max(acc.maxTemperature, _temperature);
+            acc.minHumidity = std::min(acc.minHumidity, _humidity);
+            acc.maxHumidity = std::max(acc.maxHumidity, _humidity);
+        }
+        acc.sumTemperature += _temperature;
+        acc.sumHumidity += _humidity;
+        ++acc.count;
+    }
+}
+
+void StationRollups::publish(StationId _id)
+{
+    auto& s = stations_[static_cast<std::size_t>(_id)];
+
+    {
+        std::unique_lock<std::shared_mutex> lk(s.mtx);
+        for (std::size_t i = 0; i < RollupLevels; ++i) {
+            auto& level = s.levels[i];
+            level.buckets.insert(std::end(level.buckets),
+                                 std::begin(level.finished),
+                                 std::end(level.finished));
+            level.open = level.accumulator.count > 0
+                             ? level.accumulator.bucket()
+                             : RollupBucket{};
+            if (!level.finished.empty()) {
+                expire(level, static_cast<RollupLevel>(i));
+            }
+        }
+    }
+
+    // the buckets are only read by this thread from here on
+    for (std::size_t i = 0; i < RollupLevels; ++i) {
+        auto& level = s.levels[i];
+        if (level.finished.empty()) {
+            continue;
+        }
+
+        std::vector<char> records(level.finished.size() * RecordSize);
+        for (std::size_t j = 0; j < level.finished.size(); ++j) {
+            encodeBucket(records.data() + j * RecordSize, level.finished[j]);
+        }
+        if (level.file != nullptr &&
+            (std::fwrite(records.data(), 1, records.size(), level.file) !=
+                 records.size() ||
+             std::fflush(level.file) != 0)) {
+            LOG_ERROR("Failed to write rollup file '{}'.\n",
+                      level.path.string());
+        }
+        metrics_.storeRollupBuckets.fetch_add(level.finished.size(),
+                                              std::memory_order_relaxed);
+        level.floor = level.finished.back().start +
+                      rollupWidth(static_cast<RollupLevel>(i));
+        level.finished.clear();
+
+        // rewrite the file once most of it has expired
+        if (level.stale > level.buckets.size()) {
+            rewrite(level);
+        }
+    }
+}
+
+void StationRollups::expire(Level& _level, RollupLevel _resolution)
+{
+    auto const retention = retention_[static_cast<std::size_t>(_resolution)];
+    if (retention.count() == 0) {
+        return;
+    }
+
+    auto const cutoff = now() - retention.count();
+    auto const width = rollupWidth(_resolution);
+    while (!_level.buckets.empty() &&
+           std::int64_t{_level.buckets.front().start} + width <= cutoff) {
+        _level.buckets.pop_front();
+        ++_level.stale;
+    }
+}
+
+void StationRollups::rewrite(Level& _level)
+{
+    auto tmp = _level.path;
+    tmp += ".tmp";
+
+    std::vector<char> records(_level.buckets.size() * RecordSize);
+    for (std::size_t i = 0; i < _level.buckets.size(); ++i) {
+        encodeBucket(records.data() + i * RecordSize, _level.buckets[i]);
+    }
+
+    auto const file = std::fopen(tmp.string().c_str(), "wb");
+    if (file == nullptr) {
+        LOG_ERROR("Failed to create rollup file '{}'.\n", tmp.string());
+        return;
+    }
+    auto const ok =
+        std::fwrite(records.data(), 1, records.size(), file) ==
+            records.size() &&
+        std::fclose(file) == 0;
+
+    std::error_code ec;
+    if (ok) {
+        std::fclose(_level.file);
+        fs::rename(tmp, _level.path, ec);
+        _level.file = std::fopen(_level.path.string().c_str(), "ab");
+    }
+    if (!ok || ec) {
+        LOG_ERROR("Failed to rewrite rollup file '{}'.\n",
+                  _level.path.string());
+        fs::remove(tmp, ec);
+        return;
+    }
+    _level.stale = 0;
+}
+
+void StationRollups::close() noexcept
+{
+    for (auto& s : stations_) {
+        for (auto& level : s.levels) {
+            if (level.file != nullptr) {
+                std::fclose(level.file);
+                level.file = nullptr;
+            }
+        }
+    }
+}
+
+std::vector<RollupBucket> StationRollups::query(StationId _id,
+                                                RollupLevel _level,
+                                                std::uint32_t _from,
+                                                std::uint32_t _to) const
+{
+    std::vector<RollupBucket> result;
+    auto const index = static_cast<std::size_t>(_id);
+    if (index >= stations_.size() || _level >= RollupLevel::Max ||
+        _from > _to) {
+        return result;
+    }
+
+    auto const& s = stations_[index];
+    auto const width = rollupWidth(_level);
+    // the first bucket which may overlap _from
+    auto const first = _from - std::min(_from, width - 1);
+
+    std::shared_lock<std::shared_mutex> lk(s.mtx);
+    auto const& level = s.levels[static_cast<std::size_t>(_level)];
+    auto const begin = std::lower_bound(
+        std::begin(level.buckets), std::end(level.buckets), first,
+        [](RollupBucket const& _bucket, std::uint32_t _time) {
+            return _bucket.start < _time;
+        });
+    auto const end = std::upper_bound(
+        begin, std::end(level.buckets), _to,
+        [](std::uint32_t _time, RollupBucket const& _bucket) {
+            return _time < _bucket.start;
+        });
+    result.reserve(static_cast<std::size_t>(std::distance(begin, end)) + 1);
+    result.insert(std::end(result), begin, end);
+    if (level.open.count > 0 && level.open.start >= first &&
+        level.open.start <= _to) {
+        result.push_back(level.open);
+    }
+    return result;
+}
@@ -0,0 +1,190 @@
+#ifndef WEBSOCKET_SERVER_STATION_ROLLUPS_HH
+#define WEBSOCKET_SERVER_STATION_ROLLUPS_HH
+
+#include "websocket_server/Metrics.hh"
+#include "websocket_server/Packets/In/HandshakePacket.hh"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <optional>
+#include <shared_mutex>
+#include <string_view>
+#include <vector>
+
+namespace amadeus {
+/// \brief Defines the resolutions of the rollups.
+enum class RollupLevel
+{
+    Minute,
+    Hour,
+    Day,
+    Max,
+};
+
+/// \brief The number of rollup resolutions.
+constexpr std::size_t RollupLevels{static_cast<std::size_t>(RollupLevel::Max)};
+
+/// \brief Returns the width of a bucket in seconds.
+std::uint32_t rollupWidth(RollupLevel _level) noexcept;
+
+/// \brief Returns the name of a resolution as used by the query APIs, e.g.
+/// "minute".
+std::string_view rollupName(RollupLevel _level) noexcept;
+
+/// \brief Parses the name of a resolution.
+std::optional<RollupLevel> parseRollupLevel(std::string_view _name) noexcept;
+
+/// \brief The aggregated readings of a station within a single bucket.
+struct RollupBucket
+{
+    /// The unix timestamp of the start of the bucket, a multiple of its
+    /// width.
+    std::uint32_t start;
+    /// The number of readings.
+    std::uint32_t count;
+    float minTemperature;
+    float maxTemperature;
+    float avgTemperature;
+    float minHumidity;
+    float maxHumidity;
+    float avgHumidity;
+};
+
+/// \brief Incremental min / max / avg / count rollups of the readings of
+/// every station per minute, hour and day.
+/// Every reading updates one accumulator per resolution in O(1). A bucket is
+/// finished as soon as a reading of a later bucket arrives, it is then
+/// published to the queries and appended to a rollup file in the station's
+/// directory of the \ref ReadingStore. Buckets without readings are skipped.
+/// The open buckets are not persisted, after a restart they are rebuilt from
+/// the raw readings of the store.
+/// \remarks Thread-Safe. Only a single thread (the writer thread of the
+/// \ref ReadingStore) may call \ref open, \ref add, \ref publish and
+/// \ref close, any thread may query.
+class StationRollups
+{
+  public:
+    /// The size of a single bucket on disk.
+    static constexpr std::size_t RecordSize{36};
+
+    /// \brief Constructor.
+    /// \param _retention How long the finished buckets of each resolution are
+    /// kept, by the end of the bucket. Zero keeps them forever.
+    /// \param _metrics The metrics to update.
+    StationRollups(std::array<std::chrono::seconds, RollupLevels> _retention,
+                   Metrics& _metrics);
+
+    /// \brief Closes the rollup files.
+    ~StationRollups();
+
+    StationRollups(StationRollups const&) = delete;
+    StationRollups& operator=(StationRollups const&) = delete;
+
+    /// \brief Loads the persisted buckets of a station and opens its rollup
+    /// files. A torn bucket at the end of a file is truncated.
+    /// \param _id The stationId.
+    /// \param _directory The station's directory.
+    /// \returns The first timestamp which is not covered by a persisted
+    /// bucket of every resolution. The readings since then have to be
+    /// replayed with \ref add.
+    /// \throws std::runtime_error if a rollup file cannot be opened.
+    std::uint32_t open(StationId _id, std::filesystem::path const& _directory);
+
+    /// \brief Adds a reading. Readings must be added in ascending order of
+    /// time, older readings than the persisted buckets are ignored.
+    void add(StationId _id, std::uint32_t _time, float _temperature,
+             float _humidity) noexcept;
+
+    /// \brief Makes the added readings of a station visible to queries,
+    /// persists the finished buckets and drops the expired ones.
+    void publish(StationId _id);
+
+    /// \brief Closes the rollup files.
+    void close() noexcept;
+
+    /// \brief Returns the buckets of a station which overlap [_from, _to],
+    /// including the open one.
+    /// \param _id The stationId.
+    /// \param _level The resolution.
+    /// \param _from The first unix timestamp to include.
+    /// \param _to The last unix timestamp to include.
+    std::vector<RollupBucket> query(StationId _id, RollupLevel _level,
+                                    std::uint32_t _from,
+                                    std::uint32_t _to) const;
+
+  private:
+    /// \brief The state of the open bucket.
+    struct Accumulator
+    {
+        std::uint32_t start{0};
+        std::uint32_t count{0};
+        float minTemperature{0};
+        float maxTemperature{0};
+        double sumTemperature{0};
+        float minHumidity{0};
+        float maxHumidity{0};
+        double sumHumidity{0};
+
+        /// \brief Returns the aggregates.
+        RollupBucket bucket() const noexcept;
+    };
+
+    /// \brief The rollups of a station in a single resolution.
+    struct Level
+    {
+        /// The finished buckets in ascending order of time.
+        std::deque<RollupBucket> buckets;
+        /// The open bucket as of the last \ref publish, count is zero if
+        /// there is none.
+        RollupBucket open{};
+
+        // Only accessed by the writer thread.
+
+        /// The open bucket.
+        Accumulator accumulator;
+        /// The end of the last persisted bucket.
+        std::uint32_t floor{0};
+        /// The buckets finished since the last \ref publish.
+        std::vector<RollupBucket> finished;
+        /// The rollup file.
+        std::filesystem::path path;
+        /// The open rollup file.
+        std::FILE* file{nullptr};
+        /// The number of expired buckets which are still in the file.
+        std::size_t stale{0};
+    };
+
+    /// \brief The rollups of a single station.
+    struct Station
+    {
+        /// Protects the published state of the levels.
+        mutable std::shared_mutex mtx;
+        /// The rollups of every resolution.
+        std::array<Level, RollupLevels> levels;
+    };
+
+    /// \brief Loads a rollup file.
+    void load(Level& _level, RollupLevel _resolution);
+
+    /// \brief Drops the expired buckets of a level.
+    void expire(Level& _level, RollupLevel _resolution);
+
+    /// \brief Rewrites the rollup file of a level without the expired
+    /// buckets.
+    void rewrite(Level& _level);
+
+    /// How long the finished buckets are kept.
+    std::array<std::chrono::seconds, RollupLevels> retention_;
+    /// The server wide metrics.
+    Metrics& metrics_;
+    /// The rollups of every station.
+    std::array<Station, static_cast<std::size_t>(StationId::Max)> stations_;
+};
+} // namespace amadeus
+
+#endif // !WEBSOCKET_SERVER_STATION_ROLLUPS_HH
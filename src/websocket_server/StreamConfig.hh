@@ -0,0 +1,27 @@
+#ifndef WEBSOCKET_SERVER_STREAM_CONFIG_HH
+#define WEBSOCKET_SERVER_STREAM_CONFIG_HH
+
+#include <cstdint>
+
+namespace amadeus {
+/// \brief Tells a station when to push its readings on its own instead of
+/// waiting to be polled. Both triggers can be combined, a station with
+/// neither is only polled.
+struct StreamConfig
+{
+    /// The interval in seconds at which a reading is pushed. Zero disables
+    /// the periodic push.
+    std::uint16_t interval{0};
+    /// A reading is pushed as soon as the temperature or the humidity moved
+    /// by more than this since the last pushed reading. Zero disables it.
+    float delta{0.0F};
+
+    /// \brief Returns whether the station pushes readings at all.
+    constexpr bool enabled() const noexcept
+    {
+        return interval != 0 || delta > 0.0F;
+    }
+};
+} // namespace amadeus
+
+#endif // !WEBSOCKET_SERVER_STREAM_CONFIG_HH
@@ -0,0 +1,106 @@
+#include "websocket_server/SubscriptionFilter.hh"
+
+#include <fmt/format.h>
+
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+using namespace amadeus;
+
+namespace {
+/// \brief Returns whether a value moved by at least one of the deadbands
+/// since it was last sent.
+bool exceeds(ChangeFilter const& _filter, float _sent, float _value) noexcept
+{
+    auto const change = std::fabs(_value - _sent);
+    if (_filter.deadband > 0.0F && change >= _filter.deadband) {
+        return true;
+    }
+    return _filter.relative > 0.0F && change > 0.0F &&
+           change >= _filter.relative * std::fabs(_sent);
+}
+
+/// \brief Returns whether a value crossed one of the thresholds between two
+/// readings, in either direction.
+bool crosses(ChangeFilter const& _filter, float _from, float _to) noexcept
+{
+    for (auto const threshold : _filter.thresholds) {
+        if ((_from < threshold) != (_to < threshold)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// \brief Parses the filter of a single quantity.
+ChangeFilter parseChangeFilter(JSON const& _json, char const* _name)
+{
+    ChangeFilter filter;
+    filter.deadband = _json.value("deadband", filter.deadband);
+    filter.relative = _json.value("relative", filter.relative);
+    if (!(filter.deadband >= 0.0F) || !(filter.relative >= 0.0F)) {
+        throw std::invalid_argument(
+            fmt::format("Invalid {} deadband.", _name));
+    }
+    if (auto const it = _json.find("thresholds"); it != _json.end()) {
+        filter.thresholds = it->get<std::vector<float>>();
+    }
+    return filter;
+}
+} // namespace
+
+SubscriptionFilter::SubscriptionFilter(SubscriptionFilterOptions _options)
+    : options_(std::move(_options))
+{
+}
+
+bool SubscriptionFilter::accept(WeatherStatusNotification const& _reading,
+                                bool _force)
+{
+    std::scoped_lock<std::mutex> lk(mtx_);
+    auto const crossed =
+        seen_ && (crosses(options_.temperature, seen_->temperature,
+                          _reading.temperature) ||
+                  crosses(options_.humidity, seen_->humidity,
+                          _reading.humidity));
+    seen_ = _reading;
+
+    if (!_force && sent_ && !crossed && !changed(_reading)) {
+        return false;
+    }
+    sent_ = _reading;
+    return true;
+}
+
+bool SubscriptionFilter::changed(
+    WeatherStatusNotification const& _reading) const noexcept
+{
+    auto const deadband = options_.temperature.hasDeadband() ||
+                          options_.humidity.hasDeadband();
+    if (!deadband && options_.minInterval == 0) {
+        // thresholds only
+        return false;
+    }
+    if (std::uint64_t{_reading.time} <
+        std::uint64_t{sent_->time} + options_.minInterval) {
+        return false;
+    }
+    return !deadband ||
+           exceeds(options_.temperature, sent_->temperature,
+                   _reading.temperature) ||
+           exceeds(options_.humidity, sent_->humidity, _reading.humidity);
+}
+
+SubscriptionFilterOptions amadeus::parseSubscriptionFilter(JSON const& _json)
+{
+    SubscriptionFilterOptions options;
+    options.minInterval = _json.value("minInterval", options.minInterval);
+    if (auto const it = _json.find("temperature"); it != _json.end()) {
+        options.temperature = parseChangeFilter(*it, "temperature");
+    }
+    if (auto const it = _json.find("humidity"); it != _json.end()) {
+        options.humidity = parseChangeFilter(*it, "humidity");
+    }
+    return options;
+}
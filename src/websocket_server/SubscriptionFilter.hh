@@ -0,0 +1,107 @@
+#ifndef WEBSOCKET_SERVER_SUBSCRIPTION_FILTER_HH
+#define WEBSOCKET_SERVER_SUBSCRIPTION_FILTER_HH
+
+#include "websocket_server/WeatherStatusNotification.hh"
+
+#include <nlohmann/json.hpp>
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+using JSON = nlohmann::json;
+
+namespace amadeus {
+/// \brief The change filter of a single quantity of a reading.
+struct ChangeFilter
+{
+    /// The absolute change since the last sent reading which passes the
+    /// filter. Zero disables the absolute deadband.
+    float deadband{0.0F};
+    /// The change relative to the last sent reading which passes the filter,
+    /// e.g. 0.05 for 5%. Zero disables the relative deadband.
+    float relative{0.0F};
+    /// Values whose crossing passes the filter right away.
+    std::vector<float> thresholds;
+
+    /// \brief Returns whether either deadband is enabled.
+    bool hasDeadband() const noexcept
+    {
+        return deadband > 0.0F || relative > 0.0F;
+    }
+};
+
+/// \brief What a WebSocketSession wants to know about a station it subscribed
+/// to.
+struct SubscriptionFilterOptions
+{
+    /// The filter of the temperature.
+    ChangeFilter temperature;
+    /// The filter of the humidity.
+    ChangeFilter humidity;
+    /// The minimum time between two sent readings in seconds, by the
+    /// timestamps of the readings. Zero disables the minimum interval.
+    std::uint32_t minInterval{0};
+};
+
+/// \brief Decides which weather status updates of a station are pushed to a
+/// single subscriber, before they are serialized. A reading passes if
+/// - it is the first one, or
+/// - the temperature or the humidity crossed one of their thresholds since
+///   the previous reading, or
+/// - the minimum interval since the last sent reading elapsed and the
+///   temperature or the humidity moved by at least their deadband.
+/// A filter without a deadband only waits for the minimum interval; a filter
+/// with neither only passes threshold crossings.
+/// \remarks Thread-Safe. The readings of a station may be published from
+/// more than one thread.
+class SubscriptionFilter final
+{
+  public:
+    /// \brief Constructor.
+    /// \param _options The filter.
+    explicit SubscriptionFilter(SubscriptionFilterOptions _options);
+
+    SubscriptionFilter(SubscriptionFilter const&) = delete;
+    SubscriptionFilter& operator=(SubscriptionFilter const&) = delete;
+
+    /// \brief Evaluates the filter for a reading and records it as sent if it
+    /// passes.
+    /// \param _reading The reading.
+    /// \param _force Whether the reading is sent regardless, e.g. because the
+    /// subscriber requested it.
+    /// \returns Whether the reading is sent.
+    bool accept(WeatherStatusNotification const& _reading, bool _force);
+
+  private:
+    /// \brief Returns whether the reading moved far enough from the last sent
+    /// one, see the class description.
+    bool changed(WeatherStatusNotification const& _reading) const noexcept;
+
+    /// The filter.
+    SubscriptionFilterOptions const options_;
+    /// Protects sent_ and seen_.
+    std::mutex mtx_;
+    /// The last reading which was sent.
+    std::optional<WeatherStatusNotification> sent_;
+    /// The previous reading, sent or not.
+    std::optional<WeatherStatusNotification> seen_;
+};
+
+/// \brief Parses the "filter" object of a subscribe request:
+///
+/// {
+///     "minInterval": 60,
+///     "temperature": { "deadband": 0.5, "relative": 0.05,
+///                      "thresholds": [30] },
+///     "humidity": { "deadband": 2 }
+/// }
+///
+/// Every member is optional.
+/// \param _json The "filter" object.
+/// \throws std::invalid_argument if a deadband is negative.
+SubscriptionFilterOptions parseSubscriptionFilter(JSON const& _json);
+} // namespace amadeus
+
+#endif // !WEBSOCKET_SERVER_SUBSCRIPTION_FILTER_HH
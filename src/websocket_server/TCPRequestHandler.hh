@@ -7,13 +7,19 @@
 #include "websocket_server/Packets/In.hh"
 #include "websocket_server/Packets/Out.hh"
 #include "websocket_server/SharedState.hh"
-#include "websocket_server/utils/packet_view.hh"
+#include "websocket_server/TimerService.hh"
+#include "websocket_server/utils/hex_dump.hh"
 
-#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/bind_executor.hpp>
 #include <boost/uuid/string_generator.hpp>
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_io.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <vector>
+
 namespace amadeus {
 namespace in {
 enum class PacketType : std::uint8_t;
@@ -35,8 +41,9 @@ class TCPRequestHandler
     /// \param _session A reference to the given Session.
     TCPRequestHandler(asio::io_context& _ioc, Session& _session)
         : session_(_session)
-        , pingTimer_(_ioc, PingTimeout)
-        , pongTimer_(_ioc, PongTimeout)
+        , pongTimer_(_ioc)
+        , pingTimer_(_ioc)
+        , deadlineTimer_(_ioc)
     {
     }
 
@@ -47,8 +54,7 @@ class TCPRequestHandler
     /// HandlerReturnType for more details.
     HandlerReturnType handle(in::PacketType _id, BufferView const _view)
     {
-        using namespace in;
-        auto const expectedSize = sizeByPacketId(_id);
+        auto const expectedSize = in::sizeByPacketId(_id);
 
         // If it is not big enough, we'll simply return 'Indeterminate' to the
         // caller to notify that it should read more into the input buffer
@@ -64,27 +70,100 @@ class TCPRequestHandler
 
         LOG_DEBUG("PacketId: {0:#04x}\n", _id);
 
-        switch (_id) {
-        case PacketType::Handshake:
-            return handleHandshakePacket(_view);
-        case PacketType::Pong:
-            return handlePongPacket(_view);
-        case PacketType::WeatherStatus:
-            return handleWeatherStatusPacket(_view);
-        default:
+        static constexpr auto Handlers{makeHandlers(in::Packets{})};
+
+        auto const handler = Handlers[static_cast<PacketIdType>(_id)];
+        if (handler == nullptr) {
             LOG_ERROR(
                 "Unable to find handler callback for PacketId '{0:#04x}'.\n",
                 _id);
+            return std::make_pair(ResultType::Bad, 0);
         }
 
-        return std::make_pair(ResultType::Bad, 0);
+        return (this->*handler)(_view);
     }
 
-    /// \brief Stops the internal ping and pong timers.
+    /// \brief Stops the internal ping, pong and deadline timers. The
+    /// waiters of all unanswered polls are told that the µc disconnected.
     void stop()
     {
         pingTimer_.cancel();
         pongTimer_.cancel();
+        deadlineTimer_.cancel();
+
+        while (!pending_.empty()) {
+            fail(pending_.front(), "disconnected");
+            pending_.pop_front();
+        }
+    }
+
+    /// \brief Asks the µc for its weather status on behalf of a
+    /// WebSocketSession. Every poll carries a request id which the µc echoes
+    /// in its reply, so several polls can be outstanding at once. Requests
+    /// within \ref PollCoalesceWindow of the last poll (or while \ref
+    /// MaxPendingPolls are outstanding) are attached to it as waiters and the
+    /// single reply completes all of them. Must be called on the session's
+    /// executor.
+    /// \param _requester The UUID of the requesting WebSocketSession.
+    /// \param _flag The reserved session flag of the packet.
+    void requestWeatherStatus(boost::uuids::uuid const& _requester,
+                              WebSocketSessionFlag _flag)
+    {
+        auto& metrics = session_.sharedState().metrics();
+        metrics.weatherStatusRequests.fetch_add(1, std::memory_order_relaxed);
+
+        auto const now = std::chrono::steady_clock::now();
+        if (!pending_.empty() &&
+            (now - pending_.back().sent < PollCoalesceWindow ||
+             pending_.size() >= MaxPendingPolls)) {
+            pending_.back().waiters.push_back(_requester);
+            metrics.weatherStatusCoalesced.fetch_add(1,
+                                                     std::memory_order_relaxed);
+            LOG_DEBUG("WeatherStatus poll {} in flight, {} waiters.\n",
+                      pending_.back().id, pending_.back().waiters.size());
+            return;
+        }
+
+        out::WeatherStatusPacket packet{};
+        std::memcpy(packet.uuid.data(), &_requester, packet.uuid.size());
+        packet.flag = _flag;
+        packet.requestId = nextRequestId_++;
+        if (nextRequestId_ == in::PushRequestId) {
+            nextRequestId_ = 0;
+        }
+
+        // send weather request to µc
+        auto const queued =
+            session_.writePacket(packet, [](auto&& bytes_transferred) {
+                LOG_DEBUG("WeatherStatusRequest sent with {} bytes.\n",
+                          bytes_transferred);
+            });
+        if (!queued) {
+            fail(PendingPoll{packet.requestId, now, {_requester}}, "busy");
+            return;
+        }
+
+        metrics.weatherStatusPolls.fetch_add(1, std::memory_order_relaxed);
+
+        pending_.push_back(PendingPoll{packet.requestId, now, {_requester}});
+        if (pending_.size() == 1) {
+            startDeadlineTimer();
+        }
+    }
+
+    /// \brief Tells the µc to push its readings on its own, or to stop
+    /// pushing them. Must be called on the session's executor.
+    /// \param _config The stream configuration.
+    void sendStreamConfig(StreamConfig const& _config)
+    {
+        out::StreamConfigPacket packet{};
+        packet.interval = _config.interval;
+        packet.delta = _config.delta;
+
+        session_.writeControlPacket(packet, [](auto&& bytes_transferred) {
+            LOG_DEBUG("StreamConfigPacket sent with {} bytes.\n",
+                      bytes_transferred);
+        });
     }
 
   private:
@@ -92,33 +171,84 @@ class TCPRequestHandler
     Session& session_;
     /// If no pong is received from the peer for a time equal to this
     /// timeout, then the connection will be shut down.
-    asio::steady_timer pongTimer_;
+    WheelTimer pongTimer_;
     /// Whenever this timeout expires, a ping packet will be sent to the peer.
-    asio::steady_timer pingTimer_;
+    WheelTimer pingTimer_;
+    /// Expires once the oldest unanswered poll exceeds its deadline.
+    WheelTimer deadlineTimer_;
+
+    /// \brief A weather status poll which the µc has not answered yet.
+    struct PendingPoll
+    {
+        /// The request id of the poll.
+        std::uint32_t id;
+        /// When the poll was sent.
+        std::chrono::steady_clock::time_point sent;
+        /// The WebSocketSessions waiting for the reply.
+        std::vector<boost::uuids::uuid> waiters;
+    };
+
+    /// The unanswered polls, oldest first.
+    std::deque<PendingPoll> pending_;
+    /// The request id of the next poll.
+    std::uint32_t nextRequestId_{0};
+    /// The decoded readings of the last WeatherStatusBatchPacket or
+    /// BackfillPacket, kept to reuse its capacity.
+    HistorySamples batch_;
+    /// Whether the TCP Client completed the handshake.
+    bool joined_{false};
+    /// Whether a BackfillACKPacket is being written.
+    bool backfillACKInFlight_{false};
+
+    /// The type of a handler in the dispatch table.
+    using Handler = HandlerReturnType (TCPRequestHandler::*)(BufferView);
+
+    /// \brief Decodes the (fixed part of the) packet and passes it to the
+    /// handler for its type.
+    template <typename Packet>
+    HandlerReturnType dispatch(BufferView const _view)
+    {
+        return handlePacket(decode<Packet>(_view.data()), _view);
+    }
+
+    /// \brief Returns the dispatch table from packet ids to handlers.
+    template <typename... Packets>
+    static constexpr std::array<Handler, 256>
+    makeHandlers(PacketList<Packets...>) noexcept
+    {
+        std::array<Handler, 256> handlers{};
+        ((handlers[static_cast<PacketIdType>(Schema<Packets>::id)] =
+              &TCPRequestHandler::dispatch<Packets>),
+         ...);
+        return handlers;
+    }
 
     /// TODO: Keep track of used UUIDs to reject handshake requests with
     /// duplicate UUIDs.
     /// \brief Handler function for the incoming HandshakePacket from the TCP
     /// connection.
+    /// \param _packet The decoded packet.
     /// \param _view A read-only immutable packet view of the incoming TCP
     /// frame.
-    HandlerReturnType handleHandshakePacket(BufferView const _view)
+    HandlerReturnType handlePacket(in::HandshakePacket const& _packet,
+                                   BufferView const _view)
     {
-        packet_view<in::HandshakePacket> const packet{_view.data()};
+        auto constexpr Size = wireSize<in::HandshakePacket>;
 
-        LOG_INFO("handleHandshakePacket called with view: {}.\n", packet);
+        LOG_TRACE("handleHandshakePacket called with view: {}.\n",
+                  hex_dump(_view.data(), Size));
 
         auto sendBadRequest = [&, this](auto&& _error) -> HandlerReturnType {
             out::HandshakeNAKPacket handshakeNAK{};
             handshakeNAK.reason = _error;
 
-            session_.writePacket(
+            session_.writeControlPacket(
                 handshakeNAK, [this](auto&& bytes_transferred) {
                     LOG_INFO("HandshakeNAKPacket sent with {} bytes.\n",
                              bytes_transferred);
                 });
 
-            return std::make_pair(ResultType::Good, packet.size());
+            return std::make_pair(ResultType::Good, Size);
         };
 
         // check if the stationId is valid.
@@ -127,14 +257,14 @@ class TCPRequestHandler
         HandshakeReason error{};
 
         // Is the id in range?
-        auto const id = static_cast<enum_type>(packet->stationId);
+        auto const id = static_cast<enum_type>(_packet.stationId);
         if (!(id >= 0 && id < static_cast<enum_type>(StationId::Max))) {
             LOG_DEBUG("StationId is not in range.\n");
             return sendBadRequest(HandshakeReason::ReasonStationIdInvalid);
         }
 
         boost::uuids::uuid uuid;
-        std::memcpy(&uuid, packet->uuid.data(), packet->uuid.size());
+        std::memcpy(&uuid, _packet.uuid.data(), _packet.uuid.size());
 
         auto const isValidUUID = [this](std::string const& maybe_uuid) {
             using namespace boost::uuids;
@@ -169,11 +299,11 @@ class TCPRequestHandler
         };
 
         LOG_DEBUG("UUID from packet = {0:#04x}\n",
-                  fmt::join(packet->uuid, ", "));
+                  fmt::join(_packet.uuid, ", "));
 
         if (isUUIDRegistered(uuidStr.c_str())) {
             auto const joined = session_.sharedState().join(
-                packet->stationId, &session_.derived());
+                _packet.stationId, &session_.derived());
 
             if (!joined) {
                 LOG_DEBUG("StationId already exists.\n");
@@ -181,138 +311,420 @@ class TCPRequestHandler
             }
 
             // save the StationId for this session.
-            session_.stationId(packet->stationId);
+            session_.stationId(_packet.stationId);
+            joined_ = true;
 
             startPingTimer();
 
-            out::HandshakeACKPacket const handshakeACK{};
-            session_.writePacket(
-                handshakeACK, [this](auto&& bytes_transferred) {
+            session_.writeControlPacket(
+                out::EncodedHandshakeACKPacket,
+                [this](auto&& bytes_transferred) {
                     LOG_INFO("HandshakeACKPacket sent with {} bytes.\n",
                              bytes_transferred);
                 });
+
+            // a station which pushes its readings is told so right away
+            auto const stream =
+                session_.sharedState().streamConfig(_packet.stationId);
+            if (stream.enabled()) {
+                sendStreamConfig(stream);
+            }
         } else {
             LOG_DEBUG("UUID is not registered for this TCPSession.\n");
             return sendBadRequest(HandshakeReason::ReasonUUIDInvalid);
         }
 
-        return std::make_pair(ResultType::Good, packet.size());
+        return std::make_pair(ResultType::Good, Size);
     }
 
     /// \brief Handler function for the incoming PongPacket from the TCP
     /// connection.
     /// \param _view A read-only immutable packet view of the incoming TCP
     /// frame.
-    HandlerReturnType handlePongPacket(BufferView const _view)
+    HandlerReturnType handlePacket(in::PongPacket const&,
+                                   BufferView const _view)
     {
-        packet_view<in::PongPacket> const packet{_view.data()};
+        auto constexpr Size = wireSize<in::PongPacket>;
 
-        LOG_INFO("handlePongPacket called with view: {}.\n", packet);
+        LOG_TRACE("handlePongPacket called with view: {}.\n",
+                  hex_dump(_view.data(), Size));
 
         pongTimer_.cancel();
 
-        return std::make_pair(ResultType::Good, packet.size());
+        return std::make_pair(ResultType::Good, Size);
     }
 
     /// \brief Handler function for the incoming WeatherStatusPacket from the
     /// TCP connection.
+    /// \param _packet The decoded packet.
     /// \param _view A read-only immutable packet view of the incoming TCP
     /// frame.
-    HandlerReturnType handleWeatherStatusPacket(BufferView const _view) const
+    HandlerReturnType handlePacket(in::WeatherStatusPacket const& _packet,
+                                   BufferView const _view)
     {
-        packet_view<in::WeatherStatusPacket> const packet{_view.data()};
+        auto constexpr Size = wireSize<in::WeatherStatusPacket>;
 
-        LOG_INFO("handleWeatherStatusPacket called with view: {}\n", packet);
+        LOG_TRACE("handleWeatherStatusPacket called with view: {}\n",
+                  hex_dump(_view.data(), Size));
 
-        LOG_INFO("Temperature: {} Humidity: {}\n", packet->temperature,
-                 packet->humidity);
+        if (!joined_) {
+            LOG_ERROR("WeatherStatusPacket received before the handshake.\n");
+            return std::make_pair(ResultType::Bad, 0);
+        }
+
+        LOG_DEBUG("Temperature: {} Humidity: {}\n", _packet.temperature,
+                  _packet.humidity);
 
         // convert uuid from packet to boost::uuids::uuid
         boost::uuids::uuid uuid;
-        std::memcpy(&uuid, packet->uuid.data(), uuid.size());
+        std::memcpy(&uuid, _packet.uuid.data(), uuid.size());
 
         auto& state = session_.sharedState();
 
         WeatherStatusNotification notification;
         notification.id = session_.stationId();
-        notification.temperature = packet->temperature;
-        notification.humidity = packet->humidity;
-        notification.time = packet->time;
-
-        auto callback =
-            state.template findWebSocketSession<PlainWebSocketSession>(uuid);
+        notification.temperature = _packet.temperature;
+        notification.humidity = _packet.humidity;
+        notification.time = _packet.time;
+
+        state.stationCache().update(notification);
+        state.stationHistory().append(notification);
+        state.readingStore().append(notification);
+
+        // A pushed reading only goes to the subscribers of the station.
+        if (_packet.requestId == in::PushRequestId) {
+            state.metrics().weatherStatusPushes.fetch_add(
+                1, std::memory_order_relaxed);
+            state.publish(notification, {});
+            return std::make_pair(ResultType::Good, Size);
+        }
 
-        if (callback) {
-            callback(notification);
-        } else {
-            auto callback =
-                state.template findWebSocketSession<SSLWebSocketSession>(uuid);
-            if (callback) {
-                callback(notification);
-            } else {
-                LOG_ERROR("Not WebSocketSession found by such UUID!\n");
+        // The reply completes every waiter of the poll it answers. A reply
+        // without a poll (e.g. after its deadline) is still delivered to
+        // the session it names.
+        std::vector<boost::uuids::uuid> requesters;
+        auto const it = std::find_if(
+            pending_.begin(), pending_.end(),
+            [&](auto const& _poll) { return _poll.id == _packet.requestId; });
+        if (it != pending_.end()) {
+            requesters.swap(it->waiters);
+            auto const oldest = it == pending_.begin();
+            pending_.erase(it);
+            if (oldest) {
+                startDeadlineTimer();
             }
+        } else {
+            LOG_DEBUG("WeatherStatus reply {} matches no poll.\n",
+                      _packet.requestId);
+            state.metrics().weatherStatusUnmatchedReplies.fetch_add(
+                1, std::memory_order_relaxed);
+            requesters.push_back(uuid);
+        }
+
+        // serialize once and queue it to the requesters and every subscriber
+        if (state.publish(notification, requesters) == 0) {
+            LOG_ERROR("No WebSocketSession found for the WeatherStatus "
+                      "reply!\n");
         }
 
-        return std::make_pair(ResultType::Good, packet.size());
+        return std::make_pair(ResultType::Good, Size);
     }
 
-    /// \brief Starts the interal asynchronous ping timer.
-    void startPingTimer()
+    /// \brief Handler function for the incoming WeatherStatusBatchPacket from
+    /// the TCP connection. All readings are decoded in one pass and ingested
+    /// into the history and the store as a group. The cache and the
+    /// subscribers of the station only receive the latest reading.
+    /// \param _packet The decoded fixed part of the packet.
+    /// \param _view A read-only immutable packet view of the incoming TCP
+    /// frame. Only the fixed part of the packet is guaranteed to be complete.
+    HandlerReturnType handlePacket(in::WeatherStatusBatchPacket const& _packet,
+                                   BufferView const _view)
     {
-        pingTimer_.async_wait(
-            [this, self = session_.derived().shared_from_this()](
-                auto&& _error) { onPingTimeout(_error); });
+        if (!joined_) {
+            LOG_ERROR(
+                "WeatherStatusBatchPacket received before the handshake.\n");
+            return std::make_pair(ResultType::Bad, 0);
+        }
+
+        auto const count = std::size_t{_packet.count};
+        if (count > in::MaxBatchReadings) {
+            LOG_ERROR("WeatherStatusBatch with {} readings exceeds the limit "
+                      "of {}.\n",
+                      count, in::MaxBatchReadings);
+            return std::make_pair(ResultType::Bad, 0);
+        }
+
+        auto const size = in::batchPacketSize(count);
+        if (_view.size() < size) {
+            return std::make_pair(ResultType::Indeterminate, 0);
+        }
+
+        auto const* data = static_cast<std::uint8_t const*>(_view.data());
+
+        LOG_TRACE("handleWeatherStatusBatchPacket called with view: {}\n",
+                  hex_dump(data, size));
+
+        auto& state = session_.sharedState();
+        auto& metrics = state.metrics();
+        metrics.weatherStatusBatches.fetch_add(1, std::memory_order_relaxed);
+        metrics.weatherStatusBatchReadings.fetch_add(
+            count, std::memory_order_relaxed);
+
+        if (count == 0) {
+            return std::make_pair(ResultType::Good, size);
+        }
+
+        batch_.times.resize(count);
+        batch_.temperatures.resize(count);
+        batch_.humidities.resize(count);
+        in::decodeReadings(data + wireSize<in::WeatherStatusBatchPacket>,
+                           count, batch_.times.data(),
+                           batch_.temperatures.data(),
+                           batch_.humidities.data());
+
+        LOG_DEBUG("WeatherStatusBatch with {} readings.\n", count);
+
+        auto const id = session_.stationId();
+        state.stationHistory().append(id, batch_);
+        state.readingStore().append(id, batch_);
+
+        WeatherStatusNotification notification;
+        notification.id = id;
+        notification.temperature = batch_.temperatures.back();
+        notification.humidity = batch_.humidities.back();
+        notification.time = batch_.times.back();
+
+        state.stationCache().update(notification);
+
+        // A batch is pushed by the µc on its own, an outstanding poll is
+        // still completed by the WeatherStatusPacket answering it.
+        state.publish(notification, {});
+
+        return std::make_pair(ResultType::Good, size);
     }
 
-    /// \brief Starts the interal asynchronous pong timer.
-    void startPongTimer()
+    /// \brief Handler function for the incoming BackfillPacket from the TCP
+    /// connection. Readings which were received before are skipped, the
+    /// others are stored in bulk. A packet which does not continue the
+    /// sequence of the station is dropped, the TCP Client resends from the
+    /// acknowledged sequence number. Each BackfillPacket is answered with a
+    /// BackfillACKPacket. Readings older than the latest stored reading of
+    /// the station are kept in a backfill segment of the store and merged
+    /// into the history, see \ref ReadingStore.
+    /// \param _packet The decoded fixed part of the packet.
+    /// \param _view A read-only immutable packet view of the incoming TCP
+    /// frame. Only the fixed part of the packet is guaranteed to be complete.
+    HandlerReturnType handlePacket(in::BackfillPacket const& _packet,
+                                   BufferView const _view)
     {
-        pongTimer_.expires_after(PongTimeout);
-        pongTimer_.async_wait(
-            [this, self = session_.derived().shared_from_this()](
-                auto&& _error) { onPongTimeout(_error); });
+        if (!joined_) {
+            LOG_ERROR("BackfillPacket received before the handshake.\n");
+            return std::make_pair(ResultType::Bad, 0);
+        }
+
+        auto const count = std::size_t{_packet.count};
+        if (count > in::MaxBackfillReadings) {
+            LOG_ERROR("Backfill with {} readings exceeds the limit of {}.\n",
+                      count, in::MaxBackfillReadings);
+            return std::make_pair(ResultType::Bad, 0);
+        }
+
+        auto const size = in::backfillPacketSize(count);
+        if (_view.size() < size) {
+            return std::make_pair(ResultType::Indeterminate, 0);
+        }
+
+        auto const* data = static_cast<std::uint8_t const*>(_view.data());
+
+        LOG_TRACE("handleBackfillPacket called with view: {}\n",
+                  hex_dump(data, size));
+
+        auto& state = session_.sharedState();
+        auto& metrics = state.metrics();
+        metrics.backfillReadings.fetch_add(count, std::memory_order_relaxed);
+
+        // the first backfill of a station starts its sequence
+        auto const id = session_.stationId();
+        auto const first = std::uint64_t{_packet.sequence};
+        auto const next = std::uint64_t{
+            state.backfillSequence(id).value_or(_packet.sequence)};
+
+        if (first > next) {
+            LOG_DEBUG("Backfill starts at {}, expected {}.\n", first, next);
+            metrics.backfillGaps.fetch_add(1, std::memory_order_relaxed);
+            sendBackfillACK();
+            return std::make_pair(ResultType::Good, size);
+        }
+
+        auto const duplicates = std::min<std::uint64_t>(next - first, count);
+        metrics.backfillDuplicates.fetch_add(duplicates,
+                                             std::memory_order_relaxed);
+
+        auto const fresh = count - static_cast<std::size_t>(duplicates);
+        if (fresh > 0) {
+            batch_.times.resize(fresh);
+            batch_.temperatures.resize(fresh);
+            batch_.humidities.resize(fresh);
+            in::decodeReadings(data + wireSize<in::BackfillPacket> +
+                                   duplicates * wireSize<in::WeatherReading>,
+                               fresh, batch_.times.data(),
+                               batch_.temperatures.data(),
+                               batch_.humidities.data());
+
+            // Only the readings queued for the store are acknowledged, the
+            // TCP Client resends the rest. The acknowledgement does not wait
+            // for the writer, see \ref ReadingStore::append.
+            auto& store = state.readingStore();
+            auto const stored =
+                store.enabled() ? store.append(id, batch_) : fresh;
+            batch_.times.resize(stored);
+            batch_.temperatures.resize(stored);
+            batch_.humidities.resize(stored);
+            state.stationHistory().append(id, batch_);
+            state.backfillSequence(id,
+                                   static_cast<std::uint32_t>(next + stored));
+
+            LOG_DEBUG("Backfill stored {} of {} readings.\n", stored, count);
+        } else if (!state.backfillSequence(id)) {
+            state.backfillSequence(id, static_cast<std::uint32_t>(next));
+        }
+
+        sendBackfillACK();
+
+        return std::make_pair(ResultType::Good, size);
     }
 
-    /// \brief Restarts the interal asynchronous ping timer.
-    void restartPingTimer()
+    /// \brief Acknowledges the highest contiguous backfill sequence number
+    /// of the station. While an acknowledgement is being written, further
+    /// ones are coalesced into a single one which is sent afterwards.
+    void sendBackfillACK()
     {
-        pingTimer_.expires_at(pingTimer_.expiry() + PingTimeout);
-        startPingTimer();
+        if (backfillACKInFlight_) {
+            return;
+        }
+
+        auto const next =
+            session_.sharedState().backfillSequence(session_.stationId());
+        if (!next || *next == 0) {
+            return;
+        }
+
+        out::BackfillACKPacket packet{};
+        packet.sequence = *next - 1;
+
+        // if the output queue is full, the next BackfillPacket is acked.
+        backfillACKInFlight_ =
+            session_.writePacket(packet, [this, sent = *next](auto&&) {
+                backfillACKInFlight_ = false;
+                if (session_.sharedState().backfillSequence(
+                        session_.stationId()) != sent) {
+                    sendBackfillACK();
+                }
+            });
     }
 
-    /// \brief Restarts the interal asynchronous pong timer.
-    void restartPongTimer()
+    /// \brief Answers the waiters of a poll with an error response.
+    /// \param _poll The failed poll.
+    /// \param _error Why the poll failed.
+    void fail(PendingPoll const& _poll, std::string_view _error)
     {
-        pongTimer_.expires_at(pongTimer_.expiry() + PongTimeout);
-        startPongTimer();
+        if (_poll.waiters.empty()) {
+            return;
+        }
+        auto& state = session_.sharedState();
+        state.notify(_poll.waiters,
+                     encodeWeatherStatusError(session_.stationId(), _error),
+                     std::nullopt);
     }
 
-    /// \brief The asynchronous completion token for the ping timeout.
-    /// \param _error The error.
-    void onPingTimeout(boost::system::error_code const& _error)
+    /// \brief (Re-)arms the deadline timer for the oldest unanswered poll,
+    /// or cancels it if no poll is outstanding. A single timer serves all
+    /// polls since they expire in the order they were sent.
+    void startDeadlineTimer()
     {
-        if (_error == asio::error::operation_aborted) {
+        if (pending_.empty()) {
+            deadlineTimer_.cancel();
             return;
         }
 
-        out::PingPacket const packet{};
-        session_.writePacket(packet, [this](auto&& bytes_transferred) {
-            LOG_INFO("PingPacket sent with {} bytes.\n", bytes_transferred);
-            startPongTimer();
-        });
+        auto const elapsed =
+            std::chrono::steady_clock::now() - pending_.front().sent;
+        auto const remaining =
+            std::max(std::chrono::steady_clock::duration::zero(),
+                     std::chrono::steady_clock::duration{PollTimeout} -
+                         elapsed);
 
-        restartPingTimer();
+        auto& session = session_.derived();
+        deadlineTimer_.asyncWait(
+            remaining,
+            asio::bind_executor(
+                session.stream().get_executor(),
+                [this, self = session.shared_from_this()] { onDeadline(); }));
     }
 
-    /// \brief The asynchronous completion token for the pong timeout.
-    /// \param _error The error.
-    void onPongTimeout(boost::system::error_code const& _error)
+    /// \brief Called once the oldest unanswered poll reached its deadline.
+    /// Every expired poll is answered with a timeout error, so that the
+    /// WebSocketSessions do not wait forever and the next request polls
+    /// again.
+    void onDeadline()
     {
-        if (_error == asio::error::operation_aborted) {
-            return;
+        auto const now = std::chrono::steady_clock::now();
+        auto& metrics = session_.sharedState().metrics();
+        while (!pending_.empty() &&
+               now - pending_.front().sent >= PollTimeout) {
+            auto const& poll = pending_.front();
+            LOG_ERROR("WeatherStatus poll {} timed out, {} waiters.\n",
+                      poll.id, poll.waiters.size());
+            metrics.weatherStatusPollTimeouts.fetch_add(
+                1, std::memory_order_relaxed);
+            fail(poll, "timeout");
+            pending_.pop_front();
         }
 
+        startDeadlineTimer();
+    }
+
+    /// \brief Starts the interal asynchronous ping timer.
+    void startPingTimer()
+    {
+        auto& session = session_.derived();
+        pingTimer_.asyncWait(
+            PingTimeout,
+            asio::bind_executor(
+                session.stream().get_executor(),
+                [this, self = session.shared_from_this()] { onPingTimeout(); }));
+    }
+
+    /// \brief Starts the interal asynchronous pong timer.
+    void startPongTimer()
+    {
+        auto& session = session_.derived();
+        pongTimer_.asyncWait(
+            PongTimeout,
+            asio::bind_executor(
+                session.stream().get_executor(),
+                [this, self = session.shared_from_this()] { onPongTimeout(); }));
+    }
+
+    /// \brief The asynchronous completion token for the ping timeout.
+    void onPingTimeout()
+    {
+        session_.writeControlPacket(
+            out::EncodedPingPacket, [](auto&& bytes_transferred) {
+                LOG_DEBUG("PingPacket sent with {} bytes.\n",
+                          bytes_transferred);
+            });
+
+        // The pong timeout runs from the moment the ping is queued, so a
+        // peer which stops reading is disconnected as well and at most one
+        // ping is ever queued.
+        startPongTimer();
+        startPingTimer();
+    }
+
+    /// \brief The asynchronous completion token for the pong timeout.
+    void onPongTimeout()
+    {
         LOG_ERROR("We haven't received a pong packet in the right time! "
                   "disconnecting peer...\n");
 
@@ -6,16 +6,23 @@
 #include "websocket_server/Logger.hh"
 #include "websocket_server/TCPRequestHandler.hh"
 #include "websocket_server/SharedState.hh"
+#include "websocket_server/TimerService.hh"
+#include "websocket_server/utils/ring_buffer.hh"
+#include "websocket_server/utils/write_queue.hh"
 
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/dispatch.hpp>
 #include <boost/asio/read.hpp>
 #include <boost/asio/write.hpp>
 #include <boost/beast/core/error.hpp>
 #include <boost/beast/core/stream_traits.hpp>
 
+#include <algorithm>
 #include <array>
 #include <memory>
 #include <stdexcept>
 #include <string_view>
+#include <tuple>
 #include <type_traits>
 
 namespace amadeus {
@@ -28,9 +35,21 @@ class TCPSession
 {
   private:
     /// The maximum amount of bytes for the input buffer.
-    static constexpr auto MaxInputSize{512U};
-    /// The maximum amount of bytes for the output buffer.
-    static constexpr auto MaxOutputSize{512U};
+    static constexpr std::size_t MaxInputSize{4096U};
+    /// The size of a chunk of the output queue, the maximum size of a packet
+    /// written to the µc.
+    static constexpr std::size_t MaxOutputSize{512U};
+    /// The maximum number of packets queued for the next write by
+    /// writePacket. Control packets are not limited, see
+    /// writeControlPacket.
+    static constexpr std::size_t MaxQueuedPackets{64U};
+    /// The size of the largest packet.
+    static constexpr auto MaxPacketSize{
+        std::max(in::batchPacketSize(in::MaxBatchReadings),
+                 in::backfillPacketSize(in::MaxBackfillReadings))};
+
+    static_assert(MaxPacketSize <= MaxInputSize,
+                  "The largest packet exceeds the input buffer.");
 
     /// An alias for the TCPRequestHandler tied to the current TCPSession.
     using PacketHandlerType = TCPRequestHandler<class TCPSession>;
@@ -38,15 +57,18 @@ class TCPSession
     /// The shared state.
     std::shared_ptr<SharedState> state_;
     /// The underlying input buffer for TCP responses.
-    std::array<char, MaxInputSize> input_{};
-    /// The underlying output buffer for TCP requests.
-    std::array<char, MaxOutputSize> output_{};
-    /// The number of bytes we have left to read.
-    std::size_t numBytesLeft_{};
+    ring_buffer<MaxInputSize> input_;
+    /// A contiguous copy of a packet which wraps around the input buffer.
+    std::array<char, MaxPacketSize> staging_{};
+    /// The packets queued for the µc.
+    write_queue<MaxOutputSize> output_{MaxQueuedPackets};
     /// The underlying TCPRequestHandler for the µc-connection.
     TCPRequestHandler<TCPSession> handler_;
-    /// Each session is uniquely identified with the StationId.
-    StationId stationId_;
+    /// The read / write / shutdown timeout for the current logical operation.
+    WheelTimer timeout_;
+    /// Each session is uniquely identified with the StationId. Invalid until
+    /// the handshake succeeded.
+    StationId stationId_{StationId::Max};
 
     /// \brief CompletionToken for the asynchronous read operation.
     /// \param _error The error.
@@ -56,6 +78,7 @@ class TCPSession
                             std::size_t _bytesTransferred)
     {
         if (_error) {
+            timeout_.cancel();
             handler_.stop();
             derived().disconnect();
             return;
@@ -78,10 +101,10 @@ class TCPSession
         }
 
         // Disable the timeout for the next logical operation.
-        beast::get_lowest_layer(derived().stream()).expires_never();
+        cancelTimeout();
 
         // accumulate the bytes we have read.
-        numBytesLeft_ += _bytesTransferred;
+        input_.commit(_bytesTransferred);
 
         // parse the data that was read.
         parsePacketHeader();
@@ -92,28 +115,30 @@ class TCPSession
     {
         // As long as we have packets in the buffer pending, we should parse
         // them all until there are no more bytes to be read from the buffer.
-        while (numBytesLeft_) {
+        while (!input_.empty()) {
             // Extract the PacketId from the buffer.
-            auto const id = static_cast<in::PacketType>(*input_.begin());
-
-            // Get a view of the data we have received.
-            auto const view{asio::const_buffer(input_.data(), numBytesLeft_)};
-
-            // Parse the packet header by id.
-            auto const [status, bytesParsed] = handler_.handle(id, view);
-
-            // Pop off the current packet we read. (Comparable to the erase
-            // member function for std::vector.)
-            std::memmove(input_.data(), input_.data() + bytesParsed,
-                         numBytesLeft_ - bytesParsed);
+            auto const id = static_cast<in::PacketType>(input_.front());
+
+            // Parse the packet in place, from a view of the data we have
+            // received up to the end of the ring buffer.
+            auto view = input_.data()[0];
+            auto [status, bytesParsed] = handler_.handle(id, view);
+
+            // A packet which wraps around is parsed from a contiguous copy.
+            if (status == ResultType::Indeterminate &&
+                view.size() < input_.size()) {
+                view = input_.linearize(
+                    std::min(input_.size(), staging_.size()), staging_.data());
+                std::tie(status, bytesParsed) = handler_.handle(id, view);
+            }
 
-            // Update the number of bytes we have left to read.
-            numBytesLeft_ -= bytesParsed;
+            // Pop off the current packet we read.
+            input_.consume(bytesParsed);
 
             switch (status) {
             case ResultType::Good: {
                 // do we still need to parse?
-                if (numBytesLeft_ > 0) {
+                if (!input_.empty()) {
                     continue;
                 }
                 // we are done, read another request.
@@ -128,12 +153,10 @@ class TCPSession
                 LOG_DEBUG("Incomplete Packet received ({})--> Reading more.\n",
                           packetName);
 
-                beast::get_lowest_layer(derived().stream())
-                    .expires_after(std::chrono::seconds(Timeout));
+                startTimeout();
 
                 return derived().stream().async_read_some(
-                    asio::buffer(input_.data() + numBytesLeft_,
-                                 input_.size() - numBytesLeft_),
+                    input_.prepare(),
                     [self = derived().shared_from_this()](
                         auto&& error, auto&& bytes_transferred) {
                         self->onReadPacketHeader(error, bytes_transferred);
@@ -143,6 +166,38 @@ class TCPSession
         }
     }
 
+    /// \brief Writes all queued packets with a single gathered write.
+    void doWrite()
+    {
+        auto& metrics = state_->metrics();
+        metrics.tcpWrites.fetch_add(1, std::memory_order_relaxed);
+        metrics.tcpPacketsWritten.fetch_add(output_.size(),
+                                            std::memory_order_relaxed);
+
+        asio::async_write(derived().stream(), output_.flush(),
+                          [self = derived().shared_from_this()](
+                              auto&& error, auto&& bytes_transferred) {
+                              self->onWrite(error, bytes_transferred);
+                          });
+    }
+
+    /// \brief The asynchronous completion token for the gathered write.
+    void onWrite(beast::error_code const& _error, std::size_t)
+    {
+        if (_error) {
+            LOG_ERROR("Write error: {}\n", _error.message());
+            output_.clear();
+            return;
+        }
+
+        // the handlers may queue further packets, which are written next.
+        output_.complete();
+
+        if (output_.size() > 0) {
+            doWrite();
+        }
+    }
+
   public:
     /// \brief Creates a TCPSession.
     /// \param _ioc A reference to the io_context.
@@ -150,6 +205,7 @@ class TCPSession
     TCPSession(asio::io_context& _ioc, std::shared_ptr<SharedState> _state)
         : state_(std::move(_state))
         , handler_(_ioc, *this)
+        , timeout_(_ioc)
     {
     }
 
@@ -190,6 +246,26 @@ class TCPSession
         stationId_ = _id;
     }
 
+    /// \brief Arms the timeout for the next logical operation. If it expires,
+    /// all pending asynchronous operations on the stream are cancelled.
+    void startTimeout()
+    {
+        auto& session = derived();
+        timeout_.asyncWait(
+            Timeout, asio::bind_executor(
+                         session.stream().get_executor(),
+                         [self = session.shared_from_this()] {
+                             LOG_ERROR("TCPSession timed out.\n");
+                             beast::get_lowest_layer(self->stream()).cancel();
+                         }));
+    }
+
+    /// \brief Disarms the timeout.
+    void cancelTimeout()
+    {
+        timeout_.cancel();
+    }
+
     // clang-format off
     /// \brief Send a packet and be notified about the asynchronous write
     /// operation through the CompletionHandler.
@@ -199,6 +275,8 @@ class TCPSession
     ///     // ...
     /// }
     // clang-format on
+    /// The packet is encoded and queued. Packets queued while a write is
+    /// outstanding are written together by the next write.
     /// \tparam Packet The Packet to be written to the TCP stream.
     /// \tparam CompletionHandler The function object to inform the caller about
     /// the asynchronous operation which is immediately called once the given
@@ -206,45 +284,112 @@ class TCPSession
     /// \param _packet A const reference to the given packet.
     /// \param _handler Any valid function object with the function signature
     /// described above.
+    /// \return false if the output queue is full. The packet is dropped and
+    /// the handler is never called. Only packets the caller can recover,
+    /// e.g. by answering a poll with an error or by acknowledging a later
+    /// packet, are written this way; see writeControlPacket for the others.
+    template <typename Packet, typename CompletionHandler>
+    bool writePacket(Packet const& _packet, CompletionHandler&& _handler)
+    {
+        EncodedPacket<Packet> bytes;
+        encode(_packet, bytes.data());
+
+        return writePacket(bytes, std::forward<CompletionHandler>(_handler));
+    }
+
+    /// \brief Send an already encoded packet, see above.
+    template <std::size_t Size, typename CompletionHandler>
+    bool writePacket(std::array<std::uint8_t, Size> const& _bytes,
+                     CompletionHandler&& _handler)
+    {
+        static_assert(Size <= MaxOutputSize,
+                      "Packet size exceeds output buffer.");
+
+        if (!output_.push(_bytes.data(), Size,
+                          std::forward<CompletionHandler>(_handler))) {
+            LOG_ERROR("Output queue is full, dropping packet.\n");
+            state_->metrics().tcpPacketsDropped.fetch_add(
+                1, std::memory_order_relaxed);
+            return false;
+        }
+
+        if (!output_.writing()) {
+            doWrite();
+        }
+        return true;
+    }
+
+    /// \brief Sends a control packet, see \ref writePacket. Control packets,
+    /// e.g. the handshake response, pings and stream configurations, are
+    /// never dropped: they are queued even if the output queue is full.
+    /// Their number stays small: a single handshake response, at most one
+    /// ping and a stream configuration per change. A µc which stops reading
+    /// is disconnected by the pong timeout of its next ping.
     template <typename Packet, typename CompletionHandler>
-    void writePacket(Packet const& _packet, CompletionHandler&& _handler)
+    void writeControlPacket(Packet const& _packet, CompletionHandler&& _handler)
     {
-        auto constexpr BodySize = sizeof(Packet);
+        EncodedPacket<Packet> bytes;
+        encode(_packet, bytes.data());
+
+        writeControlPacket(bytes, std::forward<CompletionHandler>(_handler));
+    }
 
-        static_assert(BodySize <= MaxOutputSize,
+    /// \brief Sends an already encoded control packet, see above.
+    template <std::size_t Size, typename CompletionHandler>
+    void writeControlPacket(std::array<std::uint8_t, Size> const& _bytes,
+                            CompletionHandler&& _handler)
+    {
+        static_assert(Size <= MaxOutputSize,
                       "Packet size exceeds output buffer.");
-        static_assert(std::is_class<Packet>::value,
-                      "Packet needs to be a struct.");
-        static_assert(std::is_trivially_copyable<Packet>::value,
-                      "Packet needs to be trivially copyable.");
 
-        std::memcpy(output_.data(), &_packet, BodySize);
+        output_.force_push(_bytes.data(), Size,
+                           std::forward<CompletionHandler>(_handler));
 
-        asio::async_write(derived().stream(), asio::buffer(output_, BodySize),
-                          [self = derived().shared_from_this(),
-                           _handler = std::move(_handler)](
-                              auto&& error, auto&& bytes_transferred) {
-                              if (error) {
-                                  LOG_ERROR("Write error: {}\n",
-                                            error.message());
-                                  return;
-                              }
-                              _handler(bytes_transferred);
-                          });
+        if (!output_.writing()) {
+            doWrite();
+        }
+    }
+
+    /// \brief Asks the µc for its weather status on behalf of a
+    /// WebSocketSession. Concurrent requests are coalesced into a single poll,
+    /// see \ref TCPRequestHandler::requestWeatherStatus.
+    /// \remarks Thread-Safe.
+    /// \param _requester The UUID of the requesting WebSocketSession.
+    /// \param _flag The reserved session flag of the packet.
+    void requestWeatherStatus(boost::uuids::uuid const& _requester,
+                              WebSocketSessionFlag _flag)
+    {
+        asio::dispatch(derived().stream().get_executor(),
+                       [self = derived().shared_from_this(), _requester,
+                        _flag] {
+                           self->handler_.requestWeatherStatus(_requester,
+                                                               _flag);
+                       });
+    }
+
+    /// \brief Tells the µc how to push its readings, see \ref
+    /// TCPRequestHandler::sendStreamConfig.
+    /// \remarks Thread-Safe.
+    /// \param _config The stream configuration.
+    void configureStream(StreamConfig const& _config)
+    {
+        asio::dispatch(derived().stream().get_executor(),
+                       [self = derived().shared_from_this(), _config] {
+                           self->handler_.sendStreamConfig(_config);
+                       });
     }
 
     /// \brief Starts the asynchronous communication by sending a 'Handshake'
     /// packet.
     void run()
     {
-        out::HandshakePacket packet{};
-
-        writePacket(packet, [this](auto&& bytes_transferred) {
-            LOG_INFO("HandshakePacket sent with {} bytes.\n",
-                     bytes_transferred);
+        writeControlPacket(
+            out::EncodedHandshakePacket, [this](auto&& bytes_transferred) {
+                LOG_INFO("HandshakePacket sent with {} bytes.\n",
+                         bytes_transferred);
 
-            doReadPacketHeader();
-        });
+                doReadPacketHeader();
+            });
     }
 
     /// \brief Starts the asynchronous read operation.
@@ -252,12 +397,11 @@ class TCPSession
     {
         LOG_DEBUG("TCPSession::doReadPacketHeader()\n");
 
-        beast::get_lowest_layer(derived().stream())
-            .expires_after(std::chrono::seconds(Timeout));
+        startTimeout();
 
         derived().stream().async_read_some(
-            asio::buffer(input_), [self = derived().shared_from_this()](
-                                      auto&& ec, auto&& bytes_transferred) {
+            input_.prepare(), [self = derived().shared_from_this()](
+                                  auto&& ec, auto&& bytes_transferred) {
                 self->onReadPacketHeader(ec, bytes_transferred);
             });
     }
@@ -0,0 +1,181 @@
+#include "websocket_server/TimerService.hh"
+#include "websocket_server/Logger.hh"
+
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/execution/context.hpp>
+#include <boost/asio/query.hpp>
+
+#include <tuple>
+#include <utility>
+#include <vector>
+
+using namespace amadeus;
+
+asio::execution_context::id TimerService::id;
+
+TimerService::TimerService(asio::io_context& _ioc)
+    : asio::execution_context::service(_ioc)
+    , ioc_(_ioc)
+    , tick_(_ioc)
+    , epoch_(ClockType::now())
+{
+}
+
+std::size_t TimerService::size()
+{
+    std::scoped_lock<std::mutex> lk(mtx_);
+    return wheel_.size();
+}
+
+void TimerService::shutdown()
+{
+    std::vector<std::function<void()>> handlers;
+    {
+        std::scoped_lock<std::mutex> lk(mtx_);
+        shutdown_ = true;
+        tick_.cancel();
+        wheel_.clear([&handlers](timing_wheel::hook& _hook) {
+            auto& timer = static_cast<WheelTimer&>(_hook);
+            handlers.emplace_back(std::move(timer.handler_));
+        });
+    }
+    // The handlers (and whatever they keep alive) are destroyed here, outside
+    // of the lock.
+}
+
+timing_wheel::tick_type
+TimerService::tickAt(ClockType::time_point _time) const noexcept
+{
+    if (_time <= epoch_) {
+        return 0;
+    }
+    auto const resolution =
+        std::chrono::duration_cast<ClockType::duration>(TimerResolution);
+    // Round up, a timer must never expire early.
+    return static_cast<timing_wheel::tick_type>(
+        (_time - epoch_ + resolution - ClockType::duration{1}) / resolution);
+}
+
+void TimerService::arm(WheelTimer& _timer, ClockType::duration _timeout)
+{
+    if (shutdown_) {
+        return;
+    }
+
+    auto const target = tickAt(ClockType::now() + _timeout);
+    auto const now = wheel_.now();
+    wheel_.schedule(_timer, target > now ? target - now : 0);
+
+    if (!ticking_) {
+        startTicking();
+    }
+}
+
+std::function<void()> TimerService::cancel(WheelTimer& _timer)
+{
+    wheel_.cancel(_timer);
+    return std::move(_timer.handler_);
+}
+
+void TimerService::startTicking()
+{
+    ticking_ = true;
+    tick_.expires_after(TimerResolution);
+    tick_.async_wait([this](auto&& ec) { onTick(ec); });
+}
+
+void TimerService::onTick(boost::system::error_code const& _error)
+{
+    if (_error == asio::error::operation_aborted) {
+        return;
+    }
+
+    using Expired =
+        std::tuple<WheelTimer*, std::uint64_t, std::function<void()>,
+                   asio::any_io_executor>;
+    std::vector<Expired> expired;
+
+    {
+        std::scoped_lock<std::mutex> lk(mtx_);
+        if (shutdown_) {
+            return;
+        }
+
+        wheel_.advance(tickAt(ClockType::now()),
+                       [&expired](timing_wheel::hook& _hook) {
+                           auto& timer = static_cast<WheelTimer&>(_hook);
+                           expired.emplace_back(&timer, timer.generation_,
+                                                std::move(timer.handler_),
+                                                timer.executor_);
+                       });
+
+        if (wheel_.empty()) {
+            ticking_ = false;
+        } else {
+            startTicking();
+        }
+    }
+
+    // Run each handler on its own executor (e.g. the strand of the session).
+    for (auto& [timer, generation, handler, executor] : expired) {
+        asio::dispatch(executor, [timer = timer, generation = generation,
+                                  handler = std::move(handler)] {
+            if (timer->expire(generation)) {
+                handler();
+            }
+        });
+    }
+}
+
+WheelTimer::WheelTimer(asio::io_context& _ioc)
+    : service_(asio::use_service<TimerService>(_ioc))
+{
+}
+
+WheelTimer::WheelTimer(asio::any_io_executor const& _executor)
+    : WheelTimer(static_cast<asio::io_context&>(
+          asio::query(_executor, asio::execution::context)))
+{
+}
+
+WheelTimer::~WheelTimer()
+{
+    cancel();
+}
+
+asio::io_context::executor_type WheelTimer::defaultExecutor() const noexcept
+{
+    return service_.ioc_.get_executor();
+}
+
+void WheelTimer::arm(std::chrono::steady_clock::duration _timeout,
+                     std::function<void()> _handler,
+                     asio::any_io_executor _executor)
+{
+    std::function<void()> previous;
+    {
+        std::scoped_lock<std::mutex> lk(service_.mtx_);
+        ++generation_;
+        previous = std::move(handler_);
+        handler_ = std::move(_handler);
+        executor_ = std::move(_executor);
+        service_.arm(*this, _timeout);
+    }
+    // The previous handler is destroyed here, outside of the lock.
+}
+
+void WheelTimer::cancel()
+{
+    std::function<void()> previous;
+    {
+        std::scoped_lock<std::mutex> lk(service_.mtx_);
+        ++generation_;
+        previous = service_.cancel(*this);
+    }
+}
+
+bool WheelTimer::expire(std::uint64_t _generation)
+{
+    std::scoped_lock<std::mutex> lk(service_.mtx_);
+    return _generation == generation_;
+}
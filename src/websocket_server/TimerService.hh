@@ -0,0 +1,156 @@
+#ifndef WEBSOCKET_SERVER_TIMER_SERVICE_HH
+#define WEBSOCKET_SERVER_TIMER_SERVICE_HH
+
+#include "websocket_server/asiofwd.hh"
+#include "websocket_server/Common.hh"
+#include "websocket_server/utils/timing_wheel.hh"
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/execution_context.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+namespace amadeus {
+class WheelTimer;
+
+/// \brief An io_context service which drives a single \ref timing_wheel for
+/// all \ref WheelTimer objects of that io_context. Instead of one
+/// asio::steady_timer (and one timer queue entry) per session and timeout,
+/// there is exactly one steady_timer per io_context which ticks with
+/// \ref TimerResolution while timers are armed. Arming and cancelling a
+/// WheelTimer is O(1).
+/// In sharded mode (see \ref IoContextPool) there is one io_context and thus
+/// one wheel per thread and the internal mutex is never contended.
+class TimerService : public asio::execution_context::service
+{
+    friend class WheelTimer;
+
+  public:
+    /// The service id.
+    static asio::execution_context::id id;
+
+    /// \brief Constructor. Called by asio::use_service.
+    /// \param _ioc The io_context which owns the service.
+    explicit TimerService(asio::io_context& _ioc);
+
+    /// \brief Returns the number of armed timers.
+    std::size_t size();
+
+  private:
+    using ClockType = std::chrono::steady_clock;
+
+    /// The io_context which owns the service.
+    asio::io_context& ioc_;
+    /// Protects the wheel.
+    std::mutex mtx_;
+    /// The timing wheel.
+    timing_wheel wheel_;
+    /// The steady_timer which drives the wheel.
+    asio::steady_timer tick_;
+    /// The point in time of tick 0.
+    ClockType::time_point epoch_;
+    /// Whether the tick timer is currently running.
+    bool ticking_{false};
+    /// Set once the io_context shuts down.
+    bool shutdown_{false};
+
+    /// \brief Destroys all handlers of the armed timers.
+    void shutdown() override;
+
+    /// \brief Arms the given timer.
+    void arm(WheelTimer& _timer, ClockType::duration _timeout);
+
+    /// \brief Cancels the given timer.
+    /// \returns The handler of the timer which must be destroyed by the
+    /// caller outside of the lock.
+    std::function<void()> cancel(WheelTimer& _timer);
+
+    /// \brief Returns the tick for the given point in time.
+    timing_wheel::tick_type tickAt(ClockType::time_point _time) const noexcept;
+
+    /// \brief Starts the tick timer. Must be called with a held lock.
+    void startTicking();
+
+    /// \brief Called for each tick.
+    void onTick(boost::system::error_code const& _error);
+};
+
+/// \brief A one-shot timer driven by the \ref TimerService of an io_context.
+/// This is a drop-in replacement for an asio::steady_timer with a single
+/// outstanding wait. The handler is dispatched to its associated executor
+/// (e.g. bound with asio::bind_executor to the session's strand) and is not
+/// invoked at all if the timer is cancelled or re-armed before it fires.
+class WheelTimer : private timing_wheel::hook
+{
+    friend class TimerService;
+
+  private:
+    /// The service driving this timer.
+    TimerService& service_;
+    /// The handler to invoke once the timer expires.
+    std::function<void()> handler_;
+    /// The executor the handler is dispatched to.
+    asio::any_io_executor executor_;
+    /// Incremented on every arm and cancel. An expiry which was already
+    /// queued for execution is discarded if the generation has changed.
+    std::uint64_t generation_{};
+
+  public:
+    /// \brief Creates a timer on the given io_context.
+    /// \param _ioc The io_context.
+    explicit WheelTimer(asio::io_context& _ioc);
+
+    /// \brief Creates a timer on the io_context of the given executor.
+    /// \param _executor An executor of an io_context or a strand of one.
+    explicit WheelTimer(asio::any_io_executor const& _executor);
+
+    /// \brief Cancels the timer.
+    ~WheelTimer();
+
+    WheelTimer(WheelTimer const&) = delete;
+    WheelTimer& operator=(WheelTimer const&) = delete;
+
+    /// \brief Arms the timer. An already armed timer is re-armed, its
+    /// previous handler is discarded.
+    /// \tparam Handler A function object with the signature void().
+    /// \param _timeout The duration after which the timer expires. The
+    /// duration is rounded up to \ref TimerResolution.
+    /// \param _handler The handler to invoke on expiry.
+    template <typename Rep, typename Period, typename Handler>
+    void asyncWait(std::chrono::duration<Rep, Period> _timeout,
+                   Handler&& _handler)
+    {
+        auto executor =
+            asio::get_associated_executor(_handler, defaultExecutor());
+        arm(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                _timeout),
+            std::function<void()>(std::forward<Handler>(_handler)),
+            std::move(executor));
+    }
+
+    /// \brief Cancels the timer. The handler will not be invoked.
+    void cancel();
+
+  private:
+    /// \brief Returns the default executor for handlers without an
+    /// associated executor.
+    asio::io_context::executor_type defaultExecutor() const noexcept;
+
+    /// \brief Arms the timer.
+    void arm(std::chrono::steady_clock::duration _timeout,
+             std::function<void()> _handler, asio::any_io_executor _executor);
+
+    /// \brief Called on the handler's executor once the timer expired.
+    /// \returns false if the timer has been cancelled or re-armed in the
+    /// meantime, in which case the handler must not be invoked.
+    bool expire(std::uint64_t _generation);
+};
+} // namespace amadeus
+
+#endif // !WEBSOCKET_SERVER_TIMER_SERVICE_HH
@@ -0,0 +1,24 @@
+#ifndef WEBSOCKET_SERVER_WEATHER_STATUS_NOTIFICATION_HH
+#define WEBSOCKET_SERVER_WEATHER_STATUS_NOTIFICATION_HH
+
+#include "websocket_server/Packets/In/HandshakePacket.hh"
+
+#include <cstdint>
+
+namespace amadeus {
+/// \brief Represents a 'notification' from a TCP connection, whenever a new
+/// weather status update is received.
+struct WeatherStatusNotification
+{
+    /// The unique station id which identifies the TCP connection.
+    StationId id;
+    /// The temperature read from the sensor.
+    float temperature;
+    /// The humidity read from the sensor.
+    float humidity;
+    /// The unix timestamp from when the sensor read the data.
+    std::uint32_t time;
+};
+} // namespace amadeus
+
+#endif // !WEBSOCKET_SERVER_WEATHER_STATUS_NOTIFICATION_HH
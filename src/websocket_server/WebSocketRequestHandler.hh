@@ -8,10 +8,16 @@
 #include "websocket_server/SharedState.hh"
 #include "websocket_server/PlainTCPSession.hh"
 #include "websocket_server/SSLTCPSession.hh"
+#include "websocket_server/SubscriptionFilter.hh"
+#include "websocket_server/WireFormat.hh"
 
 #include <nlohmann/json.hpp>
 #include <magic_enum.hpp>
 
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <optional>
 #include <string>
 
 using JSON = nlohmann::json;
@@ -36,6 +42,12 @@ enum class RequestType
 {
     WeatherStatus = 0x00,
     AvailableStations = 0x01,
+    Subscribe = 0x02,
+    Unsubscribe = 0x03,
+    History = 0x04,
+    Rollups = 0x05,
+    Stream = 0x06,
+    Batch = 0x07,
 };
 
 /// \brief Defines the ResponseType enum which includes the outgoing WebSocket
@@ -44,6 +56,12 @@ enum class ResponseType
 {
     WeatherStatus = 0x00,
     AvailableStations = 0x01,
+    Subscribe = 0x02,
+    Unsubscribe = 0x03,
+    History = 0x04,
+    Rollups = 0x05,
+    Stream = 0x06,
+    Batch = 0x07,
 };
 
 /// \brief Similar to the \ref TCPRequestHandler, this request handler is
@@ -79,52 +97,69 @@ class WebSocketRequestHandler
     /// Example: 04 00 01 02 03 04
     /// Size:    04 00 --> 04 --> 4 bytes
     /// Payload: 01 02 03 04
+    /// The binary wire formats have no size prefix and are limited by
+    /// \ref MaxBinaryMessageSize instead, see \ref handleBinary.
     HandlerReturnType handle(BufferView const _view)
     {
         auto constexpr MaxPayloadSize = 512U;
 
+        auto const buffer = reinterpret_cast<std::uint8_t const*>(_view.data());
+        LOG_TRACE("Complete buffer: {}\n", hex_dump(buffer, _view.size()));
+
+        if (session_.wireFormat() != WireFormat::Json) {
+            return handleBinary(_view);
+        }
+
         if (_view.size() > MaxPayloadSize) {
             LOG_ERROR("Payload is too big to handle! Discarding packet...\n");
             return std::make_pair(ResultType::PayloadTooBig, 0);
         }
 
-        auto const buffer = reinterpret_cast<std::uint8_t const*>(_view.data());
-        LOG_DEBUG("Complete buffer:\n");
-        for (std::size_t i = 0; i < _view.size(); ++i) {
-            fmt::print("{0:#04x} ", buffer[i]);
-        }
-        fmt::print("\n");
-
         auto const size = *reinterpret_cast<std::uint16_t const*>(buffer);
         auto const payload = buffer + 2;
         auto const totalSize = size + 2;
 
-        LOG_DEBUG("Size = {}\n", size);
-        LOG_DEBUG("TotalSize = {}\n", totalSize);
-        LOG_DEBUG("Payload: ");
-        for (std::size_t i = 0; i < size; ++i) {
-            fmt::print("{0:#04x} ", payload[i]);
-        }
-        fmt::print("\n");
+        LOG_TRACE("Size = {}, TotalSize = {}\nPayload: {}\n", size, totalSize,
+                  hex_dump(payload, size));
 
         std::string const payloadStr{payload, payload + size};
 
         try {
-            auto json = JSON::parse(payloadStr);
-            auto const requestId = json["id"].get<RequestType>();
-
-            switch (requestId) {
-            case RequestType::WeatherStatus:
-                return handleWeatherStatusRequest(totalSize, std::move(json));
-            case RequestType::AvailableStations:
-                return handleAvailableStations(totalSize, std::move(json));
-            }
+            return dispatch(totalSize, JSON::parse(payloadStr));
         } catch (std::exception const& e) {
             LOG_ERROR("Failed to parse payload to JSON string: {}\n", e.what());
             return std::make_pair(ResultType::Bad, 0);
         }
+    }
+
+    /// \brief Handles a message of a binary wire format. WebSocket messages
+    /// are framed already, so there is no size prefix: the message is a
+    /// single request or an array of requests, which are handled in order.
+    /// The whole message is consumed.
+    /// Example (MessagePack): 91 81 a2 69 64 01 --> [{"id": 1}]
+    HandlerReturnType handleBinary(BufferView const _view)
+    {
+        auto const size = _view.size();
+        try {
+            auto json = decode(
+                std::string_view{static_cast<char const*>(_view.data()), size},
+                session_.wireFormat());
+            if (!json.is_array()) {
+                return dispatch(size, std::move(json));
+            }
 
-        return std::make_pair(ResultType::Bad, 0);
+            for (auto& request : json) {
+                if (auto const result = dispatch(size, std::move(request));
+                    result.first != ResultType::Good) {
+                    return result;
+                }
+            }
+            return std::make_pair(ResultType::Good, size);
+        } catch (std::exception const& e) {
+            LOG_ERROR("Failed to decode {} payload: {}\n",
+                      wireFormatName(session_.wireFormat()), e.what());
+            return std::make_pair(ResultType::Bad, 0);
+        }
     }
 
     /// \brief Handler function for the incoming WeatherStatusRequest from the
@@ -144,54 +179,55 @@ class WebSocketRequestHandler
         LOG_DEBUG("Num Requested stations: {}\n", stations.size());
 
         auto& state = session_.sharedState();
-        // for each stationId in the request, try to obtain a shared_ptr for the
-        // tcp session (can be both plain or ssl)
-        for (auto const id : stations) {
-            SharedState::VariantType sp;
+        auto& metrics = state.metrics();
+
+        // answer from the station cache if the latest reading is still fresh,
+        // only the remaining stations are polled
+        std::vector<StationId> ids;
+        ids.reserve(stations.size());
+        for (auto const& json : stations) {
+            auto const id = json.get<StationId>();
+            if (auto const reading = state.stationCache().lookup(id)) {
+                metrics.stationCacheHits.fetch_add(1,
+                                                   std::memory_order_relaxed);
+                session_.onNotification(encodeWeatherStatus(*reading), id);
+                continue;
+            }
+            metrics.stationCacheMisses.fetch_add(1, std::memory_order_relaxed);
+            ids.emplace_back(id);
+        }
+
+        if (ids.empty()) {
+            return std::make_pair(ResultType::Good, _size);
+        }
 
-            // prepare payload
-            out::WeatherStatusPacket packet{};
-            std::memcpy(packet.uuid.data(), &session_.uuid(),
-                        packet.uuid.size());
+        // try to obtain a shared_ptr for the tcp session (can be both plain or
+        // ssl) of every requested stationId in one go
+        auto const sessions = state.findStations(ids);
+        for (std::size_t i = 0; i < ids.size(); ++i) {
+            auto const id = ids[i];
 
-            sp = state.findStation(id);
+            // ask the µc, concurrent requests for the same station are
+            // coalesced into a single poll by the tcp session
             std::visit(
                 overloaded{
                     [&](std::shared_ptr<PlainTCPSession> const& ptr) {
-                        if (ptr) {
-                            LOG_DEBUG("setting flag to Plain\n");
-                            packet.flag = WebSocketSessionFlag::Plain;
-                            LOG_DEBUG("shared_ptr<PlainTCPSession> found for "
-                                      "session with id {}!\n",
-                                      id);
-                            // send weather request to µc
-                            ptr->writePacket(
-                                packet, [this](auto&& bytes_transferred) {
-                                    LOG_INFO("WeatherStatusRequest sent with "
-                                             "{} bytes.\n",
-                                             bytes_transferred);
-                                });
-                        }
+                        LOG_DEBUG("shared_ptr<PlainTCPSession> found for "
+                                  "session with id {}!\n",
+                                  magic_enum::enum_name(id));
+                        ptr->requestWeatherStatus(session_.uuid(),
+                                                  WebSocketSessionFlag::Plain);
                     },
                     [&](std::shared_ptr<SSLTCPSession> const& ptr) {
-                        if (ptr) {
-                            LOG_DEBUG("setting flag to SSL\n");
-                            packet.flag = WebSocketSessionFlag::SSL;
-                            LOG_DEBUG("shared_ptr<SSLTCPSession> found for "
-                                      "session with id {}!\n",
-                                      id);
-                            // send weather request to µc
-                            ptr->writePacket(
-                                packet, [this](auto&& bytes_transferred) {
-                                    LOG_INFO("WeatherStatusRequest sent with "
-                                             "{} bytes.\n",
-                                             bytes_transferred);
-                                });
-                        }
+                        LOG_DEBUG("shared_ptr<SSLTCPSession> found for "
+                                  "session with id {}!\n",
+                                  magic_enum::enum_name(id));
+                        ptr->requestWeatherStatus(session_.uuid(),
+                                                  WebSocketSessionFlag::SSL);
                     },
                     [&](std::monostate) { LOG_ERROR("No StationId found!\n"); },
                 },
-                sp);
+                sessions[i]);
         }
 
         return std::make_pair(ResultType::Good, _size);
@@ -248,12 +284,328 @@ class WebSocketRequestHandler
         }
         response["stations"] = std::move(stations);
 
-        LOG_INFO("Response for AvailableStationsRequest = {}\n", response);
+        LOG_TRACE("Response for AvailableStationsRequest = {}\n", response);
 
         session_.writeRequest(
             std::move(response), [this](auto&& bytes_transferred) {
-                LOG_INFO("AvailableStationsRequest sent with {} bytes.\n",
-                         bytes_transferred);
+                LOG_DEBUG("AvailableStationsRequest sent with {} bytes.\n",
+                          bytes_transferred);
+            });
+
+        return std::make_pair(ResultType::Good, _size);
+    }
+
+    /// \brief Handler function for the incoming SubscribeRequest from the
+    /// WebSocket connection. Afterwards, every weather status update of the
+    /// given stations is pushed to the session, no matter which session
+    /// requested it. An optional "filter" (see \ref parseSubscriptionFilter)
+    /// limits the pushed updates to the ones the session cares about; every
+    /// station gets a filter of its own. Subscribing again replaces the
+    /// filter.
+    /// \param _size The size of the JSON payload.
+    /// \param _json The entire JSON payload.
+    /// The response contains the stationIds which were subscribed to:
+    ///
+    /// {
+    ///     "id": 2,
+    ///     "stationIds": [0, 1]
+    /// }
+    HandlerReturnType handleSubscribeRequest(std::size_t _size, JSON _json)
+    {
+        return handleSubscription(ResponseType::Subscribe, _size,
+                                  std::move(_json));
+    }
+
+    /// \brief Handler function for the incoming UnsubscribeRequest from the
+    /// WebSocket connection.
+    /// \param _size The size of the JSON payload.
+    /// \param _json The entire JSON payload.
+    /// The response contains the stationIds which were unsubscribed from:
+    ///
+    /// {
+    ///     "id": 3,
+    ///     "stationIds": [1]
+    /// }
+    HandlerReturnType handleUnsubscribeRequest(std::size_t _size, JSON _json)
+    {
+        return handleSubscription(ResponseType::Unsubscribe, _size,
+                                  std::move(_json));
+    }
+
+    /// \brief Handler function for the incoming HistoryRequest from the
+    /// WebSocket connection. Answers with all recorded samples of a station
+    /// between two unix timestamps (inclusive), from the on-disk store and
+    /// the in-memory history, column by column:
+    ///
+    /// {
+    ///     "id": 4,
+    ///     "stationId": 1,
+    ///     "times": [1609509835, 1609509895],
+    ///     "temperatures": [27.4, 27.5],
+    ///     "humidities": [44.2, 44.0]
+    /// }
+    /// \param _size The size of the JSON payload.
+    /// \param _json The entire JSON payload.
+    HandlerReturnType handleHistoryRequest(std::size_t _size, JSON _json)
+    {
+        LOG_DEBUG("HistoryRequest JSON = {}\n", _json);
+
+        if (!_json.contains("stationId") || !_json.contains("from") ||
+            !_json.contains("to")) {
+            return std::make_pair(ResultType::Bad, _size);
+        }
+
+        auto& state = session_.sharedState();
+        auto const stationId = _json["stationId"].get<StationId>();
+        auto const from = _json["from"].get<std::uint32_t>();
+        auto const to = _json["to"].get<std::uint32_t>();
+
+        // Older samples come from the on-disk store. The writer thread may
+        // lag behind, so the most recent ones come from the in-memory
+        // history.
+        auto samples = state.readingStore().query(stationId, from, to);
+        auto const next = samples.times.empty() ? from
+                                                : samples.times.back() + 1U;
+        if (next != 0 && next <= to) {
+            auto recent = state.stationHistory().query(stationId, next, to);
+            samples.times.insert(std::end(samples.times),
+                                 std::begin(recent.times),
+                                 std::end(recent.times));
+            samples.temperatures.insert(std::end(samples.temperatures),
+                                        std::begin(recent.temperatures),
+                                        std::end(recent.temperatures));
+            samples.humidities.insert(std::end(samples.humidities),
+                                      std::begin(recent.humidities),
+                                      std::end(recent.humidities));
+        }
+
+        JSON response;
+        response["id"] = ResponseType::History;
+        response["stationId"] = stationId;
+        response["times"] = std::move(samples.times);
+        response["temperatures"] = std::move(samples.temperatures);
+        response["humidities"] = std::move(samples.humidities);
+
+        session_.writeRequest(
+            std::move(response), [](auto&& bytes_transferred) {
+                LOG_DEBUG("HistoryResponse sent with {} bytes.\n",
+                          bytes_transferred);
+            });
+
+        return std::make_pair(ResultType::Good, _size);
+    }
+
+    /// \brief Handler function for the incoming RollupsRequest from the
+    /// WebSocket connection. Answers with the aggregated readings of a
+    /// station between two unix timestamps in the requested resolution.
+    /// \param _size The size of the JSON payload.
+    /// \param _json The entire JSON payload.
+    HandlerReturnType handleRollupsRequest(std::size_t _size, JSON _json)
+    {
+        LOG_DEBUG("RollupsRequest JSON = {}\n", _json);
+
+        if (!_json.contains("stationId") || !_json.contains("from") ||
+            !_json.contains("to") || !_json.contains("resolution")) {
+            return std::make_pair(ResultType::Bad, _size);
+        }
+
+        auto const level =
+            parseRollupLevel(_json["resolution"].get<std::string>());
+        if (!level) {
+            return std::make_pair(ResultType::Bad, _size);
+        }
+
+        auto const stationId = _json["stationId"].get<StationId>();
+        auto const from = _json["from"].get<std::uint32_t>();
+        auto const to = _json["to"].get<std::uint32_t>();
+        auto const buckets =
+            session_.sharedState().readingStore().rollups().query(
+                stationId, *level, from, to);
+
+        auto response = encodeRollups(stationId, *level, buckets);
+        response["id"] = ResponseType::Rollups;
+
+        session_.writeRequest(
+            std::move(response), [](auto&& bytes_transferred) {
+                LOG_DEBUG("RollupsResponse sent with {} bytes.\n",
+                          bytes_transferred);
+            });
+
+        return std::make_pair(ResultType::Good, _size);
+    }
+
+    /// \brief Handler function for the incoming StreamRequest from the
+    /// WebSocket connection. Changes how a station pushes its readings, see
+    /// \ref StreamConfig. Omitted fields keep their current value. The
+    /// station is told right away if it is connected, otherwise after its
+    /// next handshake:
+    ///
+    /// {
+    ///     "id": 6,
+    ///     "stationId": 1,
+    ///     "interval": 10,
+    ///     "delta": 0.5,
+    ///     "connected": true
+    /// }
+    /// \param _size The size of the JSON payload.
+    /// \param _json The entire JSON payload.
+    HandlerReturnType handleStreamRequest(std::size_t _size, JSON _json)
+    {
+        LOG_DEBUG("StreamRequest JSON = {}\n", _json);
+
+        if (!_json.contains("stationId")) {
+            return std::make_pair(ResultType::Bad, _size);
+        }
+
+        auto& state = session_.sharedState();
+        auto const stationId = _json["stationId"].get<StationId>();
+
+        auto config = state.streamConfig(stationId);
+        auto const interval =
+            _json.value("interval", std::int64_t{config.interval});
+        if (interval < 0 ||
+            interval > std::numeric_limits<std::uint16_t>::max()) {
+            return std::make_pair(ResultType::Bad, _size);
+        }
+        config.interval = static_cast<std::uint16_t>(interval);
+        config.delta = _json.value("delta", config.delta);
+        if (!(config.delta >= 0.0F)) {
+            return std::make_pair(ResultType::Bad, _size);
+        }
+        state.streamConfig(stationId, config);
+
+        auto const connected = std::visit(
+            overloaded{
+                [&](std::monostate) { return false; },
+                [&](auto const& ptr) {
+                    ptr->configureStream(config);
+                    return true;
+                },
+            },
+            state.findStation(stationId));
+
+        JSON response;
+        response["id"] = ResponseType::Stream;
+        response["stationId"] = stationId;
+        response["interval"] = config.interval;
+        response["delta"] = config.delta;
+        response["connected"] = connected;
+
+        session_.writeRequest(
+            std::move(response), [](auto&& bytes_transferred) {
+                LOG_DEBUG("StreamResponse sent with {} bytes.\n",
+                          bytes_transferred);
+            });
+
+        return std::make_pair(ResultType::Good, _size);
+    }
+
+    /// \brief Handler function for the incoming BatchRequest from the
+    /// WebSocket connection. Negotiates the flush window of the session in
+    /// milliseconds: the notifications of a window are sent as a single JSON
+    /// array. The response carries the window in effect, which may be
+    /// shorter than requested:
+    ///
+    /// {
+    ///     "id": 7,
+    ///     "window": 50
+    /// }
+    /// \param _size The size of the JSON payload.
+    /// \param _json The entire JSON payload.
+    HandlerReturnType handleBatchRequest(std::size_t _size, JSON _json)
+    {
+        LOG_DEBUG("BatchRequest JSON = {}\n", _json);
+
+        if (!_json.contains("window")) {
+            return std::make_pair(ResultType::Bad, _size);
+        }
+
+        auto const window = session_.flushWindow(
+            std::chrono::milliseconds(_json["window"].get<std::uint32_t>()));
+
+        JSON response;
+        response["id"] = ResponseType::Batch;
+        response["window"] = window.count();
+
+        session_.writeRequest(
+            std::move(response), [](auto&& bytes_transferred) {
+                LOG_DEBUG("BatchResponse sent with {} bytes.\n",
+                          bytes_transferred);
+            });
+
+        return std::make_pair(ResultType::Good, _size);
+    }
+
+  private:
+    /// \brief Calls the handler function of a decoded request.
+    /// \param _size The size of the payload.
+    /// \param _json The request.
+    HandlerReturnType dispatch(std::size_t _size, JSON _json)
+    {
+        switch (_json["id"].get<RequestType>()) {
+        case RequestType::WeatherStatus:
+            return handleWeatherStatusRequest(_size, std::move(_json));
+        case RequestType::AvailableStations:
+            return handleAvailableStations(_size, std::move(_json));
+        case RequestType::Subscribe:
+            return handleSubscribeRequest(_size, std::move(_json));
+        case RequestType::Unsubscribe:
+            return handleUnsubscribeRequest(_size, std::move(_json));
+        case RequestType::History:
+            return handleHistoryRequest(_size, std::move(_json));
+        case RequestType::Rollups:
+            return handleRollupsRequest(_size, std::move(_json));
+        case RequestType::Stream:
+            return handleStreamRequest(_size, std::move(_json));
+        case RequestType::Batch:
+            return handleBatchRequest(_size, std::move(_json));
+        }
+
+        return std::make_pair(ResultType::Bad, _size);
+    }
+
+    /// \brief Common implementation of the (un-)subscribe requests.
+    HandlerReturnType handleSubscription(ResponseType _type, std::size_t _size,
+                                         JSON _json)
+    {
+        LOG_DEBUG("{} JSON = {}\n", magic_enum::enum_name(_type), _json);
+
+        if (!_json.contains("stationIds")) {
+            return std::make_pair(ResultType::Bad, _size);
+        }
+
+        auto& state = session_.sharedState();
+        auto const& uuid = session_.uuid();
+
+        std::optional<SubscriptionFilterOptions> filter;
+        if (auto const it = _json.find("filter");
+            _type == ResponseType::Subscribe && it != _json.end()) {
+            filter = parseSubscriptionFilter(*it);
+        }
+
+        auto stationIds = JSON::array();
+        for (auto const& id : _json["stationIds"]) {
+            auto const stationId = id.get<StationId>();
+            auto const done =
+                _type == ResponseType::Subscribe
+                    ? state.subscribe(
+                          stationId, uuid, session_.notificationCallback(),
+                          filter ? std::make_shared<SubscriptionFilter>(*filter)
+                                 : nullptr)
+                    : state.unsubscribe(stationId, uuid);
+            if (done) {
+                stationIds.push_back(stationId);
+            }
+        }
+
+        JSON response;
+        response["id"] = _type;
+        response["stationIds"] = std::move(stationIds);
+
+        session_.writeRequest(
+            std::move(response), [](auto&& bytes_transferred) {
+                LOG_DEBUG("SubscriptionResponse sent with {} bytes.\n",
+                          bytes_transferred);
             });
 
         return std::make_pair(ResultType::Good, _size);
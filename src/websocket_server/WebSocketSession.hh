@@ -5,7 +5,10 @@
 #include "websocket_server/Logger.hh"
 #include "websocket_server/Common.hh"
 #include "websocket_server/SharedState.hh"
+#include "websocket_server/TimerService.hh"
 #include "websocket_server/WebSocketRequestHandler.hh"
+#include "websocket_server/WireFormat.hh"
+#include "websocket_server/utils/ring_queue.hh"
 
 #include <boost/beast/http/message.hpp>
 #include <boost/beast/core/flat_buffer.hpp>
@@ -14,17 +17,22 @@
 #include <boost/beast/websocket/stream.hpp>
 #include <boost/beast/websocket/option.hpp>
 #include <boost/beast/websocket/error.hpp>
+#include <boost/asio/bind_executor.hpp>
 #include <boost/asio/dispatch.hpp>
 #include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/uuid/random_generator.hpp>
 
 #include <magic_enum.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <functional>
 #include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
-#include <deque>
-#include <iomanip>
+#include <vector>
 
 namespace amadeus {
 /// CRTP is used here to avoid code duplication and virtual function calls.
@@ -44,10 +52,43 @@ class WebSocketSession
     WebSocketRequestHandler<Derived> handler_;
     /// Each session is uniquely identified with a random UUID.
     boost::uuids::uuid uuid_;
-    /// The send buffer
-    std::string outBuffer_;
-    /// Out buffer queue
-    std::vector<std::string> queue_;
+    /// The wire format negotiated during the WebSocket handshake.
+    WireFormat format_{WireFormat::Json};
+    /// \brief A queued outbound message.
+    struct OutboundMessage
+    {
+        /// The serialized message, may be shared with other sessions.
+        SharedBuffer buffer;
+        /// The station of a weather status update, see
+        /// \ref NotificationCallback.
+        std::optional<StationId> station;
+        /// Called with the number of written bytes.
+        std::function<void(std::size_t)> handler;
+    };
+
+    /// The outbound messages, the front one is being written.
+    ring_queue<OutboundMessage> queue_;
+    /// The size of all queued messages.
+    std::size_t queuedBytes_{0};
+    /// The keepalive timer. Created once the WebSocket handshake was accepted
+    /// because the stream (and thus its executor) is owned by the derived
+    /// class.
+    std::optional<WheelTimer> idleTimer_;
+    /// Whether a keepalive ping has been sent since the last activity.
+    bool pingSent_{false};
+    /// The flush window negotiated by the frontend. Notifications are
+    /// collected for the duration of the window and written as a single
+    /// array message. Zero writes every notification on its own.
+    std::chrono::milliseconds flushWindow_{0};
+    /// The notifications collected during the current flush window.
+    std::vector<SharedBuffer> batch_;
+    /// The size of the collected notifications.
+    std::size_t batchBytes_{0};
+    /// Expires at the end of the current flush window. A steady_timer
+    /// because the windows are shorter than the \ref TimerResolution of a
+    /// WheelTimer. Created once the WebSocket handshake was accepted, like
+    /// the idle timer.
+    std::optional<asio::steady_timer> flushTimer_;
 
     /// \brief Helper function to access the derived class.
     Derived& derived()
@@ -74,16 +115,38 @@ class WebSocketSession
     {
         auto& ws = derived().stream();
 
-        // Set the timeout for the websocket and enable ping packets to be sent.
+        // Set the handshake timeout for the websocket. The idle timeout and
+        // the keepalive pings are driven by the idle timer instead.
         websocket::stream_base::timeout const timeout{
-            std::chrono::seconds(HandshakeTimeout), std::chrono::seconds(10s),
-            true};
+            std::chrono::seconds(HandshakeTimeout),
+            websocket::stream_base::none(), false};
         ws.set_option(timeout);
 
-        // Set a decorator to change the user-agent of the handshake
+        // Negotiate the wire format. A frontend which does not ask for a
+        // subprotocol, or only for unsupported ones, is answered without a
+        // subprotocol and served JSON.
+        auto const offered = _req[http::field::sec_websocket_protocol];
+        std::optional<WireFormat> format;
+        if (!offered.empty()) {
+            format = negotiateWireFormat(
+                std::string_view{offered.data(), offered.size()});
+        }
+        format_ = format.value_or(WireFormat::Json);
+        if (format_ != WireFormat::Json) {
+            ws.binary(true);
+            ws.read_message_max(MaxBinaryMessageSize);
+        }
+
+        // Set a decorator to change the user-agent of the handshake and to
+        // confirm the subprotocol
         ws.set_option(websocket::stream_base::decorator(
-            [](websocket::response_type& res) {
+            [format](websocket::response_type& res) {
                 res.set(http::field::server, SERVER_VERSION_STRING);
+                if (format) {
+                    auto const name = wireFormatName(*format);
+                    res.set(http::field::sec_websocket_protocol,
+                            beast::string_view{name.data(), name.size()});
+                }
             }));
 
         // Accept the websocket handshake
@@ -105,10 +168,7 @@ class WebSocketSession
             // Add this session to the list of active sessions
             WebSocketSessionCtx<Derived> ctx;
             ctx.session = &derived();
-            ctx.callback = [self =
-                                derived().shared_from_this()](auto const& arg) {
-                return self->onWeatherStatusNotification(arg);
-            };
+            ctx.callback = notificationCallback();
 
             state_->join(std::move(uuid_), std::move(ctx));
 
@@ -118,6 +178,10 @@ class WebSocketSession
                 onControlMessage(_kind, _payload);
             });
 
+            idleTimer_.emplace(ws.get_executor());
+            startIdleTimer();
+            flushTimer_.emplace(ws.get_executor());
+
             // Read a message
             doRead();
         }
@@ -132,6 +196,59 @@ class WebSocketSession
     {
         LOG_DEBUG("Received control frame: {} {}\n", static_cast<int>(_kind),
                   _payload);
+
+        startIdleTimer();
+    }
+
+    /// \brief (Re-)starts the idle timer. Called on every activity of the
+    /// peer. Once half of the idle timeout elapsed without any activity, a
+    /// ping is sent. If there is still no activity during the other half, the
+    /// session is closed.
+    void startIdleTimer()
+    {
+        pingSent_ = false;
+        armIdleTimer();
+    }
+
+    /// \brief Arms the idle timer for half of the idle timeout.
+    void armIdleTimer()
+    {
+        auto& ws = derived().stream();
+        idleTimer_->asyncWait(
+            IdleTimeout / 2,
+            asio::bind_executor(
+                ws.get_executor(),
+                [self = derived().shared_from_this()] {
+                    self->onIdleTimeout();
+                }));
+    }
+
+    /// \brief Stops the idle timer.
+    void stopIdleTimer()
+    {
+        if (idleTimer_) {
+            idleTimer_->cancel();
+        }
+    }
+
+    /// \brief Called whenever the idle timer expires.
+    void onIdleTimeout()
+    {
+        auto& ws = derived().stream();
+
+        if (pingSent_) {
+            LOG_ERROR("WebSocketSession timed out.\n");
+            beast::get_lowest_layer(ws).cancel();
+            return;
+        }
+
+        pingSent_ = true;
+        ws.async_ping({}, [self = derived().shared_from_this()](auto&& ec) {
+            if (ec) {
+                LOG_ERROR("Error sending ping: {}\n", ec.message());
+            }
+        });
+        armIdleTimer();
     }
 
     /// \brief Asynchronously reads a message into the buffer.
@@ -151,6 +268,12 @@ class WebSocketSession
     void onRead(beast::error_code const& _error, std::size_t _bytesTransferred)
     {
         // The WebSocket stream was gracefully closed at both endpoints
+        if (_error) {
+            stopIdleTimer();
+        } else {
+            startIdleTimer();
+        }
+
         if (_error == websocket::error::closed ||
             _error == ssl::error::stream_truncated) {
             LOG_DEBUG("WebSocketSession was gracefully closed.\n");
@@ -210,11 +333,22 @@ class WebSocketSession
                         }
                     });
             } break;
-            case ResultType::Indeterminate: {
-                // TODO: Read more data into buffer.
-            } break;
+            case ResultType::Indeterminate:
             case ResultType::PayloadTooBig: {
-                // TODO: Send a bad request.
+                // A WebSocket message is always complete, a request which
+                // needs more bytes than the message holds never completes.
+                buffer_.consume(buffer_.size());
+                auto& stream = derived().stream();
+                return stream.async_close(
+                    beast::websocket::close_code::too_big,
+                    [self = derived().shared_from_this()](auto&& ec) {
+                        if (ec) {
+                            LOG_ERROR("Error on closing WebSocketSession: {}\n",
+                                      ec.message());
+                        } else {
+                            LOG_DEBUG("WebSocket sent close frame to peer.\n");
+                        }
+                    });
             } break;
             }
         }
@@ -234,6 +368,7 @@ class WebSocketSession
     ~WebSocketSession()
     {
         LOG_DEBUG("WebSocketSession::~WebSocketSession()\n");
+        clearQueue();
         state_->leave<Derived>(uuid_);
     }
 
@@ -255,69 +390,296 @@ class WebSocketSession
         return uuid_;
     };
 
+    /// \brief Returns the wire format negotiated with the frontend.
+    WireFormat wireFormat() const noexcept
+    {
+        return format_;
+    }
+
     /// \brief Writes a request packet to the output buffer asynchronously and
     /// informs the caller by the given CompletionHandler.
     /// \tparam CompletionHandler A valid completion handler for the
     /// asynchronous operation to be notified.
-    /// \param _request The JSON payload to be sent.
+    /// \param _request The JSON payload to be sent, serialized in the
+    /// negotiated wire format.
     /// \param _handler The completion handler.
+    /// \returns false if the message was dropped, see \ref write.
     template <typename CompletionHandler>
-    void writeRequest(JSON _request, CompletionHandler&& _handler)
+    bool writeRequest(JSON const& _request, CompletionHandler&& _handler)
     {
-        // Always add to the queue
-        queue_.push_back(_request.dump());
+        LOG_TRACE("JSON response for frontend: {}\n", _request);
+        auto message =
+            std::make_shared<std::string const>(encode(_request, format_));
+
+        return write(std::move(message), std::nullopt,
+                     std::forward<CompletionHandler>(_handler));
+    }
+
+    /// \brief Queues an already serialized message and writes it
+    /// asynchronously. The buffer is not copied. Queued messages are written
+    /// back-to-back: the next write is started from the completion of the
+    /// previous one. Once the queue reached its high-water mark, the
+    /// \ref OverflowPolicy decides what happens to the message.
+    /// \tparam CompletionHandler A valid completion handler for the
+    /// asynchronous operation to be notified.
+    /// \param _buffer The serialized message.
+    /// \param _station The station if the message is a weather status update,
+    /// see \ref NotificationCallback.
+    /// \param _handler The completion handler, called once the message was
+    /// written.
+    /// \returns false if the message was dropped. The handler is not called
+    /// then, neither for a queued message which was dropped or replaced
+    /// later on.
+    template <typename CompletionHandler>
+    bool write(SharedBuffer _buffer, std::optional<StationId> _station,
+               CompletionHandler&& _handler)
+    {
+        OutboundMessage message{std::move(_buffer), _station,
+                                std::forward<CompletionHandler>(_handler)};
+
+        if (full(message.buffer->size())) {
+            switch (state_->outboundQueueOptions().policy) {
+            case OverflowPolicy::Coalesce:
+                if (coalesce(message)) {
+                    // the replacement may be bigger than the replaced update
+                    dropOldest(0, 0);
+                    return true;
+                }
+                [[fallthrough]];
+            case OverflowPolicy::DropOldest:
+                dropOldest(message.buffer->size());
+                if (full(message.buffer->size())) {
+                    // it does not even fit next to the message being written
+                    LOG_DEBUG("WebSocketSession dropped a message of {} "
+                              "bytes, it exceeds the queue.\n",
+                              message.buffer->size());
+                    state_->metrics().wsMessagesDropped.fetch_add(
+                        1, std::memory_order_relaxed);
+                    return false;
+                }
+                break;
+            case OverflowPolicy::Disconnect:
+                state_->metrics().wsMessagesDropped.fetch_add(
+                    1, std::memory_order_relaxed);
+                disconnectSlowConsumer();
+                return false;
+            }
+        }
+
+        enqueue(std::move(message));
 
         // Are we already writing?
-        if (queue_.size() > 1)
+        if (queue_.size() == 1) {
+            doWrite();
+        }
+        return true;
+    }
+
+  private:
+    /// \brief Returns whether queueing messages of the given size would
+    /// exceed the high-water mark of the queue.
+    /// \param _size The size of the messages.
+    /// \param _count The number of messages.
+    [[nodiscard]] bool full(std::size_t _size,
+                            std::size_t _count = 1) const noexcept
+    {
+        auto const& limits = state_->outboundQueueOptions();
+        return !queue_.empty() &&
+               (queue_.size() + _count > limits.maxMessages ||
+                queuedBytes_ + _size > limits.maxBytes);
+    }
+
+    /// \brief Appends a message to the queue.
+    void enqueue(OutboundMessage _message)
+    {
+        acquire(_message);
+        queue_.push_back(std::move(_message));
+    }
+
+    /// \brief Accounts for a message which enters the queue.
+    void acquire(OutboundMessage const& _message) noexcept
+    {
+        auto const size = _message.buffer->size();
+        queuedBytes_ += size;
+
+        auto& metrics = state_->metrics();
+        metrics.wsQueuedMessages.fetch_add(1, std::memory_order_relaxed);
+        metrics.wsQueuedBytes.fetch_add(static_cast<std::int64_t>(size),
+                                        std::memory_order_relaxed);
+    }
+
+    /// \brief Accounts for a message which leaves the queue.
+    void release(OutboundMessage const& _message) noexcept
+    {
+        auto const size = _message.buffer->size();
+        queuedBytes_ -= size;
+
+        auto& metrics = state_->metrics();
+        metrics.wsQueuedMessages.fetch_sub(1, std::memory_order_relaxed);
+        metrics.wsQueuedBytes.fetch_sub(static_cast<std::int64_t>(size),
+                                        std::memory_order_relaxed);
+    }
+
+    /// \brief Removes all messages from the queue.
+    void clearQueue() noexcept
+    {
+        for (std::size_t i = 0; i < queue_.size(); ++i) {
+            release(queue_[i]);
+        }
+        queue_.clear();
+    }
+
+    /// \brief Replaces the newest queued update of the same station with the
+    /// given one. The message being written is not replaced.
+    /// \returns false if the message is no weather status update or there is
+    /// no queued update of its station.
+    bool coalesce(OutboundMessage& _message)
+    {
+        if (!_message.station) {
+            return false;
+        }
+
+        // Search from the back: replacing an older update would reorder the
+        // updates of the station.
+        for (auto i = queue_.size() - 1; i > 0; --i) {
+            auto& queued = queue_[i];
+            if (queued.station == _message.station) {
+                release(queued);
+                acquire(_message);
+                queued = std::move(_message);
+                state_->metrics().wsMessagesCoalesced.fetch_add(
+                    1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// \brief Drops the oldest queued messages until messages of the given
+    /// size fit, see \ref full. The message being written is not dropped.
+    void dropOldest(std::size_t _size, std::size_t _count = 1)
+    {
+        std::size_t dropped{0};
+        while (queue_.size() > 1 && full(_size, _count)) {
+            // the front message is being written, move it over the oldest
+            // waiting one
+            release(queue_[1]);
+            queue_[1] = std::move(queue_.front());
+            queue_.pop_front();
+            ++dropped;
+        }
+
+        if (dropped == 0) {
             return;
+        }
+        LOG_DEBUG("WebSocketSession queue is full ({} messages, {} bytes), "
+                  "dropped {} messages.\n",
+                  queue_.size(), queuedBytes_, dropped);
+        state_->metrics().wsMessagesDropped.fetch_add(
+            dropped, std::memory_order_relaxed);
+    }
+
+    /// \brief Closes the connection of a frontend which does not read its
+    /// messages fast enough.
+    void disconnectSlowConsumer()
+    {
+        auto& stream = beast::get_lowest_layer(derived().stream());
+        if (!stream.socket().is_open()) {
+            return;
+        }
 
-        // We are not currently writing, so end this immediately
-        LOG_INFO("JSON RESPONSE FOR FRONTEND: {}\n", _request.dump());
-        outBuffer_ = _request.dump();
+        LOG_ERROR("WebSocketSession queue is full ({} messages, {} bytes), "
+                  "disconnecting.\n",
+                  queue_.size(), queuedBytes_);
+        state_->metrics().wsSlowConsumerDisconnects.fetch_add(
+            1, std::memory_order_relaxed);
+        // fails the pending operations, the session leaves once its read
+        // completed
+        stream.close();
+    }
 
-        fmt::print("BYTES:\n");
-        for (auto const& b : outBuffer_) {
-            fmt::print("{:X} ", b);
+    /// \brief Adds a notification to the batch of the current flush window.
+    /// The first notification of a batch starts the window.
+    void collect(SharedBuffer const& _buffer)
+    {
+        if (batch_.empty()) {
+            flushTimer_->expires_after(flushWindow_);
+            flushTimer_->async_wait([self = derived().shared_from_this()](
+                                        beast::error_code const& _ec) {
+                if (!_ec) {
+                    self->flush();
+                }
+            });
         }
-        fmt::print("\n");
+        batchBytes_ += _buffer->size();
+        batch_.push_back(_buffer);
+    }
+
+    /// \brief Writes the collected notifications as a single array. The
+    /// serialized notifications are joined as they are, nothing is parsed or
+    /// serialized again.
+    void flush()
+    {
+        if (batch_.empty()) {
+            return;
+        }
+
+        auto message = encodeArray(batch_, batchBytes_, format_);
+
+        auto const count = batch_.size();
+        batch_.clear();
+        batchBytes_ = 0;
+        state_->metrics().wsBatchedNotifications.fetch_add(
+            count, std::memory_order_relaxed);
+
+        // a batch mixes stations and cannot be coalesced
+        write(std::make_shared<std::string const>(std::move(message)),
+              std::nullopt, [count](auto&& bytes_transferred) {
+                  LOG_DEBUG("{} WeatherStatus Responses were sent to "
+                            "frontend with {} bytes.\n",
+                            count, bytes_transferred);
+              });
+    }
 
+    /// \brief Writes the front message of the queue.
+    void doWrite()
+    {
         auto& ws = derived().stream();
-        ws.async_write(asio::buffer(queue_.front()),
-                       [self = derived().shared_from_this(),
-                        _handler = std::move(_handler)](
+        ws.async_write(asio::buffer(*queue_.front().buffer),
+                       [self = derived().shared_from_this()](
                            auto&& error, auto&& bytes_transferred) {
-                           self->onWrite(error, bytes_transferred,
-                                         std::move(_handler));
+                           self->onWrite(error, bytes_transferred);
                        });
     }
 
-    template <typename CompletionHandler>
-    void onWrite(beast::error_code const& _ec, std::size_t _bytes_transferred,
-                 CompletionHandler&& _handler)
+    /// \brief CompletionToken for the asynchronous write operation.
+    /// \param _ec The error.
+    /// \param _bytes_transferred The number of bytes written.
+    void onWrite(beast::error_code const& _ec, std::size_t _bytes_transferred)
     {
         // Handle the error, if any
         if (_ec) {
             LOG_ERROR("WS write error: {}\n", _ec.message());
+            clearQueue();
             return;
         }
-        // Remove the string from the queue
-        queue_.erase(std::begin(queue_));
 
-        // Send the next request if any
+        state_->metrics().wsMessagesWritten.fetch_add(
+            1, std::memory_order_relaxed);
+
+        auto handler = std::move(queue_.front().handler);
+        release(queue_.front());
+        queue_.pop_front();
+
+        // Send the next message if any
         if (!queue_.empty()) {
-            auto& ws = derived().stream();
-            ws.async_write(asio::buffer(queue_.front()),
-                           [self = derived().shared_from_this(),
-                            _handler = std::move(_handler)](
-                               auto&& error, auto&& bytes_transferred) {
-                               self->onWrite(error, bytes_transferred,
-                                             std::move(_handler));
-                           });
+            doWrite();
         }
 
-        _handler(_bytes_transferred);
+        handler(_bytes_transferred);
     }
 
+  public:
     /// \brief Start the asynchronous operation.
     template <class Body, class Allocator>
     void run(http::request<Body, http::basic_fields<Allocator>> _req)
@@ -333,31 +695,59 @@ class WebSocketSession
             });
     }
 
-    /// \brief Called each time a new Weather Status Response is received from a
-    /// µc.
-    /// \param _notification The actual weather status data from the TCP
-    /// connection.
-    void
-    onWeatherStatusNotification(WeatherStatusNotification const& _notification)
+    /// \brief Returns a callback which queues a notification on this
+    /// session. The callback may be invoked from any thread, the
+    /// serialization and the write itself are performed on the session's
+    /// executor. It only holds a weak_ptr to the session.
+    NotificationCallback notificationCallback()
     {
-        LOG_DEBUG("WeatherStatusNotification: {} {}\n",
-                  _notification.temperature, _notification.humidity);
+        return [weak = derived().weak_from_this()](
+                   SharedMessage const& _message,
+                   std::optional<StationId> _station) {
+            if (auto self = weak.lock()) {
+                auto& ws = self->stream();
+                asio::post(ws.get_executor(), [self, _message, _station] {
+                    self->onNotification(_message, _station);
+                });
+            }
+        };
+    }
 
-        auto const time = static_cast<std::time_t>(_notification.time);
-        auto const t = std::gmtime(&time);
-        std::stringstream ss;
-        ss << std::put_time(t, "%Y-%m-%d %H:%M:%S");
+    /// \brief Sets the flush window of this session. Notifications are
+    /// collected for the duration of the window and written as a single
+    /// array, which trades latency for fewer frames and writes.
+    /// \param _window The window, capped by
+    /// \ref OutboundQueueOptions::maxFlushWindow. Zero disables batching and
+    /// writes the notifications collected so far.
+    /// \returns The window in effect.
+    std::chrono::milliseconds flushWindow(std::chrono::milliseconds _window)
+    {
+        flushWindow_ =
+            std::clamp(_window, std::chrono::milliseconds{0},
+                       state_->outboundQueueOptions().maxFlushWindow);
+        if (flushWindow_.count() == 0) {
+            flush();
+        }
+        return flushWindow_;
+    }
 
-        // Prepare JSON response for frontend.
-        auto response = JSON::object();
-        response["id"] = ResponseType::WeatherStatus;
-        response["stationId"] = _notification.id;
-        response["temperature"] = _notification.temperature;
-        response["humidity"] = _notification.humidity;
-        response["time"] = ss.str();
+    /// \brief Called each time a new Weather Status Response is queued for
+    /// this session. Collected for the flush window, if any.
+    /// \param _message The response, shared between all recipients. It is
+    /// serialized in the wire format of the session, at most once for all
+    /// recipients which speak it.
+    /// \param _station The station of a weather status update, see
+    /// \ref NotificationCallback.
+    void onNotification(SharedMessage const& _message,
+                        std::optional<StationId> _station)
+    {
+        auto const& buffer = _message->encoded(format_);
+        if (flushWindow_.count() > 0) {
+            collect(buffer);
+            return;
+        }
 
-        // Send response back to frontend.
-        writeRequest(std::move(response), [](auto&& bytes_transferred) {
+        write(buffer, _station, [](auto&& bytes_transferred) {
             LOG_DEBUG("WeatherStatus Reponse was sent to frontend with {} "
                       "bytes.\n",
                       bytes_transferred);
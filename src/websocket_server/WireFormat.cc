@@ -0,0 +1,164 @@
+#include "websocket_server/WireFormat.hh"
+
+#include <utility>
+
+using namespace amadeus;
+
+namespace {
+/// \brief Appends an unsigned integer in network byte order.
+template <typename T>
+void appendBigEndian(std::string& _out, T _value)
+{
+    for (auto shift = static_cast<int>(sizeof(T) * 8U) - 8; shift >= 0;
+         shift -= 8) {
+        _out += static_cast<char>((_value >> static_cast<unsigned>(shift)) &
+                                  0xFFU);
+    }
+}
+
+/// \brief Appends the header of a MessagePack array.
+void appendMsgPackArray(std::string& _out, std::size_t _count)
+{
+    if (_count < 16U) {
+        _out += static_cast<char>(0x90U | _count);
+    } else if (_count <= 0xFFFFU) {
+        _out += static_cast<char>(0xDCU);
+        appendBigEndian(_out, static_cast<std::uint16_t>(_count));
+    } else {
+        _out += static_cast<char>(0xDDU);
+        appendBigEndian(_out, static_cast<std::uint32_t>(_count));
+    }
+}
+
+/// \brief Appends the header of a CBOR array of definite length.
+void appendCborArray(std::string& _out, std::size_t _count)
+{
+    if (_count < 24U) {
+        _out += static_cast<char>(0x80U | _count);
+    } else if (_count <= 0xFFU) {
+        _out += static_cast<char>(0x98U);
+        _out += static_cast<char>(_count);
+    } else if (_count <= 0xFFFFU) {
+        _out += static_cast<char>(0x99U);
+        appendBigEndian(_out, static_cast<std::uint16_t>(_count));
+    } else {
+        _out += static_cast<char>(0x9AU);
+        appendBigEndian(_out, static_cast<std::uint32_t>(_count));
+    }
+}
+} // namespace
+
+std::string_view amadeus::wireFormatName(WireFormat _format) noexcept
+{
+    switch (_format) {
+    case WireFormat::Json:
+        return "json";
+    case WireFormat::MsgPack:
+        return "msgpack";
+    case WireFormat::Cbor:
+        return "cbor";
+    }
+    return "json";
+}
+
+std::optional<WireFormat>
+amadeus::negotiateWireFormat(std::string_view _offered)
+{
+    while (!_offered.empty()) {
+        auto const comma = _offered.find(',');
+        auto protocol = _offered.substr(0, comma);
+        _offered.remove_prefix(comma == std::string_view::npos ? _offered.size()
+                                                               : comma + 1);
+
+        auto const first = protocol.find_first_not_of(" \t");
+        if (first == std::string_view::npos) {
+            continue;
+        }
+        protocol = protocol.substr(
+            first, protocol.find_last_not_of(" \t") - first + 1);
+
+        for (auto const format :
+             {WireFormat::Json, WireFormat::MsgPack, WireFormat::Cbor}) {
+            if (protocol == wireFormatName(format)) {
+                return format;
+            }
+        }
+    }
+    return std::nullopt;
+}
+
+std::string amadeus::encode(JSON const& _message, WireFormat _format)
+{
+    std::string out;
+    switch (_format) {
+    case WireFormat::Json:
+        out = _message.dump();
+        break;
+    case WireFormat::MsgPack:
+        JSON::to_msgpack(_message, out);
+        break;
+    case WireFormat::Cbor:
+        JSON::to_cbor(_message, out);
+        break;
+    }
+    return out;
+}
+
+JSON amadeus::decode(std::string_view _message, WireFormat _format)
+{
+    switch (_format) {
+    case WireFormat::MsgPack:
+        return JSON::from_msgpack(std::begin(_message), std::end(_message));
+    case WireFormat::Cbor:
+        return JSON::from_cbor(std::begin(_message), std::end(_message));
+    case WireFormat::Json:
+        break;
+    }
+    return JSON::parse(std::begin(_message), std::end(_message));
+}
+
+std::string amadeus::encodeArray(std::vector<SharedBuffer> const& _items,
+                                 std::size_t _bytes, WireFormat _format)
+{
+    std::string out;
+    out.reserve(_bytes + _items.size() + 8U);
+
+    switch (_format) {
+    case WireFormat::Json:
+        out += '[';
+        for (auto const& item : _items) {
+            if (out.size() > 1) {
+                out += ',';
+            }
+            out += *item;
+        }
+        out += ']';
+        return out;
+    case WireFormat::MsgPack:
+        appendMsgPackArray(out, _items.size());
+        break;
+    case WireFormat::Cbor:
+        appendCborArray(out, _items.size());
+        break;
+    }
+
+    for (auto const& item : _items) {
+        out += *item;
+    }
+    return out;
+}
+
+FrontendMessage::FrontendMessage(JSON _message)
+    : message_(std::move(_message))
+{
+}
+
+SharedBuffer const& FrontendMessage::encoded(WireFormat _format) const
+{
+    auto const index = static_cast<std::size_t>(_format);
+    std::call_once(once_[index], [this, index, _format] {
+        buffers_[index] =
+            std::make_shared<std::string const>(encode(message_, _format));
+    });
+    return buffers_[index];
+}
@@ -0,0 +1,98 @@
+#ifndef WEBSOCKET_SERVER_WIRE_FORMAT_HH
+#define WEBSOCKET_SERVER_WIRE_FORMAT_HH
+
+#include <nlohmann/json.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using JSON = nlohmann::json;
+
+namespace amadeus {
+/// \brief An immutable, serialized message for the frontend. The same buffer
+/// is queued to every recipient.
+using SharedBuffer = std::shared_ptr<std::string const>;
+
+/// \brief The encoding of the messages between a frontend and the server,
+/// negotiated with the Sec-WebSocket-Protocol header of the WebSocket
+/// handshake.
+enum class WireFormat : std::uint8_t
+{
+    /// JSON in text frames, every request is prefixed with its 2 byte length.
+    /// Used if the frontend does not ask for a subprotocol.
+    Json,
+    /// MessagePack in binary frames. A message holds a single request or an
+    /// array of requests, without a length prefix.
+    MsgPack,
+    /// CBOR in binary frames, like \ref MsgPack.
+    Cbor,
+};
+
+/// The number of wire formats.
+auto constexpr WireFormats = std::size_t{3};
+
+/// \brief Returns the subprotocol name of a wire format.
+std::string_view wireFormatName(WireFormat _format) noexcept;
+
+/// \brief Picks the first supported subprotocol of the Sec-WebSocket-Protocol
+/// request header, a comma separated list in order of preference.
+/// \returns std::nullopt if none is supported.
+std::optional<WireFormat> negotiateWireFormat(std::string_view _offered);
+
+/// \brief Serializes a message.
+/// \param _message The message.
+/// \param _format The wire format.
+std::string encode(JSON const& _message, WireFormat _format);
+
+/// \brief Deserializes a whole message.
+/// \param _message The message.
+/// \param _format The wire format.
+/// \throws JSON::exception if the message is malformed.
+JSON decode(std::string_view _message, WireFormat _format);
+
+/// \brief Joins serialized messages into a single array message. The
+/// messages are copied as they are, nothing is parsed or serialized again.
+/// \param _items The messages, serialized in _format.
+/// \param _bytes The size of all messages.
+/// \param _format The wire format.
+std::string encodeArray(std::vector<SharedBuffer> const& _items,
+                        std::size_t _bytes, WireFormat _format);
+
+/// \brief A message for any number of frontends, which may speak different
+/// wire formats. It is serialized at most once per wire format, by the first
+/// recipient which needs it.
+/// \remarks Thread-Safe.
+class FrontendMessage final
+{
+  public:
+    /// \brief Constructor.
+    /// \param _message The message.
+    explicit FrontendMessage(JSON _message);
+
+    FrontendMessage(FrontendMessage const&) = delete;
+    FrontendMessage& operator=(FrontendMessage const&) = delete;
+
+    /// \brief Returns the message serialized in the given wire format.
+    SharedBuffer const& encoded(WireFormat _format) const;
+
+  private:
+    /// The message.
+    JSON const message_;
+    /// Guards the serialization of every wire format.
+    mutable std::array<std::once_flag, WireFormats> once_;
+    /// The message serialized in every wire format, null until needed.
+    mutable std::array<SharedBuffer, WireFormats> buffers_;
+};
+
+/// \brief A message which is shared between all of its recipients.
+using SharedMessage = std::shared_ptr<FrontendMessage const>;
+} // namespace amadeus
+
+#endif // !WEBSOCKET_SERVER_WIRE_FORMAT_HH
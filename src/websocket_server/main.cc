@@ -1,10 +1,12 @@
 #include "websocket_server/CommandLineInterface.hh"
+#include "websocket_server/IoContextPool.hh"
 #include "websocket_server/Logger.hh"
 #include "websocket_server/PlainHttpListener.hh"
 #include "websocket_server/PlainTCPListener.hh"
 #include "websocket_server/SSLHttpListener.hh"
 #include "websocket_server/SSLTCPListener.hh"
 #include "websocket_server/ServerCertificate.hh"
+#include "websocket_server/SharedState.hh"
 
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/signal_set.hpp>
@@ -13,71 +15,75 @@
 
 #include <ratio>
 #include <thread>
+#include <vector>
 
 using namespace amadeus;
 
-/// \brief The main function.
-/// \param argc Number of arguments.
-/// \param argv The arguments.
-int main(int argc, char* argv[])
+namespace {
+/// \brief The set of listeners owned by a single shard (or by the shared
+/// io_context).
+struct Listeners
 {
-    auto& logger = Logger::instance();
-    logger.open("server_log.txt");
-
-    CommandLineInterface cli;
-    try {
-        cli.parse(argc, argv);
-    } catch (std::exception const& e) {
-        LOG_ERROR("{}\n", e.what());
-        return EXIT_FAILURE;
+    std::shared_ptr<PlainHttpListener> plainHttp;
+    std::shared_ptr<SSLHttpListener> sslHttp;
+    std::shared_ptr<PlainTCPListener> plainTCP;
+    std::shared_ptr<SSLTCPListener> sslTCP;
+
+    /// \brief Creates the HTTP and TCP listeners on the given io_context.
+    Listeners(asio::io_context& _io, ssl::context& _ctx,
+              CommandLineInterface const& _cli,
+              std::shared_ptr<SharedState> const& _state,
+              ListenerOptions const& _options)
+        : plainHttp(std::make_shared<PlainHttpListener>(
+              _io, nullptr, tcp::endpoint{_cli.ip, _cli.httpPort}, _state,
+              _options))
+        , sslHttp(std::make_shared<SSLHttpListener>(
+              _io, &_ctx, tcp::endpoint{_cli.ip, _cli.httpsPort}, _state,
+              _options))
+        , plainTCP(std::make_shared<PlainTCPListener>(
+              _io, nullptr, tcp::endpoint{_cli.ip, _cli.tcpPort}, _state,
+              _options))
+        , sslTCP(std::make_shared<SSLTCPListener>(
+              _io, &_ctx, tcp::endpoint{_cli.ip, _cli.tcpSecurePort}, _state,
+              _options))
+    {
     }
 
-    LOG_INFO("Starting server with {} threads...\n", cli.threads);
-
-    // The main io_context shared between all I/O operations and threads.
-    asio::io_context io{static_cast<int>(cli.threads)};
-
-    // The main SSL-Context shared between all SSL I/O operations and threads.
-    // It holds the server certificate.
-    ssl::context ctx{ssl::context::tls_server};
-
-    /// Load self-signed certificate for the server.
-    try {
-        loadServerCertificate(ctx, cli.certChain, cli.privKey);
-    } catch (boost::system::system_error const& e) {
-        LOG_FATAL("{}\n", e.what());
-        return EXIT_FAILURE;
+    /// \brief Launches all listeners.
+    /// \throw Any exception thrown by boost.
+    void run()
+    {
+        plainHttp->run();
+        sslHttp->run();
+        plainTCP->run();
+        sslTCP->run();
     }
+};
 
-    auto const state =
-        std::make_shared<SharedState>(std::move(cli.docRoot), cli.config);
-
-    // Create and launch the HTTP listeners.
-    auto plainHttpListener = std::make_shared<PlainHttpListener>(
-        io, nullptr, tcp::endpoint{cli.ip, cli.httpPort}, state);
-
-    auto sslHttpListener = std::make_shared<SSLHttpListener>(
-        io, &ctx, tcp::endpoint{cli.ip, cli.httpsPort}, state);
+/// \brief Runs the server with a single io_context shared between all threads.
+/// Every accepted connection is wrapped in its own strand.
+int runShared(CommandLineInterface const& _cli, ssl::context& _ctx,
+              std::shared_ptr<SharedState> const& _state)
+{
+    // The main io_context shared between all I/O operations and threads.
+    asio::io_context io{static_cast<int>(_cli.threads)};
 
-    // Create and launch the TCP listeners.
-    auto plainTCPListener = std::make_shared<PlainTCPListener>(
-        io, nullptr, tcp::endpoint{cli.ip, cli.tcpPort}, state);
+    // Large fan-outs are posted back to the io_context and thus spread over
+    // all of its threads.
+    _state->setFanOutExecutors({io.get_executor()});
 
-    auto sslTCPListener = std::make_shared<SSLTCPListener>(
-        io, &ctx, tcp::endpoint{cli.ip, cli.tcpSecurePort}, state);
+    // Create and launch the HTTP and TCP listeners.
+    Listeners listeners{io, _ctx, _cli, _state, ListenerOptions{}};
 
     try {
-        plainHttpListener->run();
-        sslHttpListener->run();
-        plainTCPListener->run();
-        sslTCPListener->run();
+        listeners.run();
     } catch (std::exception const& e) {
         LOG_FATAL("{}\n", e.what());
         io.stop();
         return EXIT_FAILURE;
     }
 
-    LOG_INFO("Server running at {}:{}\n", cli.ip, cli.httpPort);
+    LOG_INFO("Server running at {}:{}\n", _cli.ip, _cli.httpPort);
 
     // Capture SIGINT, SIGTERM for a clean shutdown.
     asio::signal_set signals(io, SIGINT, SIGTERM);
@@ -98,8 +104,8 @@ int main(int argc, char* argv[])
     // main-thread.
     auto constexpr TypicalMaxThreadCount{8U};
     boost::container::small_vector<std::thread, TypicalMaxThreadCount> threads;
-    threads.reserve(cli.threads);
-    for (auto i = cli.threads - 1; i > 0; --i) {
+    threads.reserve(_cli.threads);
+    for (auto i = _cli.threads - 1; i > 0; --i) {
         threads.emplace_back([&io] { io.run(); });
     }
 
@@ -112,3 +118,126 @@ int main(int argc, char* argv[])
 
     return EXIT_SUCCESS;
 }
+
+/// \brief Runs the server with one io_context per thread. Each shard opens
+/// its own set of listeners on the same endpoints with SO_REUSEPORT, so the
+/// kernel load balances new connections between the shards and every session
+/// stays on the shard that accepted it.
+int runSharded(CommandLineInterface const& _cli, ssl::context& _ctx,
+               std::shared_ptr<SharedState> const& _state)
+{
+    IoContextPool pool{_cli.threads, _cli.incomingCpu};
+
+    // Large fan-outs are partitioned across all shards.
+    std::vector<asio::any_io_executor> executors;
+    executors.reserve(pool.size());
+    for (std::size_t i = 0; i < pool.size(); ++i) {
+        executors.emplace_back(pool.at(i).get_executor());
+    }
+    _state->setFanOutExecutors(std::move(executors));
+
+    std::vector<Listeners> shards;
+    shards.reserve(pool.size());
+
+    try {
+        for (std::size_t i = 0; i < pool.size(); ++i) {
+            ListenerOptions options;
+            options.strand = false;
+            options.reusePort = true;
+            if (_cli.incomingCpu) {
+                options.incomingCpu = static_cast<int>(i);
+            }
+
+            shards.emplace_back(pool.at(i), _ctx, _cli, _state, options)
+                .run();
+        }
+    } catch (std::exception const& e) {
+        LOG_FATAL("{}\n", e.what());
+        pool.stop();
+        return EXIT_FAILURE;
+    }
+
+    LOG_INFO("Server running at {}:{} with {} shards\n", _cli.ip,
+             _cli.httpPort, pool.size());
+
+    // Capture SIGINT, SIGTERM for a clean shutdown.
+    asio::signal_set signals(pool.at(0), SIGINT, SIGTERM);
+    signals.async_wait(
+        [&pool](boost::system::error_code const& error, int signal_number) {
+            // Stop all shards and all of their associated handlers.
+            auto const start = std::chrono::steady_clock::now();
+            pool.stop();
+            auto const diff = std::chrono::duration<double, std::milli>(
+                                  std::chrono::steady_clock::now() - start)
+                                  .count();
+            LOG_INFO("Exited with signal {} and error: {}. Took {} ms.\n",
+                     signal_number, error.message(), diff);
+        });
+
+    // Blocks until every shard has returned.
+    pool.run();
+
+    return EXIT_SUCCESS;
+}
+} // namespace
+
+/// \brief The main function.
+/// \param argc Number of arguments.
+/// \param argv The arguments.
+int main(int argc, char* argv[])
+{
+    auto& logger = Logger::instance();
+    logger.open("server_log.txt");
+
+    CommandLineInterface cli;
+    try {
+        cli.parse(argc, argv);
+    } catch (std::exception const& e) {
+        LOG_ERROR("{}\n", e.what());
+        return EXIT_FAILURE;
+    }
+    logger.overflow(cli.logOverflow);
+    logger.severity(cli.logSeverity);
+    if (!cli.logBinaryFile.empty() && !logger.binary(cli.logBinaryFile)) {
+        LOG_ERROR("Failed to create binary log file '{}'.\n",
+                  cli.logBinaryFile);
+        return EXIT_FAILURE;
+    }
+
+    LOG_INFO("Starting server with {} threads{}...\n", cli.threads,
+             cli.sharded ? " (sharded)" : "");
+
+    // The main SSL-Context shared between all SSL I/O operations and threads.
+    // It holds the server certificate.
+    ssl::context ctx{ssl::context::tls_server};
+
+    /// Load self-signed certificate for the server.
+    try {
+        loadServerCertificate(ctx, cli.certChain, cli.privKey);
+    } catch (boost::system::system_error const& e) {
+        LOG_FATAL("{}\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    auto const state =
+        std::make_shared<SharedState>(std::move(cli.docRoot), cli.config,
+                                      cli.cacheMaxAge, cli.historyMaxBytes,
+                                      std::move(cli.store), cli.stream);
+
+    state->setOutboundQueueOptions(cli.outbound);
+
+    try {
+        state->readingStore().start();
+    } catch (std::exception const& e) {
+        LOG_FATAL("{}\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    auto const result = cli.sharded ? runSharded(cli, ctx, state)
+                                    : runShared(cli, ctx, state);
+
+    // write the readings which are still queued
+    state->readingStore().stop();
+
+    return result;
+}
@@ -0,0 +1,146 @@
+#ifndef WEBSOCKET_SERVER_BOUNDED_QUEUE_HH
+#define WEBSOCKET_SERVER_BOUNDED_QUEUE_HH
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace amadeus {
+/// \brief A bounded, lock-free multi-producer multi-consumer queue (D. Vyukov).
+/// Every cell carries a sequence number which tells producers and consumers
+/// whether it is free or filled for their current position, so neither side
+/// ever waits for the other: try_push fails if the queue is full and try_pop
+/// fails if it is empty.
+/// \remarks Thread-Safe.
+/// \tparam T The element type, must be nothrow move constructible.
+/* Example:
+ *
+ *  bounded_queue<int> q{1024};
+ *  q.try_push(42);              // any producer thread
+ *  if (auto v = q.try_pop()) {  // any consumer thread
+ *      ...
+ *  }
+ */
+template <typename T>
+class bounded_queue final
+{
+    static_assert(std::is_nothrow_move_constructible_v<T>,
+                  "T needs to be nothrow move constructible.");
+
+  public:
+    /// \brief Constructor.
+    /// \param _capacity The capacity, rounded up to a power of two.
+    explicit bounded_queue(std::size_t _capacity)
+        : capacity_(roundUp(_capacity))
+        , mask_(capacity_ - 1)
+        , cells_(std::make_unique<cell[]>(capacity_))
+    {
+        for (std::size_t i = 0; i < capacity_; ++i) {
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bounded_queue(bounded_queue const&) = delete;
+    bounded_queue& operator=(bounded_queue const&) = delete;
+
+    ~bounded_queue()
+    {
+        while (try_pop()) {
+        }
+    }
+
+    /// \brief Returns the capacity.
+    std::size_t capacity() const noexcept
+    {
+        return capacity_;
+    }
+
+    /// \brief Enqueues a value. The value is only moved from if it was
+    /// enqueued.
+    /// \returns false if the queue is full.
+    template <typename U>
+    bool try_push(U&& _value) noexcept(
+        std::is_nothrow_constructible_v<T, U&&>)
+    {
+        auto pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            auto& c = cells_[pos & mask_];
+            auto const seq = c.seq.load(std::memory_order_acquire);
+            auto const diff = static_cast<std::ptrdiff_t>(seq) -
+                              static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1,
+                                                std::memory_order_relaxed)) {
+                    ::new (static_cast<void*>(&c.storage))
+                        T(std::forward<U>(_value));
+                    c.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// \brief Dequeues a value.
+    /// \returns std::nullopt if the queue is empty.
+    std::optional<T> try_pop() noexcept
+    {
+        auto pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            auto& c = cells_[pos & mask_];
+            auto const seq = c.seq.load(std::memory_order_acquire);
+            auto const diff = static_cast<std::ptrdiff_t>(seq) -
+                              static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1,
+                                                std::memory_order_relaxed)) {
+                    auto* value =
+                        std::launder(reinterpret_cast<T*>(&c.storage));
+                    std::optional<T> result{std::move(*value)};
+                    value->~T();
+                    c.seq.store(pos + capacity_, std::memory_order_release);
+                    return result;
+                }
+            } else if (diff < 0) {
+                return std::nullopt;
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+  private:
+    /// \brief A single cell.
+    struct cell
+    {
+        std::atomic<std::size_t> seq;
+        std::aligned_storage_t<sizeof(T), alignof(T)> storage;
+    };
+
+    static std::size_t roundUp(std::size_t _n) noexcept
+    {
+        std::size_t p{2};
+        while (p < _n) {
+            p *= 2;
+        }
+        return p;
+    }
+
+    std::size_t const capacity_;
+    std::size_t const mask_;
+    std::unique_ptr<cell[]> cells_;
+    /// The next position to dequeue from, on its own cache line.
+    alignas(64) std::atomic<std::size_t> head_{0};
+    /// The next position to enqueue to, on its own cache line.
+    alignas(64) std::atomic<std::size_t> tail_{0};
+};
+} // namespace amadeus
+
+#endif // !WEBSOCKET_SERVER_BOUNDED_QUEUE_HH
@@ -0,0 +1,89 @@
+#ifndef WEBSOCKET_SERVER_ENDIAN_HH
+#define WEBSOCKET_SERVER_ENDIAN_HH
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace amadeus {
+/// Whether the host stores integers little-endian.
+inline constexpr bool LittleEndianHost{
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) &&               \
+    __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    false
+#else
+    true
+#endif
+};
+
+namespace detail {
+template <typename T>
+struct is_byte_array : std::false_type
+{
+};
+
+template <std::size_t N>
+struct is_byte_array<std::array<std::uint8_t, N>> : std::true_type
+{
+};
+
+/// \brief Copies _size bytes in reverse order.
+inline void reverse_copy(void* _out, void const* _in,
+                         std::size_t _size) noexcept
+{
+    auto* out = static_cast<unsigned char*>(_out);
+    auto const* in = static_cast<unsigned char const*>(_in);
+    for (std::size_t i = 0; i < _size; ++i) {
+        out[i] = in[_size - 1 - i];
+    }
+}
+} // namespace detail
+
+/// \brief Returns whether T can be loaded and stored with \ref load_le and
+/// \ref store_le: arithmetic types, enums and byte arrays.
+template <typename T>
+inline constexpr bool is_wire_type_v =
+    std::is_arithmetic_v<T> || std::is_enum_v<T> ||
+    detail::is_byte_array<T>::value;
+
+/// \brief Loads a little-endian value from memory of any alignment. On a
+/// little-endian host, this is a single move.
+/// \tparam T An arithmetic type, an enum or a byte array.
+/// \param _data The first byte of the value.
+template <typename T>
+[[nodiscard]] T load_le(void const* _data) noexcept
+{
+    static_assert(is_wire_type_v<T>, "T needs to be a wire type.");
+
+    T value;
+    if constexpr (LittleEndianHost || sizeof(T) == 1 ||
+                  detail::is_byte_array<T>::value) {
+        std::memcpy(&value, _data, sizeof(T));
+    } else {
+        detail::reverse_copy(&value, _data, sizeof(T));
+    }
+    return value;
+}
+
+/// \brief Stores a value little-endian into memory of any alignment. On a
+/// little-endian host, this is a single move.
+/// \tparam T An arithmetic type, an enum or a byte array.
+/// \param _data The first byte of the value.
+/// \param _value The value.
+template <typename T>
+void store_le(void* _data, T const& _value) noexcept
+{
+    static_assert(is_wire_type_v<T>, "T needs to be a wire type.");
+
+    if constexpr (LittleEndianHost || sizeof(T) == 1 ||
+                  detail::is_byte_array<T>::value) {
+        std::memcpy(_data, &_value, sizeof(T));
+    } else {
+        detail::reverse_copy(_data, &_value, sizeof(T));
+    }
+}
+} // namespace amadeus
+
+#endif // !WEBSOCKET_SERVER_ENDIAN_HH
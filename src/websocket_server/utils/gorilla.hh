@@ -0,0 +1,378 @@
+#ifndef WEBSOCKET_SERVER_GORILLA_HH
+#define WEBSOCKET_SERVER_GORILLA_HH
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace amadeus {
+/// The scale of decimal readings, one decimal place.
+constexpr double DecimalScale{10.0};
+
+/// \brief Appends single bits and bit fields of up to 32 bits to a byte
+/// buffer, most significant bit first.
+class bit_writer final
+{
+    std::vector<std::uint8_t>& out_;
+    std::uint64_t acc_{0};
+    unsigned bits_{0};
+
+  public:
+    /// \brief Constructor.
+    /// \param _out The buffer to append to.
+    explicit bit_writer(std::vector<std::uint8_t>& _out) noexcept
+        : out_(_out)
+    {
+    }
+
+    /// \brief Appends the _count low bits of _value.
+    void write(std::uint32_t _value, unsigned _count)
+    {
+        acc_ = (acc_ << _count) |
+               (static_cast<std::uint64_t>(_value) & ((1ULL << _count) - 1));
+        bits_ += _count;
+        while (bits_ >= 8) {
+            bits_ -= 8;
+            out_.push_back(static_cast<std::uint8_t>(acc_ >> bits_));
+        }
+    }
+
+    /// \brief Pads the last byte with zero bits.
+    void flush()
+    {
+        if (bits_ > 0) {
+            out_.push_back(static_cast<std::uint8_t>(acc_ << (8 - bits_)));
+        }
+        acc_ = 0;
+        bits_ = 0;
+    }
+};
+
+/// \brief Reads bit fields written by a \ref bit_writer. Reading past the end
+/// yields zero bits.
+class bit_reader final
+{
+    std::uint8_t const* data_;
+    std::size_t size_;
+    std::size_t pos_{0};
+    std::uint64_t acc_{0};
+    unsigned bits_{0};
+
+  public:
+    /// \brief Constructor.
+    /// \param _data The buffer.
+    /// \param _size The size of the buffer.
+    bit_reader(std::uint8_t const* _data, std::size_t _size) noexcept
+        : data_(_data)
+        , size_(_size)
+    {
+    }
+
+    /// \brief Reads _count bits, _count must be in [1, 32].
+    std::uint32_t read(unsigned _count) noexcept
+    {
+        while (bits_ < _count) {
+            acc_ = (acc_ << 8) | (pos_ < size_ ? data_[pos_++] : 0U);
+            bits_ += 8;
+        }
+        bits_ -= _count;
+        return static_cast<std::uint32_t>((acc_ >> bits_) &
+                                          ((1ULL << _count) - 1));
+    }
+
+    /// \brief Reads a single bit.
+    bool readBit() noexcept
+    {
+        return read(1) != 0;
+    }
+};
+
+/// \brief Encodes monotonic unix timestamps as delta-of-deltas (Gorilla,
+/// Pelkonen et al. 2015). A station reporting at a fixed rate costs a single
+/// bit per timestamp:
+///
+/// '0'                 delta-of-delta is 0
+/// '10'   + 7 bits     in [-64, 63]
+/// '110'  + 9 bits     in [-256, 255]
+/// '1110' + 12 bits    in [-2048, 2047]
+/// '1111' + 32 bits    otherwise
+///
+/// The first timestamp is written as is.
+class timestamp_encoder final
+{
+    std::uint32_t prev_{0};
+    std::int64_t prevDelta_{0};
+    bool first_{true};
+
+  public:
+    /// \brief Encodes the next timestamp.
+    void encode(bit_writer& _out, std::uint32_t _time)
+    {
+        if (first_) {
+            _out.write(_time, 32);
+            prev_ = _time;
+            first_ = false;
+            return;
+        }
+
+        auto const delta = static_cast<std::int64_t>(_time) - prev_;
+        auto const dod = delta - prevDelta_;
+        prev_ = _time;
+        prevDelta_ = delta;
+
+        auto const bits = static_cast<std::uint32_t>(dod);
+        if (dod == 0) {
+            _out.write(0b0, 1);
+        } else if (dod >= -64 && dod <= 63) {
+            _out.write(0b10, 2);
+            _out.write(bits, 7);
+        } else if (dod >= -256 && dod <= 255) {
+            _out.write(0b110, 3);
+            _out.write(bits, 9);
+        } else if (dod >= -2048 && dod <= 2047) {
+            _out.write(0b1110, 4);
+            _out.write(bits, 12);
+        } else {
+            _out.write(0b1111, 4);
+            _out.write(bits, 32);
+        }
+    }
+};
+
+/// \brief Decodes the timestamps written by a \ref timestamp_encoder.
+class timestamp_decoder final
+{
+    std::uint32_t prev_{0};
+    std::int64_t prevDelta_{0};
+    bool first_{true};
+
+    /// \brief Sign-extends a _count bit two's complement value.
+    static std::int64_t signExtend(std::uint32_t _value, unsigned _count)
+    {
+        auto const shift = 64U - _count;
+        return static_cast<std::int64_t>(static_cast<std::uint64_t>(_value)
+                                         << shift) >>
+               shift;
+    }
+
+  public:
+    /// \brief Decodes the next timestamp.
+    std::uint32_t decode(bit_reader& _in) noexcept
+    {
+        if (first_) {
+            prev_ = _in.read(32);
+            first_ = false;
+            return prev_;
+        }
+
+        std::int64_t dod{0};
+        if (_in.readBit()) {
+            if (!_in.readBit()) {
+                dod = signExtend(_in.read(7), 7);
+            } else if (!_in.readBit()) {
+                dod = signExtend(_in.read(9), 9);
+            } else if (!_in.readBit()) {
+                dod = signExtend(_in.read(12), 12);
+            } else {
+                dod = signExtend(_in.read(32), 32);
+            }
+        }
+
+        prevDelta_ += dod;
+        prev_ = static_cast<std::uint32_t>(prev_ + prevDelta_);
+        return prev_;
+    }
+};
+
+/// \brief Returns the value scaled by \ref DecimalScale if the value is
+/// exactly the float nearest to a number with a single decimal place, which
+/// is the resolution of the sensors.
+inline bool toDecimal(float _value, std::int64_t& _scaled) noexcept
+{
+    constexpr double Limit{1 << 24};
+    auto const scaled = static_cast<double>(_value) * DecimalScale;
+    if (!(scaled > -Limit && scaled < Limit)) {
+        return false;
+    }
+    _scaled = std::llround(scaled);
+    auto const value = static_cast<float>(
+        static_cast<double>(_scaled) / DecimalScale);
+    std::uint32_t a;
+    std::uint32_t b;
+    std::memcpy(&a, &value, sizeof(a));
+    std::memcpy(&b, &_value, sizeof(b));
+    return a == b;
+}
+
+/// \brief Encodes a series of floats as the XOR with their predecessor
+/// (Gorilla). Repeated values cost a single bit, slowly changing values only
+/// their meaningful bits.
+/// Readings with a single decimal place (e.g. 21.3) are not exact in binary
+/// and their XOR has almost all mantissa bits set, so a change between two
+/// such values is stored as the difference of the values scaled by
+/// \ref DecimalScale instead, usually \f$\pm 1\f$:
+///
+/// '0'                                  same value
+/// '10'  + '0'  + 3 bits                decimal difference in [-4, 4]
+///       + '10' + 8 bits                in [-128, 128]
+///       + '11' + 32 bits               otherwise
+/// '110' + meaningful bits              XOR within the previous leading and
+///                                      trailing zeros
+/// '111' + 5 bits leading zeros
+///       + 5 bits meaningful bits - 1
+///       + meaningful bits
+///
+/// The differences are zigzag encoded minus one, as 0 is never stored. The
+/// first value is written as is.
+class float_encoder final
+{
+    std::uint32_t prev_{0};
+    std::int64_t prevScaled_{0};
+    bool prevDecimal_{false};
+    unsigned leading_{32};
+    unsigned trailing_{0};
+    bool first_{true};
+
+  public:
+    /// \brief Encodes the next value.
+    void encode(bit_writer& _out, float _value)
+    {
+        std::uint32_t bits;
+        std::memcpy(&bits, &_value, sizeof(bits));
+        std::int64_t scaled{0};
+        auto const decimal = toDecimal(_value, scaled);
+
+        auto const x = bits ^ prev_;
+        auto const prevScaled = prevScaled_;
+        auto const prevDecimal = prevDecimal_;
+        prev_ = bits;
+        prevScaled_ = scaled;
+        prevDecimal_ = decimal;
+
+        if (first_) {
+            _out.write(bits, 32);
+            first_ = false;
+            return;
+        }
+
+        if (x == 0) {
+            _out.write(0b0, 1);
+            return;
+        }
+
+        if (decimal && prevDecimal) {
+            auto const diff = scaled - prevScaled;
+            auto const zigzag =
+                static_cast<std::uint32_t>(
+                    (static_cast<std::uint64_t>(diff) << 1) ^
+                    static_cast<std::uint64_t>(diff >> 63)) -
+                1;
+            _out.write(0b10, 2);
+            if (zigzag < (1U << 3)) {
+                _out.write(0b0, 1);
+                _out.write(zigzag, 3);
+            } else if (zigzag < (1U << 8)) {
+                _out.write(0b10, 2);
+                _out.write(zigzag, 8);
+            } else {
+                _out.write(0b11, 2);
+                _out.write(zigzag, 32);
+            }
+            return;
+        }
+
+        auto const leading = static_cast<unsigned>(countLeadingZeros(x));
+        auto const trailing = static_cast<unsigned>(countTrailingZeros(x));
+        if (leading_ != 32 && leading >= leading_ && trailing >= trailing_) {
+            _out.write(0b110, 3);
+            _out.write(x >> trailing_, 32 - leading_ - trailing_);
+            return;
+        }
+
+        auto const meaningful = 32 - leading - trailing;
+        _out.write(0b111, 3);
+        _out.write(leading, 5);
+        _out.write(meaningful - 1, 5);
+        _out.write(x >> trailing, meaningful);
+        leading_ = leading;
+        trailing_ = trailing;
+    }
+
+  private:
+    static int countLeadingZeros(std::uint32_t _x) noexcept
+    {
+        int n{0};
+        for (std::uint32_t bit = 1U << 31; (_x & bit) == 0; bit >>= 1) {
+            ++n;
+        }
+        return n;
+    }
+
+    static int countTrailingZeros(std::uint32_t _x) noexcept
+    {
+        int n{0};
+        for (; (_x & 1U) == 0; _x >>= 1) {
+            ++n;
+        }
+        return n;
+    }
+};
+
+/// \brief Decodes the values written by a \ref float_encoder.
+class float_decoder final
+{
+    std::uint32_t prev_{0};
+    unsigned leading_{0};
+    unsigned trailing_{0};
+    bool first_{true};
+
+  public:
+    /// \brief Decodes the next value.
+    float decode(bit_reader& _in) noexcept
+    {
+        float value;
+        if (first_) {
+            prev_ = _in.read(32);
+            first_ = false;
+        } else if (!_in.readBit()) {
+            // same value
+        } else if (!_in.readBit()) {
+            std::uint32_t zigzag;
+            if (!_in.readBit()) {
+                zigzag = _in.read(3);
+            } else if (!_in.readBit()) {
+                zigzag = _in.read(8);
+            } else {
+                zigzag = _in.read(32);
+            }
+            auto const zz = zigzag + 1ULL;
+            auto const diff = (zz & 1U) != 0
+                                  ? -static_cast<std::int64_t>((zz + 1) >> 1)
+                                  : static_cast<std::int64_t>(zz >> 1);
+
+            // the encoder only writes differences between decimal values
+            std::memcpy(&value, &prev_, sizeof(value));
+            auto const scaled =
+                std::llround(static_cast<double>(value) * DecimalScale) + diff;
+            value = static_cast<float>(static_cast<double>(scaled) /
+                                       DecimalScale);
+            std::memcpy(&prev_, &value, sizeof(prev_));
+        } else {
+            if (_in.readBit()) {
+                leading_ = _in.read(5);
+                auto const meaningful = _in.read(5) + 1;
+                trailing_ = 32 - leading_ - meaningful;
+            }
+            auto const meaningful = 32 - leading_ - trailing_;
+            prev_ ^= _in.read(meaningful) << trailing_;
+        }
+
+        std::memcpy(&value, &prev_, sizeof(value));
+        return value;
+    }
+};
+} // namespace amadeus
+
+#endif // !WEBSOCKET_SERVER_GORILLA_HH
@@ -0,0 +1,56 @@
+#ifndef WEBSOCKET_SERVER_HEX_DUMP_HH
+#define WEBSOCKET_SERVER_HEX_DUMP_HH
+
+#include <fmt/format.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace amadeus {
+/// \brief A non-owning view of raw bytes which formats as a hex dump, e.g.
+/// "0x04 0x00 0x01". Only meant to be passed to LOG_TRACE, so that the bytes
+/// are only formatted if tracing is enabled.
+class hex_dump
+{
+  public:
+    /// \brief Constructor.
+    /// \param _data The first byte.
+    /// \param _size The number of bytes.
+    constexpr hex_dump(void const* _data, std::size_t _size) noexcept
+        : data_(static_cast<std::uint8_t const*>(_data))
+        , size_(_size)
+    {
+    }
+
+    [[nodiscard]] constexpr std::uint8_t const* begin() const noexcept
+    {
+        return data_;
+    }
+
+    [[nodiscard]] constexpr std::uint8_t const* end() const noexcept
+    {
+        return data_ + size_;
+    }
+
+  private:
+    std::uint8_t const* data_{};
+    std::size_t size_{};
+};
+} // namespace amadeus
+
+template <>
+struct fmt::formatter<amadeus::hex_dump>
+{
+    template <typename ParseContext>
+    constexpr auto parse(ParseContext& ctx)
+    {
+        return ctx.begin();
+    }
+
+    template <typename FormatContext>
+    auto format(amadeus::hex_dump const& dump, FormatContext& ctx)
+    {
+        return fmt::format_to(ctx.out(), "{:#04x}", fmt::join(dump, " "));
+    }
+};
+#endif // !WEBSOCKET_SERVER_HEX_DUMP_HH
@@ -0,0 +1,124 @@
+#ifndef WEBSOCKET_SERVER_RING_BUFFER_HH
+#define WEBSOCKET_SERVER_RING_BUFFER_HH
+
+#include <boost/asio/buffer.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+
+namespace amadeus {
+/// \brief A fixed-size byte ring buffer with a read and a write cursor. Bytes
+/// are never moved once written: consuming only advances the read cursor.
+/// The readable and the free bytes are each exposed as (at most) two
+/// regions, so that a read can scatter into both free regions at once.
+/// \remarks Not thread-safe.
+/* Example:
+ *
+ *  ring_buffer<4096> input;
+ *  auto const n = socket.read_some(input.prepare());
+ *  input.commit(n);
+ *  auto const first = input.data()[0]; // readable bytes up to the wrap
+ *  input.consume(first.size());
+ */
+template <std::size_t Capacity>
+class ring_buffer final
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity needs to be a power of two.");
+
+  public:
+    using const_buffers_type = std::array<boost::asio::const_buffer, 2>;
+    using mutable_buffers_type = std::array<boost::asio::mutable_buffer, 2>;
+
+    /// \brief Returns the number of readable bytes.
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return write_ - read_;
+    }
+
+    /// \brief Returns whether there are no readable bytes.
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return write_ == read_;
+    }
+
+    /// \brief Returns the capacity.
+    [[nodiscard]] static constexpr std::size_t capacity() noexcept
+    {
+        return Capacity;
+    }
+
+    /// \brief Returns the first readable byte. The buffer must not be empty.
+    [[nodiscard]] char front() const noexcept
+    {
+        return data_[read_ & Mask];
+    }
+
+    /// \brief Returns the readable bytes, the first region ends at the wrap.
+    [[nodiscard]] const_buffers_type data() const noexcept
+    {
+        auto const begin = read_ & Mask;
+        auto const first = std::min(size(), Capacity - begin);
+        return {boost::asio::const_buffer(data_.data() + begin, first),
+                boost::asio::const_buffer(data_.data(), size() - first)};
+    }
+
+    /// \brief Returns the free bytes, the first region ends at the wrap.
+    [[nodiscard]] mutable_buffers_type prepare() noexcept
+    {
+        auto const free = Capacity - size();
+        auto const begin = write_ & Mask;
+        auto const first = std::min(free, Capacity - begin);
+        return {boost::asio::mutable_buffer(data_.data() + begin, first),
+                boost::asio::mutable_buffer(data_.data(), free - first)};
+    }
+
+    /// \brief Makes _size bytes written to the free regions readable.
+    void commit(std::size_t _size) noexcept
+    {
+        write_ += _size;
+    }
+
+    /// \brief Discards the first _size readable bytes.
+    void consume(std::size_t _size) noexcept
+    {
+        read_ += _size;
+        // an empty buffer starts over, so the next read is contiguous
+        if (read_ == write_) {
+            read_ = write_ = 0;
+        }
+    }
+
+    /// \brief Returns the first _size readable bytes as a single region. Only
+    /// if they wrap around, they are copied into _staging.
+    /// \param _size The number of bytes, at most size().
+    /// \param _staging A buffer of at least _size bytes.
+    [[nodiscard]] boost::asio::const_buffer
+    linearize(std::size_t _size, void* _staging) const noexcept
+    {
+        auto const regions = data();
+        if (_size <= regions[0].size()) {
+            return boost::asio::const_buffer(regions[0].data(), _size);
+        }
+        auto* out = static_cast<char*>(_staging);
+        std::memcpy(out, regions[0].data(), regions[0].size());
+        std::memcpy(out + regions[0].size(), regions[1].data(),
+                    _size - regions[0].size());
+        return boost::asio::const_buffer(_staging, _size);
+    }
+
+  private:
+    static constexpr std::size_t Mask{Capacity - 1};
+
+    /// The storage.
+    std::array<char, Capacity> data_{};
+    /// The total number of bytes consumed.
+    std::size_t read_{0};
+    /// The total number of bytes committed.
+    std::size_t write_{0};
+};
+} // namespace amadeus
+
+#endif // !WEBSOCKET_SERVER_RING_BUFFER_HH
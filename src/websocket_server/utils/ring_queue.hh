@@ -0,0 +1,143 @@
+#ifndef WEBSOCKET_SERVER_RING_QUEUE_HH
+#define WEBSOCKET_SERVER_RING_QUEUE_HH
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace amadeus {
+/// \brief A FIFO queue in a ring of slots. The ring doubles once it is full
+/// and never shrinks, so a queue which stays below its high-water mark does
+/// not allocate. Unlike std::deque, popping and pushing in turn does not free
+/// and allocate blocks. The queued elements can be accessed by index, the
+/// oldest being 0.
+/// \remarks Not thread-safe.
+/// \tparam T The element type, must be default constructible and nothrow
+/// move assignable.
+/* Example:
+ *
+ *  ring_queue<std::string> q;
+ *  q.push_back("a");
+ *  q.push_back("b");
+ *  auto s = std::move(q.front());
+ *  q.pop_front(); // "b" is front() now
+ */
+template <typename T>
+class ring_queue final
+{
+    static_assert(std::is_nothrow_move_assignable_v<T>,
+                  "T needs to be nothrow move assignable.");
+
+  public:
+    /// \brief Constructor.
+    /// \param _capacity The initial capacity, rounded up to a power of two.
+    explicit ring_queue(std::size_t _capacity = 16)
+        : capacity_(roundUp(_capacity))
+        , slots_(std::make_unique<T[]>(capacity_))
+    {
+    }
+
+    ring_queue(ring_queue const&) = delete;
+    ring_queue& operator=(ring_queue const&) = delete;
+
+    /// \brief Returns the number of queued elements.
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return tail_ - head_;
+    }
+
+    /// \brief Returns whether no elements are queued.
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return tail_ == head_;
+    }
+
+    /// \brief Returns the number of elements which fit without growing.
+    [[nodiscard]] std::size_t capacity() const noexcept
+    {
+        return capacity_;
+    }
+
+    /// \brief Returns the oldest element. The queue must not be empty.
+    [[nodiscard]] T& front() noexcept
+    {
+        return slots_[head_ & (capacity_ - 1)];
+    }
+
+    /// \brief Returns the _index-th oldest element.
+    [[nodiscard]] T& operator[](std::size_t _index) noexcept
+    {
+        return slots_[(head_ + _index) & (capacity_ - 1)];
+    }
+
+    /// \brief Returns the _index-th oldest element.
+    [[nodiscard]] T const& operator[](std::size_t _index) const noexcept
+    {
+        return slots_[(head_ + _index) & (capacity_ - 1)];
+    }
+
+    /// \brief Appends an element, grows the ring if it is full.
+    void push_back(T _value)
+    {
+        if (size() == capacity_) {
+            grow();
+        }
+        slots_[tail_ & (capacity_ - 1)] = std::move(_value);
+        ++tail_;
+    }
+
+    /// \brief Removes the oldest element. The queue must not be empty. The
+    /// slot is reset, so that e.g. a shared_ptr does not keep its object
+    /// alive.
+    void pop_front() noexcept
+    {
+        front() = T{};
+        ++head_;
+    }
+
+    /// \brief Removes all elements.
+    void clear() noexcept
+    {
+        while (!empty()) {
+            pop_front();
+        }
+    }
+
+  private:
+    /// \brief Doubles the capacity and moves the elements to the front of
+    /// the new ring.
+    void grow()
+    {
+        auto slots = std::make_unique<T[]>(capacity_ * 2);
+        for (std::size_t i = 0; i < size(); ++i) {
+            slots[i] = std::move((*this)[i]);
+        }
+        tail_ = size();
+        head_ = 0;
+        capacity_ *= 2;
+        slots_ = std::move(slots);
+    }
+
+    /// \brief Rounds up to the next power of two.
+    static std::size_t roundUp(std::size_t _n) noexcept
+    {
+        std::size_t capacity{1};
+        while (capacity < _n) {
+            capacity <<= 1U;
+        }
+        return capacity;
+    }
+
+    /// The number of slots, a power of two.
+    std::size_t capacity_;
+    /// The slots.
+    std::unique_ptr<T[]> slots_;
+    /// The position of the oldest element.
+    std::size_t head_{0};
+    /// The position after the newest element.
+    std::size_t tail_{0};
+};
+} // namespace amadeus
+
+#endif // !WEBSOCKET_SERVER_RING_QUEUE_HH
@@ -0,0 +1,109 @@
+#ifndef WEBSOCKET_SERVER_SEQLOCK_HH
+#define WEBSOCKET_SERVER_SEQLOCK_HH
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+namespace amadeus {
+/// \brief A sequence lock around a small, trivially copyable value. Readers
+/// never block writers and never write to shared memory: they copy the value
+/// and retry if a writer was active in the meantime. Writers are serialized
+/// among each other by the sequence counter itself.
+/// The value is stored as an array of relaxed atomic words, so a torn read is
+/// well-defined and simply discarded.
+/// \remarks Thread-Safe. Intended for values that are written rarely and read
+/// often, e.g. the latest reading of a station.
+/* Example:
+ *
+ *  struct Point {
+ *      float x;
+ *      float y;
+ *  };
+ *
+ *  seqlock<Point> p;
+ *  p.store({1.0f, 2.0f});   // writer thread
+ *  auto const v = p.load(); // any reader thread
+ */
+template <typename T>
+class seqlock final
+{
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "T needs to be trivially copyable.");
+
+    using word_type = std::uint64_t;
+    static constexpr std::size_t Words{(sizeof(T) + sizeof(word_type) - 1) /
+                                       sizeof(word_type)};
+
+    /// The sequence counter, odd while a writer is active.
+    std::atomic<std::uint32_t> seq_{0};
+    /// The value.
+    std::array<std::atomic<word_type>, Words> data_{};
+
+  public:
+    seqlock() noexcept = default;
+    seqlock(seqlock const&) = delete;
+    seqlock& operator=(seqlock const&) = delete;
+
+    /// \brief Stores a new value.
+    void store(T const& _value) noexcept
+    {
+        std::array<word_type, Words> words{};
+        std::memcpy(words.data(), &_value, sizeof(T));
+
+        // acquire the write side by making the sequence odd
+        auto seq = seq_.load(std::memory_order_relaxed);
+        for (;;) {
+            if ((seq & 1U) == 0U &&
+                seq_.compare_exchange_weak(seq, seq + 1,
+                                           std::memory_order_acquire,
+                                           std::memory_order_relaxed)) {
+                break;
+            }
+            std::this_thread::yield();
+            seq = seq_.load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (std::size_t i = 0; i < Words; ++i) {
+            data_[i].store(words[i], std::memory_order_relaxed);
+        }
+
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    /// \brief Returns a consistent copy of the current value.
+    T load() const noexcept
+    {
+        std::array<word_type, Words> words{};
+
+        for (;;) {
+            auto const before = seq_.load(std::memory_order_acquire);
+            if ((before & 1U) != 0U) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            for (std::size_t i = 0; i < Words; ++i) {
+                words[i] = data_[i].load(std::memory_order_relaxed);
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq_.load(std::memory_order_relaxed) == before) {
+                break;
+            }
+        }
+
+        // T may have default member initializers; it is still trivially
+        // copyable, so copying its bytes is well-defined.
+        T value;
+        std::memcpy(static_cast<void*>(&value), words.data(), sizeof(T));
+        return value;
+    }
+};
+} // namespace amadeus
+
+#endif // !WEBSOCKET_SERVER_SEQLOCK_HH
@@ -0,0 +1,194 @@
+#ifndef WEBSOCKET_SERVER_SHARDED_MAP_HH
+#define WEBSOCKET_SERVER_SHARDED_MAP_HH
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace amadeus {
+/// \brief A hash map split into a fixed number of shards, each guarded by its
+/// own reader-writer lock. Lookups only take the shared lock of a single
+/// shard, so concurrent readers never serialize on a global mutex and writers
+/// only block readers of the same shard. Each shard lives on its own cache
+/// line to avoid false sharing between the shard locks.
+/// \remarks Thread-Safe. The values are never handed out by reference, the
+/// visitors are invoked with the shard lock held and must not call back into
+/// the same map.
+/// \tparam Key The key type.
+/// \tparam Value The mapped type.
+/// \tparam Hash The hash function for the key.
+/// \tparam ShardCount The number of shards, must be a power of two.
+template <typename Key, typename Value, typename Hash = std::hash<Key>,
+          std::size_t ShardCount = 16>
+class sharded_map final
+{
+    static_assert(ShardCount > 0 && (ShardCount & (ShardCount - 1)) == 0,
+                  "ShardCount must be a power of two.");
+    static_assert(ShardCount < 256, "ShardCount must fit into a byte.");
+
+    /// Batches up to this size are resolved without allocating.
+    static constexpr std::size_t InlineBatch{32};
+    /// Marks a key of a batch as resolved.
+    static constexpr std::uint8_t Done{0xFF};
+
+  public:
+    using key_type = Key;
+    using mapped_type = Value;
+
+    sharded_map() = default;
+    sharded_map(sharded_map const&) = delete;
+    sharded_map& operator=(sharded_map const&) = delete;
+
+    /// \brief Inserts the value if the key does not exist yet.
+    /// \returns true if the value was inserted.
+    bool try_emplace(Key _key, Value _value)
+    {
+        auto& s = shardFor(_key);
+        std::unique_lock<std::shared_mutex> lk(s.mtx);
+        return s.map.try_emplace(std::move(_key), std::move(_value)).second;
+    }
+
+    /// \brief Erases the given key.
+    /// \returns true if the key existed.
+    bool erase(Key const& _key)
+    {
+        auto& s = shardFor(_key);
+        std::unique_lock<std::shared_mutex> lk(s.mtx);
+        return s.map.erase(_key) != 0;
+    }
+
+    /// \brief Invokes _visitor with the value mapped to _key, if any.
+    /// \param _visitor A function object with the signature
+    /// void(Value const&).
+    /// \returns true if the key was found.
+    template <typename Visitor>
+    bool visit(Key const& _key, Visitor&& _visitor) const
+    {
+        auto const& s = shardFor(_key);
+        std::shared_lock<std::shared_mutex> lk(s.mtx);
+        if (auto const it = s.map.find(_key); it != std::end(s.map)) {
+            _visitor(it->second);
+            return true;
+        }
+        return false;
+    }
+
+    /// \brief Batched lookup. Resolves all keys in [_first, _last) and
+    /// invokes _visitor(index, value) for each key that was found, where
+    /// index is the position of the key in the range. Every shard is locked
+    /// at most once, no matter how many keys fall into it.
+    /// \param _visitor A function object with the signature
+    /// void(std::size_t, Value const&).
+    template <typename ForwardIt, typename Visitor>
+    void visit_many(ForwardIt _first, ForwardIt _last,
+                    Visitor&& _visitor) const
+    {
+        auto const count =
+            static_cast<std::size_t>(std::distance(_first, _last));
+
+        // The shard index of every key, small batches stay on the stack.
+        std::array<std::uint8_t, InlineBatch> inlineShards;
+        std::vector<std::uint8_t> heapShards;
+        std::uint8_t* shards = inlineShards.data();
+        if (count > InlineBatch) {
+            heapShards.resize(count);
+            shards = heapShards.data();
+        }
+
+        std::size_t index{};
+        for (auto it = _first; it != _last; ++it, ++index) {
+            shards[index] = static_cast<std::uint8_t>(shardIndex(*it));
+        }
+
+        auto it = _first;
+        for (std::size_t i = 0; i < count; ++i, ++it) {
+            if (shards[i] == Done) {
+                continue;
+            }
+            // resolve all remaining keys of this shard under a single lock
+            auto const current = shards[i];
+            auto const& s = shards_[current];
+            std::shared_lock<std::shared_mutex> lk(s.mtx);
+            auto jt = it;
+            for (std::size_t j = i; j < count; ++j, ++jt) {
+                if (shards[j] != current) {
+                    continue;
+                }
+                shards[j] = Done;
+                if (auto const found = s.map.find(*jt);
+                    found != std::end(s.map)) {
+                    _visitor(j, found->second);
+                }
+            }
+        }
+    }
+
+    /// \brief Invokes _visitor(key, value) for every entry. Shards are
+    /// locked one after another, the result is not an atomic snapshot of the
+    /// whole map.
+    /// \param _visitor A function object with the signature
+    /// void(Key const&, Value const&).
+    template <typename Visitor>
+    void for_each(Visitor&& _visitor) const
+    {
+        for (auto const& s : shards_) {
+            std::shared_lock<std::shared_mutex> lk(s.mtx);
+            for (auto const& [key, value] : s.map) {
+                _visitor(key, value);
+            }
+        }
+    }
+
+    /// \brief Returns the number of entries.
+    std::size_t size() const
+    {
+        std::size_t n{};
+        for (auto const& s : shards_) {
+            std::shared_lock<std::shared_mutex> lk(s.mtx);
+            n += s.map.size();
+        }
+        return n;
+    }
+
+  private:
+    /// \brief A single shard.
+    struct alignas(64) shard
+    {
+        mutable std::shared_mutex mtx;
+        std::unordered_map<Key, Value, Hash> map;
+    };
+
+    std::array<shard, ShardCount> shards_;
+    Hash hash_;
+
+    std::size_t shardIndex(Key const& _key) const
+    {
+        // Mix the hash a little, std::hash is the identity for integral
+        // types.
+        auto h = static_cast<std::size_t>(hash_(_key));
+        h ^= h >> 16;
+        h *= 0x45d9f3bU;
+        h ^= h >> 16;
+        return h & (ShardCount - 1);
+    }
+
+    shard& shardFor(Key const& _key)
+    {
+        return shards_[shardIndex(_key)];
+    }
+
+    shard const& shardFor(Key const& _key) const
+    {
+        return shards_[shardIndex(_key)];
+    }
+};
+} // namespace amadeus
+
+#endif // !WEBSOCKET_SERVER_SHARDED_MAP_HH
@@ -0,0 +1,273 @@
+#ifndef WEBSOCKET_SERVER_TIMING_WHEEL_HH
+#define WEBSOCKET_SERVER_TIMING_WHEEL_HH
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace amadeus {
+/// \brief A hierarchical hashed timing wheel with O(1) schedule and cancel.
+/// Timers are intrusive: the caller embeds a \ref timing_wheel::hook into its
+/// own timer object, the wheel only links and unlinks the hooks. Time is
+/// measured in abstract ticks, the owner of the wheel is responsible for
+/// mapping ticks to a clock and for calling \ref advance.
+///
+/// The wheel consists of 4 levels with 64 slots each. Level 0 has a
+/// granularity of 1 tick, level N a granularity of 64^N ticks. Whenever level
+/// 0 wraps around, the next slot of level 1 is cascaded down into level 0 (and
+/// so on). This covers delays of up to 64^4 - 1 ticks, longer delays are
+/// clamped.
+/// \remarks Not Thread-Safe.
+/* Example:
+ *
+ *  struct MyTimer : timing_wheel::hook {
+ *      int id;
+ *  };
+ *
+ *  timing_wheel wheel;
+ *  MyTimer t;
+ *  wheel.schedule(t, 10);
+ *  wheel.advance(wheel.now() + 10, [](timing_wheel::hook& h) {
+ *      auto& timer = static_cast<MyTimer&>(h);
+ *  });
+ */
+class timing_wheel final
+{
+  public:
+    using tick_type = std::uint64_t;
+
+    /// \brief The intrusive list hook which has to be embedded into a timer.
+    class hook
+    {
+        friend class timing_wheel;
+
+        hook* prev_{};
+        hook* next_{};
+        tick_type expiry_{};
+
+      public:
+        hook() = default;
+        hook(hook const&) = delete;
+        hook& operator=(hook const&) = delete;
+
+        /// \brief Returns true if the hook is currently scheduled.
+        [[nodiscard]] bool linked() const noexcept
+        {
+            return next_ != nullptr;
+        }
+
+        /// \brief Returns the tick at which the hook expires.
+        [[nodiscard]] tick_type expiry() const noexcept
+        {
+            return expiry_;
+        }
+    };
+
+    /// The number of bits per level.
+    static constexpr unsigned SlotBits{6U};
+    /// The number of slots per level.
+    static constexpr std::size_t Slots{std::size_t{1} << SlotBits};
+    /// The number of levels.
+    static constexpr unsigned Levels{4U};
+    /// The maximum delay in ticks.
+    static constexpr tick_type MaxDelay{(tick_type{1} << (SlotBits * Levels)) -
+                                        1};
+
+    timing_wheel() noexcept
+    {
+        for (auto& level : slots_) {
+            for (auto& head : level) {
+                head.prev_ = head.next_ = &head;
+            }
+        }
+    }
+
+    timing_wheel(timing_wheel const&) = delete;
+    timing_wheel& operator=(timing_wheel const&) = delete;
+
+    /// \brief Returns the next tick which will be processed by \ref advance.
+    [[nodiscard]] tick_type now() const noexcept
+    {
+        return current_;
+    }
+
+    /// \brief Returns the number of scheduled hooks.
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    /// \brief Returns true if no hook is scheduled.
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return size_ == 0;
+    }
+
+    /// \brief Schedules the given hook to expire in _delay ticks. A hook that
+    /// is already scheduled is rescheduled.
+    /// \param _hook The hook.
+    /// \param _delay The delay in ticks. A delay of 0 expires on the next
+    /// processed tick.
+    void schedule(hook& _hook, tick_type _delay) noexcept
+    {
+        if (_hook.linked()) {
+            unlink(_hook);
+        } else {
+            ++size_;
+        }
+        _hook.expiry_ = current_ + (_delay > MaxDelay ? MaxDelay : _delay);
+        add(_hook);
+    }
+
+    /// \brief Cancels the given hook. Does nothing if it is not scheduled.
+    /// \param _hook The hook.
+    /// \returns true if the hook was scheduled.
+    bool cancel(hook& _hook) noexcept
+    {
+        if (!_hook.linked()) {
+            return false;
+        }
+        unlink(_hook);
+        --size_;
+        return true;
+    }
+
+    /// \brief Unlinks all scheduled hooks and invokes _onClear for each one.
+    /// \param _onClear A function object with the signature void(hook&).
+    template <typename ClearHandler>
+    void clear(ClearHandler&& _onClear)
+    {
+        for (auto& level : slots_) {
+            for (auto& head : level) {
+                while (head.next_ != &head) {
+                    auto& h = *head.next_;
+                    unlink(h);
+                    --size_;
+                    _onClear(h);
+                }
+            }
+        }
+    }
+
+    /// \brief Processes all ticks up to and including _target and invokes
+    /// _onExpire for every expired hook. The hook is unlinked before the
+    /// callback is invoked, so the callback may reschedule it or schedule and
+    /// cancel any other hook.
+    /// \param _target The last tick to process.
+    /// \param _onExpire A function object with the signature void(hook&).
+    /// \returns The number of expired hooks.
+    template <typename ExpireHandler>
+    std::size_t advance(tick_type _target, ExpireHandler&& _onExpire)
+    {
+        std::size_t expired{};
+
+        while (current_ <= _target) {
+            auto const index = static_cast<std::size_t>(current_ & SlotMask);
+
+            // Level 0 wrapped around, cascade the higher levels down.
+            if (index == 0 && cascade(1) == 0 && cascade(2) == 0) {
+                cascade(3);
+            }
+            ++current_;
+
+            hook pending;
+            splice(slots_[0][index], pending);
+            while (pending.next_ != &pending) {
+                auto& h = *pending.next_;
+                unlink(h);
+                --size_;
+                ++expired;
+                _onExpire(h);
+            }
+        }
+
+        return expired;
+    }
+
+  private:
+    static constexpr tick_type SlotMask{Slots - 1};
+
+    /// The slots of each level. Each slot is the sentinel of a circular,
+    /// doubly linked list.
+    std::array<std::array<hook, Slots>, Levels> slots_;
+    /// The next tick to be processed.
+    tick_type current_{};
+    /// The number of scheduled hooks.
+    std::size_t size_{};
+
+    /// \brief Returns the slot index of _tick on the given level.
+    static constexpr std::size_t indexOf(tick_type _tick,
+                                         unsigned _level) noexcept
+    {
+        return static_cast<std::size_t>((_tick >> (SlotBits * _level)) &
+                                        SlotMask);
+    }
+
+    /// \brief Links the hook into the slot matching its expiry.
+    void add(hook& _hook) noexcept
+    {
+        auto const expiry = _hook.expiry_;
+        hook* head{};
+
+        if (expiry < current_) {
+            // Already due, expire on the next processed tick.
+            head = &slots_[0][indexOf(current_, 0)];
+        } else {
+            auto const delta = expiry - current_;
+            unsigned level{};
+            while (level + 1 < Levels &&
+                   delta >= (tick_type{1} << (SlotBits * (level + 1)))) {
+                ++level;
+            }
+            head = &slots_[level][indexOf(expiry, level)];
+        }
+
+        _hook.prev_ = head->prev_;
+        _hook.next_ = head;
+        head->prev_->next_ = &_hook;
+        head->prev_ = &_hook;
+    }
+
+    /// \brief Unlinks the hook from whatever list it is linked into.
+    static void unlink(hook& _hook) noexcept
+    {
+        _hook.prev_->next_ = _hook.next_;
+        _hook.next_->prev_ = _hook.prev_;
+        _hook.prev_ = _hook.next_ = nullptr;
+    }
+
+    /// \brief Moves the whole list of _from into the empty list _to.
+    static void splice(hook& _from, hook& _to) noexcept
+    {
+        if (_from.next_ == &_from) {
+            _to.prev_ = _to.next_ = &_to;
+            return;
+        }
+        _to.next_ = _from.next_;
+        _to.prev_ = _from.prev_;
+        _to.next_->prev_ = &_to;
+        _to.prev_->next_ = &_to;
+        _from.prev_ = _from.next_ = &_from;
+    }
+
+    /// \brief Re-distributes the current slot of the given level into the
+    /// lower levels.
+    /// \returns The index of the cascaded slot.
+    std::size_t cascade(unsigned _level) noexcept
+    {
+        auto const index = indexOf(current_, _level);
+
+        hook pending;
+        splice(slots_[_level][index], pending);
+        while (pending.next_ != &pending) {
+            auto& h = *pending.next_;
+            unlink(h);
+            add(h);
+        }
+
+        return index;
+    }
+};
+} // namespace amadeus
+
+#endif // !WEBSOCKET_SERVER_TIMING_WHEEL_HH
@@ -0,0 +1,27 @@
+#ifndef WEBSOCKET_SERVER_UUID_HASH_HH
+#define WEBSOCKET_SERVER_UUID_HASH_HH
+
+#include <boost/uuid/uuid.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace amadeus {
+/// \brief A cheap hash function for random (version 4) UUIDs. boost::hash
+/// combines the UUID byte by byte, which is needlessly slow for keys that are
+/// already uniformly distributed. This simply folds the two 64 bit halves.
+struct uuid_hash
+{
+    std::size_t operator()(boost::uuids::uuid const& _uuid) const noexcept
+    {
+        std::uint64_t lo{};
+        std::uint64_t hi{};
+        std::memcpy(&lo, _uuid.data, sizeof(lo));
+        std::memcpy(&hi, _uuid.data + sizeof(lo), sizeof(hi));
+        return static_cast<std::size_t>(lo ^ (hi * 0x9E3779B97F4A7C15ULL));
+    }
+};
+} // namespace amadeus
+
+#endif // !WEBSOCKET_SERVER_UUID_HASH_HH
@@ -0,0 +1,223 @@
+#ifndef WEBSOCKET_SERVER_WRITE_QUEUE_HH
+#define WEBSOCKET_SERVER_WRITE_QUEUE_HH
+
+#include <boost/asio/buffer.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace amadeus {
+/// \brief An outbound packet queue for a single stream. Packets are copied
+/// into fixed-size chunks while a write is outstanding. flush() hands all
+/// queued packets to a single gathered write and complete() notifies every
+/// packet's handler once that write finished. The chunks are reused, so a
+/// steady stream of packets does not allocate.
+/// \remarks Not thread-safe.
+/// \tparam ChunkSize The size of a chunk, the maximum size of a packet.
+/* Example:
+ *
+ *  write_queue<512> queue{64};
+ *  queue.push(&packet, sizeof(packet), [](std::size_t) { ... });
+ *  if (!queue.writing()) {
+ *      asio::async_write(stream, queue.flush(), [&](auto&& ec, auto&&) {
+ *          queue.complete();
+ *      });
+ *  }
+ */
+template <std::size_t ChunkSize>
+class write_queue final
+{
+    /// A chunk of packet bytes.
+    using chunk = std::array<char, ChunkSize>;
+
+    /// \brief A queued packet.
+    struct entry
+    {
+        /// The size of the packet.
+        std::size_t size;
+        /// Called with the size of the packet once it was written.
+        std::function<void(std::size_t)> handler;
+    };
+
+  public:
+    /// The type of the handler of a packet.
+    using handler_type = std::function<void(std::size_t)>;
+
+    /// \brief A ConstBufferSequence of the packets being written. It refers
+    /// to the queue and stays valid until complete() or clear() is called.
+    class buffers_type
+    {
+      public:
+        using value_type = boost::asio::const_buffer;
+        using const_iterator = value_type const*;
+
+        buffers_type(const_iterator _begin, const_iterator _end) noexcept
+            : begin_(_begin)
+            , end_(_end)
+        {
+        }
+
+        const_iterator begin() const noexcept
+        {
+            return begin_;
+        }
+
+        const_iterator end() const noexcept
+        {
+            return end_;
+        }
+
+      private:
+        const_iterator begin_;
+        const_iterator end_;
+    };
+
+    /// \brief Constructor.
+    /// \param _limit The maximum number of queued packets for push().
+    explicit write_queue(std::size_t _limit)
+        : limit_(_limit)
+    {
+    }
+
+    write_queue(write_queue const&) = delete;
+    write_queue& operator=(write_queue const&) = delete;
+
+    /// \brief Returns the number of queued packets which are not being
+    /// written yet.
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return queued_.size();
+    }
+
+    /// \brief Returns whether push() refuses further packets.
+    [[nodiscard]] bool full() const noexcept
+    {
+        return queued_.size() >= limit_;
+    }
+
+    /// \brief Returns whether packets are being written.
+    [[nodiscard]] bool writing() const noexcept
+    {
+        return !writing_.empty();
+    }
+
+    /// \brief Copies a packet into the queue.
+    /// \param _data The packet bytes.
+    /// \param _size The size of the packet, at most ChunkSize.
+    /// \param _handler Called with _size once the packet was written.
+    /// \return false if the queue is full, the packet is dropped then.
+    bool push(void const* _data, std::size_t _size, handler_type _handler)
+    {
+        if (full()) {
+            return false;
+        }
+        force_push(_data, _size, std::move(_handler));
+        return true;
+    }
+
+    /// \brief Copies a packet into the queue regardless of the limit, e.g. a
+    /// control packet the stream cannot do without. The caller must bound the
+    /// number of such packets itself.
+    /// \param _data The packet bytes.
+    /// \param _size The size of the packet, at most ChunkSize.
+    /// \param _handler Called with _size once the packet was written.
+    void force_push(void const* _data, std::size_t _size, handler_type _handler)
+    {
+        if (chunks_.empty() || used_ + _size > ChunkSize) {
+            chunks_.push_back(acquire());
+            used_ = 0;
+            buffers_.emplace_back(chunks_.back()->data(), 0);
+        }
+        std::memcpy(chunks_.back()->data() + used_, _data, _size);
+        used_ += _size;
+        buffers_.back() = boost::asio::const_buffer(chunks_.back()->data(),
+                                                    used_);
+        queued_.push_back(entry{_size, std::move(_handler)});
+    }
+
+    /// \brief Moves all queued packets into the write and returns their
+    /// bytes, one buffer per chunk. Must not be called while writing.
+    [[nodiscard]] buffers_type flush() noexcept
+    {
+        writing_.swap(queued_);
+        writingChunks_.swap(chunks_);
+        writingBuffers_.swap(buffers_);
+        used_ = 0;
+        return buffers_type{writingBuffers_.data(),
+                            writingBuffers_.data() + writingBuffers_.size()};
+    }
+
+    /// \brief Finishes the write: calls the handler of every written packet
+    /// in order. The handlers may queue new packets.
+    void complete()
+    {
+        for (auto& packet : writing_) {
+            packet.handler(packet.size);
+        }
+        release();
+    }
+
+    /// \brief Drops all packets without calling their handlers, e.g. after
+    /// the write failed.
+    void clear() noexcept
+    {
+        release();
+        queued_.clear();
+        for (auto& c : chunks_) {
+            free_.push_back(std::move(c));
+        }
+        chunks_.clear();
+        buffers_.clear();
+        used_ = 0;
+    }
+
+  private:
+    /// \brief Returns a free chunk.
+    std::unique_ptr<chunk> acquire()
+    {
+        if (free_.empty()) {
+            return std::make_unique<chunk>();
+        }
+        auto c = std::move(free_.back());
+        free_.pop_back();
+        return c;
+    }
+
+    /// \brief Forgets the written packets and reuses their chunks.
+    void release() noexcept
+    {
+        writing_.clear();
+        for (auto& c : writingChunks_) {
+            free_.push_back(std::move(c));
+        }
+        writingChunks_.clear();
+        writingBuffers_.clear();
+    }
+
+    /// The maximum number of queued packets for push().
+    std::size_t limit_;
+    /// The queued packets.
+    std::vector<entry> queued_;
+    /// The chunks of the queued packets.
+    std::vector<std::unique_ptr<chunk>> chunks_;
+    /// The used bytes of every chunk of the queued packets.
+    std::vector<boost::asio::const_buffer> buffers_;
+    /// The used bytes of the last chunk.
+    std::size_t used_{0};
+    /// The packets being written.
+    std::vector<entry> writing_;
+    /// The chunks of the packets being written.
+    std::vector<std::unique_ptr<chunk>> writingChunks_;
+    /// The used bytes of every chunk being written.
+    std::vector<boost::asio::const_buffer> writingBuffers_;
+    /// Chunks which can be reused.
+    std::vector<std::unique_ptr<chunk>> free_;
+};
+} // namespace amadeus
+
+#endif // !WEBSOCKET_SERVER_WRITE_QUEUE_HH
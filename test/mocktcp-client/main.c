@@ -1,4 +1,5 @@
 #include <errno.h>
+#include <math.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <sys/types.h>
@@ -28,7 +29,14 @@ typedef struct weather_status_request_packet
     uint8_t header;
     uint8_t uuid[16];
     uint8_t flag;
+    uint32_t request_id;
 } weather_status_request_packet_t;
+typedef struct stream_config_packet
+{
+    uint8_t header;
+    uint16_t interval;
+    float delta;
+} stream_config_packet_t;
 
 // out
 typedef struct pong_packet
@@ -43,7 +51,20 @@ typedef struct weather_status_response_packet
     float humidity;    // 0 - 100%
     uint32_t time;
     uint8_t flag;
+    uint32_t request_id;
 } weather_status_response_packet_t;
+typedef struct weather_reading
+{
+    float temperature; // -40 - 80°C
+    float humidity;    // 0 - 100%
+    uint32_t time;
+} weather_reading_t;
+typedef struct weather_status_batch_packet
+{
+    uint8_t header;
+    uint16_t count;
+    weather_reading_t readings[256];
+} weather_status_batch_packet_t;
 #pragma pack(pop)
 
 int input_timeout(int filedes, unsigned int seconds)
@@ -63,9 +84,22 @@ int input_timeout(int filedes, unsigned int seconds)
     return select(FD_SETSIZE, &set, NULL, NULL, &timeout);
 }
 
+// simulate a sensor read
+weather_reading_t read_sensor(void)
+{
+    weather_reading_t reading = {
+        .temperature = ((float)rand() / (float)(RAND_MAX)) * 70.f,
+        .humidity = ((float)rand() / (float)(RAND_MAX)) * 100.f,
+        .time = (uint32_t)time(NULL)};
+    return reading;
+}
+
+// usage: mocktcp-client <station_id> [batch_size]
+// With a batch size, a reading is taken every second and pushed in a
+// weather status batch packet once 'batch_size' readings were taken.
 int main(int argc, char* argv[])
 {
-    if (argc != 2) {
+    if (argc != 2 && argc != 3) {
         fprintf(stderr, "insufficient arguments.\n");
         return 1;
     }
@@ -73,6 +107,19 @@ int main(int argc, char* argv[])
     srand((unsigned int)time(NULL));
 
     uint8_t const station_id = (uint8_t)strtol(argv[1], NULL, 10);
+    long const batch_size = argc == 3 ? strtol(argv[2], NULL, 10) : 0;
+    if (batch_size < 0 || batch_size > 256) {
+        fprintf(stderr, "batch size must be within 0 - 256.\n");
+        return 1;
+    }
+
+    weather_status_batch_packet_t batch = {.header = 0x03, .count = 0};
+    int acked = 0;
+    // the stream config, readings are pushed every 'interval' seconds or on
+    // a change beyond 'delta'
+    stream_config_packet_t stream = {.header = 0x06};
+    weather_reading_t pushed = {0};
+    time_t last_push = 0;
 
     char buffer[64];
     int sockfd;
@@ -110,6 +157,41 @@ int main(int argc, char* argv[])
         // timeout
         if (result == 0) {
             printf("select() timeout.\n");
+            if (acked && (stream.interval > 0 || stream.delta > 0.f)) {
+                weather_reading_t const reading = read_sensor();
+                int const due =
+                    stream.interval > 0 &&
+                    time(NULL) - last_push >= (time_t)stream.interval;
+                int const changed =
+                    stream.delta > 0.f &&
+                    (fabsf(reading.temperature - pushed.temperature) >
+                         stream.delta ||
+                     fabsf(reading.humidity - pushed.humidity) > stream.delta);
+                if (due || changed) {
+                    weather_status_response_packet_t response = {
+                        .header = 0x02,
+                        .temperature = reading.temperature,
+                        .humidity = reading.humidity,
+                        .time = reading.time,
+                        .request_id = 0xffffffff};
+                    ssize_t const sent = send(
+                        sockfd, (const void*)&response, sizeof(response), 0);
+                    printf("pushed weather status packet %zd bytes.\n", sent);
+                    pushed = reading;
+                    last_push = time(NULL);
+                }
+            }
+            if (acked && batch_size > 0) {
+                batch.readings[batch.count++] = read_sensor();
+                if (batch.count == batch_size) {
+                    size_t const size =
+                        3 + batch.count * sizeof(weather_reading_t);
+                    ssize_t const sent =
+                        send(sockfd, (const void*)&batch, size, 0);
+                    printf("sent weather status batch %zd bytes.\n", sent);
+                    batch.count = 0;
+                }
+            }
             continue;
         }
 
@@ -140,6 +222,7 @@ int main(int argc, char* argv[])
             // ack
         case 0x01: {
             printf("handshake ack received\n");
+            acked = 1;
         } break;
             // nak
         case 0x02: {
@@ -152,6 +235,12 @@ int main(int argc, char* argv[])
             pong_packet_t packet = {.header = 0x01};
             bytes = send(sockfd, (const void*)&packet, sizeof(packet), 0);
             printf("sent pong packet %zu bytes.\n", bytes);
+        } break;
+            // stream config
+        case 0x06: {
+            memcpy(&stream, buffer, sizeof(stream));
+            printf("stream config received: interval %u delta %f\n",
+                   stream.interval, stream.delta);
         } break;
             // weather_status request
         case 0x04: {
@@ -172,13 +261,14 @@ int main(int argc, char* argv[])
             // sleep(1);
             usleep(100000);
             // send random data
-            float const temp = ((float)rand() / (float)(RAND_MAX)) * 70.f;
-            float const hum = ((float)rand() / (float)(RAND_MAX)) * 100.f;
-            weather_status_response_packet_t response = {.header = 0x02,
-                                                         .temperature = temp,
-                                                         .humidity = hum,
-                                                         .time = t,
-                                                         .flag = p.flag};
+            weather_reading_t const reading = read_sensor();
+            weather_status_response_packet_t response = {
+                .header = 0x02,
+                .temperature = reading.temperature,
+                .humidity = reading.humidity,
+                .time = t,
+                .flag = p.flag,
+                .request_id = p.request_id};
 
             // copy original uuid to response
             memcpy(response.uuid, p.uuid, 16);